@@ -0,0 +1,99 @@
+/*
+ **
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#define LOG_TAG "AllocationGuard"
+
+#include "AllocationGuard.h"
+#include <cutils/log.h>
+#include <pthread.h>
+#include <stdint.h>
+
+namespace android_audio_legacy{
+
+#ifdef DEBUG
+
+/** Depth of the forbidden scopes, per thread. */
+static pthread_key_t forbiddenDepthKey;
+
+static pthread_once_t forbiddenDepthKeyOnce = PTHREAD_ONCE_INIT;
+
+static void createForbiddenDepthKey()
+{
+    LOG_ALWAYS_FATAL_IF(pthread_key_create(&forbiddenDepthKey, NULL) != 0);
+}
+
+static intptr_t getForbiddenDepth()
+{
+    pthread_once(&forbiddenDepthKeyOnce, createForbiddenDepthKey);
+    return reinterpret_cast<intptr_t>(pthread_getspecific(forbiddenDepthKey));
+}
+
+static void setForbiddenDepth(intptr_t depth)
+{
+    pthread_setspecific(forbiddenDepthKey, reinterpret_cast<void *>(depth));
+}
+
+AllocationGuard::ForbiddenScope::ForbiddenScope(bool forbid) :
+    _forbid(forbid)
+{
+    if (_forbid) {
+
+        setForbiddenDepth(getForbiddenDepth() + 1);
+    }
+}
+
+AllocationGuard::ForbiddenScope::~ForbiddenScope()
+{
+    if (_forbid) {
+
+        setForbiddenDepth(getForbiddenDepth() - 1);
+    }
+}
+
+bool AllocationGuard::isAllocationForbidden()
+{
+    return getForbiddenDepth() != 0;
+}
+
+void AllocationGuard::checkAllocation(const char *context)
+{
+    LOG_ALWAYS_FATAL_IF(isAllocationForbidden(), "%s: allocation while forbidden", context);
+}
+
+#else
+
+AllocationGuard::ForbiddenScope::ForbiddenScope(bool forbid) :
+    _forbid(forbid)
+{
+}
+
+AllocationGuard::ForbiddenScope::~ForbiddenScope()
+{
+}
+
+bool AllocationGuard::isAllocationForbidden()
+{
+    return false;
+}
+
+void AllocationGuard::checkAllocation(const char * /*context*/)
+{
+}
+
+#endif
+
+}; // namespace android
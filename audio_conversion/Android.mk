@@ -28,12 +28,22 @@ LOCAL_PATH := $(call my-dir)
 # Common variables
 
 audio_conversion_src_files :=  \
+    AllocationGuard.cpp \
     AudioConversion.cpp \
+    AudioConversionBatch.cpp \
     AudioConverter.cpp \
+    AudioDitherer.cpp \
+    AudioFusedConverter.cpp \
     AudioReformatter.cpp \
     AudioRemapper.cpp \
     AudioResampler.cpp \
-    Resampler.cpp
+    AudioRingBuffer.cpp \
+    ConversionCostModel.cpp \
+    CpuFeatures.cpp \
+    IntegerRatioResampler.cpp \
+    PolyphaseResampler.cpp \
+    Resampler.cpp \
+    ScratchArena.cpp
 
 audio_conversion_includes_dir := \
     libaudioresample
@@ -64,6 +74,12 @@ audio_conversion_static_lib_target += \
 
 audio_conversion_cflags := -Wall -Werror
 
+# Allocation free checks of the conversion (see AllocationGuard.h) on host and eng builds
+audio_conversion_cflags_host := -DDEBUG
+ifeq ($(TARGET_BUILD_VARIANT),eng)
+audio_conversion_cflags_target := -DDEBUG
+endif
+
 #######################################################################
 # Build for libaudioconversion with and without gcov for host and target
 
@@ -74,7 +90,7 @@ $( \
     $(eval LOCAL_C_INCLUDES := $(audio_conversion_includes_common)) \
     $(eval LOCAL_C_INCLUDES += $(audio_conversion_includes_dir_$(1))) \
     $(eval LOCAL_SRC_FILES := $(audio_conversion_src_files)) \
-    $(eval LOCAL_CFLAGS := $(audio_conversion_cflags)) \
+    $(eval LOCAL_CFLAGS := $(audio_conversion_cflags) $(audio_conversion_cflags_$(1))) \
     $(eval LOCAL_STATIC_LIBRARIES := $(audio_conversion_static_lib_$(1))) \
     $(eval LOCAL_MODULE_TAGS := optional) \
 )
@@ -116,6 +132,48 @@ LOCAL_MODULE := libaudioconversion_static_host
 $(call make_audio_conversion_lib,host)
 include $(BUILD_HOST_STATIC_LIBRARY)
 
+# Host benchmark, linked with a stand-in of the resampler library instead of
+# libaudioresample so that it runs on any host
+include $(CLEAR_VARS)
+LOCAL_MODULE := audio_conversion_bench_host
+LOCAL_SRC_FILES := \
+    bench/AudioConversionBench.cpp \
+    bench/IaResamplerStandIn.cpp
+LOCAL_C_INCLUDES := $(audio_conversion_includes_common)
+LOCAL_C_INCLUDES += $(audio_conversion_includes_dir_host)
+LOCAL_CFLAGS := $(audio_conversion_cflags)
+LOCAL_STATIC_LIBRARIES := \
+    libaudioconversion_static_host \
+    libsamplespec_static_host \
+    libaudio_comms_convert_host \
+    libaudio_comms_utilities_host \
+    libcutils \
+    liblog
+LOCAL_LDLIBS := -lrt -lpthread
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_HOST_EXECUTABLE)
+
+# Host tests, resampling through the stand-in of the resampler library of the benchmark
+include $(CLEAR_VARS)
+LOCAL_MODULE := audio_conversion_test_host
+LOCAL_SRC_FILES := \
+    test/AudioConversionTest.cpp \
+    test/AudioRemapperTest.cpp \
+    bench/IaResamplerStandIn.cpp
+LOCAL_C_INCLUDES := $(audio_conversion_includes_common)
+LOCAL_C_INCLUDES += $(audio_conversion_includes_dir_host)
+LOCAL_CFLAGS := $(audio_conversion_cflags)
+LOCAL_STATIC_LIBRARIES := \
+    libaudioconversion_static_host \
+    libsamplespec_static_host \
+    libaudio_comms_convert_host \
+    libaudio_comms_utilities_host \
+    libcutils \
+    liblog
+LOCAL_LDLIBS := -lrt -lpthread
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_HOST_NATIVE_TEST)
+
 endif
 
 # Build for target (inconditionnal)
@@ -18,14 +18,18 @@
 #define LOG_TAG "AudioConversion"
 
 #include "AudioConversion.h"
+#include "AllocationGuard.h"
 #include "AudioConverter.h"
+#include "AudioDitherer.h"
+#include "AudioFusedConverter.h"
 #include "AudioReformatter.h"
 #include "AudioRemapper.h"
 #include "AudioResampler.h"
 #include "AudioUtils.h"
+#include "ConversionCostModel.h"
+#include "IntegerRatioResampler.h"
 #include <media/AudioBufferProvider.h>
 #include <cutils/log.h>
-#include <stdlib.h>
 
 using namespace android;
 using namespace std;
@@ -36,27 +40,76 @@ const uint32_t AudioConversion::MAX_RATE = 92000;
 
 const uint32_t AudioConversion::MIN_RATE = 8000;
 
-AudioConversion::AudioConversion() :
-    _convOutBufferIndex(0),
-    _convOutFrames(0),
-    _convOutBufferSizeInFrames(0),
-    _convOutBuffer(NULL)
+const size_t AudioConversion::MAX_CACHED_CHAINS = 4;
+
+/**
+ * Steps working on a single sample spec item.
+ */
+static const uint32_t REMAP_STEP = 1 << ChannelCountSampleSpecItem;
+static const uint32_t REFORMAT_STEP = 1 << FormatSampleSpecItem;
+static const uint32_t RESAMPLE_STEP = 1 << RateSampleSpecItem;
+
+const uint32_t AudioConversion::FUSED_STEP = REMAP_STEP | REFORMAT_STEP;
+
+const uint32_t AudioConversion::CANDIDATE_PLANS[][NbSampleSpecItems] = {
+
+    { REMAP_STEP | REFORMAT_STEP, RESAMPLE_STEP, 0 },
+    { RESAMPLE_STEP, REMAP_STEP | REFORMAT_STEP, 0 },
+    { REMAP_STEP, REFORMAT_STEP, RESAMPLE_STEP },
+    { REMAP_STEP, RESAMPLE_STEP, REFORMAT_STEP },
+    { REFORMAT_STEP, REMAP_STEP, RESAMPLE_STEP },
+    { REFORMAT_STEP, RESAMPLE_STEP, REMAP_STEP },
+    { RESAMPLE_STEP, REMAP_STEP, REFORMAT_STEP },
+    { RESAMPLE_STEP, REFORMAT_STEP, REMAP_STEP }
+};
+
+const size_t AudioConversion::NB_CANDIDATE_PLANS =
+        sizeof(CANDIDATE_PLANS) / sizeof(CANDIDATE_PLANS[0]);
+
+AudioConversion::ConversionChain::ConversionChain() :
+    _configured(false),
+    _dithering(false),
+    _resamplingQuality(MediumResamplingQuality)
 {
     _audioConverter[ChannelCountSampleSpecItem] = new AudioRemapper(ChannelCountSampleSpecItem);
     _audioConverter[FormatSampleSpecItem] = new AudioReformatter(FormatSampleSpecItem);
     _audioConverter[RateSampleSpecItem] = new AudioResampler(RateSampleSpecItem);
+    _fusedConverter = new AudioFusedConverter();
+    _ditherer = new AudioDitherer(FormatSampleSpecItem);
 }
 
-AudioConversion::~AudioConversion()
+AudioConversion::ConversionChain::~ConversionChain()
 {
     for (int i = 0; i < NbSampleSpecItems; i++) {
 
         delete _audioConverter[i];
         _audioConverter[i] = NULL;
     }
+    delete _fusedConverter;
+    _fusedConverter = NULL;
+    delete _ditherer;
+    _ditherer = NULL;
+}
+
+AudioConversion::AudioConversion() :
+    _activeChain(NULL),
+    _chainCacheHits(0),
+    _chainCacheMisses(0),
+    _reservedFrames(0),
+    _dithering(true),
+    _resamplingQuality(MediumResamplingQuality)
+{
+}
 
-    free(_convOutBuffer);
-    _convOutBuffer = NULL;
+AudioConversion::~AudioConversion()
+{
+    ConversionChainListIterator it;
+    for (it = _chainCache.begin(); it != _chainCache.end(); ++it) {
+
+        delete *it;
+    }
+    _chainCache.clear();
+    _activeChain = NULL;
 }
 
 status_t AudioConversion::configure(const SampleSpec &ssSrc, const SampleSpec &ssDst)
@@ -65,36 +118,289 @@ status_t AudioConversion::configure(const SampleSpec &ssSrc, const SampleSpec &s
 
     emptyConversionChain();
 
-    free(_convOutBuffer);
-
-    _convOutBuffer = NULL;
-    _convOutBufferIndex = 0;
-    _convOutFrames = 0;
-    _convOutBufferSizeInFrames = 0;
-
     _ssSrc = ssSrc;
     _ssDst = ssDst;
 
-    if (ssSrc == ssDst) {
+    // Converted buffer only keeps the frames converted beyond a request, sized for the worst case
+    ret = _convOutBuffer.allocate((MAX_RATE / MIN_RATE) * 2, ssDst.getFrameSize());
+    if (ret != NO_ERROR) {
+
+        return ret;
+    }
+
+    if (ssSrc.isCompatible(ssDst)) {
 
         LOGD("%s: no convertion required", __FUNCTION__);
         return ret;
     }
 
+    _activeChain = getCachedChain(ssSrc, ssDst);
+    if (_activeChain->_configured) {
+
+        // Chain already configured for these sample specifications, its converters restart from
+        // silence as for a new stream
+        AudioConverterListIterator it;
+        for (it = _activeChain->_audioConvList.begin(); it != _activeChain->_audioConvList.end();
+             ++it) {
+
+            (*it)->reset();
+        }
+        return reserveChainBuffers();
+    }
+
+    // Cheapest plan first, the next ones are fallbacks if a converter does not support its step
+    Plan plans[NB_CANDIDATE_PLANS];
+    size_t planCount = listPlans(ssSrc, ssDst, plans);
+    ret = INVALID_OPERATION;
+    for (size_t i = 0; i < planCount; i++) {
+
+        ret = configurePlan(plans[i], ssSrc, ssDst);
+        if (ret == NO_ERROR) {
+
+            LOGD("%s: plan %d of %d, %d steps, %.0f ns per second", __FUNCTION__,
+                 static_cast<int>(i), static_cast<int>(planCount),
+                 static_cast<int>(plans[i].stepCount), plans[i].cost);
+            _activeChain->_plan = plans[i];
+            _activeChain->_configured = true;
+            return reserveChainBuffers();
+        }
+        _activeChain->_audioConvList.clear();
+    }
+    emptyConversionChain();
+    return ret;
+}
+
+void AudioConversion::calibrate()
+{
+    ConversionCostModel::calibrate();
+}
+
+AudioConversion::Plan AudioConversion::getPlan() const
+{
+    return isConversionChainEmpty() ? Plan() : _activeChain->_plan;
+}
+
+size_t AudioConversion::getDelayFrames() const
+{
+    size_t delayFrames = _convOutBuffer.getAvailableFrames();
+
+    if (isConversionChainEmpty()) {
+
+        return delayFrames;
+    }
+    AudioConverterListConstIterator it;
+    for (it = _activeChain->_audioConvList.begin(); it != _activeChain->_audioConvList.end();
+         ++it) {
+
+        const AudioConverter *conv = *it;
+        delayFrames += AudioUtils::convertSrcToDstInFrames(conv->getDelayFrames(),
+                                                           conv->getDstSampleSpec(),
+                                                           _ssDst);
+    }
+    return delayFrames;
+}
+
+size_t AudioConversion::listPlans(const SampleSpec &ssSrc, const SampleSpec &ssDst,
+                                  Plan *plans) const
+{
+    size_t planCount = 0;
+
+    for (size_t candidate = 0; candidate < NB_CANDIDATE_PLANS; candidate++) {
+
+        Plan plan;
+        SampleSpec tmpSsSrc = ssSrc;
+        bool supported = true;
+
+        for (size_t i = 0; i < NbSampleSpecItems && CANDIDATE_PLANS[candidate][i] != 0; i++) {
+
+            uint32_t step = CANDIDATE_PLANS[candidate][i];
+            uint32_t differentItems = 0;
+            for (int item = 0; item < NbSampleSpecItems; item++) {
+
+                if ((step & (1 << item)) && !SampleSpec::isSampleSpecItemEqual(
+                        static_cast<SampleSpecItem>(item), tmpSsSrc, ssDst)) {
+
+                    differentItems |= 1 << item;
+                }
+            }
+            if (differentItems == 0) {
+
+                // Nothing to convert
+                continue;
+            }
+            SampleSpec tmpSsDst = getStepDstSampleSpec(step, tmpSsSrc, ssDst);
+            float cost = getStepCost(step, tmpSsSrc, tmpSsDst);
+            if (differentItems != step || cost < 0) {
+
+                // Fused step converts both items, the single item steps handle the others
+                supported = false;
+                break;
+            }
+            plan.steps[plan.stepCount++] = step;
+            plan.cost += cost;
+            tmpSsSrc = tmpSsDst;
+        }
+        if (!supported) {
+
+            continue;
+        }
+
+        // Insertion by cost, unless the same steps are already listed
+        size_t position = planCount;
+        bool listed = false;
+        for (size_t i = 0; i < planCount && !listed; i++) {
+
+            listed = plans[i].stepCount == plan.stepCount &&
+                    memcmp(plans[i].steps, plan.steps, plan.stepCount * sizeof(uint32_t)) == 0;
+            if (position == planCount && plan.cost < plans[i].cost) {
+
+                position = i;
+            }
+        }
+        if (listed) {
+
+            continue;
+        }
+        for (size_t i = planCount; i > position; i--) {
+
+            plans[i] = plans[i - 1];
+        }
+        plans[position] = plan;
+        planCount++;
+    }
+    return planCount;
+}
+
+float AudioConversion::getStepCost(uint32_t step, const SampleSpec &ssSrc,
+                                   const SampleSpec &ssDst) const
+{
+    ConversionCostModel::Stage stage;
+    bool dithered = _dithering && AudioDitherer::reducesBitDepth(ssSrc, ssDst);
+
+    if (step == FUSED_STEP) {
+
+        if (dithered) {
+
+            // Fused kernels round the samples
+            return -1;
+        }
+        stage = ConversionCostModel::FusedStage;
+    } else if (step == REMAP_STEP) {
+
+        stage = ConversionCostModel::RemapStage;
+    } else if (step == REFORMAT_STEP) {
+
+        stage = dithered ? ConversionCostModel::DitherStage : ConversionCostModel::ReformatStage;
+    } else if (step == RESAMPLE_STEP) {
+
+        stage = IntegerRatioResampler::supportsConversion(ssSrc, ssDst) ?
+                    ConversionCostModel::FixedResampleStage :
+                    ConversionCostModel::FloatResampleStage;
+    } else {
+
+        return -1;
+    }
+    return ConversionCostModel::getStepCost(stage, ssSrc, ssDst);
+}
+
+status_t AudioConversion::configurePlan(const Plan &plan,
+                                        const SampleSpec &ssSrc,
+                                        const SampleSpec &ssDst)
+{
     SampleSpec tmpSsSrc = ssSrc;
 
-    // Start by adding the remapper, it will add consequently the reformatter and resampler
-    // This function may alter the source sample spec
-    ret = configureAndAddConverter(ChannelCountSampleSpecItem, &tmpSsSrc, &ssDst);
-    if (ret != NO_ERROR) {
+    // Each converter alters the temporary source sample spec
+    for (size_t i = 0; i < plan.stepCount; i++) {
 
-        return ret;
+        status_t ret = doConfigureAndAddConverter(plan.steps[i], &tmpSsSrc, &ssDst);
+        if (ret != NO_ERROR) {
+
+            return ret;
+        }
     }
 
-    // Assert the temporary sample spec equals the destination sample spec
-    LOG_ALWAYS_FATAL_IF(tmpSsSrc != ssDst);
+    // Assert the temporary sample spec is compatible with the destination sample spec
+    LOG_ALWAYS_FATAL_IF(!tmpSsSrc.isCompatible(ssDst));
 
-    return ret;
+    return NO_ERROR;
+}
+
+status_t AudioConversion::reserve(size_t maxFrames)
+{
+    _reservedFrames = maxFrames;
+    return reserveChainBuffers();
+}
+
+status_t AudioConversion::reserveChainBuffers()
+{
+    if (_reservedFrames == 0 || isConversionChainEmpty()) {
+
+        return NO_ERROR;
+    }
+    status_t status = allocateScratchBuffers(_reservedFrames);
+    if (status != NO_ERROR) {
+
+        return status;
+    }
+
+    // Each converter reserves for the frames it receives from the previous one
+    size_t frames = _reservedFrames;
+    AudioConverterListIterator it;
+    for (it = _activeChain->_audioConvList.begin(); it != _activeChain->_audioConvList.end();
+         ++it) {
+
+        AudioConverter *audioConverter = *it;
+        status = audioConverter->reserve(frames);
+        if (status != NO_ERROR) {
+
+            LOGE("%s: cannot reserve %d frames", __FUNCTION__, static_cast<int>(frames));
+            return status;
+        }
+        frames = AudioUtils::convertSrcToDstInFrames(frames, audioConverter->getSrcSampleSpec(),
+                                                     audioConverter->getDstSampleSpec());
+    }
+    return NO_ERROR;
+}
+
+AudioConversion::ConversionChain *AudioConversion::getCachedChain(const SampleSpec &ssSrc,
+                                                                   const SampleSpec &ssDst)
+{
+    ConversionChainListIterator it;
+    for (it = _chainCache.begin(); it != _chainCache.end(); ++it) {
+
+        ConversionChain *chain = *it;
+        if (chain->_ssSrc == ssSrc && chain->_ssDst == ssDst &&
+            chain->_dithering == _dithering &&
+            chain->_resamplingQuality == _resamplingQuality) {
+
+            // Most recently used first, relinking does not allocate
+            _chainCache.splice(_chainCache.begin(), _chainCache, it);
+            _chainCacheHits++;
+            return chain;
+        }
+    }
+    _chainCacheMisses++;
+
+    if (_chainCache.size() < MAX_CACHED_CHAINS) {
+
+        _chainCache.push_front(new ConversionChain());
+    } else {
+
+        // Recycle the least recently used chain
+        it = _chainCache.end();
+        _chainCache.splice(_chainCache.begin(), _chainCache, --it);
+    }
+    ConversionChain *chain = _chainCache.front();
+    chain->_ssSrc = ssSrc;
+    chain->_ssDst = ssDst;
+    chain->_dithering = _dithering;
+    chain->_resamplingQuality = _resamplingQuality;
+    // Quality levels of the conversion are the ones of the polyphase resampler
+    static_cast<AudioResampler *>(chain->_audioConverter[RateSampleSpecItem])->setQuality(
+        static_cast<PolyphaseResampler::Quality>(_resamplingQuality));
+    chain->_configured = false;
+    chain->_audioConvList.clear();
+    return chain;
 }
 
 status_t AudioConversion::getConvertedBuffer(void *dst,
@@ -106,42 +412,24 @@ status_t AudioConversion::getConvertedBuffer(void *dst,
 
     status_t status = NO_ERROR;
 
-    if (_activeAudioConvList.empty()) {
+    if (isConversionChainEmpty()) {
 
         LOGE("%s: conversion called with empty converter list", __FUNCTION__);
         return NO_INIT;
     }
 
-    //
-    // Realloc the Output of the conversion if required (with margin of the worst case)
-    //
-    if (_convOutBufferSizeInFrames < outFrames) {
-
-        _convOutBufferSizeInFrames = outFrames + (MAX_RATE / MIN_RATE) * 2;
-        _convOutBuffer = static_cast<int16_t *>(realloc(_convOutBuffer,
-                                _ssDst.convertFramesToBytes(_convOutBufferSizeInFrames)));
-    }
-
-    size_t framesRequested = outFrames;
+    char *dstBytes = static_cast<char *>(dst);
 
     //
     // Frames are already available from the ConvOutBuffer, empty it first!
     //
-    if (_convOutFrames) {
-
-        size_t frameToCopy = min(framesRequested, _convOutFrames);
-        framesRequested -= frameToCopy;
-        _convOutBufferIndex += _ssDst.convertFramesToBytes(frameToCopy);
-    }
+    size_t framesRequested = outFrames - _convOutBuffer.read(dstBytes, outFrames);
 
     //
-    // Frames still needed? (_pConvOutBuffer emptied!)
+    // Frames still needed? (_convOutBuffer emptied!)
     //
     while (framesRequested != 0) {
 
-        //
-        // Outputs in the convOutBuffer
-        //
         AudioBufferProvider::Buffer &buffer(_convInBuffer);
 
         // Calculate the frames we need to get from buffer provider
@@ -159,50 +447,72 @@ status_t AudioConversion::getConvertedBuffer(void *dst,
         }
 
         //
-        // Convert
+        // Convert within the scratch buffers
         //
-        size_t convertedFrames;
-        char *convBuf = reinterpret_cast<char *>(_convOutBuffer) + _convOutBufferIndex;
-        status = convert(buffer.raw, reinterpret_cast<void **>(&convBuf),
-                         buffer.frameCount, &convertedFrames);
+        uint32_t convertedFrames;
+        void *convBuf = NULL;
+        status = convert(buffer.raw, &convBuf, buffer.frameCount, &convertedFrames);
         if (status != NO_ERROR) {
 
             bufferProvider->releaseBuffer(&buffer);
             return status;
         }
 
-        _convOutFrames += convertedFrames;
-        _convOutBufferIndex += _ssDst.convertFramesToBytes(convertedFrames);
-
-        size_t framesToCopy = min(framesRequested, convertedFrames);
+        //
+        // Copy the requested frames to the destination, keep the remaining frames
+        // for next call
+        //
+        size_t framesToCopy = min(framesRequested, static_cast<size_t>(convertedFrames));
+        memcpy(dstBytes + _ssDst.convertFramesToBytes(outFrames - framesRequested),
+               convBuf, _ssDst.convertFramesToBytes(framesToCopy));
         framesRequested -= framesToCopy;
 
+        status = pushRemainingFrames(static_cast<char *>(convBuf) +
+                                     _ssDst.convertFramesToBytes(framesToCopy),
+                                     convertedFrames - framesToCopy);
+
         //
         // Release the buffer
         //
         bufferProvider->releaseBuffer(&buffer);
+
+        if (status != NO_ERROR) {
+
+            return status;
+        }
     }
 
-    //
-    // Copy requested outFrames from the output buffer of the conversion.
-    // Move the remaining frames to the beginning of the convOut buffer
-    //
-    memcpy(dst, _convOutBuffer, _ssDst.convertFramesToBytes(outFrames));
-    _convOutFrames -= outFrames;
+    return NO_ERROR;
+}
 
-    //
-    // Move the remaining frames to the beginning of the convOut buffer
-    //
-    if (_convOutFrames) {
+status_t AudioConversion::pushRemainingFrames(const void *src, size_t frames)
+{
+    if (frames > _convOutBuffer.getFreeFrames()) {
 
-        memmove(_convOutBuffer,
-                reinterpret_cast<char *>(_convOutBuffer) + _ssDst.convertFramesToBytes(outFrames),
-                _ssDst.convertFramesToBytes(_convOutFrames));
-    }
+        // Conversion produced more frames than the worst case, resize keeping the frames
+        LOGW("%s: %d frames do not fit in converted buffer", __FUNCTION__,
+             static_cast<int>(frames));
+        AllocationGuard::checkAllocation(__FUNCTION__);
+        size_t remainingFrames = _convOutBuffer.getAvailableFrames();
+        char *remaining = new char[_ssDst.convertFramesToBytes(remainingFrames)];
+        if (!remaining) {
 
-    // Reset buffer Index
-    _convOutBufferIndex = 0;
+            return NO_MEMORY;
+        }
+        _convOutBuffer.read(remaining, remainingFrames);
+        status_t status = _convOutBuffer.allocate(remainingFrames + frames,
+                                                  _ssDst.getFrameSize());
+        if (status == NO_ERROR) {
 
+            _convOutBuffer.write(remaining, remainingFrames);
+        }
+        delete []remaining;
+        if (status != NO_ERROR) {
+
+            return status;
+        }
+    }
+    _convOutBuffer.write(src, frames);
     return NO_ERROR;
 }
 
@@ -211,13 +521,7 @@ status_t AudioConversion::convert(const void *src,
                                   const uint32_t inFrames,
                                   uint32_t *outFrames)
 {
-    const void *srcBuf = src;
-    void *dstBuf = NULL;
-    size_t srcFrames = inFrames;
-    size_t dstFrames = 0;
-    status_t status = NO_ERROR;
-
-    if (_activeAudioConvList.empty()) {
+    if (isConversionChainEmpty()) {
 
         // Empty converter list -> No need for convertion
         // Copy the input on the ouput if provided by the client
@@ -234,17 +538,69 @@ status_t AudioConversion::convert(const void *src,
         return NO_ERROR;
     }
 
+    if (_reservedFrames != 0 && inFrames > _reservedFrames) {
+
+        // Longer transfer than planned, the buffers grow before the allocation free section
+        LOGW("%s: %d frames exceed the %d frames reserved, reserving again", __FUNCTION__,
+             inFrames, static_cast<int>(_reservedFrames));
+        status_t status = reserve(inFrames);
+        if (status != NO_ERROR) {
+
+            return status;
+        }
+    }
+
+    // Once reserved, the whole chain must run without any allocation
+    AllocationGuard::ForbiddenScope allocationScope(_reservedFrames != 0);
+
+    status_t status = allocateScratchBuffers(inFrames);
+    if (status != NO_ERROR) {
+
+        return status;
+    }
+    return convertChain(src, dst, inFrames, outFrames, _scratch);
+}
+
+status_t AudioConversion::convertChain(const void *src,
+                                       void **dst,
+                                       const uint32_t inFrames,
+                                       uint32_t *outFrames,
+                                       const ScratchArena &scratch)
+{
+    const void *srcBuf = src;
+    void *dstBuf = NULL;
+    size_t srcFrames = inFrames;
+    size_t dstFrames = 0;
+    status_t status = NO_ERROR;
+
+    // Index of the scratch buffer holding the source of the converter, none for the input
+    int srcScratch = -1;
+
+    AudioConverterList &audioConvList = _activeChain->_audioConvList;
     AudioConverterListIterator it;
-    for (it = _activeAudioConvList.begin(); it != _activeAudioConvList.end(); ++it) {
+    for (it = audioConvList.begin(); it != audioConvList.end(); ++it) {
 
         AudioConverter *pConv = *it;
-        dstBuf = NULL;
+        int dstScratch;
         dstFrames = 0;
 
-        if (*dst && (pConv == _activeAudioConvList.back())) {
+        if (*dst && (pConv == audioConvList.back())) {
 
             // Last converter must output within the provided buffer (if provided!!!)
+            dstScratch = -1;
             dstBuf = *dst;
+        } else if (srcScratch >= 0 && pConv->supportsInPlace()) {
+
+            // Never converts in place within the input buffer of the client
+            dstScratch = srcScratch;
+        } else {
+
+            // Ping-pong between the scratch buffers
+            dstScratch = (srcScratch == 0) ? 1 : 0;
+        }
+        if (dstScratch >= 0) {
+
+            dstBuf = scratch.getBuffer(dstScratch);
         }
         status = pConv->convert(srcBuf, &dstBuf, srcFrames, &dstFrames);
         if (status != NO_ERROR) {
@@ -253,6 +609,7 @@ status_t AudioConversion::convert(const void *src,
         }
         srcBuf = dstBuf;
         srcFrames = dstFrames;
+        srcScratch = dstScratch;
     }
     *dst = dstBuf;
     *outFrames = dstFrames;
@@ -260,69 +617,110 @@ status_t AudioConversion::convert(const void *src,
     return status;
 }
 
-void AudioConversion::emptyConversionChain()
+size_t AudioConversion::getScratchBufferSize(uint32_t inFrames) const
 {
-    _activeAudioConvList.clear();
+    size_t frames = inFrames;
+    size_t bytes = 0;
+
+    // Scratch buffers must fit the largest output of the chain
+    const AudioConverterList &audioConvList = _activeChain->_audioConvList;
+    AudioConverterListConstIterator it;
+    for (it = audioConvList.begin(); it != audioConvList.end(); ++it) {
+
+        const SampleSpec &ssConvDst = (*it)->getDstSampleSpec();
+        frames = AudioUtils::convertSrcToDstInFrames(frames, (*it)->getSrcSampleSpec(), ssConvDst);
+
+        // Allocate one more frame for resampler
+        bytes = max(bytes, ssConvDst.convertFramesToBytes(frames + 1));
+    }
+    return bytes;
 }
 
-status_t AudioConversion::doConfigureAndAddConverter(SampleSpecItem sampleSpecItem,
-                                                     SampleSpec *ssSrc,
-                                                     const SampleSpec *ssDst)
+status_t AudioConversion::allocateScratchBuffers(uint32_t inFrames)
 {
-    LOG_ALWAYS_FATAL_IF(sampleSpecItem >= NbSampleSpecItems);
-
-    SampleSpec tmpSsDst = *ssSrc;
-    tmpSsDst.setSampleSpecItem(sampleSpecItem, ssDst->getSampleSpecItem(sampleSpecItem));
-    if (sampleSpecItem == ChannelCountSampleSpecItem) {
+    size_t bytes = getScratchBufferSize(inFrames);
+    if (bytes <= _scratch.getBufferSize()) {
 
-        tmpSsDst.setChannelsPolicy(ssDst->getChannelsPolicy());
+        return NO_ERROR;
     }
 
-    status_t ret = _audioConverter[sampleSpecItem]->configure(*ssSrc, tmpSsDst);
-    if (ret != NO_ERROR) {
+    // Scratch buffers are only used within a convert call, content is not kept.
+    return _scratch.allocate(bytes);
+}
 
-        return ret;
+void AudioConversion::emptyConversionChain()
+{
+    if (_activeChain != NULL && !_activeChain->_configured) {
+
+        // Partially configured chain must not be found in the cache
+        _activeChain->_ssSrc = SampleSpec();
+        _activeChain->_ssDst = SampleSpec();
+        _activeChain->_audioConvList.clear();
     }
-    _activeAudioConvList.push_back(_audioConverter[sampleSpecItem]);
-    *ssSrc = tmpSsDst;
+    _activeChain = NULL;
+}
 
-    return NO_ERROR;
+bool AudioConversion::isConversionChainEmpty() const
+{
+    return _activeChain == NULL || _activeChain->_audioConvList.empty();
 }
 
-status_t AudioConversion::configureAndAddConverter(SampleSpecItem sampleSpecItem,
-                                                   SampleSpec *ssSrc,
-                                                   const SampleSpec *ssDst)
+SampleSpec AudioConversion::getStepDstSampleSpec(uint32_t step,
+                                                 const SampleSpec &ssSrc,
+                                                 const SampleSpec &ssDst)
 {
-    LOG_ALWAYS_FATAL_IF(sampleSpecItem >= NbSampleSpecItems);
+    SampleSpec tmpSsDst = ssSrc;
 
-    // If the input format size is higher, first perform the reformat
-    // then add the resampler
-    // and perform the reformat (if not already done)
-    if (ssSrc->getSampleSpecItem(sampleSpecItem) > ssDst->getSampleSpecItem(sampleSpecItem)) {
+    for (int item = 0; item < NbSampleSpecItems; item++) {
 
-        status_t ret = doConfigureAndAddConverter(sampleSpecItem, ssSrc, ssDst);
-        if (ret != NO_ERROR) {
+        if (step & (1 << item)) {
 
-            return ret;
+            SampleSpecItem sampleSpecItem = static_cast<SampleSpecItem>(item);
+            tmpSsDst.setSampleSpecItem(sampleSpecItem, ssDst.getSampleSpecItem(sampleSpecItem));
         }
     }
+    if (step & REMAP_STEP) {
 
-    if ((sampleSpecItem + 1) < NbSampleSpecItems) {
-        // Dive
-        status_t ret = configureAndAddConverter((SampleSpecItem)(sampleSpecItem + 1), ssSrc,
-                                                ssDst);
-        if (ret != NO_ERROR) {
+        tmpSsDst.setChannelsPolicy(ssDst.getChannelsPolicy());
+        tmpSsDst.setChannelMask(ssDst.getChannelMask());
+    }
+    return tmpSsDst;
+}
 
-            return ret;
+status_t AudioConversion::doConfigureAndAddConverter(uint32_t step,
+                                                     SampleSpec *ssSrc,
+                                                     const SampleSpec *ssDst)
+{
+    SampleSpec tmpSsDst = getStepDstSampleSpec(step, *ssSrc, *ssDst);
+    AudioConverter *audioConverter;
+
+    if (step == FUSED_STEP) {
+
+        audioConverter = _activeChain->_fusedConverter;
+    } else if (step == REFORMAT_STEP && _activeChain->_dithering &&
+               AudioDitherer::reducesBitDepth(*ssSrc, tmpSsDst)) {
+
+        // Requantization to 16 bits is dithered instead of rounded
+        audioConverter = _activeChain->_ditherer;
+    } else {
+
+        // Single item step, performed by the converter dedicated to the item
+        int item = 0;
+        while (item < NbSampleSpecItems && step != static_cast<uint32_t>(1 << item)) {
+
+            item++;
         }
+        LOG_ALWAYS_FATAL_IF(item >= NbSampleSpecItems);
+        audioConverter = _activeChain->_audioConverter[item];
     }
+    status_t ret = audioConverter->configure(*ssSrc, tmpSsDst);
+    if (ret != NO_ERROR) {
 
-    // Handle the case of destination sample spec item is higher than input sample spec
-    // or destination and source channels policy are different
-    if (!SampleSpec::isSampleSpecItemEqual(sampleSpecItem, *ssSrc, *ssDst)) {
-
-        return doConfigureAndAddConverter(sampleSpecItem, ssSrc, ssDst);
+        return ret;
     }
+    _activeChain->_audioConvList.push_back(audioConverter);
+    *ssSrc = tmpSsDst;
+
     return NO_ERROR;
 }
 
@@ -0,0 +1,289 @@
+/*
+ **
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+#define LOG_TAG "AudioConversionBatch"
+
+#include "AudioConversionBatch.h"
+#include "AllocationGuard.h"
+#include "AudioConversion.h"
+#include <cutils/log.h>
+#include <algorithm>
+
+using namespace android;
+using namespace std;
+
+namespace android_audio_legacy{
+
+// Waking a worker costs about as much as converting a few thousand samples
+const size_t AudioConversionBatch::DEFAULT_PARALLEL_SAMPLES = 16384;
+
+AudioConversionBatch::AudioConversionBatch(uint32_t workers, size_t parallelSamples) :
+    _workers(NULL),
+    _workerCount(0),
+    _parallelSamples(parallelSamples),
+    _reserved(false),
+    _jobs(NULL),
+    _jobCount(0),
+    _nextJob(0),
+    _pendingJobs(0),
+    _generation(0),
+    _stopping(false)
+{
+    pthread_mutex_init(&_lock, NULL);
+    pthread_cond_init(&_startCond, NULL);
+    pthread_cond_init(&_doneCond, NULL);
+
+    if (workers == 0) {
+
+        return;
+    }
+    _workers = new Worker[workers];
+    for (uint32_t i = 0; i < workers; i++) {
+
+        _workers[_workerCount]._batch = this;
+        if (pthread_create(&_workers[_workerCount]._thread, NULL, workerThread,
+                           &_workers[_workerCount]) != 0) {
+
+            LOGE("%s: could only start %d of %d workers", __FUNCTION__, _workerCount, workers);
+            break;
+        }
+        _workerCount++;
+    }
+}
+
+AudioConversionBatch::~AudioConversionBatch()
+{
+    pthread_mutex_lock(&_lock);
+    _stopping = true;
+    pthread_cond_broadcast(&_startCond);
+    pthread_mutex_unlock(&_lock);
+
+    for (uint32_t i = 0; i < _workerCount; i++) {
+
+        pthread_join(_workers[i]._thread, NULL);
+    }
+    delete []_workers;
+
+    pthread_cond_destroy(&_doneCond);
+    pthread_cond_destroy(&_startCond);
+    pthread_mutex_destroy(&_lock);
+}
+
+status_t AudioConversionBatch::reserve(const Job *jobs, size_t count)
+{
+    status_t status = checkJobs(jobs, count);
+    if (status != NO_ERROR) {
+
+        return status;
+    }
+
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; i++) {
+
+        AudioConversion *conversion = jobs[i].conversion;
+        if (jobs[i].inFrames > conversion->_reservedFrames) {
+
+            status = conversion->reserve(jobs[i].inFrames);
+            if (status != NO_ERROR) {
+
+                return status;
+            }
+        }
+        if (!conversion->isConversionChainEmpty()) {
+
+            bytes = max(bytes, conversion->getScratchBufferSize(jobs[i].inFrames));
+        }
+    }
+
+    // Any job may be picked by any thread
+    status = _scratch.allocate(bytes);
+    for (uint32_t i = 0; i < _workerCount && status == NO_ERROR; i++) {
+
+        status = _workers[i]._scratch.allocate(bytes);
+    }
+    _reserved = (status == NO_ERROR);
+    return status;
+}
+
+status_t AudioConversionBatch::run(Job *jobs, size_t count)
+{
+    status_t status = checkJobs(jobs, count);
+    if (status != NO_ERROR) {
+
+        return status;
+    }
+
+    size_t samples = 0;
+    bool exceedsReservation = false;
+    for (size_t i = 0; i < count; i++) {
+
+        samples += jobs[i].conversion->_ssSrc.getChannelCount() * jobs[i].inFrames;
+        exceedsReservation |= jobs[i].inFrames > jobs[i].conversion->_reservedFrames;
+    }
+
+    if (_reserved && exceedsReservation) {
+
+        // Longer jobs than planned, the buffers grow before the allocation free section
+        LOGW("%s: jobs exceed the frames reserved, reserving again", __FUNCTION__);
+        status = reserve(jobs, count);
+        if (status != NO_ERROR) {
+
+            return status;
+        }
+    }
+
+    AllocationGuard::ForbiddenScope allocationScope(_reserved);
+
+    if (_workerCount == 0 || count < 2 || samples < _parallelSamples) {
+
+        for (size_t i = 0; i < count; i++) {
+
+            runJob(&jobs[i], &_scratch);
+        }
+    } else {
+
+        pthread_mutex_lock(&_lock);
+        _jobs = jobs;
+        _jobCount = count;
+        _nextJob = 0;
+        _pendingJobs = count;
+        _generation++;
+        pthread_cond_broadcast(&_startCond);
+        pthread_mutex_unlock(&_lock);
+
+        // Calling thread picks jobs as well
+        runPendingJobs(&_scratch);
+
+        pthread_mutex_lock(&_lock);
+        while (_pendingJobs != 0) {
+
+            pthread_cond_wait(&_doneCond, &_lock);
+        }
+        // Late workers must not pick jobs of a batch given back to the caller
+        _jobs = NULL;
+        _jobCount = 0;
+        pthread_mutex_unlock(&_lock);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+
+        if (jobs[i].status != NO_ERROR) {
+
+            return jobs[i].status;
+        }
+    }
+    return NO_ERROR;
+}
+
+status_t AudioConversionBatch::checkJobs(const Job *jobs, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+
+        if (jobs[i].conversion == NULL || jobs[i].dst == NULL) {
+
+            LOGE("%s: job %d has no conversion or destination", __FUNCTION__,
+                 static_cast<int>(i));
+            return BAD_VALUE;
+        }
+        // Conversions keep a state, they cannot run concurrently
+        for (size_t j = 0; j < i; j++) {
+
+            if (jobs[j].conversion == jobs[i].conversion) {
+
+                LOGE("%s: jobs %d and %d share the same conversion", __FUNCTION__,
+                     static_cast<int>(j), static_cast<int>(i));
+                return BAD_VALUE;
+            }
+        }
+    }
+    return NO_ERROR;
+}
+
+void AudioConversionBatch::runJob(Job *job, ScratchArena *scratch)
+{
+    AudioConversion *conversion = job->conversion;
+    void *dst = job->dst;
+
+    job->outFrames = 0;
+    if (conversion->isConversionChainEmpty()) {
+
+        job->status = conversion->convert(job->src, &dst, job->inFrames, &job->outFrames);
+        return;
+    }
+    job->status = scratch->allocate(conversion->getScratchBufferSize(job->inFrames));
+    if (job->status != NO_ERROR) {
+
+        return;
+    }
+    job->status = conversion->convertChain(job->src, &dst, job->inFrames, &job->outFrames,
+                                           *scratch);
+}
+
+void AudioConversionBatch::runPendingJobs(ScratchArena *scratch)
+{
+    pthread_mutex_lock(&_lock);
+    while (_jobs != NULL && _nextJob < _jobCount) {
+
+        Job *job = &_jobs[_nextJob++];
+        pthread_mutex_unlock(&_lock);
+
+        runJob(job, scratch);
+
+        pthread_mutex_lock(&_lock);
+        if (--_pendingJobs == 0) {
+
+            pthread_cond_signal(&_doneCond);
+        }
+    }
+    pthread_mutex_unlock(&_lock);
+}
+
+void AudioConversionBatch::workerLoop(Worker *worker)
+{
+    pthread_mutex_lock(&_lock);
+    uint32_t generation = _generation;
+    while (true) {
+
+        while (!_stopping && _generation == generation) {
+
+            pthread_cond_wait(&_startCond, &_lock);
+        }
+        if (_stopping) {
+
+            break;
+        }
+        generation = _generation;
+        bool reserved = _reserved;
+        pthread_mutex_unlock(&_lock);
+
+        {
+            AllocationGuard::ForbiddenScope allocationScope(reserved);
+            runPendingJobs(&worker->_scratch);
+        }
+
+        pthread_mutex_lock(&_lock);
+    }
+    pthread_mutex_unlock(&_lock);
+}
+
+void *AudioConversionBatch::workerThread(void *context)
+{
+    Worker *worker = static_cast<Worker *>(context);
+    worker->_batch->workerLoop(worker);
+    return NULL;
+}
+
+}; // namespace android
@@ -18,6 +18,7 @@
 #define LOG_TAG "AudioConverter"
 
 #include "AudioConverter.h"
+#include "AllocationGuard.h"
 #include "AudioUtils.h"
 #include <cutils/log.h>
 
@@ -65,9 +66,9 @@ status_t AudioConverter::allocateConvertBuffer(ssize_t bytes)
 {
     status_t ret = NO_ERROR;
     // Allocate one more frame for resampler
-    _convertBufSize = bytes +
-            (audio_bytes_per_sample(_ssDst.getFormat()) * _ssDst.getChannelCount());
+    _convertBufSize = bytes + _ssDst.getFrameSize();
 
+    AllocationGuard::checkAllocation(__FUNCTION__);
     delete []_convertBuf;
     _convertBuf = NULL;
 
@@ -83,8 +84,7 @@ status_t AudioConverter::allocateConvertBuffer(ssize_t bytes)
 
 status_t AudioConverter::configure(const SampleSpec &ssSrc, const SampleSpec &ssDst)
 {
-    _ssSrc = ssSrc;
-    _ssDst = ssDst;
+    resetConfiguration(ssSrc, ssDst);
 
     for (int i = 0; i < NbSampleSpecItems; i++) {
 
@@ -107,13 +107,19 @@ status_t AudioConverter::configure(const SampleSpec &ssSrc, const SampleSpec &ss
         }
     }
 
+    return NO_ERROR;
+}
+
+void AudioConverter::resetConfiguration(const SampleSpec &ssSrc, const SampleSpec &ssDst)
+{
+    _ssSrc = ssSrc;
+    _ssDst = ssDst;
+
     // Reset the convert function pointer
     _convertSamplesFct = NULL;
 
     // force the size to 0 to clear the buffer
     _convertBufSize = 0;
-
-    return NO_ERROR;
 }
 
 status_t AudioConverter::convert(const void *src,
@@ -27,6 +27,8 @@ public:
 
     /**
      * conversion function pointer definition.
+     * Converters select their conversion function, or kernel, once in configure, from the
+     * sample specifications. Convert calls it once per buffer: there is no dispatch per frame.
      *
      * @param[in] src the source buffer.
      * @param[out] dst the destination buffer.
@@ -78,8 +80,72 @@ public:
                                       uint32_t inFrames,
                                       uint32_t *outFrames);
 
+    /**
+     * Allocates the internal buffers of the converter for a maximum number of input frames per
+     * call, so that convert does not allocate within this limit. Output buffers are not
+     * reserved: callers that need an allocation free convert give the destination buffer.
+     * Before using this function, configure must have been called.
+     *
+     * @param[in] maxInFrames maximum number of frames in the source sample specification.
+     *
+     * @return status OK if the buffers are allocated, error code otherwise.
+     */
+    virtual android::status_t reserve(size_t /*maxInFrames*/) { return android::NO_ERROR; }
+
+    /**
+     * Checks if the converter may convert in place, ie with the same source and destination
+     * buffer. It requires that samples of a frame are read before any destination write may
+     * overwrite them, which is only possible if the frame size does not grow.
+     * Before using this function, configure must have been called.
+     *
+     * @return true if the source buffer may be given as destination buffer, false otherwise.
+     */
+    virtual bool supportsInPlace() const { return false; }
+
+    /**
+     * Gets the group delay of the converter, ie the number of frames by which the converter
+     * delays the signal from its source to its destination. Converters without any filter
+     * process each frame on its own and add no delay.
+     * Before using this function, configure must have been called.
+     *
+     * @return delay in frames in the destination sample specification.
+     */
+    virtual size_t getDelayFrames() const { return 0; }
+
+    /**
+     * Restarts the conversion from silence, as for a new stream: filter histories and phases
+     * are cleared, without any allocation. Converters processing each frame on its own keep no
+     * state to clear.
+     * Before using this function, configure must have been called.
+     */
+    virtual void reset() {}
+
+    /**
+     * Source sample specifications getter.
+     *
+     * @return source sample specifications of the converter.
+     */
+    const SampleSpec &getSrcSampleSpec() const { return _ssSrc; }
+
+    /**
+     * Destination sample specifications getter.
+     *
+     * @return destination sample specifications of the converter.
+     */
+    const SampleSpec &getDstSampleSpec() const { return _ssDst; }
+
 protected:
 
+    /**
+     * Resets the converter for a new pair of sample specifications.
+     * Stores the sample specifications, clears the conversion function and the output buffer.
+     * Converters that work on several sample spec items at once use it instead of configure.
+     *
+     * @param[in] ssSrc source sample specifications.
+     * @param[in] ssDst destination sample specification.
+     */
+    void resetConfiguration(const SampleSpec &ssSrc, const SampleSpec &ssDst);
+
     /**
      * Converts the number of frames in the destination sample spec in a number of frames in the
      * source sample spec.
@@ -100,6 +166,9 @@ protected:
      */
     size_t convertSrcToDstInFrames(ssize_t frames) const;
 
+    /**
+     * Conversion function selected on configure, NULL if there is nothing to convert.
+     */
     SampleConverter _convertSamplesFct;
 
     /**
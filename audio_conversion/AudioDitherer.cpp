@@ -0,0 +1,242 @@
+/*
+ **
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#define LOG_TAG "AudioDitherer"
+
+#include "AudioDitherer.h"
+#include "CpuFeatures.h"
+#include <cutils/log.h>
+#include <algorithm>
+#include <limits.h>
+#include <string.h>
+
+#ifdef AUDIO_CONVERSION_X86
+#include <emmintrin.h>
+#endif
+
+#define base AudioReformatter
+
+using namespace android;
+
+namespace android_audio_legacy{
+
+const size_t AudioDitherer::NOISE_LANES;
+
+/**
+ * Seeds of the xorshift generators, any non null value is valid.
+ */
+const uint32_t AudioDitherer::NOISE_SEEDS[NOISE_LANES] = {
+
+    0x9E3779B9, 0x7F4A7C15, 0x85EBCA6B, 0xC2B2AE35
+};
+
+//
+// Steps of the noise generator and requantization of a sample, shared by the scalar kernels
+// and the tails of the vector kernels.
+//
+static inline uint32_t nextNoiseState(uint32_t state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static inline int16_t ditherQ31toS16(int32_t sample, int32_t noise, int32_t previousNoise)
+{
+    // Sample in Q23 plus a triangular noise of +/- 1 LSB of 16 bits, then rounded
+    int32_t dithered = ((sample >> 8) + noise - previousNoise + 128) >> 8;
+    if (dithered > SHRT_MAX) {
+
+        return SHRT_MAX;
+    }
+    return static_cast<int16_t>(dithered < SHRT_MIN ? SHRT_MIN : dithered);
+}
+
+//
+// Vector kernels, same samples as the scalar reference kernels.
+//
+#ifdef AUDIO_CONVERSION_X86
+
+static void generateNoiseSse2(uint32_t *state, int32_t *noise, size_t groups)
+{
+    __m128i lanes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(state));
+
+    for (size_t i = 0; i < groups; i++) {
+
+        lanes = _mm_xor_si128(lanes, _mm_slli_epi32(lanes, 13));
+        lanes = _mm_xor_si128(lanes, _mm_srli_epi32(lanes, 17));
+        lanes = _mm_xor_si128(lanes, _mm_slli_epi32(lanes, 5));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(noise + i * 4), _mm_srli_epi32(lanes, 24));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(state), lanes);
+}
+
+static void quantizeQ31toS16Sse2(const int32_t *src, const int32_t *noise, int16_t *dst,
+                                 size_t samples, uint32_t channels)
+{
+    const int32_t *previousNoise = noise;
+    const int32_t *sampleNoise = noise + channels;
+    const __m128i half = _mm_set1_epi32(128);
+    size_t i;
+
+    for (i = 0; i + 8 <= samples; i += 8) {
+
+        __m128i low = _mm_srai_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)),
+                                     8);
+        __m128i high = _mm_srai_epi32(
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 4)), 8);
+        __m128i ditherLow = _mm_sub_epi32(
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(sampleNoise + i)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(previousNoise + i)));
+        __m128i ditherHigh = _mm_sub_epi32(
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(sampleNoise + i + 4)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(previousNoise + i + 4)));
+        low = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(low, ditherLow), half), 8);
+        high = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(high, ditherHigh), half), 8);
+        // Saturating pack clips as the scalar kernel does
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi32(low, high));
+    }
+    for (; i < samples; i++) {
+
+        dst[i] = ditherQ31toS16(src[i], sampleNoise[i], previousNoise[i]);
+    }
+}
+
+#endif // AUDIO_CONVERSION_X86
+
+AudioDitherer::AudioDitherer(SampleSpecItem sampleSpecItem) :
+    base(sampleSpecItem),
+    _noiseKernel(NULL),
+    _quantizeKernel(NULL),
+    _ditherToQ31Kernel(NULL)
+{
+    resetNoise();
+}
+
+bool AudioDitherer::reducesBitDepth(const SampleSpec &ssSrc, const SampleSpec &ssDst)
+{
+    return ssDst.getFormat() == AUDIO_FORMAT_PCM_16_BIT &&
+           SampleSpec::getBytesPerSample(ssSrc.getFormat()) >
+           SampleSpec::getBytesPerSample(ssDst.getFormat());
+}
+
+status_t AudioDitherer::configure(const SampleSpec &ssSrc, const SampleSpec &ssDst)
+{
+    // Checks that only the format differs, without selecting the reformat kernels
+    status_t status = AudioConverter::configure(ssSrc, ssDst);
+    if (status != NO_ERROR) {
+
+        return status;
+    }
+    if (!reducesBitDepth(ssSrc, ssDst) || ssSrc.getChannelCount() > SampleSpec::MAX_CHANNELS) {
+
+        return INVALID_OPERATION;
+    }
+    // Q31 samples are requantized as is
+    _ditherToQ31Kernel = selectToQ31Kernel(ssSrc.getFormat());
+    if (_ditherToQ31Kernel == NULL && ssSrc.getFormat() != AUDIO_FORMAT_PCM_32_BIT) {
+
+        LOGE("%s: ditherer not available", __FUNCTION__);
+        return INVALID_OPERATION;
+    }
+
+    _noiseKernel = generateNoise;
+    _quantizeKernel = quantizeQ31toS16;
+#ifdef AUDIO_CONVERSION_X86
+    if (CpuFeatures::hasFeature(CpuFeatures::Sse2)) {
+
+        _noiseKernel = generateNoiseSse2;
+        _quantizeKernel = quantizeQ31toS16Sse2;
+    }
+#endif
+    resetNoise();
+    _convertSamplesFct = static_cast<SampleConverter>(&AudioDitherer::ditherFrames);
+
+    return NO_ERROR;
+}
+
+void AudioDitherer::resetNoise()
+{
+    memcpy(_noiseState, NOISE_SEEDS, sizeof(_noiseState));
+    memset(_lastNoise, 0, sizeof(_lastNoise));
+}
+
+status_t AudioDitherer::ditherFrames(const void *src,
+                                     void *dst,
+                                     const uint32_t inFrames,
+                                     uint32_t *outFrames)
+{
+    const uint8_t *srcBytes = static_cast<const uint8_t *>(src);
+    int16_t *dst16 = static_cast<int16_t *>(dst);
+    size_t srcSampleSize = SampleSpec::getBytesPerSample(_ssSrc.getFormat());
+    uint32_t channels = _ssSrc.getChannelCount();
+    size_t samples = inFrames * channels;
+    int32_t q31Samples[Q31_CHUNK_SAMPLES];
+    // Noise of the previous sample of each channel, then noise of the chunk rounded to lanes
+    int32_t noise[SampleSpec::MAX_CHANNELS + Q31_CHUNK_SAMPLES + NOISE_LANES];
+    size_t done = 0;
+
+    memcpy(noise, _lastNoise, channels * sizeof(int32_t));
+
+    // A chunk is read before being written, so in place conversion is safe as samples shrink.
+    while (done < samples) {
+
+        size_t chunk = std::min(samples - done, Q31_CHUNK_SAMPLES);
+        const int32_t *q31 = reinterpret_cast<const int32_t *>(srcBytes + done * srcSampleSize);
+        if (_ditherToQ31Kernel != NULL) {
+
+            _ditherToQ31Kernel(q31, q31Samples, chunk);
+            q31 = q31Samples;
+        }
+        _noiseKernel(_noiseState, noise + channels, (chunk + NOISE_LANES - 1) / NOISE_LANES);
+        _quantizeKernel(q31, noise, dst16 + done, chunk, channels);
+
+        // Noise of the last samples of each channel shapes the next chunk
+        memmove(noise, noise + chunk, channels * sizeof(int32_t));
+        done += chunk;
+    }
+    memcpy(_lastNoise, noise, channels * sizeof(int32_t));
+
+    // Transformation is "iso"frames
+    *outFrames = inFrames;
+
+    return NO_ERROR;
+}
+
+void AudioDitherer::generateNoise(uint32_t *state, int32_t *noise, size_t groups)
+{
+    for (size_t i = 0; i < groups; i++) {
+
+        for (size_t lane = 0; lane < NOISE_LANES; lane++) {
+
+            state[lane] = nextNoiseState(state[lane]);
+            noise[i * NOISE_LANES + lane] = static_cast<int32_t>(state[lane] >> 24);
+        }
+    }
+}
+
+void AudioDitherer::quantizeQ31toS16(const int32_t *src, const int32_t *noise, int16_t *dst,
+                                     size_t samples, uint32_t channels)
+{
+    for (size_t i = 0; i < samples; i++) {
+
+        dst[i] = ditherQ31toS16(src[i], noise[channels + i], noise[i]);
+    }
+}
+
+}; // namespace android
@@ -0,0 +1,139 @@
+/*
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+#pragma once
+
+#include "AudioReformatter.h"
+
+namespace android_audio_legacy {
+
+/**
+ * Reformatter requantizing samples to 16 bits with a dither.
+ * Plain rounding to 16 bits turns the low order bits of the source into an error correlated
+ * with the signal, heard as distortion on fades and low level signals. The ditherer adds a
+ * triangular (TPDF) noise of +/- 1 LSB before rounding, which makes the error a signal
+ * independent noise. The noise is high-pass shaped: each value is the difference of two
+ * successive uniform values of the channel, which pushes the noise power towards the high
+ * frequencies, where the ear is less sensitive.
+ * Samples do not depend on the previously output samples, so that the requantization is
+ * vectorized as the other kernels, and it runs without any allocation.
+ */
+class AudioDitherer : public AudioReformatter {
+
+public:
+    AudioDitherer(SampleSpecItem sampleSpecItem);
+
+    /**
+     * Configures the ditherer.
+     * Only the requantizations to 16 bits from a larger format are supported.
+     * The noise generator is reset, so that a configured ditherer always outputs the same
+     * samples for the same input.
+     *
+     * @param[in] ssSrc the source sample specifications.
+     * @param[in] ssDst the destination sample specifications.
+     *
+     * @return OK if the conversion reduces the bit depth to 16 bits, INVALID_OPERATION otherwise.
+     */
+    virtual android::status_t configure(const SampleSpec &ssSrc, const SampleSpec &ssDst);
+
+    /**
+     * Checks if a conversion reduces the bit depth of the samples to 16 bits, ie if the
+     * conversion should be dithered.
+     *
+     * @param[in] ssSrc the source sample specifications.
+     * @param[in] ssDst the destination sample specifications.
+     *
+     * @return true if the samples are requantized to 16 bits, false otherwise.
+     */
+    static bool reducesBitDepth(const SampleSpec &ssSrc, const SampleSpec &ssDst);
+
+    /**
+     * Resets the noise generator and the noise history, as configure does.
+     */
+    virtual void reset() { resetNoise(); }
+
+private:
+    /**
+     * Noise kernel definition.
+     * Generates uniform noise values within [0, 256[, ie one 16 bits LSB in Q23, by groups of
+     * NOISE_LANES values, each lane of the group coming from its own generator.
+     *
+     * @param[in:out] state state of the generators of each lane.
+     * @param[out] noise noise values.
+     * @param[in] groups number of groups of NOISE_LANES values to generate.
+     */
+    typedef void (*NoiseKernel)(uint32_t *state, int32_t *noise, size_t groups);
+
+    /**
+     * Requantization kernel definition.
+     * Adds the difference of the noise values of the sample and of the previous sample of the
+     * channel to the Q31 sample, then rounds it to 16 bits with saturation.
+     *
+     * @param[in] src the Q31 samples.
+     * @param[in] noise the noise values, preceded by the channel count values of the previous
+     *                  samples.
+     * @param[out] dst the 16 bits samples.
+     * @param[in] samples number of samples to requantize.
+     * @param[in] channels channel count.
+     */
+    typedef void (*QuantizeKernel)(const int32_t *src, const int32_t *noise, int16_t *dst,
+                                   size_t samples, uint32_t channels);
+
+    /**
+     * Requantizes the frames by chunks, through the Q31 pivot format.
+     *
+     * @param[in] src the source buffer.
+     * @param[out] dst the destination buffer, caller to ensure the destination
+     *             is large enough.
+     * @param[in] inFrames number of input frames.
+     * @param[out] outFrames output frames processed.
+     *
+     * @return error code.
+     */
+    android::status_t ditherFrames(const void *src,
+                                   void *dst,
+                                   const uint32_t inFrames,
+                                   uint32_t *outFrames);
+
+    /**
+     * Scalar reference kernels, used if no vector instruction set is available.
+     */
+    static void generateNoise(uint32_t *state, int32_t *noise, size_t groups);
+    static void quantizeQ31toS16(const int32_t *src, const int32_t *noise, int16_t *dst,
+                                 size_t samples, uint32_t channels);
+
+    /**
+     * Resets the noise generators and the noise history of the channels.
+     */
+    void resetNoise();
+
+    static const size_t NOISE_LANES = 4; /**< Noise values generated at once. */
+
+    static const uint32_t NOISE_SEEDS[NOISE_LANES]; /**< Initial states of the generators. */
+
+    NoiseKernel _noiseKernel; /**< Noise kernel selected at configure. */
+    QuantizeKernel _quantizeKernel; /**< Requantization kernel selected at configure. */
+    ReformatKernel _ditherToQ31Kernel; /**< Kernel to Q31, NULL if the source is in Q31. */
+
+    uint32_t _noiseState[NOISE_LANES]; /**< State of the generator of each lane. */
+
+    /**
+     * Noise value of the last sample of each channel, high-pass shaping of the next samples
+     * starts from them.
+     */
+    int32_t _lastNoise[SampleSpec::MAX_CHANNELS];
+};
+
+}; // namespace android
@@ -0,0 +1,295 @@
+/*
+ **
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#define LOG_TAG "AudioFusedConverter"
+
+#include "AudioFusedConverter.h"
+#include "CpuFeatures.h"
+#include <cutils/log.h>
+
+#ifdef AUDIO_CONVERSION_X86
+#include <emmintrin.h>
+#endif
+
+#define base AudioConverter
+
+using namespace android;
+
+namespace android_audio_legacy{
+
+//
+// Sample operations, identical to the ones of the remapper and the reformatter.
+//
+static inline uint32_t convertS16toS24over32(int16_t sample)
+{
+    return (uint32_t)((int32_t)sample << 16) >> 8;
+}
+
+static inline int16_t convertS24over32toS16(uint32_t sample)
+{
+    return (int16_t)(((int32_t)sample << 8) >> 16);
+}
+
+template<typename type>
+static inline type averageSamples(type a, type b)
+{
+    return (a >> 1) + (b >> 1) + (a & b & 1);
+}
+
+//
+// Reference kernels.
+// Remap is done before the reformat when the channel count decreases, after otherwise,
+// as the conversion chain does.
+//
+static void convertMonoS16toStereoS24over32(const void *src, void *dst, size_t frames)
+{
+    const int16_t *src16 = static_cast<const int16_t *>(src);
+    uint32_t *dst32 = static_cast<uint32_t *>(dst);
+
+    for (size_t i = 0; i < frames; i++) {
+
+        dst32[2 * i] = dst32[2 * i + 1] = convertS16toS24over32(src16[i]);
+    }
+}
+
+static void convertStereoS16toMonoS24over32(const void *src, void *dst, size_t frames)
+{
+    const int16_t *src16 = static_cast<const int16_t *>(src);
+    uint32_t *dst32 = static_cast<uint32_t *>(dst);
+
+    for (size_t i = 0; i < frames; i++) {
+
+        dst32[i] = convertS16toS24over32(averageSamples<int16_t>(src16[2 * i], src16[2 * i + 1]));
+    }
+}
+
+static void convertMonoS24over32toStereoS16(const void *src, void *dst, size_t frames)
+{
+    const uint32_t *src32 = static_cast<const uint32_t *>(src);
+    int16_t *dst16 = static_cast<int16_t *>(dst);
+
+    for (size_t i = 0; i < frames; i++) {
+
+        dst16[2 * i] = dst16[2 * i + 1] = convertS24over32toS16(src32[i]);
+    }
+}
+
+static void convertStereoS24over32toMonoS16(const void *src, void *dst, size_t frames)
+{
+    const uint32_t *src32 = static_cast<const uint32_t *>(src);
+    int16_t *dst16 = static_cast<int16_t *>(dst);
+
+    for (size_t i = 0; i < frames; i++) {
+
+        dst16[i] = convertS24over32toS16(averageSamples<uint32_t>(src32[2 * i], src32[2 * i + 1]));
+    }
+}
+
+#ifdef AUDIO_CONVERSION_X86
+
+//
+// SSE2 kernels, 8 frames per iteration, remaining frames handled by the reference kernels.
+//
+static void convertMonoS16toStereoS24over32Sse2(const void *src, void *dst, size_t frames)
+{
+    const int16_t *src16 = static_cast<const int16_t *>(src);
+    uint32_t *dst32 = static_cast<uint32_t *>(dst);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i;
+
+    for (i = 0; i + 8 <= frames; i += 8) {
+
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src16 + i));
+        __m128i low = _mm_slli_epi32(_mm_unpacklo_epi16(in, zero), 8);
+        __m128i high = _mm_slli_epi32(_mm_unpackhi_epi16(in, zero), 8);
+        __m128i *out = reinterpret_cast<__m128i *>(dst32 + 2 * i);
+        _mm_storeu_si128(out, _mm_unpacklo_epi32(low, low));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi32(low, low));
+        _mm_storeu_si128(out + 2, _mm_unpacklo_epi32(high, high));
+        _mm_storeu_si128(out + 3, _mm_unpackhi_epi32(high, high));
+    }
+    convertMonoS16toStereoS24over32(src16 + i, dst32 + 2 * i, frames - i);
+}
+
+static void convertStereoS16toMonoS24over32Sse2(const void *src, void *dst, size_t frames)
+{
+    const int16_t *src16 = static_cast<const int16_t *>(src);
+    uint32_t *dst32 = static_cast<uint32_t *>(dst);
+    size_t i;
+
+    for (i = 0; i + 8 <= frames; i += 8) {
+
+        for (size_t half = 0; half < 8; half += 4) {
+
+            __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src16 + 2 * (i + half)));
+            // Sign extended left and right samples: their sum does not overflow on 32 bits
+            __m128i left = _mm_srai_epi32(_mm_slli_epi32(in, 16), 16);
+            __m128i right = _mm_srai_epi32(in, 16);
+            __m128i average = _mm_srai_epi32(_mm_add_epi32(left, right), 1);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst32 + i + half),
+                             _mm_srli_epi32(_mm_slli_epi32(average, 16), 8));
+        }
+    }
+    convertStereoS16toMonoS24over32(src16 + 2 * i, dst32 + i, frames - i);
+}
+
+static void convertMonoS24over32toStereoS16Sse2(const void *src, void *dst, size_t frames)
+{
+    const uint32_t *src32 = static_cast<const uint32_t *>(src);
+    int16_t *dst16 = static_cast<int16_t *>(dst);
+    size_t i;
+
+    for (i = 0; i + 8 <= frames; i += 8) {
+
+        __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src32 + i));
+        __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src32 + i + 4));
+        low = _mm_srai_epi32(_mm_slli_epi32(low, 8), 16);
+        high = _mm_srai_epi32(_mm_slli_epi32(high, 8), 16);
+        __m128i mono = _mm_packs_epi32(low, high);
+        __m128i *out = reinterpret_cast<__m128i *>(dst16 + 2 * i);
+        _mm_storeu_si128(out, _mm_unpacklo_epi16(mono, mono));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(mono, mono));
+    }
+    convertMonoS24over32toStereoS16(src32 + i, dst16 + 2 * i, frames - i);
+}
+
+static void convertStereoS24over32toMonoS16Sse2(const void *src, void *dst, size_t frames)
+{
+    const uint32_t *src32 = static_cast<const uint32_t *>(src);
+    int16_t *dst16 = static_cast<int16_t *>(dst);
+    const __m128i one = _mm_set1_epi32(1);
+    __m128i mono[2];
+    size_t i;
+
+    for (i = 0; i + 8 <= frames; i += 8) {
+
+        for (size_t half = 0; half < 2; half++) {
+
+            const __m128i *in = reinterpret_cast<const __m128i *>(src32 + 2 * i + 8 * half);
+            // Deinterleave: { l0, l1, r0, r1 } and { l2, l3, r2, r3 }
+            __m128i first = _mm_shuffle_epi32(_mm_loadu_si128(in), _MM_SHUFFLE(3, 1, 2, 0));
+            __m128i second = _mm_shuffle_epi32(_mm_loadu_si128(in + 1), _MM_SHUFFLE(3, 1, 2, 0));
+            __m128i left = _mm_unpacklo_epi64(first, second);
+            __m128i right = _mm_unpackhi_epi64(first, second);
+            __m128i average = _mm_add_epi32(_mm_add_epi32(_mm_srli_epi32(left, 1),
+                                                          _mm_srli_epi32(right, 1)),
+                                            _mm_and_si128(_mm_and_si128(left, right), one));
+            mono[half] = _mm_srai_epi32(_mm_slli_epi32(average, 8), 16);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst16 + i), _mm_packs_epi32(mono[0], mono[1]));
+    }
+    convertStereoS24over32toMonoS16(src32 + 2 * i, dst16 + i, frames - i);
+}
+
+#else
+
+#define convertMonoS16toStereoS24over32Sse2 NULL
+#define convertStereoS16toMonoS24over32Sse2 NULL
+#define convertMonoS24over32toStereoS16Sse2 NULL
+#define convertStereoS24over32toMonoS16Sse2 NULL
+
+#endif // AUDIO_CONVERSION_X86
+
+const AudioFusedConverter::FusedKernelEntry AudioFusedConverter::_fusedKernels[] = {
+    {
+        1, AUDIO_FORMAT_PCM_16_BIT, 2, AUDIO_FORMAT_PCM_8_24_BIT,
+        convertMonoS16toStereoS24over32, convertMonoS16toStereoS24over32Sse2
+    },
+    {
+        2, AUDIO_FORMAT_PCM_16_BIT, 1, AUDIO_FORMAT_PCM_8_24_BIT,
+        convertStereoS16toMonoS24over32, convertStereoS16toMonoS24over32Sse2
+    },
+    {
+        1, AUDIO_FORMAT_PCM_8_24_BIT, 2, AUDIO_FORMAT_PCM_16_BIT,
+        convertMonoS24over32toStereoS16, convertMonoS24over32toStereoS16Sse2
+    },
+    {
+        2, AUDIO_FORMAT_PCM_8_24_BIT, 1, AUDIO_FORMAT_PCM_16_BIT,
+        convertStereoS24over32toMonoS16, convertStereoS24over32toMonoS16Sse2
+    }
+};
+
+AudioFusedConverter::AudioFusedConverter() :
+    base(NbSampleSpecItems),
+    _fusedKernel(NULL)
+{
+}
+
+bool AudioFusedConverter::supportsInPlace() const
+{
+    return _ssDst.getFrameSize() <= _ssSrc.getFrameSize();
+}
+
+bool AudioFusedConverter::hasDefaultChannelsPolicy(const SampleSpec &sampleSpec)
+{
+    for (uint32_t channel = 0; channel < sampleSpec.getChannelCount(); channel++) {
+
+        if (sampleSpec.getChannelsPolicy(channel) != SampleSpec::Copy) {
+
+            return false;
+        }
+    }
+    return true;
+}
+
+status_t AudioFusedConverter::configure(const SampleSpec &ssSrc, const SampleSpec &ssDst)
+{
+    resetConfiguration(ssSrc, ssDst);
+    _fusedKernel = NULL;
+
+    if (!SampleSpec::isSampleSpecItemEqual(RateSampleSpecItem, ssSrc, ssDst) ||
+        !hasDefaultChannelsPolicy(ssSrc) || !hasDefaultChannelsPolicy(ssDst)) {
+
+        return INVALID_OPERATION;
+    }
+
+    for (size_t i = 0; i < sizeof(_fusedKernels) / sizeof(_fusedKernels[0]); i++) {
+
+        const FusedKernelEntry &entry = _fusedKernels[i];
+
+        if ((entry.srcChannels != ssSrc.getChannelCount()) ||
+            (entry.srcFormat != ssSrc.getFormat()) ||
+            (entry.dstChannels != ssDst.getChannelCount()) ||
+            (entry.dstFormat != ssDst.getFormat())) {
+
+            continue;
+        }
+        _fusedKernel = entry.kernel;
+        if ((entry.vectorKernel != NULL) && CpuFeatures::hasFeature(CpuFeatures::Sse2)) {
+
+            _fusedKernel = entry.vectorKernel;
+        }
+        _convertSamplesFct = static_cast<SampleConverter>(&AudioFusedConverter::convertFrames);
+        return NO_ERROR;
+    }
+    return INVALID_OPERATION;
+}
+
+status_t AudioFusedConverter::convertFrames(const void *src,
+                                            void *dst,
+                                            const uint32_t inFrames,
+                                            uint32_t *outFrames)
+{
+    _fusedKernel(src, dst, inFrames);
+
+    // Transformation is "iso" frames
+    *outFrames = inFrames;
+
+    return NO_ERROR;
+}
+
+}; // namespace android
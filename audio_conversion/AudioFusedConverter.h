@@ -0,0 +1,105 @@
+/*
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+#pragma once
+
+#include "AudioConverter.h"
+
+namespace android_audio_legacy {
+
+/**
+ * Converter working on several sample spec items in a single pass.
+ * For the frequent remap + reformat combinations, a fused kernel produces the same samples than
+ * the remapper followed (or preceded) by the reformatter, without the intermediate buffer and
+ * its memory sweep.
+ */
+class AudioFusedConverter : public AudioConverter {
+
+public:
+    AudioFusedConverter();
+
+    /**
+     * Configures the fused converter.
+     * Looks up the fused kernels registry for the source and destination sample specifications.
+     *
+     * @param[in] ssSrc the source sample specifications.
+     * @param[in] ssDst the destination sample specifications.
+     *
+     * @return OK if a fused kernel handles the whole conversion, INVALID_OPERATION otherwise
+     *         and the conversion chain must be used.
+     */
+    virtual android::status_t configure(const SampleSpec &ssSrc, const SampleSpec &ssDst);
+
+private:
+    /**
+     * Conversion is done frame per frame, in place is supported if the frame size does not grow.
+     */
+    virtual bool supportsInPlace() const;
+
+    /**
+     * Fused kernel definition.
+     *
+     * @param[in] src the source buffer.
+     * @param[out] dst the destination buffer, caller to ensure the destination
+     *             is large enough.
+     * @param[in] frames number of frames to convert.
+     */
+    typedef void (*FusedKernel)(const void *src, void *dst, size_t frames);
+
+    /**
+     * Entry of the fused kernels registry.
+     */
+    struct FusedKernelEntry {
+
+        uint32_t srcChannels; /**< Source channel count. */
+        audio_format_t srcFormat; /**< Source format. */
+        uint32_t dstChannels; /**< Destination channel count. */
+        audio_format_t dstFormat; /**< Destination format. */
+        FusedKernel kernel; /**< Reference kernel. */
+        FusedKernel vectorKernel; /**< SSE2 kernel, NULL if none. */
+    };
+
+    /**
+     * Checks if all the channels of a sample specification have the Copy policy.
+     * Fused kernels only implement the default policies.
+     *
+     * @param[in] sampleSpec sample specification to check.
+     *
+     * @return true if all channels policies are Copy, false otherwise.
+     */
+    static bool hasDefaultChannelsPolicy(const SampleSpec &sampleSpec);
+
+    /**
+     * Converts the frames using the kernel selected at configure.
+     *
+     * @param[in] src the source buffer.
+     * @param[out] dst the destination buffer, caller to ensure the destination
+     *             is large enough.
+     * @param[in] inFrames number of input frames.
+     * @param[out] outFrames output frames processed.
+     *
+     * @return error code.
+     */
+    android::status_t convertFrames(const void *src,
+                                    void *dst,
+                                    const uint32_t inFrames,
+                                    uint32_t *outFrames);
+
+    FusedKernel _fusedKernel; /**< Kernel selected at configure. */
+
+    static const FusedKernelEntry _fusedKernels[]; /**< Fused kernels registry. */
+};
+
+}; // namespace android
@@ -18,7 +18,26 @@
 #define LOG_TAG "AudioReformatter"
 
 #include "AudioReformatter.h"
+#include "CpuFeatures.h"
 #include <cutils/log.h>
+#include <algorithm>
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+
+#ifdef AUDIO_CONVERSION_X86
+#include <emmintrin.h>
+#ifdef AUDIO_CONVERSION_SSSE3
+#include <tmmintrin.h>
+#endif
+#ifdef AUDIO_CONVERSION_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+#ifdef AUDIO_CONVERSION_NEON
+#include <arm_neon.h>
+#endif
 
 #define base AudioConverter
 
@@ -26,8 +45,463 @@ using namespace android;
 
 namespace android_audio_legacy{
 
+const size_t AudioReformatter::Q31_CHUNK_SAMPLES;
+
+/**
+ * Range and mask of the samples in 24 bits formats.
+ */
+static const int32_t S24_MAX = (1 << 23) - 1;
+static const uint32_t S24_MASK = 0xFFFFFF;
+
+/**
+ * Scale of the float samples in Q31, and highest float below this scale: the float nearest to
+ * the highest Q31 value is the scale itself, that does not fit.
+ */
+static const float Q31_SCALE = 2147483648.0f;
+static const float Q31_FLOAT_MAX = 2147483520.0f;
+
+//
+// Sample conversions from / to the Q31 pivot format, shared by the scalar kernels and the
+// tails of the vector kernels.
+// Narrowing rounds to the nearest, only the highest positive values may then overflow.
+//
+static inline int32_t s16ToQ31(int16_t sample)
+{
+    return static_cast<int32_t>(static_cast<uint32_t>(sample) << 16);
+}
+
+static inline int16_t q31ToS16(int32_t sample)
+{
+    int32_t rounded = ((sample >> 15) + 1) >> 1;
+    return static_cast<int16_t>(rounded > SHRT_MAX ? SHRT_MAX : rounded);
+}
+
+static inline int32_t s24over32ToQ31(uint32_t sample)
+{
+    return static_cast<int32_t>(sample << 8);
+}
+
+static inline int32_t q31ToS24(int32_t sample)
+{
+    int32_t rounded = ((sample >> 7) + 1) >> 1;
+    return rounded > S24_MAX ? S24_MAX : rounded;
+}
+
+static inline uint32_t q31ToS24over32(int32_t sample)
+{
+    return static_cast<uint32_t>(q31ToS24(sample)) & S24_MASK;
+}
+
+static inline int32_t s24PackedToQ31(const uint8_t *sample)
+{
+    return static_cast<int32_t>((static_cast<uint32_t>(sample[0]) << 8) |
+                                (static_cast<uint32_t>(sample[1]) << 16) |
+                                (static_cast<uint32_t>(sample[2]) << 24));
+}
+
+static inline void q31ToS24Packed(int32_t sample, uint8_t *dst)
+{
+    int32_t rounded = q31ToS24(sample);
+    dst[0] = static_cast<uint8_t>(rounded);
+    dst[1] = static_cast<uint8_t>(rounded >> 8);
+    dst[2] = static_cast<uint8_t>(rounded >> 16);
+}
+
+static inline int32_t floatToQ31(float sample)
+{
+    float scaled = sample * Q31_SCALE;
+
+    // Written so that NaN clips to the max, as the SSE min does
+    if (!(scaled < Q31_FLOAT_MAX)) {
+
+        scaled = Q31_FLOAT_MAX;
+    } else if (scaled < -Q31_SCALE) {
+
+        scaled = -Q31_SCALE;
+    }
+    return static_cast<int32_t>(lrintf(scaled));
+}
+
+static inline float q31ToFloat(int32_t sample)
+{
+    return static_cast<float>(sample) * (1.0f / Q31_SCALE);
+}
+
+//
+// Vector kernels.
+// Each kernel handles as many samples as possible with vectors, then lets the scalar
+// reference kernel complete the tail.
+//
+#ifdef AUDIO_CONVERSION_X86
+
+static void convertS16toS24over32Sse2(const void *src, void *dst, size_t samples)
+{
+    const int16_t *src16 = static_cast<const int16_t *>(src);
+    uint32_t *dst32 = static_cast<uint32_t *>(dst);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i;
+
+    for (i = 0; i + 8 <= samples; i += 8) {
+
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src16 + i));
+        // Zero extension of the 16 bits sample then shift it on bits 8 to 23
+        __m128i outLow = _mm_slli_epi32(_mm_unpacklo_epi16(in, zero), 8);
+        __m128i outHigh = _mm_slli_epi32(_mm_unpackhi_epi16(in, zero), 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst32 + i), outLow);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst32 + i + 4), outHigh);
+    }
+    for (; i < samples; i++) {
+
+        dst32[i] = (uint32_t)((int32_t)src16[i] << 16) >> 8;
+    }
+}
+
+static void convertS24over32toS16Sse2(const void *src, void *dst, size_t samples)
+{
+    const uint32_t *src32 = static_cast<const uint32_t *>(src);
+    int16_t *dst16 = static_cast<int16_t *>(dst);
+    size_t i;
+
+    for (i = 0; i + 8 <= samples; i += 8) {
+
+        __m128i inLow = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src32 + i));
+        __m128i inHigh = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src32 + i + 4));
+        // Sign extension of bits 8 to 23: values fit in 16 bits, so the pack never saturates
+        inLow = _mm_srai_epi32(_mm_slli_epi32(inLow, 8), 16);
+        inHigh = _mm_srai_epi32(_mm_slli_epi32(inHigh, 8), 16);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst16 + i), _mm_packs_epi32(inLow, inHigh));
+    }
+    for (; i < samples; i++) {
+
+        dst16[i] = (int16_t)(((int32_t)src32[i] << 8) >> 16);
+    }
+}
+
+static void convertS16toQ31Sse2(const void *src, void *dst, size_t samples)
+{
+    const int16_t *src16 = static_cast<const int16_t *>(src);
+    int32_t *dst32 = static_cast<int32_t *>(dst);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i;
+
+    for (i = 0; i + 8 <= samples; i += 8) {
+
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src16 + i));
+        // Interleaving with zeros puts each sample in the high half of its 32 bits container
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst32 + i), _mm_unpacklo_epi16(zero, in));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst32 + i + 4), _mm_unpackhi_epi16(zero, in));
+    }
+    for (; i < samples; i++) {
+
+        dst32[i] = s16ToQ31(src16[i]);
+    }
+}
+
+static void convertQ31toS16Sse2(const void *src, void *dst, size_t samples)
+{
+    const int32_t *src32 = static_cast<const int32_t *>(src);
+    int16_t *dst16 = static_cast<int16_t *>(dst);
+    const __m128i one = _mm_set1_epi32(1);
+    size_t i;
+
+    for (i = 0; i + 8 <= samples; i += 8) {
+
+        __m128i inLow = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src32 + i));
+        __m128i inHigh = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src32 + i + 4));
+        // Rounded to the nearest, the pack saturates the only overflowing value
+        inLow = _mm_srai_epi32(_mm_add_epi32(_mm_srai_epi32(inLow, 15), one), 1);
+        inHigh = _mm_srai_epi32(_mm_add_epi32(_mm_srai_epi32(inHigh, 15), one), 1);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst16 + i), _mm_packs_epi32(inLow, inHigh));
+    }
+    for (; i < samples; i++) {
+
+        dst16[i] = q31ToS16(src32[i]);
+    }
+}
+
+static void convertS24over32toQ31Sse2(const void *src, void *dst, size_t samples)
+{
+    const uint32_t *src32 = static_cast<const uint32_t *>(src);
+    int32_t *dst32 = static_cast<int32_t *>(dst);
+    size_t i;
+
+    for (i = 0; i + 4 <= samples; i += 4) {
+
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src32 + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst32 + i), _mm_slli_epi32(in, 8));
+    }
+    for (; i < samples; i++) {
+
+        dst32[i] = s24over32ToQ31(src32[i]);
+    }
+}
+
+/**
+ * Rounds Q31 samples to the nearest 24 bits value, clipping the only overflowing value.
+ */
+static inline __m128i roundQ31toS24Sse2(__m128i in)
+{
+    __m128i rounded = _mm_srai_epi32(_mm_add_epi32(_mm_srai_epi32(in, 7), _mm_set1_epi32(1)), 1);
+    // Comparison yields -1 on overflow
+    return _mm_add_epi32(rounded, _mm_cmpgt_epi32(rounded, _mm_set1_epi32(S24_MAX)));
+}
+
+static void convertQ31toS24over32Sse2(const void *src, void *dst, size_t samples)
+{
+    const int32_t *src32 = static_cast<const int32_t *>(src);
+    uint32_t *dst32 = static_cast<uint32_t *>(dst);
+    const __m128i mask = _mm_set1_epi32(S24_MASK);
+    size_t i;
+
+    for (i = 0; i + 4 <= samples; i += 4) {
+
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src32 + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst32 + i),
+                         _mm_and_si128(roundQ31toS24Sse2(in), mask));
+    }
+    for (; i < samples; i++) {
+
+        dst32[i] = q31ToS24over32(src32[i]);
+    }
+}
+
+static void convertFloatToQ31Sse2(const void *src, void *dst, size_t samples)
+{
+    const float *srcFloat = static_cast<const float *>(src);
+    int32_t *dst32 = static_cast<int32_t *>(dst);
+    const __m128 scale = _mm_set1_ps(Q31_SCALE);
+    const __m128 max = _mm_set1_ps(Q31_FLOAT_MAX);
+    const __m128 min = _mm_set1_ps(-Q31_SCALE);
+    size_t i;
+
+    for (i = 0; i + 4 <= samples; i += 4) {
+
+        __m128 in = _mm_mul_ps(_mm_loadu_ps(srcFloat + i), scale);
+        // Clipped first, as the conversion yields the lowest value on overflow
+        in = _mm_max_ps(_mm_min_ps(in, max), min);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst32 + i), _mm_cvtps_epi32(in));
+    }
+    for (; i < samples; i++) {
+
+        dst32[i] = floatToQ31(srcFloat[i]);
+    }
+}
+
+static void convertQ31toFloatSse2(const void *src, void *dst, size_t samples)
+{
+    const int32_t *src32 = static_cast<const int32_t *>(src);
+    float *dstFloat = static_cast<float *>(dst);
+    const __m128 scale = _mm_set1_ps(1.0f / Q31_SCALE);
+    size_t i;
+
+    for (i = 0; i + 4 <= samples; i += 4) {
+
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src32 + i));
+        _mm_storeu_ps(dstFloat + i, _mm_mul_ps(_mm_cvtepi32_ps(in), scale));
+    }
+    for (; i < samples; i++) {
+
+        dstFloat[i] = q31ToFloat(src32[i]);
+    }
+}
+
+#ifdef AUDIO_CONVERSION_SSSE3
+
+AUDIO_CONVERSION_TARGET("ssse3")
+static void convertS16toS24over32Ssse3(const void *src, void *dst, size_t samples)
+{
+    const int16_t *src16 = static_cast<const int16_t *>(src);
+    uint32_t *dst32 = static_cast<uint32_t *>(dst);
+    // Each 16 bits sample lands in bytes 1 and 2 of its 32 bits container, others are zeroed
+    const __m128i shuffleLow = _mm_setr_epi8(-1, 0, 1, -1, -1, 2, 3, -1,
+                                             -1, 4, 5, -1, -1, 6, 7, -1);
+    const __m128i shuffleHigh = _mm_setr_epi8(-1, 8, 9, -1, -1, 10, 11, -1,
+                                              -1, 12, 13, -1, -1, 14, 15, -1);
+    size_t i;
+
+    for (i = 0; i + 8 <= samples; i += 8) {
+
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src16 + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst32 + i), _mm_shuffle_epi8(in, shuffleLow));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst32 + i + 4),
+                         _mm_shuffle_epi8(in, shuffleHigh));
+    }
+    for (; i < samples; i++) {
+
+        dst32[i] = (uint32_t)((int32_t)src16[i] << 16) >> 8;
+    }
+}
+
+AUDIO_CONVERSION_TARGET("ssse3")
+static void convertS24over32toS16Ssse3(const void *src, void *dst, size_t samples)
+{
+    const uint32_t *src32 = static_cast<const uint32_t *>(src);
+    int16_t *dst16 = static_cast<int16_t *>(dst);
+    // Gathers bytes 1 and 2 of each 32 bits container in the low half of the vector
+    const __m128i shuffle = _mm_setr_epi8(1, 2, 5, 6, 9, 10, 13, 14,
+                                          -1, -1, -1, -1, -1, -1, -1, -1);
+    size_t i;
+
+    for (i = 0; i + 8 <= samples; i += 8) {
+
+        __m128i inLow = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src32 + i));
+        __m128i inHigh = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src32 + i + 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst16 + i),
+                         _mm_unpacklo_epi64(_mm_shuffle_epi8(inLow, shuffle),
+                                            _mm_shuffle_epi8(inHigh, shuffle)));
+    }
+    for (; i < samples; i++) {
+
+        dst16[i] = (int16_t)(((int32_t)src32[i] << 8) >> 16);
+    }
+}
+
+AUDIO_CONVERSION_TARGET("ssse3")
+static void convertS24PackedToQ31Ssse3(const void *src, void *dst, size_t samples)
+{
+    const uint8_t *src8 = static_cast<const uint8_t *>(src);
+    int32_t *dst32 = static_cast<int32_t *>(dst);
+    // Each 3 bytes sample lands in the highest bytes of its 32 bits container
+    const __m128i shuffle = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5,
+                                          -1, 6, 7, 8, -1, 9, 10, 11);
+    size_t i;
+
+    // 16 bytes are loaded for 4 samples, never beyond the last sample
+    for (i = 0; 3 * i + 16 <= 3 * samples; i += 4) {
+
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src8 + 3 * i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst32 + i), _mm_shuffle_epi8(in, shuffle));
+    }
+    for (; i < samples; i++) {
+
+        dst32[i] = s24PackedToQ31(src8 + 3 * i);
+    }
+}
+
+AUDIO_CONVERSION_TARGET("ssse3")
+static void convertQ31toS24PackedSsse3(const void *src, void *dst, size_t samples)
+{
+    const int32_t *src32 = static_cast<const int32_t *>(src);
+    uint8_t *dst8 = static_cast<uint8_t *>(dst);
+    // Gathers the 3 lowest bytes of each rounded sample in the 12 lowest bytes of the vector
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9,
+                                          10, 12, 13, 14, -1, -1, -1, -1);
+    size_t i;
+
+    for (i = 0; i + 4 <= samples; i += 4) {
+
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src32 + i));
+        __m128i out = _mm_shuffle_epi8(roundQ31toS24Sse2(in), shuffle);
+        // Only the 12 bytes of the 4 samples are stored
+        int32_t last = _mm_cvtsi128_si32(_mm_srli_si128(out, 8));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dst8 + 3 * i), out);
+        memcpy(dst8 + 3 * i + 8, &last, sizeof(last));
+    }
+    for (; i < samples; i++) {
+
+        q31ToS24Packed(src32[i], dst8 + 3 * i);
+    }
+}
+
+#endif // AUDIO_CONVERSION_SSSE3
+
+#ifdef AUDIO_CONVERSION_AVX2
+
+AUDIO_CONVERSION_TARGET("avx2")
+static void convertS16toS24over32Avx2(const void *src, void *dst, size_t samples)
+{
+    const int16_t *src16 = static_cast<const int16_t *>(src);
+    uint32_t *dst32 = static_cast<uint32_t *>(dst);
+    size_t i;
+
+    for (i = 0; i + 16 <= samples; i += 16) {
+
+        __m128i inLow = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src16 + i));
+        __m128i inHigh = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src16 + i + 8));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst32 + i),
+                            _mm256_slli_epi32(_mm256_cvtepu16_epi32(inLow), 8));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst32 + i + 8),
+                            _mm256_slli_epi32(_mm256_cvtepu16_epi32(inHigh), 8));
+    }
+    for (; i < samples; i++) {
+
+        dst32[i] = (uint32_t)((int32_t)src16[i] << 16) >> 8;
+    }
+}
+
+AUDIO_CONVERSION_TARGET("avx2")
+static void convertS24over32toS16Avx2(const void *src, void *dst, size_t samples)
+{
+    const uint32_t *src32 = static_cast<const uint32_t *>(src);
+    int16_t *dst16 = static_cast<int16_t *>(dst);
+    size_t i;
+
+    for (i = 0; i + 16 <= samples; i += 16) {
+
+        __m256i inLow = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src32 + i));
+        __m256i inHigh = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src32 + i + 8));
+        inLow = _mm256_srai_epi32(_mm256_slli_epi32(inLow, 8), 16);
+        inHigh = _mm256_srai_epi32(_mm256_slli_epi32(inHigh, 8), 16);
+        // Pack works within 128 bits lanes, restore the sample order afterwards
+        __m256i out = _mm256_permute4x64_epi64(_mm256_packs_epi32(inLow, inHigh), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst16 + i), out);
+    }
+    for (; i < samples; i++) {
+
+        dst16[i] = (int16_t)(((int32_t)src32[i] << 8) >> 16);
+    }
+}
+
+#endif // AUDIO_CONVERSION_AVX2
+
+#endif // AUDIO_CONVERSION_X86
+
+#ifdef AUDIO_CONVERSION_NEON
+
+static void convertS16toS24over32Neon(const void *src, void *dst, size_t samples)
+{
+    const uint16_t *src16 = static_cast<const uint16_t *>(src);
+    uint32_t *dst32 = static_cast<uint32_t *>(dst);
+    size_t i;
+
+    for (i = 0; i + 8 <= samples; i += 8) {
+
+        uint16x8_t in = vld1q_u16(src16 + i);
+        vst1q_u32(dst32 + i, vshlq_n_u32(vmovl_u16(vget_low_u16(in)), 8));
+        vst1q_u32(dst32 + i + 4, vshlq_n_u32(vmovl_u16(vget_high_u16(in)), 8));
+    }
+    for (; i < samples; i++) {
+
+        dst32[i] = (uint32_t)src16[i] << 8;
+    }
+}
+
+static void convertS24over32toS16Neon(const void *src, void *dst, size_t samples)
+{
+    const uint32_t *src32 = static_cast<const uint32_t *>(src);
+    uint16_t *dst16 = static_cast<uint16_t *>(dst);
+    size_t i;
+
+    for (i = 0; i + 8 <= samples; i += 8) {
+
+        // Narrowing shift keeps bits 8 to 23
+        uint16x4_t outLow = vshrn_n_u32(vld1q_u32(src32 + i), 8);
+        uint16x4_t outHigh = vshrn_n_u32(vld1q_u32(src32 + i + 4), 8);
+        vst1q_u16(dst16 + i, vcombine_u16(outLow, outHigh));
+    }
+    for (; i < samples; i++) {
+
+        dst16[i] = (uint16_t)(src32[i] >> 8);
+    }
+}
+
+#endif // AUDIO_CONVERSION_NEON
+
 AudioReformatter::AudioReformatter(SampleSpecItem sampleSpecItem) :
-    base(sampleSpecItem)
+    base(sampleSpecItem),
+    _reformatKernel(NULL),
+    _toQ31Kernel(NULL),
+    _fromQ31Kernel(NULL)
 {
 }
 
@@ -39,65 +513,348 @@ status_t AudioReformatter::configure(const SampleSpec &ssSrc, const SampleSpec &
         return status;
     }
 
-    if (ssSrc.getFormat() == AUDIO_FORMAT_PCM_16_BIT &&
-            ssDst.getFormat() == AUDIO_FORMAT_PCM_8_24_BIT) {
-
-        _convertSamplesFct =
-                static_cast<SampleConverter>(&AudioReformatter::convertS16toS24over32);
+    _reformatKernel = selectKernel(ssSrc.getFormat(), ssDst.getFormat());
+    if (_reformatKernel != NULL) {
 
-    } else if (ssSrc.getFormat() == AUDIO_FORMAT_PCM_8_24_BIT &&
-               ssDst.getFormat() == AUDIO_FORMAT_PCM_16_BIT) {
-
-        _convertSamplesFct =
-                static_cast<SampleConverter>(&AudioReformatter::convertS24over32toS16);
+        _convertSamplesFct = static_cast<SampleConverter>(&AudioReformatter::reformatFrames);
+        return NO_ERROR;
+    }
 
-    } else {
+    // No direct kernel, samples go through the Q31 pivot format
+    _toQ31Kernel = selectToQ31Kernel(ssSrc.getFormat());
+    _fromQ31Kernel = selectFromQ31Kernel(ssDst.getFormat());
+    if (_toQ31Kernel == NULL || _fromQ31Kernel == NULL) {
 
         LOGE("%s: reformatter not available", __FUNCTION__);
         return INVALID_OPERATION;
     }
+    _convertSamplesFct = static_cast<SampleConverter>(&AudioReformatter::reformatFramesThroughQ31);
+
     return NO_ERROR;
 }
 
-status_t AudioReformatter::convertS16toS24over32(const void *src,
-                                                  void *dst,
-                                                  const uint32_t inFrames,
-                                                  uint32_t *outFrames)
+bool AudioReformatter::supportsInPlace() const
 {
-    uint32_t i;
-    const int16_t *src16 = (const int16_t *)src;
-    uint32_t *dst32 = (uint32_t *)dst;
-    size_t n = inFrames * _ssSrc.getChannelCount();
+    return _ssDst.getFrameSize() <= _ssSrc.getFrameSize();
+}
 
-    for (i = 0; i < n; i ++) {
+AudioReformatter::ReformatKernel AudioReformatter::selectKernel(audio_format_t srcFormat,
+                                                                audio_format_t dstFormat)
+{
+    if (srcFormat == AUDIO_FORMAT_PCM_16_BIT && dstFormat == AUDIO_FORMAT_PCM_8_24_BIT) {
 
-        *(dst32 + i) = (uint32_t)((int32_t) *(src16 + i) << 16) >> 8;
+#ifdef AUDIO_CONVERSION_X86
+#ifdef AUDIO_CONVERSION_AVX2
+        if (CpuFeatures::hasFeature(CpuFeatures::Avx2)) {
+
+            return convertS16toS24over32Avx2;
+        }
+#endif
+#ifdef AUDIO_CONVERSION_SSSE3
+        if (CpuFeatures::hasFeature(CpuFeatures::Ssse3)) {
+
+            return convertS16toS24over32Ssse3;
+        }
+#endif
+        if (CpuFeatures::hasFeature(CpuFeatures::Sse2)) {
+
+            return convertS16toS24over32Sse2;
+        }
+#endif
+#ifdef AUDIO_CONVERSION_NEON
+        return convertS16toS24over32Neon;
+#endif
+        return convertS16toS24over32;
+    }
+
+    if (srcFormat == AUDIO_FORMAT_PCM_8_24_BIT && dstFormat == AUDIO_FORMAT_PCM_16_BIT) {
+
+#ifdef AUDIO_CONVERSION_X86
+#ifdef AUDIO_CONVERSION_AVX2
+        if (CpuFeatures::hasFeature(CpuFeatures::Avx2)) {
+
+            return convertS24over32toS16Avx2;
+        }
+#endif
+#ifdef AUDIO_CONVERSION_SSSE3
+        if (CpuFeatures::hasFeature(CpuFeatures::Ssse3)) {
+
+            return convertS24over32toS16Ssse3;
+        }
+#endif
+        if (CpuFeatures::hasFeature(CpuFeatures::Sse2)) {
+
+            return convertS24over32toS16Sse2;
+        }
+#endif
+#ifdef AUDIO_CONVERSION_NEON
+        return convertS24over32toS16Neon;
+#endif
+        return convertS24over32toS16;
+    }
+
+    // The Q31 pivot format is also the 32 bits format, a single kernel does the conversion
+    if (srcFormat == AUDIO_FORMAT_PCM_32_BIT) {
+
+        return selectFromQ31Kernel(dstFormat);
+    }
+    if (dstFormat == AUDIO_FORMAT_PCM_32_BIT) {
+
+        return selectToQ31Kernel(srcFormat);
+    }
+    return NULL;
+}
+
+AudioReformatter::ReformatKernel AudioReformatter::selectToQ31Kernel(audio_format_t format)
+{
+#ifdef AUDIO_CONVERSION_X86
+    bool useSse2 = CpuFeatures::hasFeature(CpuFeatures::Sse2);
+#endif
+
+    switch (static_cast<uint32_t>(format)) {
+
+    case AUDIO_FORMAT_PCM_16_BIT:
+#ifdef AUDIO_CONVERSION_X86
+        if (useSse2) {
+
+            return convertS16toQ31Sse2;
+        }
+#endif
+        return convertS16toQ31;
+
+    case AUDIO_FORMAT_PCM_8_24_BIT:
+#ifdef AUDIO_CONVERSION_X86
+        if (useSse2) {
+
+            return convertS24over32toQ31Sse2;
+        }
+#endif
+        return convertS24over32toQ31;
+
+    case SampleSpec::PCM_FLOAT_FORMAT:
+#ifdef AUDIO_CONVERSION_X86
+        if (useSse2) {
+
+            return convertFloatToQ31Sse2;
+        }
+#endif
+        return convertFloatToQ31;
+
+    case SampleSpec::PCM_24_BIT_PACKED_FORMAT:
+#ifdef AUDIO_CONVERSION_SSSE3
+        if (CpuFeatures::hasFeature(CpuFeatures::Ssse3)) {
+
+            return convertS24PackedToQ31Ssse3;
+        }
+#endif
+        return convertS24PackedToQ31;
+
+    default:
+        return NULL;
+    }
+}
+
+AudioReformatter::ReformatKernel AudioReformatter::selectFromQ31Kernel(audio_format_t format)
+{
+#ifdef AUDIO_CONVERSION_X86
+    bool useSse2 = CpuFeatures::hasFeature(CpuFeatures::Sse2);
+#endif
+
+    switch (static_cast<uint32_t>(format)) {
+
+    case AUDIO_FORMAT_PCM_16_BIT:
+#ifdef AUDIO_CONVERSION_X86
+        if (useSse2) {
+
+            return convertQ31toS16Sse2;
+        }
+#endif
+        return convertQ31toS16;
+
+    case AUDIO_FORMAT_PCM_8_24_BIT:
+#ifdef AUDIO_CONVERSION_X86
+        if (useSse2) {
+
+            return convertQ31toS24over32Sse2;
+        }
+#endif
+        return convertQ31toS24over32;
+
+    case SampleSpec::PCM_FLOAT_FORMAT:
+#ifdef AUDIO_CONVERSION_X86
+        if (useSse2) {
+
+            return convertQ31toFloatSse2;
+        }
+#endif
+        return convertQ31toFloat;
+
+    case SampleSpec::PCM_24_BIT_PACKED_FORMAT:
+#ifdef AUDIO_CONVERSION_SSSE3
+        if (CpuFeatures::hasFeature(CpuFeatures::Ssse3)) {
+
+            return convertQ31toS24PackedSsse3;
+        }
+#endif
+        return convertQ31toS24Packed;
+
+    default:
+        return NULL;
     }
+}
+
+status_t AudioReformatter::reformatFrames(const void *src,
+                                          void *dst,
+                                          const uint32_t inFrames,
+                                          uint32_t *outFrames)
+{
+    _reformatKernel(src, dst, inFrames * _ssSrc.getChannelCount());
+
     // Transformation is "iso"frames
     *outFrames = inFrames;
 
     return NO_ERROR;
 }
 
-status_t AudioReformatter::convertS24over32toS16(const void *src,
-                                                  void *dst,
-                                                  const uint32_t inFrames,
-                                                  uint32_t *outFrames)
+status_t AudioReformatter::reformatFramesThroughQ31(const void *src,
+                                                    void *dst,
+                                                    const uint32_t inFrames,
+                                                    uint32_t *outFrames)
 {
-    const uint32_t *src32 = (const uint32_t *)src;
-    int16_t *dst16 = (int16_t *)dst;
-    uint32_t i;
-
-    size_t n = inFrames * _ssSrc.getChannelCount();
+    const uint8_t *srcBytes = static_cast<const uint8_t *>(src);
+    uint8_t *dstBytes = static_cast<uint8_t *>(dst);
+    size_t srcSampleSize = SampleSpec::getBytesPerSample(_ssSrc.getFormat());
+    size_t dstSampleSize = SampleSpec::getBytesPerSample(_ssDst.getFormat());
+    size_t samples = inFrames * _ssSrc.getChannelCount();
+    int32_t q31Samples[Q31_CHUNK_SAMPLES];
+    size_t done = 0;
 
-    for (i = 0; i < n; i ++) {
+    // A chunk is read before being written, so in place conversion is safe as far as the
+    // samples do not grow.
+    while (done < samples) {
 
-         *(dst16 + i) = (int16_t) (((int32_t)(*(src32 + i)) <<  8) >> 16);
+        size_t chunk = std::min(samples - done, Q31_CHUNK_SAMPLES);
+        _toQ31Kernel(srcBytes + done * srcSampleSize, q31Samples, chunk);
+        _fromQ31Kernel(q31Samples, dstBytes + done * dstSampleSize, chunk);
+        done += chunk;
     }
+
     // Transformation is "iso"frames
     *outFrames = inFrames;
 
     return NO_ERROR;
 }
 
+void AudioReformatter::convertS16toS24over32(const void *src, void *dst, size_t samples)
+{
+    size_t i;
+    const int16_t *src16 = (const int16_t *)src;
+    uint32_t *dst32 = (uint32_t *)dst;
+
+    for (i = 0; i < samples; i ++) {
+
+        *(dst32 + i) = (uint32_t)((int32_t) *(src16 + i) << 16) >> 8;
+    }
+}
+
+void AudioReformatter::convertS24over32toS16(const void *src, void *dst, size_t samples)
+{
+    const uint32_t *src32 = (const uint32_t *)src;
+    int16_t *dst16 = (int16_t *)dst;
+    size_t i;
+
+    for (i = 0; i < samples; i ++) {
+
+         *(dst16 + i) = (int16_t) (((int32_t)(*(src32 + i)) <<  8) >> 16);
+    }
+}
+
+void AudioReformatter::convertS16toQ31(const void *src, void *dst, size_t samples)
+{
+    const int16_t *src16 = static_cast<const int16_t *>(src);
+    int32_t *dst32 = static_cast<int32_t *>(dst);
+
+    for (size_t i = 0; i < samples; i++) {
+
+        dst32[i] = s16ToQ31(src16[i]);
+    }
+}
+
+void AudioReformatter::convertQ31toS16(const void *src, void *dst, size_t samples)
+{
+    const int32_t *src32 = static_cast<const int32_t *>(src);
+    int16_t *dst16 = static_cast<int16_t *>(dst);
+
+    for (size_t i = 0; i < samples; i++) {
+
+        dst16[i] = q31ToS16(src32[i]);
+    }
+}
+
+void AudioReformatter::convertS24over32toQ31(const void *src, void *dst, size_t samples)
+{
+    const uint32_t *src32 = static_cast<const uint32_t *>(src);
+    int32_t *dst32 = static_cast<int32_t *>(dst);
+
+    for (size_t i = 0; i < samples; i++) {
+
+        dst32[i] = s24over32ToQ31(src32[i]);
+    }
+}
+
+void AudioReformatter::convertQ31toS24over32(const void *src, void *dst, size_t samples)
+{
+    const int32_t *src32 = static_cast<const int32_t *>(src);
+    uint32_t *dst32 = static_cast<uint32_t *>(dst);
+
+    for (size_t i = 0; i < samples; i++) {
+
+        dst32[i] = q31ToS24over32(src32[i]);
+    }
+}
+
+void AudioReformatter::convertS24PackedToQ31(const void *src, void *dst, size_t samples)
+{
+    const uint8_t *src8 = static_cast<const uint8_t *>(src);
+    int32_t *dst32 = static_cast<int32_t *>(dst);
+
+    for (size_t i = 0; i < samples; i++) {
+
+        dst32[i] = s24PackedToQ31(src8 + 3 * i);
+    }
+}
+
+void AudioReformatter::convertQ31toS24Packed(const void *src, void *dst, size_t samples)
+{
+    const int32_t *src32 = static_cast<const int32_t *>(src);
+    uint8_t *dst8 = static_cast<uint8_t *>(dst);
+
+    for (size_t i = 0; i < samples; i++) {
+
+        q31ToS24Packed(src32[i], dst8 + 3 * i);
+    }
+}
+
+void AudioReformatter::convertFloatToQ31(const void *src, void *dst, size_t samples)
+{
+    const float *srcFloat = static_cast<const float *>(src);
+    int32_t *dst32 = static_cast<int32_t *>(dst);
+
+    for (size_t i = 0; i < samples; i++) {
+
+        dst32[i] = floatToQ31(srcFloat[i]);
+    }
+}
+
+void AudioReformatter::convertQ31toFloat(const void *src, void *dst, size_t samples)
+{
+    const int32_t *src32 = static_cast<const int32_t *>(src);
+    float *dstFloat = static_cast<float *>(dst);
+
+    for (size_t i = 0; i < samples; i++) {
+
+        dstFloat[i] = q31ToFloat(src32[i]);
+    }
+}
+
 }; // namespace android
@@ -24,18 +24,103 @@ class AudioReformatter : public AudioConverter {
 public:
     AudioReformatter(SampleSpecItem sampleSpecItem);
 
+protected:
+    /**
+     * Reformat kernel definition.
+     * Kernels work on samples, whatever the channel count is, as reformatting is "iso" frames.
+     *
+     * @param[in] src the source buffer.
+     * @param[out] dst the destination buffer, caller to ensure the destination
+     *             is large enough.
+     * @param[in] samples number of samples to convert.
+     */
+    typedef void (*ReformatKernel)(const void *src, void *dst, size_t samples);
+
+    /**
+     * Selects the fastest kernels supported by the CPU to convert a format to / from
+     * the Q31 pivot format, ie AUDIO_FORMAT_PCM_32_BIT.
+     * Narrowing to 16 or 24 bits rounds to the nearest, float samples are clipped to [-1, 1[.
+     *
+     * @param[in] format format converted to / from Q31.
+     *
+     * @return kernel to use, NULL if the format is not supported.
+     */
+    static ReformatKernel selectToQ31Kernel(audio_format_t format);
+    static ReformatKernel selectFromQ31Kernel(audio_format_t format);
+
+    static const size_t Q31_CHUNK_SAMPLES = 256; /**< Samples converted at once through Q31. */
+
 private:
+    /**
+     * Conversion is done frame per frame, in place is supported if the frame size does not grow.
+     */
+    virtual bool supportsInPlace() const;
+
     virtual android::status_t configure(const SampleSpec &ssSrc, const SampleSpec &ssDst);
 
-    android::status_t convertS16toS24over32(const void *src,
-                                            void *dst,
-                                            const uint32_t inFrames,
-                                            uint32_t *outFrames);
+    /**
+     * Reformats the frames using the kernel selected at configure.
+     *
+     * @param[in] src the source buffer.
+     * @param[out] dst the destination buffer, caller to ensure the destination
+     *             is large enough.
+     * @param[in] inFrames number of input frames.
+     * @param[out] outFrames output frames processed.
+     *
+     * @return error code.
+     */
+    android::status_t reformatFrames(const void *src,
+                                     void *dst,
+                                     const uint32_t inFrames,
+                                     uint32_t *outFrames);
+
+    /**
+     * Reformats the frames through the Q31 pivot format, if no direct kernel is available.
+     * Samples are converted by chunks, within an intermediate buffer on the stack.
+     *
+     * @param[in] src the source buffer.
+     * @param[out] dst the destination buffer, caller to ensure the destination
+     *             is large enough.
+     * @param[in] inFrames number of input frames.
+     * @param[out] outFrames output frames processed.
+     *
+     * @return error code.
+     */
+    android::status_t reformatFramesThroughQ31(const void *src,
+                                               void *dst,
+                                               const uint32_t inFrames,
+                                               uint32_t *outFrames);
+
+    /**
+     * Selects the fastest kernel supported by the CPU for a conversion.
+     * Kernels are chosen once, according to the runtime CPU features, they all output
+     * the same samples as the scalar reference kernel.
+     *
+     * @param[in] srcFormat source format.
+     * @param[in] dstFormat destination format.
+     *
+     * @return kernel to use, NULL if the conversion goes through the Q31 pivot format.
+     */
+    static ReformatKernel selectKernel(audio_format_t srcFormat, audio_format_t dstFormat);
+
+
+    /**
+     * Scalar reference kernels, used if no vector instruction set is available.
+     */
+    static void convertS16toS24over32(const void *src, void *dst, size_t samples);
+    static void convertS24over32toS16(const void *src, void *dst, size_t samples);
+    static void convertS16toQ31(const void *src, void *dst, size_t samples);
+    static void convertQ31toS16(const void *src, void *dst, size_t samples);
+    static void convertS24over32toQ31(const void *src, void *dst, size_t samples);
+    static void convertQ31toS24over32(const void *src, void *dst, size_t samples);
+    static void convertS24PackedToQ31(const void *src, void *dst, size_t samples);
+    static void convertQ31toS24Packed(const void *src, void *dst, size_t samples);
+    static void convertFloatToQ31(const void *src, void *dst, size_t samples);
+    static void convertQ31toFloat(const void *src, void *dst, size_t samples);
 
-    android::status_t convertS24over32toS16(const void *src,
-                                            void *dst,
-                                            const uint32_t inFrames,
-                                            uint32_t *outFrames);
+    ReformatKernel _reformatKernel; /**< Direct kernel selected at configure. */
+    ReformatKernel _toQ31Kernel; /**< Kernel from the source format to Q31. */
+    ReformatKernel _fromQ31Kernel; /**< Kernel from Q31 to the destination format. */
 };
 
 }; // namespace android
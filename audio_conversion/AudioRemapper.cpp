@@ -18,7 +18,18 @@
 #define LOG_TAG "AudioRemapper"
 
 #include "AudioRemapper.h"
+#include "CpuFeatures.h"
 #include <cutils/log.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#ifdef AUDIO_CONVERSION_X86
+#include <emmintrin.h>
+#ifdef AUDIO_CONVERSION_SSSE3
+#include <tmmintrin.h>
+#endif
+#endif
 
 #define base AudioConverter
 
@@ -26,12 +37,287 @@ using namespace android;
 
 namespace android_audio_legacy{
 
+/**
+ * Sample of the packed 24 bits format, little endian.
+ */
+struct Packed24Sample {
+
+    uint8_t bytes[3];
+};
+
 template<> struct AudioRemapper::formatSupported<int16_t> {};
 template<> struct AudioRemapper::formatSupported<uint32_t> {};
+template<> struct AudioRemapper::formatSupported<int32_t> {};
+template<> struct AudioRemapper::formatSupported<float> {};
+template<> struct AudioRemapper::formatSupported<Packed24Sample> {};
+
+/**
+ * Shuffle control value zeroing the destination byte.
+ */
+static const uint8_t shuffleZero = 0x80;
+
+/**
+ * Channel layouts of the sample specifications without a channel mask matching their
+ * channel count, indexed by channel count.
+ */
+static const uint32_t defaultChannelMasks[] = {
+
+    0,
+    AUDIO_CHANNEL_OUT_MONO,
+    AUDIO_CHANNEL_OUT_STEREO,
+    AUDIO_CHANNEL_OUT_STEREO | AUDIO_CHANNEL_OUT_FRONT_CENTER,
+    AUDIO_CHANNEL_OUT_QUAD,
+    AUDIO_CHANNEL_OUT_QUAD | AUDIO_CHANNEL_OUT_FRONT_CENTER,
+    AUDIO_CHANNEL_OUT_5POINT1,
+    AUDIO_CHANNEL_OUT_5POINT1 | AUDIO_CHANNEL_OUT_BACK_CENTER,
+    AUDIO_CHANNEL_OUT_7POINT1
+};
+
+/**
+ * Gains folding each channel position (bit index of the output channel mask) on the front
+ * left and right channels.
+ */
+static const float minus3dB = 0.7071068f;
+static const float foldGains[][2] = {
+
+    { 1.0f, 0.0f },           // Front left
+    { 0.0f, 1.0f },           // Front right
+    { minus3dB, minus3dB },   // Front center
+    { 0.0f, 0.0f },           // Low frequency
+    { minus3dB, 0.0f },       // Back left
+    { 0.0f, minus3dB },       // Back right
+    { 1.0f, 0.0f },           // Front left of center
+    { 0.0f, 1.0f },           // Front right of center
+    { 0.5f, 0.5f },           // Back center
+    { minus3dB, 0.0f },       // Side left
+    { 0.0f, minus3dB },       // Side right
+    { 0.5f, 0.5f },           // Top center
+    { minus3dB, 0.0f },       // Top front left
+    { 0.5f, 0.5f },           // Top front center
+    { 0.0f, minus3dB },       // Top front right
+    { minus3dB, 0.0f },       // Top back left
+    { 0.5f, 0.5f },           // Top back center
+    { 0.0f, minus3dB }        // Top back right
+};
+
+/**
+ * Gets the position of each channel of a sample specification.
+ *
+ * @param[in] sampleSpec sample specification.
+ * @param[out] positions bit of the output channel mask of each channel, 0 if unknown.
+ */
+static void getChannelPositions(const SampleSpec &sampleSpec, uint32_t *positions)
+{
+    uint32_t channels = sampleSpec.getChannelCount();
+    uint32_t mask = sampleSpec.getChannelMask();
+
+    if (static_cast<uint32_t>(__builtin_popcount(mask)) != channels) {
+
+        mask = channels < sizeof(defaultChannelMasks) / sizeof(defaultChannelMasks[0]) ?
+                defaultChannelMasks[channels] : 0;
+    }
+    for (uint32_t channel = 0; channel < channels; channel++) {
+
+        // Channels are interleaved by increasing position
+        positions[channel] = mask & -mask;
+        mask &= mask - 1;
+    }
+}
+
+/**
+ * Finds the channel at a given position.
+ *
+ * @param[in] positions position of each channel.
+ * @param[in] channels number of channels.
+ * @param[in] position position to look for.
+ *
+ * @return index of the channel, channels if not found.
+ */
+static uint32_t findChannel(const uint32_t *positions, uint32_t channels, uint32_t position)
+{
+    uint32_t channel = 0;
+    while (channel < channels && positions[channel] != position) {
+
+        channel++;
+    }
+    return channel;
+}
+
+/**
+ * Gets the position equivalent to a back or side position, 5.1 layouts using either.
+ *
+ * @param[in] position bit of the output channel mask.
+ *
+ * @return equivalent position, 0 if none.
+ */
+static uint32_t getEquivalentPosition(uint32_t position)
+{
+    switch (position) {
+
+    case AUDIO_CHANNEL_OUT_BACK_LEFT:
+        return AUDIO_CHANNEL_OUT_SIDE_LEFT;
+    case AUDIO_CHANNEL_OUT_BACK_RIGHT:
+        return AUDIO_CHANNEL_OUT_SIDE_RIGHT;
+    case AUDIO_CHANNEL_OUT_SIDE_LEFT:
+        return AUDIO_CHANNEL_OUT_BACK_LEFT;
+    case AUDIO_CHANNEL_OUT_SIDE_RIGHT:
+        return AUDIO_CHANNEL_OUT_BACK_RIGHT;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Converts a sample to a signed integer, 8_24 samples being sign extended.
+ */
+template<typename type>
+static inline int32_t sampleToInt(type sample);
+
+template<>
+inline int32_t sampleToInt<int16_t>(int16_t sample)
+{
+    return sample;
+}
+
+template<>
+inline int32_t sampleToInt<uint32_t>(uint32_t sample)
+{
+    return static_cast<int32_t>(sample << 8) >> 8;
+}
+
+template<>
+inline int32_t sampleToInt<int32_t>(int32_t sample)
+{
+    return sample;
+}
+
+template<>
+inline int32_t sampleToInt<Packed24Sample>(Packed24Sample sample)
+{
+    uint32_t value = (static_cast<uint32_t>(sample.bytes[0]) << 8) |
+            (static_cast<uint32_t>(sample.bytes[1]) << 16) |
+            (static_cast<uint32_t>(sample.bytes[2]) << 24);
+    return static_cast<int32_t>(value) >> 8;
+}
+
+/**
+ * Converts a signed integer to a sample, with saturation.
+ */
+template<typename type>
+static inline type intToSample(int64_t value);
+
+template<>
+inline int16_t intToSample<int16_t>(int64_t value)
+{
+    static const int64_t max16 = (1 << 15) - 1;
+    static const int64_t min16 = -(1 << 15);
+    return static_cast<int16_t>(value > max16 ? max16 : value < min16 ? min16 : value);
+}
+
+template<>
+inline uint32_t intToSample<uint32_t>(int64_t value)
+{
+    static const int64_t max24 = (1 << 23) - 1;
+    static const int64_t min24 = -(1 << 23);
+    value = value > max24 ? max24 : value < min24 ? min24 : value;
+    return static_cast<uint32_t>(value) & 0xffffff;
+}
+
+template<>
+inline int32_t intToSample<int32_t>(int64_t value)
+{
+    static const int64_t max32 = 0x7fffffff;
+    static const int64_t min32 = -max32 - 1;
+    return static_cast<int32_t>(value > max32 ? max32 : value < min32 ? min32 : value);
+}
+
+template<>
+inline Packed24Sample intToSample<Packed24Sample>(int64_t value)
+{
+    uint32_t sample = intToSample<uint32_t>(value);
+    Packed24Sample packed = {{ static_cast<uint8_t>(sample),
+                               static_cast<uint8_t>(sample >> 8),
+                               static_cast<uint8_t>(sample >> 16) }};
+    return packed;
+}
+
+/**
+ * Mixing arithmetic of a sample type: integer samples are mixed in fixed point, within
+ * a 64 bits accumulator, then rounded and saturated. Float samples are mixed in float and
+ * never clipped.
+ */
+template<typename type>
+struct MixTraits {
+
+    typedef int32_t Value;
+    typedef int64_t Accumulator;
+
+    static Value fromSample(type sample) { return sampleToInt<type>(sample); }
+
+    /** Mix starts with half a quantum, so that the final shift rounds to the nearest. */
+    static Accumulator initialMix(uint32_t shift) { return 1 << (shift - 1); }
+
+    static type toSample(Accumulator mix, uint32_t shift)
+    {
+        return intToSample<type>(mix >> shift);
+    }
+};
+
+template<>
+struct MixTraits<float> {
+
+    typedef float Value;
+    typedef float Accumulator;
+
+    static Value fromSample(float sample) { return sample; }
+
+    static Accumulator initialMix(uint32_t) { return 0.0f; }
+
+    static float toSample(Accumulator mix, uint32_t shift) { return mix / (1 << shift); }
+};
+
+/**
+ * Floored average of two samples, (a + b) / 2 without overflow.
+ * Sign of the type is kept by the shifts (arithmetic for int16_t, logical for uint32_t).
+ */
+template<typename type>
+static inline type averageSamples(type a, type b)
+{
+    return (a >> 1) + (b >> 1) + (a & b & 1);
+}
+
+#ifdef AUDIO_CONVERSION_X86
+
+template<typename type>
+static inline __m128i averageSamples(__m128i a, __m128i b);
+
+template<>
+inline __m128i averageSamples<int16_t>(__m128i a, __m128i b)
+{
+    __m128i odd = _mm_and_si128(_mm_and_si128(a, b), _mm_set1_epi16(1));
+    return _mm_add_epi16(_mm_add_epi16(_mm_srai_epi16(a, 1), _mm_srai_epi16(b, 1)), odd);
+}
+
+template<>
+inline __m128i averageSamples<uint32_t>(__m128i a, __m128i b)
+{
+    __m128i odd = _mm_and_si128(_mm_and_si128(a, b), _mm_set1_epi32(1));
+    return _mm_add_epi32(_mm_add_epi32(_mm_srli_epi32(a, 1), _mm_srli_epi32(b, 1)), odd);
+}
+
+template<>
+inline __m128i averageSamples<int32_t>(__m128i a, __m128i b)
+{
+    __m128i odd = _mm_and_si128(_mm_and_si128(a, b), _mm_set1_epi32(1));
+    return _mm_add_epi32(_mm_add_epi32(_mm_srai_epi32(a, 1), _mm_srai_epi32(b, 1)), odd);
+}
+
+#endif
 
 AudioRemapper::AudioRemapper(SampleSpecItem sampleSpecItem) :
     base(sampleSpecItem)
 {
+    memset(_remapTable, 0, sizeof(_remapTable));
 }
 
 status_t AudioRemapper::configure(const SampleSpec &ssSrc, const SampleSpec &ssDst)
@@ -42,7 +328,7 @@ status_t AudioRemapper::configure(const SampleSpec &ssSrc, const SampleSpec &ssD
         return ret;
     }
 
-    switch (ssSrc.getFormat()) {
+    switch (static_cast<uint32_t>(ssSrc.getFormat())) {
 
     case AUDIO_FORMAT_PCM_16_BIT:
 
@@ -54,6 +340,22 @@ status_t AudioRemapper::configure(const SampleSpec &ssSrc, const SampleSpec &ssD
         ret = configure<uint32_t>();
         break;
 
+    case AUDIO_FORMAT_PCM_32_BIT:
+
+        ret = configure<int32_t>();
+        break;
+
+    case SampleSpec::PCM_FLOAT_FORMAT:
+
+        // Float and packed samples can not be averaged bitwise, they are always mixed
+        ret = configureMix<float>();
+        break;
+
+    case SampleSpec::PCM_24_BIT_PACKED_FORMAT:
+
+        ret = configureMix<Packed24Sample>();
+        break;
+
     default:
 
         ret = INVALID_OPERATION;
@@ -69,152 +371,580 @@ android::status_t AudioRemapper::configure()
 {
     formatSupported<type>();
 
-    if (_ssSrc.isMono() && _ssDst.isStereo()) {
+    if ((_ssSrc.getChannelCount() > MaxChannels) || (_ssDst.getChannelCount() > MaxChannels)) {
 
-        _convertSamplesFct =
-                static_cast<SampleConverter>(&AudioRemapper::convertMonoToStereo<type>);
-    } else if (_ssSrc.isStereo() && _ssDst.isMono()) {
+        return configureMix<type>();
+    }
 
-        _convertSamplesFct =
-                static_cast<SampleConverter>(&AudioRemapper::convertStereoToMono<type>);
-    } else if (_ssSrc.isStereo() && _ssDst.isStereo()) {
+    if ((_ssSrc.isMono() && _ssDst.isMono()) ||
+        (!_ssSrc.isMono() && !_ssSrc.isStereo()) ||
+        (!_ssDst.isMono() && !_ssDst.isStereo())) {
 
-        // Iso channel, checks the channels policy
-        if (!SampleSpec::isSampleSpecItemEqual(ChannelCountSampleSpecItem, _ssSrc, _ssDst)) {
+        return INVALID_OPERATION;
+    }
+    if (SampleSpec::isSampleSpecItemEqual(ChannelCountSampleSpecItem, _ssSrc, _ssDst)) {
 
-            _convertSamplesFct =
-                  static_cast<SampleConverter>(&AudioRemapper::convertChannelsPolicyInStereo<type>);
-        }
-    } else {
+        // Iso channel with same channels policy, nothing to remap
+        return OK;
+    }
+
+    compileRemapTable();
+    compileShuffleControls(sizeof(type));
+    selectRemapKernel<type>();
+
+    return OK;
+}
+
+template<typename type>
+android::status_t AudioRemapper::configureMix()
+{
+    formatSupported<type>();
+
+    if ((_ssSrc.getChannelCount() > SampleSpec::MAX_CHANNELS) ||
+        (_ssDst.getChannelCount() > SampleSpec::MAX_CHANNELS) ||
+        (_ssSrc.getChannelCount() == 0) || (_ssDst.getChannelCount() == 0)) {
 
         return INVALID_OPERATION;
     }
+    if (SampleSpec::isSampleSpecItemEqual(ChannelCountSampleSpecItem, _ssSrc, _ssDst)) {
+
+        // Same channels layout, nothing to remap
+        return OK;
+    }
+    compileMixMatrix();
+    selectMixKernel<type>();
+
     return OK;
 }
 
 template<typename type>
-status_t AudioRemapper::convertStereoToMono(const void *src,
-                                            void *dst,
-                                            const uint32_t inFrames,
-                                            uint32_t *outFrames)
+void AudioRemapper::selectRemapKernel()
+{
+    if (_ssSrc.isMono()) {
+
+        _convertSamplesFct = getRemapKernel<type, 1, 2>();
+    } else if (_ssDst.isMono()) {
+
+        _convertSamplesFct = getRemapKernel<type, 2, 1>();
+    } else {
+
+        _convertSamplesFct = getRemapKernel<type, 2, 2>();
+    }
+}
+
+template<typename type, uint32_t srcChannels, uint32_t dstChannels>
+AudioConverter::SampleConverter AudioRemapper::getRemapKernel()
+{
+#ifdef AUDIO_CONVERSION_SSSE3
+    if (CpuFeatures::hasFeature(CpuFeatures::Ssse3)) {
+
+        return static_cast<SampleConverter>(
+                    &AudioRemapper::remapFramesSsse3<type, srcChannels, dstChannels>);
+    }
+#endif
+    return static_cast<SampleConverter>(
+                &AudioRemapper::remapFrames<type, srcChannels, dstChannels>);
+}
+
+bool AudioRemapper::supportsInPlace() const
+{
+    return _ssDst.getFrameSize() <= _ssSrc.getFrameSize();
+}
+
+void AudioRemapper::compileRemapTable()
 {
-    const type *srcTyped = static_cast<const type *>(src);
-    type *dstTyped = static_cast<type *>(dst);
     uint32_t srcChannels = _ssSrc.getChannelCount();
-    size_t frames;
+    uint32_t dstChannels = _ssDst.getChannelCount();
+    uint32_t validSrcChannel[MaxChannels];
+    uint32_t validSrcChannels = 0;
 
-    for (frames = 0; frames < inFrames; frames++) {
+    // Average on all valid source channels
+    for (uint32_t channel = 0; channel < srcChannels; channel++) {
 
-        dstTyped[frames] = getAveragedSrcFrame<type>(&srcTyped[srcChannels * frames]);
+        if (_ssSrc.getChannelsPolicy(channel) != SampleSpec::Ignore) {
+
+            validSrcChannel[validSrcChannels++] = channel;
+        }
+    }
+    RemapEntry average = { 0, 0, 0 };
+    if (validSrcChannels != 0) {
+
+        average.srcA = validSrcChannel[0];
+        average.srcB = validSrcChannel[validSrcChannels - 1];
+        average.mask = ~0u;
+    }
+
+    for (uint32_t channel = 0; channel < dstChannels; channel++) {
+
+        RemapEntry *entry = &_remapTable[channel];
+        SampleSpec::ChannelsPolicy dstPolicy = _ssDst.getChannelsPolicy(channel);
+
+        if (_ssDst.isMono()) {
+
+            *entry = average;
+        } else if (dstPolicy == SampleSpec::Ignore) {
+
+            // Destination policy is Ignore, so set to null dest sample
+            entry->srcA = entry->srcB = 0;
+            entry->mask = 0;
+        } else if (_ssSrc.isMono()) {
+
+            entry->srcA = entry->srcB = 0;
+            entry->mask = ~0u;
+        } else if ((dstPolicy == SampleSpec::Copy) &&
+                   (_ssSrc.getChannelsPolicy(channel) != SampleSpec::Ignore)) {
+
+            entry->srcA = entry->srcB = channel;
+            entry->mask = ~0u;
+        } else {
+
+            // Destination policy is Average, or Copy from an ignored source channel
+            *entry = average;
+        }
+    }
+}
+
+void AudioRemapper::compileLayoutMatrix(std::vector<float> &matrix) const
+{
+    uint32_t srcChannels = _ssSrc.getChannelCount();
+    uint32_t dstChannels = _ssDst.getChannelCount();
+    uint32_t srcPositions[SampleSpec::MAX_CHANNELS];
+    uint32_t dstPositions[SampleSpec::MAX_CHANNELS];
+
+    getChannelPositions(_ssSrc, srcPositions);
+    getChannelPositions(_ssDst, dstPositions);
+    uint32_t dstLeft = findChannel(dstPositions, dstChannels, AUDIO_CHANNEL_OUT_FRONT_LEFT);
+    uint32_t dstRight = findChannel(dstPositions, dstChannels, AUDIO_CHANNEL_OUT_FRONT_RIGHT);
+
+    for (uint32_t src = 0; src < srcChannels; src++) {
+
+        if (_ssSrc.getChannelsPolicy(src) == SampleSpec::Ignore) {
+
+            continue;
+        }
+        uint32_t dst = findChannel(dstPositions, dstChannels, srcPositions[src]);
+        uint32_t equivalentPosition = getEquivalentPosition(srcPositions[src]);
+        if ((dst == dstChannels) && (equivalentPosition != 0) &&
+            (findChannel(srcPositions, srcChannels, equivalentPosition) == srcChannels)) {
+
+            // Back channels are played on side channels (or the opposite) if not used
+            dst = findChannel(dstPositions, dstChannels, equivalentPosition);
+        }
+
+        if (_ssSrc.isMono() && (dstLeft < dstChannels || dstRight < dstChannels)) {
+
+            // Mono source on the front channels, as for stereo
+            if (dstLeft < dstChannels) {
+
+                matrix[dstLeft * srcChannels + src] = 1.0f;
+            }
+            if (dstRight < dstChannels) {
+
+                matrix[dstRight * srcChannels + src] = 1.0f;
+            }
+        } else if (_ssDst.isMono()) {
+
+            uint32_t bit = srcPositions[src] != 0 ? __builtin_ctz(srcPositions[src]) : 0;
+            matrix[src] = bit < sizeof(foldGains) / sizeof(foldGains[0]) ?
+                    (foldGains[bit][0] + foldGains[bit][1]) / 2 : 0.5f;
+        } else if ((srcPositions[src] != 0) && (dst < dstChannels)) {
+
+            matrix[dst * srcChannels + src] = 1.0f;
+        } else if ((srcPositions[src] == 0) || (dstPositions[0] == 0)) {
+
+            // Unknown layout, channels are copied by index
+            if (src < dstChannels) {
+
+                matrix[src * srcChannels + src] = 1.0f;
+            }
+        } else {
+
+            uint32_t bit = __builtin_ctz(srcPositions[src]);
+            if (bit < sizeof(foldGains) / sizeof(foldGains[0])) {
+
+                if (dstLeft < dstChannels) {
+
+                    matrix[dstLeft * srcChannels + src] = foldGains[bit][0];
+                }
+                if (dstRight < dstChannels) {
+
+                    matrix[dstRight * srcChannels + src] = foldGains[bit][1];
+                }
+            }
+        }
+    }
+
+    // Destination channels policies
+    std::vector<float> average(srcChannels, 0.0f);
+    for (uint32_t dst = 0; dst < dstChannels; dst++) {
+
+        for (uint32_t src = 0; src < srcChannels; src++) {
+
+            average[src] += matrix[dst * srcChannels + src] / dstChannels;
+        }
+    }
+    for (uint32_t dst = 0; dst < dstChannels; dst++) {
+
+        SampleSpec::ChannelsPolicy policy = _ssDst.getChannelsPolicy(dst);
+        float *row = &matrix[dst * srcChannels];
+        if (policy == SampleSpec::Ignore) {
+
+            std::fill(row, row + srcChannels, 0.0f);
+        } else if (policy == SampleSpec::Average) {
+
+            std::copy(average.begin(), average.end(), row);
+        }
+    }
+}
+
+void AudioRemapper::compileMixMatrix()
+{
+    uint32_t srcChannels = _ssSrc.getChannelCount();
+    uint32_t dstChannels = _ssDst.getChannelCount();
+    std::vector<float> matrix(dstChannels * srcChannels, 0.0f);
+
+    if ((srcChannels <= MaxChannels) && (dstChannels <= MaxChannels)) {
+
+        // Same channels policies as the remap table of the integer formats
+        compileRemapTable();
+        for (uint32_t dst = 0; dst < dstChannels; dst++) {
+
+            const RemapEntry &entry = _remapTable[dst];
+            if (entry.mask != 0) {
+
+                matrix[dst * srcChannels + entry.srcA] += 0.5f;
+                matrix[dst * srcChannels + entry.srcB] += 0.5f;
+            }
+        }
+    } else {
+
+        compileLayoutMatrix(matrix);
+    }
+
+    // Normalization and conversion to fixed point
+    _mixMatrix.resize(dstChannels * srcChannels);
+    for (uint32_t dst = 0; dst < dstChannels; dst++) {
+
+        const float *row = &matrix[dst * srcChannels];
+        float sum = 0.0f;
+        for (uint32_t src = 0; src < srcChannels; src++) {
+
+            sum += fabsf(row[src]);
+        }
+        float scale = sum > 1.0f ? (1 << MixCoefShift) / sum : (1 << MixCoefShift);
+        for (uint32_t src = 0; src < srcChannels; src++) {
+
+            _mixMatrix[dst * srcChannels + src] = static_cast<int16_t>(lrintf(row[src] * scale));
+        }
     }
-    // Transformation is "iso" frames
-    *outFrames = inFrames;
-    return NO_ERROR;
 }
 
 template<typename type>
-status_t AudioRemapper::convertMonoToStereo(const void *src,
-                                            void *dst,
-                                            const uint32_t inFrames,
-                                            uint32_t *outFrames)
+void AudioRemapper::selectMixKernel()
 {
-    const type *srcTyped = static_cast<const type *>(src);
-    type *dstTyped = static_cast<type *>(dst);
-    size_t frames = 0;
+    _convertSamplesFct = static_cast<SampleConverter>(&AudioRemapper::mixFrames<type>);
+#ifdef AUDIO_CONVERSION_X86
+    if ((sizeof(type) != sizeof(int16_t)) || !CpuFeatures::hasFeature(CpuFeatures::Sse2)) {
+
+        return;
+    }
+    uint32_t srcChannels = _ssSrc.getChannelCount();
     uint32_t dstChannels = _ssDst.getChannelCount();
+    if (dstChannels == 2 && srcChannels == 6) {
+
+        _convertSamplesFct = static_cast<SampleConverter>(
+                    &AudioRemapper::mixFramesToStereoSse2<6>);
+    } else if (dstChannels == 2 && srcChannels == 8) {
 
-    for (frames = 0; frames < inFrames; frames++) {
+        _convertSamplesFct = static_cast<SampleConverter>(
+                    &AudioRemapper::mixFramesToStereoSse2<8>);
+    } else if (srcChannels == 2 && dstChannels == 8) {
 
-        uint32_t channels;
-        for (channels = 0; channels < dstChannels; channels++) {
+        _convertSamplesFct = static_cast<SampleConverter>(&AudioRemapper::mixFramesStereoTo8Sse2);
+    }
+#endif
+}
 
-            if (_ssDst.getChannelsPolicy(channels) != SampleSpec::Ignore) {
+template<typename type>
+void AudioRemapper::mixFramesRange(const type *src,
+                                   type *dst,
+                                   uint32_t firstFrame,
+                                   uint32_t lastFrame) const
+{
+    uint32_t srcChannels = _ssSrc.getChannelCount();
+    uint32_t dstChannels = _ssDst.getChannelCount();
+    const int16_t *matrix = &_mixMatrix[0];
+    typename MixTraits<type>::Value srcFrame[SampleSpec::MAX_CHANNELS];
 
-                dstTyped[dstChannels * frames + channels] = srcTyped[frames];
+    for (uint32_t frame = firstFrame; frame < lastFrame; frame++) {
+
+        // Whole source frame is read before writing, as conversion may be done in place
+        for (uint32_t channel = 0; channel < srcChannels; channel++) {
+
+            srcFrame[channel] = MixTraits<type>::fromSample(src[frame * srcChannels + channel]);
+        }
+        for (uint32_t channel = 0; channel < dstChannels; channel++) {
+
+            const int16_t *row = &matrix[channel * srcChannels];
+            typename MixTraits<type>::Accumulator mix = MixTraits<type>::initialMix(MixCoefShift);
+            for (uint32_t srcChannel = 0; srcChannel < srcChannels; srcChannel++) {
+
+                mix += static_cast<typename MixTraits<type>::Accumulator>(srcFrame[srcChannel]) *
+                        row[srcChannel];
             }
+            dst[frame * dstChannels + channel] = MixTraits<type>::toSample(mix, MixCoefShift);
         }
     }
+}
+
+template<typename type>
+status_t AudioRemapper::mixFrames(const void *src,
+                                  void *dst,
+                                  const uint32_t inFrames,
+                                  uint32_t *outFrames)
+{
+    mixFramesRange<type>(static_cast<const type *>(src), static_cast<type *>(dst), 0, inFrames);
 
     // Transformation is "iso" frames
     *outFrames = inFrames;
     return NO_ERROR;
 }
 
-template<typename type>
-status_t AudioRemapper::convertChannelsPolicyInStereo(const void *src,
-                                                      void *dst,
-                                                      const uint32_t inFrames,
-                                                      uint32_t *outFrames)
+#ifdef AUDIO_CONVERSION_X86
+
+/**
+ * Rounds, scales down and saturates the 32 bits mixes of two vectors to 16 bits samples.
+ */
+template<int shift>
+static inline __m128i packMixes(__m128i mix0, __m128i mix1)
 {
-    const type *srcTyped = static_cast<const type *>(src);
-    uint32_t frames = 0;
-    uint32_t srcChannels = _ssSrc.getChannelCount();
+    const __m128i rounding = _mm_set1_epi32(1 << (shift - 1));
+    mix0 = _mm_srai_epi32(_mm_add_epi32(mix0, rounding), shift);
+    mix1 = _mm_srai_epi32(_mm_add_epi32(mix1, rounding), shift);
+    return _mm_packs_epi32(mix0, mix1);
+}
+
+template<uint32_t srcChannels>
+status_t AudioRemapper::mixFramesToStereoSse2(const void *src,
+                                              void *dst,
+                                              const uint32_t inFrames,
+                                              uint32_t *outFrames)
+{
+    static const uint32_t vectorSamples = VectorBytes / sizeof(int16_t);
+    const int16_t *srcTyped = static_cast<const int16_t *>(src);
+    int16_t *dstTyped = static_cast<int16_t *>(dst);
+    int16_t rows[2][vectorSamples];
+
+    // Coefficients beyond the source channels discard the samples of the next frame
+    memset(rows, 0, sizeof(rows));
+    for (uint32_t channel = 0; channel < srcChannels; channel++) {
+
+        rows[0][channel] = _mixMatrix[channel];
+        rows[1][channel] = _mixMatrix[srcChannels + channel];
+    }
+    const __m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[0]));
+    const __m128i right = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[1]));
 
-    struct Stereo {
-        type leftCh;
-        type rightCh;
-    } *dstTyped = static_cast<Stereo *>(dst);
+    // Never read beyond the last source frame
+    uint32_t frame;
+    for (frame = 0; frame * srcChannels + vectorSamples <= inFrames * srcChannels; frame++) {
 
-    for (frames = 0; frames < inFrames; frames++) {
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(
+                                         &srcTyped[frame * srcChannels]));
+        __m128i mixLeft = _mm_madd_epi16(in, left);
+        __m128i mixRight = _mm_madd_epi16(in, right);
 
-        dstTyped[frames].leftCh = convertSample(&srcTyped[srcChannels * frames], Left);
-        dstTyped[frames].rightCh = convertSample(&srcTyped[srcChannels * frames], Right);
+        // Horizontal sums of the left and right partial mixes
+        __m128i sum = _mm_add_epi32(_mm_unpacklo_epi32(mixLeft, mixRight),
+                                    _mm_unpackhi_epi32(mixLeft, mixRight));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+
+        int32_t out = _mm_cvtsi128_si32(packMixes<MixCoefShift>(sum, sum));
+        memcpy(&dstTyped[frame * 2], &out, sizeof(out));
     }
+    mixFramesRange<int16_t>(srcTyped, dstTyped, frame, inFrames);
+
     // Transformation is "iso" frames
     *outFrames = inFrames;
     return NO_ERROR;
 }
 
+status_t AudioRemapper::mixFramesStereoTo8Sse2(const void *src,
+                                               void *dst,
+                                               const uint32_t inFrames,
+                                               uint32_t *outFrames)
+{
+    const int16_t *srcTyped = static_cast<const int16_t *>(src);
+    int16_t *dstTyped = static_cast<int16_t *>(dst);
+    int16_t pairs[2][VectorBytes / sizeof(int16_t)];
 
-template<typename type>
-type AudioRemapper::convertSample(const type *src, Channel channel) const
+    // Left and right coefficients of each destination channel, interleaved as the samples
+    for (uint32_t channel = 0; channel < 8; channel++) {
+
+        pairs[channel / 4][2 * (channel % 4)] = _mixMatrix[2 * channel];
+        pairs[channel / 4][2 * (channel % 4) + 1] = _mixMatrix[2 * channel + 1];
+    }
+    const __m128i coefs0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pairs[0]));
+    const __m128i coefs1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pairs[1]));
+
+    for (uint32_t frame = 0; frame < inFrames; frame++) {
+
+        int32_t stereo;
+        memcpy(&stereo, &srcTyped[frame * 2], sizeof(stereo));
+        __m128i in = _mm_set1_epi32(stereo);
+        __m128i out = packMixes<MixCoefShift>(_mm_madd_epi16(in, coefs0),
+                                              _mm_madd_epi16(in, coefs1));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(&dstTyped[frame * 8]), out);
+    }
+
+    // Transformation is "iso" frames
+    *outFrames = inFrames;
+    return NO_ERROR;
+}
+
+#endif // AUDIO_CONVERSION_X86
+
+void AudioRemapper::compileShuffleControls(size_t sampleSize)
 {
-    SampleSpec::ChannelsPolicy dstPolicy = _ssDst.getChannelsPolicy(channel);
+    uint32_t srcChannels = _ssSrc.getChannelCount();
+    uint32_t dstChannels = _ssDst.getChannelCount();
 
-    if (dstPolicy == SampleSpec::Ignore) {
+    for (uint32_t byte = 0; byte < VectorBytes; byte++) {
 
-        // Destination policy is Ignore, so set to null dest sample
-        return 0;
+        uint32_t sample = byte / sampleSize;
+        uint32_t frame = sample / dstChannels;
+        const RemapEntry &entry = _remapTable[sample % dstChannels];
+        uint32_t srcChannel[2] = { entry.srcA, entry.srcB };
 
-    } else if (dstPolicy == SampleSpec::Average) {
+        for (uint32_t operand = 0; operand < 2; operand++) {
 
-        // Destination policy is average, so average on all channels of the source frame
-        return getAveragedSrcFrame<type>(src);
+            uint32_t srcByte = (frame * srcChannels + srcChannel[operand]) * sampleSize +
+                    byte % sampleSize;
+            bool inFirstVector = srcByte < VectorBytes;
 
+            _shuffleCtrl[operand][0][byte] = inFirstVector ? srcByte : shuffleZero;
+            _shuffleCtrl[operand][1][byte] = inFirstVector ? shuffleZero : srcByte - VectorBytes;
+        }
+        _maskCtrl[byte] = static_cast<uint8_t>(entry.mask);
     }
-    // Destination policy is Copy
-    // so copy only if source channel policy is not ignore
-    if (_ssSrc.getChannelsPolicy(channel) != SampleSpec::Ignore) {
+}
 
-        return src[channel];
+template<typename type, uint32_t srcChannels, uint32_t dstChannels>
+void AudioRemapper::remapFramesRange(const type *src,
+                                     type *dst,
+                                     uint32_t firstFrame,
+                                     uint32_t lastFrame) const
+{
+    // Remap table is loaded once, a mono source may only be read at index 0
+    uint32_t srcA[dstChannels];
+    uint32_t srcB[dstChannels];
+    type mask[dstChannels];
+    for (uint32_t channel = 0; channel < dstChannels; channel++) {
+
+        srcA[channel] = srcChannels == 1 ? 0 : _remapTable[channel].srcA;
+        srcB[channel] = srcChannels == 1 ? 0 : _remapTable[channel].srcB;
+        mask[channel] = static_cast<type>(_remapTable[channel].mask);
+    }
+
+    for (uint32_t frame = firstFrame; frame < lastFrame; frame++) {
+
+        const type *srcFrame = &src[srcChannels * frame];
+        type *dstFrame = &dst[dstChannels * frame];
+        type remappedFrame[dstChannels];
+
+        // Whole source frame is read before writing, as conversion may be done in place
+        for (uint32_t channel = 0; channel < dstChannels; channel++) {
+
+            remappedFrame[channel] = averageSamples<type>(srcFrame[srcA[channel]],
+                                                          srcFrame[srcB[channel]]) & mask[channel];
+        }
+        for (uint32_t channel = 0; channel < dstChannels; channel++) {
+
+            dstFrame[channel] = remappedFrame[channel];
+        }
     }
-    // Even if policy is Copy, if the source channel is Ignore,
-    // take the average of the other source channels
-    return getAveragedSrcFrame<type>(src);
 }
 
-template<typename type>
-type AudioRemapper::getAveragedSrcFrame(const type *src) const
+template<typename type, uint32_t srcChannels, uint32_t dstChannels>
+status_t AudioRemapper::remapFrames(const void *src,
+                                    void *dst,
+                                    const uint32_t inFrames,
+                                    uint32_t *outFrames)
 {
-    uint32_t validSrcChannels = 0;
-    uint64_t dst = 0;
+    remapFramesRange<type, srcChannels, dstChannels>(static_cast<const type *>(src),
+                                                     static_cast<type *>(dst), 0, inFrames);
 
-    // Loops on source channels, checks upon the channel policy to take it into account
-    // or not.
-    // Average on all valid source channels
-    for (uint32_t iSrcChannels = 0; iSrcChannels < _ssSrc.getChannelCount(); iSrcChannels++) {
+    // Transformation is "iso" frames
+    *outFrames = inFrames;
+    return NO_ERROR;
+}
 
-        if (_ssSrc.getChannelsPolicy(iSrcChannels) != SampleSpec::Ignore) {
+#ifdef AUDIO_CONVERSION_SSSE3
 
-            dst += src[iSrcChannels];
-            validSrcChannels += 1;
+template<typename type, uint32_t srcChannels, uint32_t dstChannels>
+AUDIO_CONVERSION_TARGET("ssse3")
+status_t AudioRemapper::remapFramesSsse3(const void *src,
+                                         void *dst,
+                                         const uint32_t inFrames,
+                                         uint32_t *outFrames)
+{
+    // Frames of a vector and the source bytes they need only depend on the channels and format
+    static const uint32_t framesPerVector = VectorBytes / (dstChannels * sizeof(type));
+    static const size_t srcFrameSize = srcChannels * sizeof(type);
+    static const size_t srcBytesPerVector = framesPerVector * srcFrameSize;
+
+    const uint8_t *srcBytes = static_cast<const uint8_t *>(src);
+    type *dstTyped = static_cast<type *>(dst);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ctrlA0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(_shuffleCtrl[0][0]));
+    const __m128i ctrlA1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(_shuffleCtrl[0][1]));
+    const __m128i ctrlB0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(_shuffleCtrl[1][0]));
+    const __m128i ctrlB1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(_shuffleCtrl[1][1]));
+    const __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i *>(_maskCtrl));
+    uint32_t frames;
+
+    for (frames = 0; frames + framesPerVector <= inFrames; frames += framesPerVector) {
+
+        const uint8_t *in = srcBytes + frames * srcFrameSize;
+        __m128i in0;
+        __m128i in1 = zero;
+
+        // Never read beyond the source frames of this vector
+        if (srcBytesPerVector < VectorBytes) {
+
+            in0 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(in));
+        } else {
+
+            in0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+            if (srcBytesPerVector > VectorBytes) {
+
+                in1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + VectorBytes));
+            }
         }
+        __m128i a = _mm_or_si128(_mm_shuffle_epi8(in0, ctrlA0), _mm_shuffle_epi8(in1, ctrlA1));
+        __m128i b = _mm_or_si128(_mm_shuffle_epi8(in0, ctrlB0), _mm_shuffle_epi8(in1, ctrlB1));
+        __m128i out = _mm_and_si128(averageSamples<type>(a, b), mask);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(&dstTyped[frames * dstChannels]), out);
     }
-    if ( validSrcChannels) {
+    remapFramesRange<type, srcChannels, dstChannels>(reinterpret_cast<const type *>(src),
+                                                     dstTyped, frames, inFrames);
 
-        dst = dst /  validSrcChannels;
-    }
-    return dst;
+    // Transformation is "iso" frames
+    *outFrames = inFrames;
+    return NO_ERROR;
 }
 
+#else
+
+template<typename type, uint32_t srcChannels, uint32_t dstChannels>
+status_t AudioRemapper::remapFramesSsse3(const void *src,
+                                         void *dst,
+                                         const uint32_t inFrames,
+                                         uint32_t *outFrames)
+{
+    return remapFrames<type, srcChannels, dstChannels>(src, dst, inFrames, outFrames);
+}
+
+#endif // AUDIO_CONVERSION_SSSE3
+
 }; // namespace android
@@ -16,15 +16,46 @@
 #pragma once
 
 #include "AudioConverter.h"
+#include <vector>
 
 namespace android_audio_legacy {
 
 class AudioRemapper : public AudioConverter {
 
-    enum Channel {
+    /**
+     * Remap table handles mono and stereo streams, wider streams are mixed with a matrix.
+     */
+    enum {
+
+        MaxChannels = 2
+    };
+
+    /**
+     * Fractional bits of the mixing matrix coefficients, 1.0 still fits an int16_t.
+     */
+    enum {
+
+        MixCoefShift = 14
+    };
+
+    /**
+     * Size of the vectors used by the SIMD remap kernel.
+     */
+    enum {
 
-        Left = 0,
-        Right
+        VectorBytes = 16
+    };
+
+    /**
+     * Remap operation of one destination channel, compiled from the channels policies.
+     * Destination sample is the floored average of the source samples at srcA and srcB indexes,
+     * masked with mask. A copy uses the same index twice, an ignored channel uses a null mask.
+     */
+    struct RemapEntry {
+
+        uint32_t srcA; /**< Index of the first source channel to average. */
+        uint32_t srcB; /**< Index of the second source channel to average. */
+        uint32_t mask; /**< Mask applied on the averaged sample. */
     };
 
 public:
@@ -36,6 +67,11 @@ public:
     AudioRemapper(SampleSpecItem sampleSpecItem);
 
 private:
+    /**
+     * Conversion is done frame per frame, in place is supported if the frame size does not grow.
+     */
+    virtual bool supportsInPlace() const;
+
     /**
      * Configure the remapper.
      * Selects the appropriate remap operation to use according to the source
@@ -50,8 +86,7 @@ private:
 
     /**
      * Configure the remapper.
-     * Selects the appropriate remap operation to use according to the source
-     * and destination sample specifications.
+     * Compiles the channels policies into the remap table and selects the remap kernel.
      *
      * @tparam type Audio data format from S16 to S32.
      *
@@ -61,8 +96,63 @@ private:
     android::status_t configure();
 
     /**
-     * Remap from stereo to mono in typed format.
-     * Convert a stereo source into a mono destination in typed format.
+     * Configure the remapper to mix the frames with the mixing matrix.
+     * Used as soon as one side has more than two channels, and whatever the channels for the
+     * float and packed 24 bits formats, as their samples can not be averaged bitwise.
+     *
+     * @tparam type Audio data format.
+     *
+     * @return error code.
+     */
+    template<typename type>
+    android::status_t configureMix();
+
+    /**
+     * Compiles the source and destination channels policies into the remap table.
+     * A mono destination takes the average of the valid source channels, a mono source is
+     * copied on each destination channel not ignored.
+     * In stereo, a destination channel with Ignore policy is zeroed, with Average policy takes
+     * the average of the valid source channels, with Copy policy copies the source channel of
+     * same index (or the average if this source channel is ignored).
+     */
+    void compileRemapTable();
+
+    /**
+     * Compiles the channel masks and channels policies into the mixing matrix.
+     * Up to stereo on both sides, the matrix is the remap table (see compileRemapTable), so
+     * that the float and packed 24 bits formats get the same channels as the other formats.
+     * Otherwise, it is compiled from the channel masks, see compileLayoutMatrix.
+     * Rows are then normalized so that a destination sample never clips.
+     */
+    void compileMixMatrix();
+
+    /**
+     * Compiles the channel masks and channels policies into the mixing matrix, used as soon as
+     * one side has more than two channels.
+     * A source channel is copied on the destination channel at the same position, if any,
+     * back and side positions being equivalent if not both used.
+     * Otherwise it is folded on the front left and right channels (ITU downmix coefficients,
+     * low frequency channel dropped), or on the front center channel for a mono destination.
+     * A mono source is copied on the front left and right channels.
+     * Channels policies still apply: an ignored source channel is not mixed, an ignored
+     * destination channel is zeroed and an average destination channel gets the mix of all
+     * destination channels.
+     *
+     * @param[out] matrix mixing matrix, a row of source channels gains per destination channel,
+     *                    zeroed by the caller.
+     */
+    void compileLayoutMatrix(std::vector<float> &matrix) const;
+
+    /**
+     * Selects the mix kernel, SIMD one for common layouts if supported by the CPU.
+     *
+     * @tparam type Audio data format from S16 to S32, no other type allowed.
+     */
+    template<typename type>
+    void selectMixKernel();
+
+    /**
+     * Mix frames in typed format with the mixing matrix, reference kernel.
      *
      * @tparam type Audio data format from S16 to S32, no other type allowed.
      * @param[in] src the source buffer.
@@ -74,17 +164,29 @@ private:
      * @return error code.
      */
     template<typename type>
-    android::status_t convertStereoToMono(const void *src,
-                                          void *dst,
-                                          const uint32_t inFrames,
-                                          uint32_t *outFrames);
+    android::status_t mixFrames(const void *src,
+                                void *dst,
+                                const uint32_t inFrames,
+                                uint32_t *outFrames);
 
     /**
-     * Remap from mono to stereo in typed format.
-     * Convert a mono source into a stereo destination in typed format
+     * Mix a range of frames with the mixing matrix.
      *
      * @tparam type Audio data format from S16 to S32, no other type allowed.
      * @param[in] src the source buffer.
+     * @param[out] dst the destination buffer.
+     * @param[in] firstFrame index of the first frame to mix.
+     * @param[in] lastFrame index following the last frame to mix.
+     */
+    template<typename type>
+    void mixFramesRange(const type *src, type *dst, uint32_t firstFrame, uint32_t lastFrame) const;
+
+    /**
+     * Downmix S16 frames of up to 8 channels to stereo, SSE2 kernel.
+     * Each source frame is multiplied with a row of coefficients per destination channel.
+     *
+     * @tparam srcChannels number of channels of the source, 8 at most.
+     * @param[in] src the source buffer.
      * @param[out] dst the destination buffer, caller to ensure the destination
      *             is large enough.
      * @param[in] inFrames number of input frames.
@@ -92,18 +194,17 @@ private:
      *
      * @return error code.
      */
-    template<typename type>
-    android::status_t convertMonoToStereo(const void *src,
-                                          void *dst,
-                                          const uint32_t inFrames,
-                                          uint32_t *outFrames);
+    template<uint32_t srcChannels>
+    android::status_t mixFramesToStereoSse2(const void *src,
+                                            void *dst,
+                                            const uint32_t inFrames,
+                                            uint32_t *outFrames);
 
     /**
-     * Remap channels policy in typed format.
-     * Convert a stereo source into a stereo destination in typed format
-     * with different channels policy.
+     * Upmix S16 stereo frames to 8 channels, SSE2 kernel.
+     * Each source frame is broadcast then multiplied with a pair of coefficients per
+     * destination channel.
      *
-     * @tparam type Audio data format from S16 to S32, no other type allowed.
      * @param[in] src the source buffer.
      * @param[out] dst the destination buffer, caller to ensure the destination
      *             is large enough.
@@ -112,38 +213,99 @@ private:
      *
      * @return error code.
      */
+    android::status_t mixFramesStereoTo8Sse2(const void *src,
+                                             void *dst,
+                                             const uint32_t inFrames,
+                                             uint32_t *outFrames);
+
+    /**
+     * Builds the byte shuffle controls used by the SIMD kernel from the remap table.
+     *
+     * @param[in] sampleSize size in bytes of a sample.
+     */
+    void compileShuffleControls(size_t sampleSize);
+
+    /**
+     * Selects the remap kernel specialized for the source and destination channels count.
+     * Kernel is only selected on configure, the conversion function pointer being the kernel
+     * itself: the channels count are not checked again on convert.
+     *
+     * @tparam type Audio data format from S16 to S32, no other type allowed.
+     */
     template<typename type>
-    android::status_t convertChannelsPolicyInStereo(const void *src,
-                                                    void *dst,
-                                                    const uint32_t inFrames,
-                                                    uint32_t *outFrames);
+    void selectRemapKernel();
 
     /**
-     * Convert a source sample in typed format.
-     * Gets destination channel from the source sample according to the destination
-     * channel policy.
+     * Gets the remap kernel of a channels count pair, SIMD one if supported by the CPU.
      *
      * @tparam type Audio data format from S16 to S32, no other type allowed.
-     * @param[in] src16 the source frame.
-     * @param[in] channel the channel of the destination.
+     * @tparam srcChannels number of channels of the source.
+     * @tparam dstChannels number of channels of the destination.
      *
-     * @return destination channel sample.
+     * @return remap kernel.
      */
-    template<typename type>
-    type convertSample(const type *src, Channel channel) const;
+    template<typename type, uint32_t srcChannels, uint32_t dstChannels>
+    static SampleConverter getRemapKernel();
 
     /**
-     * Average source frame in typed format.
-     * Gets an averaged value of the source audio frame taking into
-     * account the policy of the source channels.
+     * Remap frames in typed format, reference kernel.
+     * Channels count are compile time constants, so that the frame loop is fully unrolled.
      *
      * @tparam type Audio data format from S16 to S32, no other type allowed.
-     * @param[in] src16 the source frame.
+     * @tparam srcChannels number of channels of the source.
+     * @tparam dstChannels number of channels of the destination.
+     * @param[in] src the source buffer.
+     * @param[out] dst the destination buffer, caller to ensure the destination
+     *             is large enough.
+     * @param[in] inFrames number of input frames.
+     * @param[out] outFrames output frames processed.
      *
-     * @return destination channel sample.
+     * @return error code.
      */
-    template<typename type>
-    type getAveragedSrcFrame(const type *src16) const;
+    template<typename type, uint32_t srcChannels, uint32_t dstChannels>
+    android::status_t remapFrames(const void *src,
+                                  void *dst,
+                                  const uint32_t inFrames,
+                                  uint32_t *outFrames);
+
+    /**
+     * Remap frames in typed format, SSSE3 kernel.
+     * Gathers the srcA and srcB samples of a vector of destination frames with byte shuffles,
+     * then averages and masks them. Remaining frames are handled by the reference kernel.
+     *
+     * @tparam type Audio data format from S16 to S32, no other type allowed.
+     * @tparam srcChannels number of channels of the source.
+     * @tparam dstChannels number of channels of the destination.
+     * @param[in] src the source buffer.
+     * @param[out] dst the destination buffer, caller to ensure the destination
+     *             is large enough.
+     * @param[in] inFrames number of input frames.
+     * @param[out] outFrames output frames processed.
+     *
+     * @return error code.
+     */
+    template<typename type, uint32_t srcChannels, uint32_t dstChannels>
+    android::status_t remapFramesSsse3(const void *src,
+                                       void *dst,
+                                       const uint32_t inFrames,
+                                       uint32_t *outFrames);
+
+    /**
+     * Remap a range of frames with the remap table.
+     *
+     * @tparam type Audio data format from S16 to S32, no other type allowed.
+     * @tparam srcChannels number of channels of the source.
+     * @tparam dstChannels number of channels of the destination.
+     * @param[in] src the source buffer.
+     * @param[out] dst the destination buffer.
+     * @param[in] firstFrame index of the first frame to remap.
+     * @param[in] lastFrame index following the last frame to remap.
+     */
+    template<typename type, uint32_t srcChannels, uint32_t dstChannels>
+    void remapFramesRange(const type *src,
+                          type *dst,
+                          uint32_t firstFrame,
+                          uint32_t lastFrame) const;
 
     /**
      * provide a compile time error if no specialization is provided for a given type
@@ -152,7 +314,20 @@ private:
      */
     template<typename T>
     struct formatSupported;
+
+    RemapEntry _remapTable[MaxChannels]; /**< Remap operation of each destination channel. */
+
+    /**
+     * Shuffle controls gathering the srcA (index 0) and srcB (index 1) samples from the first
+     * and second source vectors.
+     */
+    uint8_t _shuffleCtrl[2][2][VectorBytes];
+    uint8_t _maskCtrl[VectorBytes]; /**< Destination channels masks of a vector of frames. */
+
+    /**
+     * Mixing matrix, one row of source channels coefficients per destination channel.
+     */
+    std::vector<int16_t> _mixMatrix;
 };
 
 }; // namespace android
-
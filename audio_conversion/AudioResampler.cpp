@@ -20,6 +20,10 @@
 #include <cutils/log.h>
 
 #include "AudioResampler.h"
+#include "AllocationGuard.h"
+#include "AudioUtils.h"
+#include "IntegerRatioResampler.h"
+#include "PolyphaseResampler.h"
 #include "Resampler.h"
 
 #define base AudioConverter
@@ -30,8 +34,12 @@ namespace android_audio_legacy{
 
 AudioResampler::AudioResampler(SampleSpecItem sampleSpecItem) :
     base(sampleSpecItem),
+    _integerResampler(new IntegerRatioResampler(RateSampleSpecItem)),
     _resampler(new Resampler(RateSampleSpecItem)),
+    _polyphaseResampler(new PolyphaseResampler(RateSampleSpecItem)),
     _pivotResampler(new Resampler(RateSampleSpecItem)),
+    _pivotBuffer(NULL),
+    _pivotBufferSamples(0),
     _activeResamplerList()
 {
 }
@@ -39,8 +47,38 @@ AudioResampler::AudioResampler(SampleSpecItem sampleSpecItem) :
 AudioResampler::~AudioResampler()
 {
     _activeResamplerList.clear();
+    delete _integerResampler;
     delete _resampler;
+    delete _polyphaseResampler;
     delete _pivotResampler;
+    delete []_pivotBuffer;
+}
+
+void AudioResampler::setQuality(PolyphaseResampler::Quality quality)
+{
+    _polyphaseResampler->setQuality(quality);
+}
+
+status_t AudioResampler::allocatePivotBuffer(size_t frames)
+{
+    // One more frame for the resampler
+    size_t samples = (frames + 1) * _pivotSs.getChannelCount();
+
+    if (samples <= _pivotBufferSamples) {
+
+        return NO_ERROR;
+    }
+    AllocationGuard::checkAllocation(__FUNCTION__);
+    delete []_pivotBuffer;
+    _pivotBuffer = new float[samples];
+    if (!_pivotBuffer) {
+
+        LOGE("%s: cannot allocate pivot buffer", __FUNCTION__);
+        _pivotBufferSamples = 0;
+        return NO_MEMORY;
+    }
+    _pivotBufferSamples = samples;
+    return NO_ERROR;
 }
 
 status_t AudioResampler::configure(const SampleSpec &ssSrc, const SampleSpec &ssDst)
@@ -53,18 +91,38 @@ status_t AudioResampler::configure(const SampleSpec &ssSrc, const SampleSpec &ss
         return status;
     }
 
+    // Integer ratios on 16 bits samples do not need any conversion to float
+    status = _integerResampler->configure(ssSrc, ssDst);
+    if (status == NO_ERROR) {
+
+        LOGD("%s: using integer ratio resampler", __FUNCTION__);
+        _activeResamplerList.push_back(_integerResampler);
+        return NO_ERROR;
+    }
+
     status = _resampler->configure(ssSrc, ssDst);
     if (status != NO_ERROR) {
 
         //
         // Our resampling lib does not support all conversions
-        // using 2 resamplers
+        // prefer the single pass polyphase resampler
+        //
+        status = _polyphaseResampler->configure(ssSrc, ssDst);
+        if (status == NO_ERROR) {
+
+            LOGD("%s: using polyphase resampler", __FUNCTION__);
+            _activeResamplerList.push_back(_polyphaseResampler);
+            return NO_ERROR;
+        }
+
+        //
+        // Otherwise using 2 resamplers
         //
         LOGD("%s: trying to use working sample rate @ 48kHz", __FUNCTION__);
-        SampleSpec pivotSs = ssDst;
-        pivotSs.setSampleRate(PIVOT_SAMPLE_RATE);
+        _pivotSs = ssDst;
+        _pivotSs.setSampleRate(PIVOT_SAMPLE_RATE);
 
-        status = _pivotResampler->configure(ssSrc, pivotSs);
+        status = _pivotResampler->configure(ssSrc, _pivotSs);
         if (status != NO_ERROR) {
 
             LOGD("%s: trying to use pivot sample rate @ %dkHz: FAILED",
@@ -73,18 +131,75 @@ status_t AudioResampler::configure(const SampleSpec &ssSrc, const SampleSpec &ss
         }
         _activeResamplerList.push_back(_pivotResampler);
 
-        status = _resampler->configure(pivotSs, ssDst);
+        status = _resampler->configure(_pivotSs, ssDst);
         if (status != NO_ERROR) {
 
             LOGD("%s: trying to use pivot sample rate @ 48kHz: FAILED", __FUNCTION__);
             return status;
         }
+
+        // Samples are only converted from / to float at the edges of the pivot chain
+        _pivotResampler->setFloatInterface(false, true);
+        _resampler->setFloatInterface(true, false);
     }
     _activeResamplerList.push_back(_resampler);
 
     return NO_ERROR;
 }
 
+status_t AudioResampler::reserve(size_t maxInFrames)
+{
+    size_t frames = maxInFrames;
+
+    ResamplerListIterator it;
+    for (it = _activeResamplerList.begin(); it != _activeResamplerList.end(); ++it) {
+
+        AudioConverter *conv = *it;
+        status_t status = conv->reserve(frames);
+        if (status != NO_ERROR) {
+
+            return status;
+        }
+        if (conv != _activeResamplerList.back()) {
+
+            // Same sizing as the pivot buffer of convert
+            frames = AudioUtils::convertSrcToDstInFrames(frames, _ssSrc, _pivotSs);
+            status = allocatePivotBuffer(frames);
+            if (status != NO_ERROR) {
+
+                return status;
+            }
+        }
+    }
+    return NO_ERROR;
+}
+
+size_t AudioResampler::getDelayFrames() const
+{
+    size_t delayFrames = 0;
+
+    // Resampling library does not expose the delay of its engine, only the filters of the
+    // integer ratio and polyphase resamplers are counted
+    ResamplerListConstIterator it;
+    for (it = _activeResamplerList.begin(); it != _activeResamplerList.end(); ++it) {
+
+        const AudioConverter *conv = *it;
+        delayFrames += AudioUtils::convertSrcToDstInFrames(conv->getDelayFrames(),
+                                                           conv->getDstSampleSpec(),
+                                                           _ssDst);
+    }
+    return delayFrames;
+}
+
+void AudioResampler::reset()
+{
+    ResamplerListIterator it;
+    for (it = _activeResamplerList.begin(); it != _activeResamplerList.end(); ++it) {
+
+        (*it)->reset();
+    }
+}
+
 status_t AudioResampler::convert(const void *src,
                                   void **dst,
                                   uint32_t inFrames,
@@ -98,10 +213,21 @@ status_t AudioResampler::convert(const void *src,
     ResamplerListIterator it;
     for (it = _activeResamplerList.begin(); it != _activeResamplerList.end(); ++it) {
 
-        Resampler *conv = *it;
+        AudioConverter *conv = *it;
         dstFrames = 0;
+        dstBuf = NULL;
+
+        if (conv != _activeResamplerList.back()) {
+
+            // Pivot resampler outputs float samples within the intermediate buffer
+            status_t status = allocatePivotBuffer(
+                AudioUtils::convertSrcToDstInFrames(srcFrames, _ssSrc, _pivotSs));
+            if (status != NO_ERROR) {
 
-        if (*dst && conv == _activeResamplerList.back()) {
+                return status;
+            }
+            dstBuf = _pivotBuffer;
+        } else if (*dst) {
 
             // Last converter must output within the provided buffer (if provided!!!)
             dstBuf = *dst;
@@ -17,20 +17,28 @@
 
 #include <list>
 #include "AudioConverter.h"
+#include "PolyphaseResampler.h"
 
 namespace android_audio_legacy {
 
-class Resampler;
-
 class AudioResampler : public AudioConverter {
 
-    typedef std::list<Resampler *>::iterator ResamplerListIterator;
+    typedef std::list<AudioConverter *>::iterator ResamplerListIterator;
+    typedef std::list<AudioConverter *>::const_iterator ResamplerListConstIterator;
 
 public:
     AudioResampler(SampleSpecItem sampleSpecItem);
 
     virtual ~AudioResampler();
 
+    /**
+     * Selects the quality level of the polyphase resampler, ie of the rate pairs the resampling
+     * library does not support. Medium by default, applied on next configure.
+     *
+     * @param[in] quality quality level of the filter.
+     */
+    void setQuality(PolyphaseResampler::Quality quality);
+
 private:
     // forbid copy
     AudioResampler(const AudioResampler &);
@@ -47,11 +55,54 @@ private:
                                       uint32_t inFrames,
                                       uint32_t *outFrames);
 
+    /**
+     * Allocates the buffers of the active resamplers, and the pivot buffer between them, for
+     * a maximum number of input frames per call.
+     *
+     * @param[in] maxInFrames maximum number of frames in the source sample specification.
+     *
+     * @return status OK if the buffers are allocated, error code otherwise.
+     */
+    virtual android::status_t reserve(size_t maxInFrames);
+
+    /**
+     * Gets the delay of the active resamplers, the delay of the pivot resampler being counted
+     * at the destination sample rate as well.
+     *
+     * @return delay in frames at the destination sample rate.
+     */
+    virtual size_t getDelayFrames() const;
+
+    /**
+     * Resets the active resamplers.
+     */
+    virtual void reset();
+
+    /**
+     * Ensures the intermediate buffer of the pivot chain holds enough float samples.
+     *
+     * @param[in] frames number of frames at pivot sample rate.
+     *
+     * @return error code.
+     */
+    android::status_t allocatePivotBuffer(size_t frames);
+
+    AudioConverter *_integerResampler; /**< Fixed point path for the integer ratios. */
     Resampler *_resampler;
+    /** Single pass fallback for the unsupported rate pairs. */
+    PolyphaseResampler *_polyphaseResampler;
     Resampler *_pivotResampler;
 
+    /**
+     * Output of the pivot resampler, input of the second resampler.
+     * Samples stay in float between the two stages.
+     */
+    float *_pivotBuffer;
+    size_t _pivotBufferSamples; /**< Size of the pivot buffer in samples. */
+    SampleSpec _pivotSs; /**< Sample specifications at pivot sample rate. */
+
     // List of audio converter enabled
-    std::list<Resampler *> _activeResamplerList;
+    std::list<AudioConverter *> _activeResamplerList;
 
     static const uint32_t PIVOT_SAMPLE_RATE = 48000;
 };
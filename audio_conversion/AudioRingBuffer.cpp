@@ -0,0 +1,144 @@
+/*
+ **
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#define LOG_TAG "AudioRingBuffer"
+
+#include "AudioRingBuffer.h"
+#include "AllocationGuard.h"
+#include <cutils/log.h>
+#include <string.h>
+#include <algorithm>
+
+using namespace android;
+using namespace std;
+
+namespace android_audio_legacy{
+
+AudioRingBuffer::AudioRingBuffer() :
+    _buffer(NULL),
+    _capacity(0),
+    _frameSize(0),
+    _readIndex(0),
+    _writeIndex(0)
+{
+}
+
+AudioRingBuffer::~AudioRingBuffer()
+{
+    delete []_buffer;
+}
+
+status_t AudioRingBuffer::allocate(size_t frames, size_t frameSize)
+{
+    size_t capacity = 1;
+    while (capacity < frames) {
+
+        capacity <<= 1;
+    }
+
+    reset();
+
+    if (capacity == _capacity && frameSize == _frameSize && _buffer) {
+
+        return NO_ERROR;
+    }
+
+    AllocationGuard::checkAllocation(__FUNCTION__);
+    delete []_buffer;
+    _buffer = new char[capacity * frameSize];
+    if (!_buffer) {
+
+        LOGE("%s: cannot allocate ring buffer", __FUNCTION__);
+        _capacity = 0;
+        _frameSize = 0;
+        return NO_MEMORY;
+    }
+    _capacity = capacity;
+    _frameSize = frameSize;
+    return NO_ERROR;
+}
+
+void AudioRingBuffer::reset()
+{
+    _readIndex = 0;
+    _writeIndex = 0;
+}
+
+size_t AudioRingBuffer::getReadView(const void **view) const
+{
+    size_t position = _readIndex & (_capacity - 1);
+
+    *view = _buffer + position * _frameSize;
+    return min(getAvailableFrames(), _capacity - position);
+}
+
+void AudioRingBuffer::consume(size_t frames)
+{
+    LOG_ALWAYS_FATAL_IF(frames > getAvailableFrames());
+    _readIndex += frames;
+}
+
+size_t AudioRingBuffer::getWriteView(void **view) const
+{
+    size_t position = _writeIndex & (_capacity - 1);
+
+    *view = _buffer + position * _frameSize;
+    return min(getFreeFrames(), _capacity - position);
+}
+
+void AudioRingBuffer::produce(size_t frames)
+{
+    LOG_ALWAYS_FATAL_IF(frames > getFreeFrames());
+    _writeIndex += frames;
+}
+
+size_t AudioRingBuffer::read(void *dst, size_t frames)
+{
+    char *dstBytes = static_cast<char *>(dst);
+    size_t framesRead = 0;
+
+    // At most two contiguous views: until the end of the storage, then from its beginning
+    while (framesRead < frames && getAvailableFrames() != 0) {
+
+        const void *view;
+        size_t viewFrames = min(getReadView(&view), frames - framesRead);
+
+        memcpy(dstBytes + framesRead * _frameSize, view, viewFrames * _frameSize);
+        consume(viewFrames);
+        framesRead += viewFrames;
+    }
+    return framesRead;
+}
+
+size_t AudioRingBuffer::write(const void *src, size_t frames)
+{
+    const char *srcBytes = static_cast<const char *>(src);
+    size_t framesWritten = 0;
+
+    while (framesWritten < frames && getFreeFrames() != 0) {
+
+        void *view;
+        size_t viewFrames = min(getWriteView(&view), frames - framesWritten);
+
+        memcpy(view, srcBytes + framesWritten * _frameSize, viewFrames * _frameSize);
+        produce(viewFrames);
+        framesWritten += viewFrames;
+    }
+    return framesWritten;
+}
+
+}; // namespace android
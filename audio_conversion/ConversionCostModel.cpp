@@ -0,0 +1,221 @@
+/*
+ **
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#define LOG_TAG "ConversionCostModel"
+
+#include "ConversionCostModel.h"
+#include "AudioDitherer.h"
+#include "AudioFusedConverter.h"
+#include "AudioReformatter.h"
+#include "AudioRemapper.h"
+#include "AudioResampler.h"
+#include "AudioUtils.h"
+#include <cutils/log.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+using namespace android;
+
+namespace android_audio_legacy{
+
+/**
+ * Default costs of a sample, in nanoseconds, per kind of converter.
+ * Measured by calibrate with the SSE2 kernels, except the float resampler cost, estimated for
+ * the resampling library of the target.
+ */
+float ConversionCostModel::_sampleCost[NbStages] = {
+
+    0.07f, // RemapStage
+    0.03f, // ReformatStage
+    0.47f, // DitherStage
+    3.20f, // FixedResampleStage
+    6.00f, // FloatResampleStage
+    0.04f  // FusedStage
+};
+
+float ConversionCostModel::_byteCost = 0.007f;
+
+static const char *const stageNames[ConversionCostModel::NbStages] = {
+
+    "remap", "reformat", "dither", "fixed_resample", "float_resample", "fused"
+};
+
+/**
+ * Lowest cost of a sample, a calibration lost in the measurement noise must not make a
+ * converter free.
+ */
+static const double MIN_SAMPLE_COST = 0.01;
+
+static double nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+float ConversionCostModel::getStepCost(Stage stage, const SampleSpec &ssSrc,
+                                       const SampleSpec &ssDst)
+{
+    LOG_ALWAYS_FATAL_IF(stage >= NbStages);
+
+    // Samples and bytes read and written for one second of audio
+    float srcSamples = static_cast<float>(ssSrc.getSampleRate()) * ssSrc.getChannelCount();
+    float dstSamples = static_cast<float>(ssDst.getSampleRate()) * ssDst.getChannelCount();
+    float bytes = srcSamples * SampleSpec::getBytesPerSample(ssSrc.getFormat()) +
+            dstSamples * SampleSpec::getBytesPerSample(ssDst.getFormat());
+
+    return _sampleCost[stage] * (srcSamples + dstSamples) + _byteCost * bytes;
+}
+
+const char *ConversionCostModel::getStageName(Stage stage)
+{
+    LOG_ALWAYS_FATAL_IF(stage >= NbStages);
+    return stageNames[stage];
+}
+
+void ConversionCostModel::calibrate()
+{
+    // Representative conversion of each kind of converter, on stereo 48 kHz streams if possible
+    struct Calibration {
+
+        Stage stage;
+        AudioConverter *converter;
+        SampleSpec ssSrc;
+        SampleSpec ssDst;
+    };
+    Calibration calibrations[NbStages] = {
+
+        { RemapStage, new AudioRemapper(ChannelCountSampleSpecItem),
+          SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, 48000),
+          SampleSpec(1, AUDIO_FORMAT_PCM_16_BIT, 48000) },
+        { ReformatStage, new AudioReformatter(FormatSampleSpecItem),
+          SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, 48000),
+          SampleSpec(2, AUDIO_FORMAT_PCM_8_24_BIT, 48000) },
+        { DitherStage, new AudioDitherer(FormatSampleSpecItem),
+          SampleSpec(2, AUDIO_FORMAT_PCM_8_24_BIT, 48000),
+          SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, 48000) },
+        { FixedResampleStage, new AudioResampler(RateSampleSpecItem),
+          SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, 16000),
+          SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, 48000) },
+        { FloatResampleStage, new AudioResampler(RateSampleSpecItem),
+          SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, 44100),
+          SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, 48000) },
+        { FusedStage, new AudioFusedConverter(),
+          SampleSpec(1, AUDIO_FORMAT_PCM_16_BIT, 48000),
+          SampleSpec(2, AUDIO_FORMAT_PCM_8_24_BIT, 48000) }
+    };
+
+    double byteCost = measureByteCost();
+    if (byteCost > 0) {
+
+        _byteCost = static_cast<float>(byteCost);
+    }
+    for (int i = 0; i < NbStages; i++) {
+
+        Calibration &calibration = calibrations[i];
+        double samples;
+        double bytes;
+        double ns = measureConverter(calibration.converter, calibration.ssSrc,
+                                     calibration.ssDst, &samples, &bytes);
+        delete calibration.converter;
+        if (ns < 0) {
+
+            LOGW("%s: cannot measure %s, keeping default cost", __FUNCTION__,
+                 stageNames[calibration.stage]);
+            continue;
+        }
+        double sampleCost = (ns - _byteCost * bytes) / samples;
+        _sampleCost[calibration.stage] = static_cast<float>(sampleCost > MIN_SAMPLE_COST ?
+                                                            sampleCost : MIN_SAMPLE_COST);
+        LOGD("%s: %s %.3f ns per sample", __FUNCTION__, stageNames[calibration.stage],
+             _sampleCost[calibration.stage]);
+    }
+    LOGD("%s: %.4f ns per byte", __FUNCTION__, _byteCost);
+}
+
+double ConversionCostModel::measureConverter(AudioConverter *converter,
+                                             const SampleSpec &ssSrc,
+                                             const SampleSpec &ssDst,
+                                             double *samples,
+                                             double *bytes)
+{
+    // Streams are converted by periods of 10 ms
+    uint32_t frames = ssSrc.getSampleRate() / 100;
+    if (converter->configure(ssSrc, ssDst) != NO_ERROR ||
+        converter->reserve(frames) != NO_ERROR) {
+
+        return -1;
+    }
+    std::vector<uint8_t> src(ssSrc.convertFramesToBytes(frames));
+    std::vector<uint8_t> dst(ssDst.convertFramesToBytes(
+                                 AudioUtils::convertSrcToDstInFrames(frames, ssSrc, ssDst) + 1));
+    uint32_t outFrames = 0;
+
+    double best = -1;
+    for (uint32_t repetition = 0; repetition <= CALIBRATION_REPETITIONS; repetition++) {
+
+        double start = nowNs();
+        for (uint32_t period = 0; period < CALIBRATION_PERIODS; period++) {
+
+            void *dstBuf = &dst[0];
+            if (converter->convert(&src[0], &dstBuf, frames, &outFrames) != NO_ERROR) {
+
+                return -1;
+            }
+        }
+        double elapsed = (nowNs() - start) / CALIBRATION_PERIODS;
+
+        // First repetition only warms up the caches
+        if (repetition != 0 && (best < 0 || elapsed < best)) {
+
+            best = elapsed;
+        }
+    }
+    *samples = static_cast<double>(frames) * ssSrc.getChannelCount() +
+            static_cast<double>(outFrames) * ssDst.getChannelCount();
+    *bytes = static_cast<double>(src.size()) + ssDst.convertFramesToBytes(outFrames);
+    return best;
+}
+
+double ConversionCostModel::measureByteCost()
+{
+    // Size of a period of a stereo 8_24 stream at 48 kHz
+    static const size_t size = 480 * 2 * sizeof(uint32_t);
+    std::vector<uint8_t> src(size, 0);
+    std::vector<uint8_t> dst(size);
+
+    double best = -1;
+    for (uint32_t repetition = 0; repetition <= CALIBRATION_REPETITIONS; repetition++) {
+
+        double start = nowNs();
+        for (uint32_t period = 0; period < CALIBRATION_PERIODS; period++) {
+
+            memcpy(&dst[0], &src[0], size);
+            // Keeps the copies, the compiler must not merge them
+            src[period % size] = dst[(period * 7) % size];
+        }
+        double elapsed = (nowNs() - start) / CALIBRATION_PERIODS;
+        if (repetition != 0 && (best < 0 || elapsed < best)) {
+
+            best = elapsed;
+        }
+    }
+    return best / (2 * size);
+}
+
+}; // namespace android
@@ -0,0 +1,128 @@
+/*
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+#pragma once
+
+#include <SampleSpec.h>
+
+namespace android_audio_legacy {
+
+class AudioConverter;
+
+/**
+ * Streaming cost model of the converters, used to plan the order of a conversion chain.
+ * The cost of a converter is linear in the samples it reads and writes, with a coefficient per
+ * kind of converter, plus the cost of the bytes it moves, shared by all the converters.
+ * Costs are expressed in nanoseconds of CPU: the cost of a step is the CPU time needed to
+ * convert one second of audio. Coefficients have defaults, they may be measured again on the
+ * running platform by calibrate.
+ */
+class ConversionCostModel {
+
+public:
+    /**
+     * Kinds of converters, each with its own cost per sample.
+     */
+    enum Stage {
+
+        RemapStage, /**< Remapper, channels count or policy. */
+        ReformatStage, /**< Reformatter, rounding if narrowing the samples. */
+        DitherStage, /**< Ditherer, requantizes the samples to 16 bits. */
+        FixedResampleStage, /**< Resampler using the fixed point integer ratio path. */
+        FloatResampleStage, /**< Resampler working in float. */
+        FusedStage, /**< Fused converter, remaps and reformats in a single pass. */
+        NbStages
+    };
+
+    /**
+     * Gets the estimated cost of a converter.
+     *
+     * @param[in] stage kind of converter.
+     * @param[in] ssSrc source sample specifications of the converter.
+     * @param[in] ssDst destination sample specifications of the converter.
+     *
+     * @return CPU time to convert one second of audio, in nanoseconds.
+     */
+    static float getStepCost(Stage stage, const SampleSpec &ssSrc, const SampleSpec &ssDst);
+
+    /**
+     * Measures the coefficients of the model on the running platform.
+     * Each kind of converter converts a few periods of a representative conversion, and the
+     * cost of the bytes is measured with a memory copy. Coefficients are process wide, so
+     * calibrate must be called before the streams are configured, typically at startup: it
+     * takes a few milliseconds and allocates.
+     */
+    static void calibrate();
+
+    /**
+     * Gets the cost of a sample read or written by a kind of converter.
+     *
+     * @param[in] stage kind of converter.
+     *
+     * @return cost in nanoseconds.
+     */
+    static float getSampleCost(Stage stage) { return _sampleCost[stage]; }
+
+    /**
+     * Gets the cost of a byte read or written by any converter.
+     *
+     * @return cost in nanoseconds.
+     */
+    static float getByteCost() { return _byteCost; }
+
+    /**
+     * Gets the name of a kind of converter, for debugging purposes.
+     *
+     * @param[in] stage kind of converter.
+     *
+     * @return name of the stage.
+     */
+    static const char *getStageName(Stage stage);
+
+private:
+    /**
+     * Measures the time taken by a converter for a few periods.
+     *
+     * @param[in] converter converter to measure.
+     * @param[in] ssSrc source sample specifications to configure.
+     * @param[in] ssDst destination sample specifications to configure.
+     * @param[out] samples samples read and written by the converter for one period.
+     * @param[out] bytes bytes read and written by the converter for one period.
+     *
+     * @return best time for one period in nanoseconds, negative if the conversion failed.
+     */
+    static double measureConverter(AudioConverter *converter,
+                                   const SampleSpec &ssSrc,
+                                   const SampleSpec &ssDst,
+                                   double *samples,
+                                   double *bytes);
+
+    /**
+     * Measures the time taken to copy a byte, read and write.
+     *
+     * @return cost of a byte in nanoseconds.
+     */
+    static double measureByteCost();
+
+    static float _sampleCost[NbStages]; /**< Cost of a sample, per kind of converter. */
+
+    static float _byteCost; /**< Cost of a byte, whatever the converter. */
+
+    static const uint32_t CALIBRATION_PERIODS = 50; /**< Periods measured per repetition. */
+
+    static const uint32_t CALIBRATION_REPETITIONS = 3; /**< Best time of the repetitions. */
+};
+
+}; // namespace android
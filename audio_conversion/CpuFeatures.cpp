@@ -0,0 +1,100 @@
+/*
+ **
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#define LOG_TAG "CpuFeatures"
+
+#include "CpuFeatures.h"
+#include <cutils/log.h>
+
+#ifdef AUDIO_CONVERSION_X86
+#include <cpuid.h>
+#endif
+
+namespace android_audio_legacy {
+
+volatile uint32_t CpuFeatures::_features = 0;
+
+volatile bool CpuFeatures::_detected = false;
+
+bool CpuFeatures::hasFeature(Feature feature)
+{
+    // Detection is idempotent, concurrent first calls will simply detect twice.
+    if (!_detected) {
+
+        _features = detect();
+        _detected = true;
+    }
+    return (_features & feature) != 0;
+}
+
+#ifdef AUDIO_CONVERSION_X86
+
+uint32_t CpuFeatures::detect()
+{
+    uint32_t features = 0;
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+
+        LOGW("%s: cpuid not supported", __FUNCTION__);
+        return features;
+    }
+    if (edx & bit_SSE2) {
+
+        features |= Sse2;
+    }
+    if (ecx & bit_SSSE3) {
+
+        features |= Ssse3;
+    }
+
+    // AVX2 also requires the OS to save the YMM registers (OSXSAVE + XCR0 bits 1 and 2)
+    bool osSavesYmm = false;
+    if ((ecx & bit_OSXSAVE) && (ecx & bit_AVX)) {
+
+        uint32_t xcr0Low, xcr0High;
+        __asm__ __volatile__ (".byte 0x0f, 0x01, 0xd0" : "=a" (xcr0Low), "=d" (xcr0High) : "c" (0));
+        osSavesYmm = (xcr0Low & 0x6) == 0x6;
+    }
+    if (osSavesYmm && (__get_cpuid_max(0, NULL) >= 7)) {
+
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        if (ebx & (1 << 5)) {
+
+            features |= Avx2;
+        }
+    }
+    LOGD("%s: sse2=%d ssse3=%d avx2=%d", __FUNCTION__,
+         (features & Sse2) != 0, (features & Ssse3) != 0, (features & Avx2) != 0);
+    return features;
+}
+
+#else
+
+uint32_t CpuFeatures::detect()
+{
+#ifdef AUDIO_CONVERSION_NEON
+    // NEON kernels are only built when the whole module targets NEON
+    return Neon;
+#else
+    return 0;
+#endif
+}
+
+#endif
+
+}; // namespace android
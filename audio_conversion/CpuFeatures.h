@@ -0,0 +1,87 @@
+/*
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#define AUDIO_CONVERSION_X86 1
+#endif
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define AUDIO_CONVERSION_NEON 1
+#endif
+
+/**
+ * Per-function instruction set selection.
+ * Kernels built for an instruction set not enabled for the whole module are tagged with the
+ * target attribute, so that they can be picked at runtime according to the CPU features.
+ * Intrinsics headers only allow it from GCC 4.9 (or clang), older compilers only get the
+ * kernels enabled by the module flags.
+ */
+#if defined(AUDIO_CONVERSION_X86) && \
+    (defined(__clang__) || (__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)))
+#define AUDIO_CONVERSION_TARGET(isa) __attribute__((target(isa)))
+#define AUDIO_CONVERSION_SSSE3 1
+#define AUDIO_CONVERSION_AVX2 1
+#else
+#define AUDIO_CONVERSION_TARGET(isa)
+#if defined(__SSSE3__)
+#define AUDIO_CONVERSION_SSSE3 1
+#endif
+#if defined(__AVX2__)
+#define AUDIO_CONVERSION_AVX2 1
+#endif
+#endif
+
+namespace android_audio_legacy {
+
+class CpuFeatures {
+
+public:
+    /**
+     * Instruction set extensions the conversion kernels may rely on.
+     */
+    enum Feature {
+        Sse2 = 1 << 0,
+        Ssse3 = 1 << 1,
+        Avx2 = 1 << 2,
+        Neon = 1 << 3
+    };
+
+    /**
+     * Checks if the CPU running the process supports an instruction set extension.
+     * Detection is done once, on first call, then cached.
+     *
+     * @param[in] feature instruction set extension to check.
+     *
+     * @return true if supported by both the CPU and the OS, false otherwise.
+     */
+    static bool hasFeature(Feature feature);
+
+private:
+    /**
+     * Queries the CPU for its features.
+     *
+     * @return bit field of supported Feature.
+     */
+    static uint32_t detect();
+
+    static volatile uint32_t _features; /**< Cached features, valid if _detected is set. */
+    static volatile bool _detected; /**< Features detection done. */
+};
+
+}; // namespace android
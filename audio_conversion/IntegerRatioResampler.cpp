@@ -0,0 +1,429 @@
+/*
+ **
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#define LOG_TAG "IntegerRatioResampler"
+
+#include "IntegerRatioResampler.h"
+#include "AllocationGuard.h"
+#include "CpuFeatures.h"
+#include <cutils/log.h>
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+#ifdef AUDIO_CONVERSION_X86
+#include <emmintrin.h>
+#endif
+
+#ifdef AUDIO_CONVERSION_NEON
+#include <arm_neon.h>
+#endif
+
+#define base AudioConverter
+
+using namespace android;
+
+namespace android_audio_legacy{
+
+/** Cutoff frequency, relative to the lowest Nyquist frequency. */
+static const double ROLLOFF = 0.90;
+
+/** Kaiser window shape parameter. */
+static const double BETA = 7.0;
+
+static const int32_t Q15_ONE = 1 << 15;
+
+static inline int16_t roundQ15(int32_t sum)
+{
+    int32_t sample = (sum + (Q15_ONE >> 1)) >> 15;
+
+    if (sample > SHRT_MAX) {
+
+        return SHRT_MAX;
+    } else if (sample < SHRT_MIN) {
+
+        return SHRT_MIN;
+    }
+    return static_cast<int16_t>(sample);
+}
+
+static void filterPhases(const int16_t *coefs, const int16_t *samples, size_t taps,
+                         uint32_t phases, int16_t *dst, size_t dstStride)
+{
+    for (uint32_t phase = 0; phase < phases; phase++, coefs += taps) {
+
+        int32_t sum = 0;
+        for (size_t k = 0; k < taps; k++) {
+
+            sum += coefs[k] * samples[k];
+        }
+        dst[phase * dstStride] = roundQ15(sum);
+    }
+}
+
+#ifdef AUDIO_CONVERSION_X86
+
+static void filterPhasesSse2(const int16_t *coefs, const int16_t *samples, size_t taps,
+                             uint32_t phases, int16_t *dst, size_t dstStride)
+{
+    const __m128i rounding = _mm_set1_epi32(Q15_ONE >> 1);
+
+    for (uint32_t phase = 0; phase < phases; phase++, coefs += taps) {
+
+        // Two accumulators to hide the latency of the additions
+        __m128i sum0 = _mm_setzero_si128();
+        __m128i sum1 = _mm_setzero_si128();
+        size_t k;
+
+        for (k = 0; k + 16 <= taps; k += 16) {
+
+            sum0 = _mm_add_epi32(sum0, _mm_madd_epi16(
+                        _mm_loadu_si128(reinterpret_cast<const __m128i *>(coefs + k)),
+                        _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + k))));
+            sum1 = _mm_add_epi32(sum1, _mm_madd_epi16(
+                        _mm_loadu_si128(reinterpret_cast<const __m128i *>(coefs + k + 8)),
+                        _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + k + 8))));
+        }
+        for (; k < taps; k += 8) {
+
+            sum0 = _mm_add_epi32(sum0, _mm_madd_epi16(
+                        _mm_loadu_si128(reinterpret_cast<const __m128i *>(coefs + k)),
+                        _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + k))));
+        }
+        sum0 = _mm_add_epi32(sum0, sum1);
+        sum0 = _mm_add_epi32(sum0, _mm_shuffle_epi32(sum0, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum0 = _mm_add_epi32(sum0, _mm_shuffle_epi32(sum0, _MM_SHUFFLE(2, 3, 0, 1)));
+
+        // Round, then saturate on 16 bits with the pack
+        sum0 = _mm_srai_epi32(_mm_add_epi32(sum0, rounding), 15);
+        dst[phase * dstStride] =
+                static_cast<int16_t>(_mm_cvtsi128_si32(_mm_packs_epi32(sum0, sum0)));
+    }
+}
+
+#endif
+
+#ifdef AUDIO_CONVERSION_NEON
+
+static void filterPhasesNeon(const int16_t *coefs, const int16_t *samples, size_t taps,
+                             uint32_t phases, int16_t *dst, size_t dstStride)
+{
+    for (uint32_t phase = 0; phase < phases; phase++, coefs += taps) {
+
+        int32x4_t sum = vdupq_n_s32(0);
+        for (size_t k = 0; k < taps; k += 4) {
+
+            sum = vmlal_s16(sum, vld1_s16(coefs + k), vld1_s16(samples + k));
+        }
+        int32x2_t half = vadd_s32(vget_low_s32(sum), vget_high_s32(sum));
+        dst[phase * dstStride] = roundQ15(vget_lane_s32(vpadd_s32(half, half), 0));
+    }
+}
+
+#endif
+
+IntegerRatioResampler::IntegerRatioResampler(SampleSpecItem sampleSpecItem) :
+    base(sampleSpecItem),
+    _phases(0),
+    _step(0),
+    _taps(0),
+    _coefs(NULL),
+    _channels(0),
+    _history(NULL),
+    _historyFrames(0),
+    _position(0),
+    _filter(NULL)
+{
+}
+
+IntegerRatioResampler::~IntegerRatioResampler()
+{
+    delete []_coefs;
+    delete []_history;
+}
+
+bool IntegerRatioResampler::supportsConversion(const SampleSpec &ssSrc, const SampleSpec &ssDst)
+{
+    uint32_t phases;
+    uint32_t step;
+    return ssSrc.getFormat() == AUDIO_FORMAT_PCM_16_BIT &&
+           getFactors(ssSrc.getSampleRate(), ssDst.getSampleRate(), &phases, &step);
+}
+
+bool IntegerRatioResampler::getFactors(uint32_t srcRate, uint32_t dstRate, uint32_t *phases,
+                                       uint32_t *step)
+{
+    *phases = 1;
+    *step = 1;
+    if (srcRate == 0 || dstRate == 0) {
+
+        return false;
+    }
+    if (dstRate > srcRate && dstRate % srcRate == 0) {
+
+        *phases = dstRate / srcRate;
+    } else if (srcRate > dstRate && srcRate % dstRate == 0) {
+
+        *step = srcRate / dstRate;
+    }
+    return isFactorSupported(*phases * *step);
+}
+
+bool IntegerRatioResampler::isFactorSupported(uint32_t factor)
+{
+    return factor == 2 || factor == 3 || factor == 6;
+}
+
+double IntegerRatioResampler::besselI0(double x)
+{
+    double sum = 1;
+    double term = 1;
+    double halfX = x / 2;
+
+    for (int k = 1; k < 50; k++) {
+
+        term *= (halfX / k) * (halfX / k);
+        sum += term;
+        if (term < sum * 1e-12) {
+
+            break;
+        }
+    }
+    return sum;
+}
+
+status_t IntegerRatioResampler::computeCoefficients()
+{
+    // The prototype spans LOW_RATE_TAPS frames at the lowest rate
+    uint32_t taps = LOW_RATE_TAPS * _step;
+
+    delete []_coefs;
+    _coefs = new int16_t[_phases * taps];
+    if (!_coefs) {
+
+        LOGE("%s: cannot allocate coefficient table", __FUNCTION__);
+        return NO_MEMORY;
+    }
+
+    // Cutoff relative to the source Nyquist frequency, lowered when decimating
+    double cutoff = ROLLOFF / _step;
+    double halfLength = taps / 2.0;
+    double windowNorm = besselI0(BETA);
+    std::vector<double> coefs(taps);
+
+    for (uint32_t phase = 0; phase < _phases; phase++) {
+
+        double sum = 0;
+
+        for (uint32_t tap = 0; tap < taps; tap++) {
+
+            // Distance in source frames between the tap and the output frame
+            double x = tap - (halfLength - 1) - (double)phase / _phases;
+            double sinc = (x == 0) ? 1 : sin(M_PI * cutoff * x) / (M_PI * cutoff * x);
+            double u = x / halfLength;
+            double window = (u * u < 1) ? besselI0(BETA * sqrt(1 - u * u)) / windowNorm : 0;
+
+            coefs[tap] = cutoff * sinc * window;
+            sum += coefs[tap];
+        }
+
+        // Unity gain at DC on each phase, rounding error is given to the largest coefficient
+        int16_t *phaseCoefs = &_coefs[phase * taps];
+        int32_t quantizedSum = 0;
+        uint32_t largest = 0;
+        for (uint32_t tap = 0; tap < taps; tap++) {
+
+            phaseCoefs[tap] = static_cast<int16_t>(lrint(coefs[tap] / sum * Q15_ONE));
+            quantizedSum += phaseCoefs[tap];
+            if (phaseCoefs[tap] > phaseCoefs[largest]) {
+
+                largest = tap;
+            }
+        }
+        int32_t adjusted = phaseCoefs[largest] + Q15_ONE - quantizedSum;
+        LOG_ALWAYS_FATAL_IF(adjusted >= Q15_ONE);
+        phaseCoefs[largest] = static_cast<int16_t>(adjusted);
+    }
+    _taps = taps;
+    return NO_ERROR;
+}
+
+status_t IntegerRatioResampler::allocateHistory(size_t frames)
+{
+    if (frames <= _historyFrames) {
+
+        return NO_ERROR;
+    }
+    AllocationGuard::checkAllocation(__FUNCTION__);
+    int16_t *history = new int16_t[frames * _channels];
+    if (!history) {
+
+        LOGE("%s: cannot allocate history buffer", __FUNCTION__);
+        return NO_MEMORY;
+    }
+    // Keep the history frames of each channel
+    for (uint32_t channel = 0; channel < _channels; channel++) {
+
+        int16_t *channelHistory = &history[channel * frames];
+        if (_history) {
+
+            memcpy(channelHistory, &_history[channel * _historyFrames],
+                   (_taps - 1) * sizeof(int16_t));
+        } else {
+
+            memset(channelHistory, 0, (_taps - 1) * sizeof(int16_t));
+        }
+    }
+    delete []_history;
+    _history = history;
+    _historyFrames = frames;
+    return NO_ERROR;
+}
+
+status_t IntegerRatioResampler::configure(const SampleSpec &ssSrc, const SampleSpec &ssDst)
+{
+    status_t status = base::configure(ssSrc, ssDst);
+    if (status != NO_ERROR) {
+
+        return status;
+    }
+    uint32_t phases;
+    uint32_t step;
+    if (ssSrc.getFormat() != AUDIO_FORMAT_PCM_16_BIT ||
+        !getFactors(ssSrc.getSampleRate(), ssDst.getSampleRate(), &phases, &step)) {
+
+        return INVALID_OPERATION;
+    }
+
+    // Coefficient table is only computed when the ratio changes
+    if (!_coefs || phases != _phases || step != _step) {
+
+        _phases = phases;
+        _step = step;
+        status = computeCoefficients();
+        if (status != NO_ERROR) {
+
+            return status;
+        }
+    }
+
+    // New stream: history is reset to silence
+    delete []_history;
+    _history = NULL;
+    _historyFrames = 0;
+    _channels = ssSrc.getChannelCount();
+    _position = 0;
+    status = allocateHistory(_taps - 1 + ssSrc.convertUsecToframes(20000));
+    if (status != NO_ERROR) {
+
+        return status;
+    }
+
+    _filter = filterPhases;
+#ifdef AUDIO_CONVERSION_X86
+    if (CpuFeatures::hasFeature(CpuFeatures::Sse2)) {
+
+        _filter = filterPhasesSse2;
+    }
+#endif
+#ifdef AUDIO_CONVERSION_NEON
+    _filter = filterPhasesNeon;
+#endif
+
+    _convertSamplesFct = static_cast<SampleConverter>(&IntegerRatioResampler::resampleFrames);
+
+    LOGD("%s: %d -> %d, %d phases of %d taps", __FUNCTION__, ssSrc.getSampleRate(),
+         ssDst.getSampleRate(), _phases, _taps);
+    return NO_ERROR;
+}
+
+status_t IntegerRatioResampler::reserve(size_t maxInFrames)
+{
+    return allocateHistory(_taps - 1 + maxInFrames);
+}
+
+size_t IntegerRatioResampler::getDelayFrames() const
+{
+    // Inner products are centered half of the taps before their last source frame
+    return convertSrcToDstInFrames(_taps / 2);
+}
+
+void IntegerRatioResampler::reset()
+{
+    for (uint32_t channel = 0; channel < _channels; channel++) {
+
+        memset(&_history[channel * _historyFrames], 0, (_taps - 1) * sizeof(int16_t));
+    }
+    _position = 0;
+}
+
+status_t IntegerRatioResampler::resampleFrames(const void *src,
+                                               void *dst,
+                                               const uint32_t inFrames,
+                                               uint32_t *outFrames)
+{
+    const int16_t *srcSamples = static_cast<const int16_t *>(src);
+    int16_t *dstSamples = static_cast<int16_t *>(dst);
+    size_t historyFrames = _taps - 1;
+    size_t totalFrames = historyFrames + inFrames;
+
+    status_t status = allocateHistory(totalFrames);
+    if (status != NO_ERROR) {
+
+        *outFrames = 0;
+        return status;
+    }
+
+    // Planar copy of the input after the history frames
+    for (uint32_t channel = 0; channel < _channels; channel++) {
+
+        int16_t *channelFrames = &_history[channel * _historyFrames + historyFrames];
+        for (uint32_t frame = 0; frame < inFrames; frame++) {
+
+            channelFrames[frame] = srcSamples[frame * _channels + channel];
+        }
+    }
+
+    size_t position = _position;
+    uint32_t frames = 0;
+
+    // Each input position gives the frames of all the phases: one of them when decimating
+    while (position + _taps <= totalFrames) {
+
+        for (uint32_t channel = 0; channel < _channels; channel++) {
+
+            _filter(_coefs, &_history[channel * _historyFrames + position], _taps, _phases,
+                    &dstSamples[frames * _channels + channel], _channels);
+        }
+        frames += _phases;
+        position += _step;
+    }
+
+    // Keep the last frames as history of next call
+    for (uint32_t channel = 0; channel < _channels; channel++) {
+
+        int16_t *channelFrames = &_history[channel * _historyFrames];
+        memmove(channelFrames, channelFrames + inFrames, historyFrames * sizeof(int16_t));
+    }
+    _position = position - inFrames;
+
+    *outFrames = frames;
+    return NO_ERROR;
+}
+
+}; // namespace android
@@ -0,0 +1,160 @@
+/*
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#pragma once
+
+#include "AudioConverter.h"
+
+namespace android_audio_legacy {
+
+/**
+ * Fixed point resampler for the integer ratios between voice and media rates.
+ * Interpolates or decimates 16 bits samples by 2, 3 or 6 (8k <-> 16k, 16k <-> 48k,
+ * 8k <-> 48k...) with a polyphase FIR of Q15 coefficients, without any conversion to float.
+ * The prototype filter spans the same number of frames at the lowest rate whatever the
+ * ratio, so the delay is constant: half of the prototype length, in frames at the highest
+ * rate.
+ */
+class IntegerRatioResampler : public AudioConverter {
+
+public:
+    /**
+     * Constructor of the integer ratio resampler.
+     *
+     * @param[in] sampleSpecItem Sample specification item on which this audio
+     *             converter is working on.
+     */
+    IntegerRatioResampler(SampleSpecItem sampleSpecItem);
+
+    virtual ~IntegerRatioResampler();
+
+    /**
+     * Configures the resampler.
+     * Only 16 bits samples and ratios supported by the fixed point path are accepted.
+     *
+     * @param[in] ssSrc source sample specifications.
+     * @param[in] ssDst destination sample specification.
+     *
+     * @return status OK if the ratio is supported, error code otherwise.
+     */
+    virtual android::status_t configure(const SampleSpec &ssSrc, const SampleSpec &ssDst);
+
+    /**
+     * Checks if a rate conversion is supported by the fixed point path.
+     *
+     * @param[in] ssSrc source sample specifications.
+     * @param[in] ssDst destination sample specification.
+     *
+     * @return true if the format and the ratio are supported, false otherwise.
+     */
+    static bool supportsConversion(const SampleSpec &ssSrc, const SampleSpec &ssDst);
+
+    /**
+     * Allocates the history buffers for a maximum number of input frames per call.
+     *
+     * @param[in] maxInFrames maximum number of frames in the source sample specification.
+     *
+     * @return status OK if the buffers are allocated, error code otherwise.
+     */
+    virtual android::status_t reserve(size_t maxInFrames);
+
+    /**
+     * Gets the delay of the filter, half of the prototype length.
+     *
+     * @return delay in frames at the destination sample rate.
+     */
+    virtual size_t getDelayFrames() const;
+
+    /**
+     * Clears the history frames and the position of the filter.
+     */
+    virtual void reset();
+
+private:
+    /**
+     * Filter kernel definition.
+     * Computes the output samples of all the phases for one input position of one channel.
+     *
+     * @param[in] coefs Q15 coefficient table.
+     * @param[in] samples samples of one channel.
+     * @param[in] taps number of taps per phase, multiple of 8.
+     * @param[in] phases number of phases.
+     * @param[out] dst first output sample.
+     * @param[in] dstStride distance between the output samples, ie the number of channels.
+     */
+    typedef void (*FilterKernel)(const int16_t *coefs, const int16_t *samples, size_t taps,
+                                 uint32_t phases, int16_t *dst, size_t dstStride);
+
+    android::status_t resampleFrames(const void *src,
+                                     void *dst,
+                                     const uint32_t inFrames,
+                                     uint32_t *outFrames);
+
+    /**
+     * Computes the Q15 coefficient table for the current ratio.
+     *
+     * @return error code.
+     */
+    android::status_t computeCoefficients();
+
+    /**
+     * Ensures the history buffers hold enough frames.
+     *
+     * @param[in] frames number of frames to hold per channel.
+     *
+     * @return error code.
+     */
+    android::status_t allocateHistory(size_t frames);
+
+    /**
+     * Zeroth order modified Bessel function of the first kind, used by the Kaiser window.
+     */
+    static double besselI0(double x);
+
+    /**
+     * Gets the interpolation and decimation factors of a rate conversion.
+     *
+     * @param[in] srcRate source rate.
+     * @param[in] dstRate destination rate.
+     * @param[out] phases interpolation factor, 1 when decimating.
+     * @param[out] step decimation factor, 1 when interpolating.
+     *
+     * @return true if the ratio is supported, false otherwise.
+     */
+    static bool getFactors(uint32_t srcRate, uint32_t dstRate, uint32_t *phases, uint32_t *step);
+
+    static bool isFactorSupported(uint32_t factor);
+
+    uint32_t _phases; /**< Interpolation factor, 1 when decimating. */
+    uint32_t _step; /**< Decimation factor, 1 when interpolating. */
+    uint32_t _taps; /**< Taps per phase, multiple of 8. */
+    int16_t *_coefs; /**< Q15 coefficient table, _phases rows of _taps coefficients. */
+
+    uint32_t _channels; /**< Number of channels resampled. */
+    int16_t *_history; /**< Planar input frames, starting with _taps - 1 frames of history. */
+    size_t _historyFrames; /**< Capacity of the history buffer per channel, in frames. */
+    size_t _position; /**< First input frame of the next inner product. */
+
+    FilterKernel _filter; /**< Filter kernel selected at configure. */
+
+    /**
+     * Taps of the prototype filter per frame at the lowest rate.
+     * Multiple of 8, so that the taps per phase are a multiple of 8 in both directions.
+     */
+    static const uint32_t LOW_RATE_TAPS = 32;
+};
+
+}; // namespace android
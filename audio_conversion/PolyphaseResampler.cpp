@@ -0,0 +1,383 @@
+/*
+ **
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#define LOG_TAG "PolyphaseResampler"
+
+#include "PolyphaseResampler.h"
+#include "AllocationGuard.h"
+#include "CpuFeatures.h"
+#include <cutils/log.h>
+#include <math.h>
+#include <string.h>
+
+#ifdef AUDIO_CONVERSION_X86
+#include <xmmintrin.h>
+#endif
+
+#ifdef AUDIO_CONVERSION_NEON
+#include <arm_neon.h>
+#endif
+
+#define base Resampler
+
+using namespace android;
+
+namespace android_audio_legacy{
+
+const PolyphaseResampler::FilterDesign PolyphaseResampler::_filterDesigns[NbQualities] = {
+    { 16, 0.85f, 5.0f },   // Low
+    { 32, 0.90f, 7.0f },   // Medium
+    { 64, 0.94f, 9.0f }    // High
+};
+
+static float dotProduct(const float *coefs, const float *samples, size_t taps)
+{
+    float sum = 0;
+
+    for (size_t k = 0; k < taps; k++) {
+
+        sum += coefs[k] * samples[k];
+    }
+    return sum;
+}
+
+#ifdef AUDIO_CONVERSION_X86
+
+static float dotProductSse(const float *coefs, const float *samples, size_t taps)
+{
+    // Two accumulators to hide the latency of the additions
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    size_t k;
+
+    for (k = 0; k + 8 <= taps; k += 8) {
+
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(coefs + k), _mm_loadu_ps(samples + k)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(coefs + k + 4),
+                                           _mm_loadu_ps(samples + k + 4)));
+    }
+    for (; k < taps; k += 4) {
+
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(coefs + k), _mm_loadu_ps(samples + k)));
+    }
+    sum0 = _mm_add_ps(sum0, sum1);
+    sum0 = _mm_add_ps(sum0, _mm_movehl_ps(sum0, sum0));
+    sum0 = _mm_add_ss(sum0, _mm_shuffle_ps(sum0, sum0, 1));
+    return _mm_cvtss_f32(sum0);
+}
+
+#endif
+
+#ifdef AUDIO_CONVERSION_NEON
+
+static float dotProductNeon(const float *coefs, const float *samples, size_t taps)
+{
+    float32x4_t sum = vdupq_n_f32(0);
+
+    for (size_t k = 0; k < taps; k += 4) {
+
+        sum = vmlaq_f32(sum, vld1q_f32(coefs + k), vld1q_f32(samples + k));
+    }
+    float32x2_t half = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+    return vget_lane_f32(vpadd_f32(half, half), 0);
+}
+
+#endif
+
+PolyphaseResampler::PolyphaseResampler(SampleSpecItem sampleSpecItem, Quality quality) :
+    base(sampleSpecItem),
+    _quality(quality),
+    _tableQuality(quality),
+    _phases(0),
+    _step(0),
+    _taps(0),
+    _coefs(NULL),
+    _channels(0),
+    _history(NULL),
+    _historyFrames(0),
+    _position(0),
+    _phase(0),
+    _dotProduct(NULL)
+{
+}
+
+PolyphaseResampler::~PolyphaseResampler()
+{
+    delete []_coefs;
+    delete []_history;
+}
+
+void PolyphaseResampler::setQuality(Quality quality)
+{
+    LOG_ALWAYS_FATAL_IF(quality >= NbQualities);
+    _quality = quality;
+}
+
+uint32_t PolyphaseResampler::greatestCommonDivisor(uint32_t a, uint32_t b)
+{
+    while (b != 0) {
+
+        uint32_t remainder = a % b;
+        a = b;
+        b = remainder;
+    }
+    return a;
+}
+
+double PolyphaseResampler::besselI0(double x)
+{
+    double sum = 1;
+    double term = 1;
+    double halfX = x / 2;
+
+    // Power series, converges quickly for the beta values used by the designs
+    for (int k = 1; k < 50; k++) {
+
+        term *= (halfX / k) * (halfX / k);
+        sum += term;
+        if (term < sum * 1e-12) {
+
+            break;
+        }
+    }
+    return sum;
+}
+
+status_t PolyphaseResampler::computeCoefficients()
+{
+    const FilterDesign &design = _filterDesigns[_quality];
+    uint32_t phases = _phases;
+    uint32_t taps = design.taps;
+
+    delete []_coefs;
+    _coefs = new float[phases * taps];
+    if (!_coefs) {
+
+        LOGE("%s: cannot allocate coefficient table", __FUNCTION__);
+        return NO_MEMORY;
+    }
+
+    // Cutoff relative to the source Nyquist frequency, lowered when decimating
+    double cutoff = design.rolloff * (_phases < _step ? (double)_phases / _step : 1.0);
+    double halfLength = taps / 2.0;
+    double windowNorm = besselI0(design.beta);
+
+    for (uint32_t phase = 0; phase < phases; phase++) {
+
+        float *coefs = &_coefs[phase * taps];
+        double sum = 0;
+
+        for (uint32_t tap = 0; tap < taps; tap++) {
+
+            // Distance in source frames between the tap and the output frame
+            double x = tap - (halfLength - 1) - (double)phase / phases;
+            double sinc = (x == 0) ? 1 : sin(M_PI * cutoff * x) / (M_PI * cutoff * x);
+            double u = x / halfLength;
+            double window = (u * u < 1) ? besselI0(design.beta * sqrt(1 - u * u)) / windowNorm : 0;
+            double coef = cutoff * sinc * window;
+
+            coefs[tap] = coef;
+            sum += coef;
+        }
+        // Unity gain at DC on each phase
+        for (uint32_t tap = 0; tap < taps; tap++) {
+
+            coefs[tap] /= sum;
+        }
+    }
+    _taps = taps;
+    _tableQuality = _quality;
+    return NO_ERROR;
+}
+
+status_t PolyphaseResampler::allocateHistory(size_t frames)
+{
+    if (frames <= _historyFrames) {
+
+        return NO_ERROR;
+    }
+    AllocationGuard::checkAllocation(__FUNCTION__);
+    float *history = new float[frames * _channels];
+    if (!history) {
+
+        LOGE("%s: cannot allocate history buffer", __FUNCTION__);
+        return NO_MEMORY;
+    }
+    // Keep the history frames of each channel
+    for (uint32_t channel = 0; channel < _channels; channel++) {
+
+        float *channelHistory = &history[channel * frames];
+        if (_history) {
+
+            memcpy(channelHistory, &_history[channel * _historyFrames],
+                   (_taps - 1) * sizeof(float));
+        } else {
+
+            memset(channelHistory, 0, (_taps - 1) * sizeof(float));
+        }
+    }
+    delete []_history;
+    _history = history;
+    _historyFrames = frames;
+    return NO_ERROR;
+}
+
+status_t PolyphaseResampler::createEngine(const SampleSpec &ssSrc, const SampleSpec &ssDst)
+{
+    uint32_t srcRate = ssSrc.getSampleRate();
+    uint32_t dstRate = ssDst.getSampleRate();
+
+    if (srcRate == 0 || dstRate == 0) {
+
+        return INVALID_OPERATION;
+    }
+    uint32_t divisor = greatestCommonDivisor(srcRate, dstRate);
+    uint32_t phases = dstRate / divisor;
+    uint32_t step = srcRate / divisor;
+
+    if (phases > MAX_PHASES) {
+
+        LOGE("%s: ratio %d/%d requires too many phases", __FUNCTION__, dstRate, srcRate);
+        return INVALID_OPERATION;
+    }
+
+    // Coefficient table is only computed when the ratio or the quality changes
+    if (!_coefs || phases != _phases || step != _step || _quality != _tableQuality) {
+
+        _phases = phases;
+        _step = step;
+        status_t status = computeCoefficients();
+        if (status != NO_ERROR) {
+
+            return status;
+        }
+    }
+
+    // New stream: history is reset to silence
+    delete []_history;
+    _history = NULL;
+    _historyFrames = 0;
+    _channels = ssSrc.getChannelCount();
+    _position = 0;
+    _phase = 0;
+    status_t status = allocateHistory(_taps - 1 + ssSrc.convertUsecToframes(20000));
+    if (status != NO_ERROR) {
+
+        return status;
+    }
+
+    _dotProduct = dotProduct;
+#ifdef AUDIO_CONVERSION_X86
+    if (CpuFeatures::hasFeature(CpuFeatures::Sse2)) {
+
+        _dotProduct = dotProductSse;
+    }
+#endif
+#ifdef AUDIO_CONVERSION_NEON
+    _dotProduct = dotProductNeon;
+#endif
+
+    LOGD("%s: %d -> %d, %d phases of %d taps", __FUNCTION__, srcRate, dstRate, _phases, _taps);
+    return NO_ERROR;
+}
+
+status_t PolyphaseResampler::reserve(size_t maxInFrames)
+{
+    status_t status = base::reserve(maxInFrames);
+    if (status != NO_ERROR) {
+
+        return status;
+    }
+    return allocateHistory(_taps - 1 + maxInFrames);
+}
+
+size_t PolyphaseResampler::getDelayFrames() const
+{
+    // Inner products are centered half of the taps before their last source frame
+    return convertSrcToDstInFrames(_taps / 2);
+}
+
+void PolyphaseResampler::deleteEngine()
+{
+    _position = 0;
+    _phase = 0;
+}
+
+void PolyphaseResampler::resetEngine()
+{
+    for (uint32_t channel = 0; channel < _channels; channel++) {
+
+        memset(&_history[channel * _historyFrames], 0, (_taps - 1) * sizeof(float));
+    }
+    _position = 0;
+    _phase = 0;
+}
+
+void PolyphaseResampler::processFloat(float *src, uint32_t inFrames, float *dst,
+                                      uint32_t *outFrames)
+{
+    size_t historyFrames = _taps - 1;
+    size_t totalFrames = historyFrames + inFrames;
+
+    *outFrames = 0;
+    if (allocateHistory(totalFrames) != NO_ERROR) {
+
+        return;
+    }
+
+    // Planar copy of the input after the history frames
+    for (uint32_t channel = 0; channel < _channels; channel++) {
+
+        float *channelFrames = &_history[channel * _historyFrames + historyFrames];
+        for (uint32_t frame = 0; frame < inFrames; frame++) {
+
+            channelFrames[frame] = src[frame * _channels + channel];
+        }
+    }
+
+    size_t position = _position;
+    uint32_t phase = _phase;
+    uint32_t frames = 0;
+
+    while (position + _taps <= totalFrames) {
+
+        const float *coefs = &_coefs[phase * _taps];
+        for (uint32_t channel = 0; channel < _channels; channel++) {
+
+            dst[frames * _channels + channel] =
+                    _dotProduct(coefs, &_history[channel * _historyFrames + position], _taps);
+        }
+        frames++;
+
+        phase += _step;
+        position += phase / _phases;
+        phase %= _phases;
+    }
+
+    // Keep the last frames as history of next call
+    for (uint32_t channel = 0; channel < _channels; channel++) {
+
+        float *channelFrames = &_history[channel * _historyFrames];
+        memmove(channelFrames, channelFrames + inFrames, historyFrames * sizeof(float));
+    }
+    _position = position - inFrames;
+    _phase = phase;
+
+    *outFrames = frames;
+}
+
+}; // namespace android
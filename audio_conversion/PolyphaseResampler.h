@@ -0,0 +1,153 @@
+/*
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#pragma once
+
+#include "Resampler.h"
+
+namespace android_audio_legacy {
+
+/**
+ * Polyphase FIR resampler.
+ * Handles any rational ratio between the source and destination rates in a single pass, so
+ * that rate pairs not supported by the resampling library do not need the pivot chain.
+ * The ratio is reduced to L / M: the windowed sinc prototype filter is split into L phases of
+ * N taps, each output frame is the inner product of N input frames with one phase.
+ */
+class PolyphaseResampler : public Resampler {
+
+public:
+    /**
+     * Quality / cost levels, trading the number of taps per phase and the filter rolloff.
+     */
+    enum Quality {
+
+        Low = 0,
+        Medium,
+        High,
+
+        NbQualities
+    };
+
+    /**
+     * Constructor of the polyphase resampler.
+     *
+     * @param[in] sampleSpecItem Sample specification item on which this audio
+     *             converter is working on.
+     * @param[in] quality quality level of the filter.
+     */
+    PolyphaseResampler(SampleSpecItem sampleSpecItem, Quality quality = Medium);
+
+    virtual ~PolyphaseResampler();
+
+    /**
+     * Selects the quality level, effective on next configure.
+     *
+     * @param[in] quality quality level of the filter.
+     */
+    void setQuality(Quality quality);
+
+    /**
+     * Allocates the history buffers, and the float buffers if needed, for a maximum number of
+     * input frames per call.
+     *
+     * @param[in] maxInFrames maximum number of frames in the source sample specification.
+     *
+     * @return status OK if the buffers are allocated, error code otherwise.
+     */
+    virtual android::status_t reserve(size_t maxInFrames);
+
+    /**
+     * Gets the delay of the filter, half of the taps of a phase at the source sample rate.
+     *
+     * @return delay in frames at the destination sample rate.
+     */
+    virtual size_t getDelayFrames() const;
+
+private:
+    /**
+     * Inner product kernel definition.
+     *
+     * @param[in] coefs coefficients of the phase.
+     * @param[in] samples samples of one channel.
+     * @param[in] taps number of taps, multiple of 4.
+     *
+     * @return inner product.
+     */
+    typedef float (*DotProductKernel)(const float *coefs, const float *samples, size_t taps);
+
+    /**
+     * Filter design parameters of a quality level.
+     */
+    struct FilterDesign {
+
+        uint32_t taps; /**< Taps per phase, multiple of 4. */
+        float rolloff; /**< Cutoff frequency, relative to the lowest Nyquist frequency. */
+        float beta; /**< Kaiser window shape parameter. */
+    };
+
+    virtual android::status_t createEngine(const SampleSpec &ssSrc, const SampleSpec &ssDst);
+
+    virtual void deleteEngine();
+
+    virtual void resetEngine();
+
+    virtual void processFloat(float *src, uint32_t inFrames, float *dst, uint32_t *outFrames);
+
+    /**
+     * Computes the coefficient table for the current ratio and quality.
+     *
+     * @return error code.
+     */
+    android::status_t computeCoefficients();
+
+    /**
+     * Ensures the history buffers hold enough frames.
+     *
+     * @param[in] frames number of frames to hold per channel.
+     *
+     * @return error code.
+     */
+    android::status_t allocateHistory(size_t frames);
+
+    /**
+     * Zeroth order modified Bessel function of the first kind, used by the Kaiser window.
+     */
+    static double besselI0(double x);
+
+    static uint32_t greatestCommonDivisor(uint32_t a, uint32_t b);
+
+    Quality _quality; /**< Quality level requested. */
+    Quality _tableQuality; /**< Quality level of the coefficient table. */
+    uint32_t _phases; /**< L: number of phases, ie interpolation factor. */
+    uint32_t _step; /**< M: decimation factor. */
+    uint32_t _taps; /**< N: taps per phase. */
+    float *_coefs; /**< Coefficient table, _phases rows of _taps coefficients. */
+
+    uint32_t _channels; /**< Number of channels resampled. */
+    float *_history; /**< Planar input frames, starting with _taps - 1 frames of history. */
+    size_t _historyFrames; /**< Capacity of the history buffer per channel, in frames. */
+    size_t _position; /**< First input frame of the next inner product. */
+    uint32_t _phase; /**< Phase of the next output frame. */
+
+    DotProductKernel _dotProduct; /**< Inner product kernel selected at configure. */
+
+    static const FilterDesign _filterDesigns[NbQualities]; /**< Designs of quality levels. */
+
+    static const uint32_t MAX_PHASES = 1024; /**< Bounds the size of the coefficient table. */
+};
+
+}; // namespace android
@@ -18,56 +18,393 @@
 #define LOG_TAG "Resampler"
 
 #include "Resampler.h"
+#include "AllocationGuard.h"
+#include "CpuFeatures.h"
 #include <cutils/log.h>
 #include <iasrc_resampler.h>
 #include <limits.h>
+#include <string.h>
+#include <algorithm>
+
+#ifdef AUDIO_CONVERSION_X86
+#include <emmintrin.h>
+#endif
 
 #define base AudioConverter
 
 using namespace android;
+using std::max;
 
 namespace android_audio_legacy{
 
+/**
+ * Range of the samples in 24 bits over 32 format, used to clip.
+ */
+static const int32_t S24_MAX = (1 << 23) - 1;
+static const int32_t S24_MIN = -(1 << 23);
+
+/**
+ * Mask of the valid bits of a sample in 24 bits over 32 format.
+ */
+static const uint32_t S24_MASK = 0xFFFFFF;
+
+/**
+ * Range of the samples in 32 bits format, as floats: the float nearest to the highest 32 bits
+ * value does not fit.
+ */
+static const float S32_FLOAT_MAX = 2147483520.0f;
+static const float S32_FLOAT_MIN = -2147483648.0f;
+
+//
+// Reference float conversion kernels.
+// Float samples keep the scale of the integer format.
+//
+static void convertS16toFloat(const void *src, float *dst, size_t samples)
+{
+    const int16_t *src16 = static_cast<const int16_t *>(src);
+
+    for (size_t i = 0; i < samples; i++) {
+
+        dst[i] = src16[i];
+    }
+}
+
+static void convertFloatToS16(const float *src, void *dst, size_t samples)
+{
+    int16_t *dst16 = static_cast<int16_t *>(dst);
+
+    for (size_t i = 0; i < samples; i++) {
+
+        float sample = src[i];
+        if (sample > SHRT_MAX) {
+
+            sample = SHRT_MAX;
+        } else if (sample < SHRT_MIN) {
+
+            sample = SHRT_MIN;
+        }
+        dst16[i] = static_cast<int16_t>(sample);
+    }
+}
+
+static void convertS24over32toFloat(const void *src, float *dst, size_t samples)
+{
+    const uint32_t *src32 = static_cast<const uint32_t *>(src);
+
+    for (size_t i = 0; i < samples; i++) {
+
+        // Sign extension from bit 23
+        dst[i] = static_cast<int32_t>(src32[i] << 8) >> 8;
+    }
+}
+
+static void convertFloatToS24over32(const float *src, void *dst, size_t samples)
+{
+    uint32_t *dst32 = static_cast<uint32_t *>(dst);
+
+    for (size_t i = 0; i < samples; i++) {
+
+        float sample = src[i];
+        if (sample > S24_MAX) {
+
+            sample = S24_MAX;
+        } else if (sample < S24_MIN) {
+
+            sample = S24_MIN;
+        }
+        dst32[i] = static_cast<uint32_t>(static_cast<int32_t>(sample)) & S24_MASK;
+    }
+}
+
+static void convertS32toFloat(const void *src, float *dst, size_t samples)
+{
+    const int32_t *src32 = static_cast<const int32_t *>(src);
+
+    for (size_t i = 0; i < samples; i++) {
+
+        dst[i] = src32[i];
+    }
+}
+
+static void convertFloatToS32(const float *src, void *dst, size_t samples)
+{
+    int32_t *dst32 = static_cast<int32_t *>(dst);
+
+    for (size_t i = 0; i < samples; i++) {
+
+        float sample = src[i];
+        if (sample > S32_FLOAT_MAX) {
+
+            sample = S32_FLOAT_MAX;
+        } else if (sample < S32_FLOAT_MIN) {
+
+            sample = S32_FLOAT_MIN;
+        }
+        dst32[i] = static_cast<int32_t>(sample);
+    }
+}
+
+static void convertS24PackedToFloat(const void *src, float *dst, size_t samples)
+{
+    const uint8_t *src8 = static_cast<const uint8_t *>(src);
+
+    for (size_t i = 0; i < samples; i++) {
+
+        const uint8_t *sample = src8 + 3 * i;
+        uint32_t value = (static_cast<uint32_t>(sample[0]) << 8) |
+                (static_cast<uint32_t>(sample[1]) << 16) | (static_cast<uint32_t>(sample[2]) << 24);
+        // Sign extension from bit 31
+        dst[i] = static_cast<int32_t>(value) >> 8;
+    }
+}
+
+static void convertFloatToS24Packed(const float *src, void *dst, size_t samples)
+{
+    uint8_t *dst8 = static_cast<uint8_t *>(dst);
+
+    for (size_t i = 0; i < samples; i++) {
+
+        float sample = src[i];
+        if (sample > S24_MAX) {
+
+            sample = S24_MAX;
+        } else if (sample < S24_MIN) {
+
+            sample = S24_MIN;
+        }
+        int32_t value = static_cast<int32_t>(sample);
+        dst8[3 * i] = static_cast<uint8_t>(value);
+        dst8[3 * i + 1] = static_cast<uint8_t>(value >> 8);
+        dst8[3 * i + 2] = static_cast<uint8_t>(value >> 16);
+    }
+}
+
+//
+// Float samples are already in the resampler format.
+//
+static void copyToFloat(const void *src, float *dst, size_t samples)
+{
+    memcpy(dst, src, samples * sizeof(float));
+}
+
+static void copyFromFloat(const float *src, void *dst, size_t samples)
+{
+    memcpy(dst, src, samples * sizeof(float));
+}
+
+#ifdef AUDIO_CONVERSION_X86
+
+//
+// SSE2 float conversion kernels, remaining samples handled by the reference kernels.
+// Clipping is done in float with min / max, so that the loops are branch free.
+//
+static void convertS16toFloatSse2(const void *src, float *dst, size_t samples)
+{
+    const int16_t *src16 = static_cast<const int16_t *>(src);
+    size_t i;
+
+    for (i = 0; i + 8 <= samples; i += 8) {
+
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src16 + i));
+        __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(in, in), 16);
+        __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(in, in), 16);
+        _mm_storeu_ps(dst + i, _mm_cvtepi32_ps(low));
+        _mm_storeu_ps(dst + i + 4, _mm_cvtepi32_ps(high));
+    }
+    convertS16toFloat(src16 + i, dst + i, samples - i);
+}
+
+static void convertFloatToS16Sse2(const float *src, void *dst, size_t samples)
+{
+    int16_t *dst16 = static_cast<int16_t *>(dst);
+    const __m128 max = _mm_set1_ps(SHRT_MAX);
+    const __m128 min = _mm_set1_ps(SHRT_MIN);
+    size_t i;
+
+    for (i = 0; i + 8 <= samples; i += 8) {
+
+        __m128 low = _mm_max_ps(_mm_min_ps(_mm_loadu_ps(src + i), max), min);
+        __m128 high = _mm_max_ps(_mm_min_ps(_mm_loadu_ps(src + i + 4), max), min);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst16 + i),
+                         _mm_packs_epi32(_mm_cvttps_epi32(low), _mm_cvttps_epi32(high)));
+    }
+    convertFloatToS16(src + i, dst16 + i, samples - i);
+}
+
+static void convertS24over32toFloatSse2(const void *src, float *dst, size_t samples)
+{
+    const uint32_t *src32 = static_cast<const uint32_t *>(src);
+    size_t i;
+
+    for (i = 0; i + 4 <= samples; i += 4) {
+
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src32 + i));
+        _mm_storeu_ps(dst + i, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(in, 8), 8)));
+    }
+    convertS24over32toFloat(src32 + i, dst + i, samples - i);
+}
+
+static void convertFloatToS24over32Sse2(const float *src, void *dst, size_t samples)
+{
+    uint32_t *dst32 = static_cast<uint32_t *>(dst);
+    const __m128 max = _mm_set1_ps(S24_MAX);
+    const __m128 min = _mm_set1_ps(S24_MIN);
+    const __m128i mask = _mm_set1_epi32(S24_MASK);
+    size_t i;
+
+    for (i = 0; i + 4 <= samples; i += 4) {
+
+        __m128 in = _mm_max_ps(_mm_min_ps(_mm_loadu_ps(src + i), max), min);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst32 + i),
+                         _mm_and_si128(_mm_cvttps_epi32(in), mask));
+    }
+    convertFloatToS24over32(src + i, dst32 + i, samples - i);
+}
+
+static void convertS32toFloatSse2(const void *src, float *dst, size_t samples)
+{
+    const int32_t *src32 = static_cast<const int32_t *>(src);
+    size_t i;
+
+    for (i = 0; i + 4 <= samples; i += 4) {
+
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src32 + i));
+        _mm_storeu_ps(dst + i, _mm_cvtepi32_ps(in));
+    }
+    convertS32toFloat(src32 + i, dst + i, samples - i);
+}
+
+static void convertFloatToS32Sse2(const float *src, void *dst, size_t samples)
+{
+    int32_t *dst32 = static_cast<int32_t *>(dst);
+    const __m128 max = _mm_set1_ps(S32_FLOAT_MAX);
+    const __m128 min = _mm_set1_ps(S32_FLOAT_MIN);
+    size_t i;
+
+    for (i = 0; i + 4 <= samples; i += 4) {
+
+        __m128 in = _mm_max_ps(_mm_min_ps(_mm_loadu_ps(src + i), max), min);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst32 + i), _mm_cvttps_epi32(in));
+    }
+    convertFloatToS32(src + i, dst32 + i, samples - i);
+}
+
+#endif // AUDIO_CONVERSION_X86
+
 Resampler::Resampler(SampleSpecItem sampleSpecItem) :
     base(sampleSpecItem),
-    _maxFrameCnt(0),
-    _context(NULL), _floatInp(NULL), _floatOut(NULL)
+    _bufferSamples(0),
+    _context(NULL), _floatInp(NULL), _floatOut(NULL),
+    _engineReady(false),
+    _toFloatKernel(NULL),
+    _fromFloatKernel(NULL),
+    _floatInput(false),
+    _floatOutput(false)
 {
 }
 
 Resampler::~Resampler()
 {
-    if (_context) {
-        iaresamplib_reset(_context);
-        iaresamplib_delete(&_context);
-    }
+    Resampler::deleteEngine();
 
     delete []_floatInp;
     delete []_floatOut;
 }
 
-status_t Resampler::allocateBuffer()
+status_t Resampler::allocateBuffer(size_t frames)
 {
-    if (_maxFrameCnt == 0) {
-        _maxFrameCnt = BUF_SIZE;
-    } else {
-        _maxFrameCnt *= 2; // simply double the buf size
+    // Capacity is counted in samples, the channel count may change with the configuration
+    size_t samples = (max(frames, static_cast<size_t>(BUF_SIZE)) + 1) * _ssSrc.getChannelCount();
+    if (samples <= _bufferSamples) {
+
+        return NO_ERROR;
     }
 
+    AllocationGuard::checkAllocation(__FUNCTION__);
     delete []_floatInp;
     delete []_floatOut;
+    _bufferSamples = 0;
 
-    _floatInp = new float[(_maxFrameCnt + 1) * _ssSrc.getChannelCount()];
-    _floatOut = new float[(_maxFrameCnt + 1) * _ssSrc.getChannelCount()];
+    _floatInp = new float[samples];
+    _floatOut = new float[samples];
 
     if (!_floatInp || !_floatOut) {
 
         LOGE("cannot allocate resampler tmp buffers.\n");
         delete []_floatInp;
         delete []_floatOut;
+        _floatInp = _floatOut = NULL;
 
         return NO_MEMORY;
     }
+    _bufferSamples = samples;
+    return NO_ERROR;
+}
+
+status_t Resampler::selectFloatKernels(audio_format_t format)
+{
+#ifdef AUDIO_CONVERSION_X86
+    bool useSse2 = CpuFeatures::hasFeature(CpuFeatures::Sse2);
+#endif
+
+    switch (static_cast<uint32_t>(format)) {
+
+    case AUDIO_FORMAT_PCM_16_BIT:
+
+        _toFloatKernel = convertS16toFloat;
+        _fromFloatKernel = convertFloatToS16;
+#ifdef AUDIO_CONVERSION_X86
+        if (useSse2) {
+
+            _toFloatKernel = convertS16toFloatSse2;
+            _fromFloatKernel = convertFloatToS16Sse2;
+        }
+#endif
+        break;
+
+    case AUDIO_FORMAT_PCM_8_24_BIT:
+
+        _toFloatKernel = convertS24over32toFloat;
+        _fromFloatKernel = convertFloatToS24over32;
+#ifdef AUDIO_CONVERSION_X86
+        if (useSse2) {
+
+            _toFloatKernel = convertS24over32toFloatSse2;
+            _fromFloatKernel = convertFloatToS24over32Sse2;
+        }
+#endif
+        break;
+
+    case AUDIO_FORMAT_PCM_32_BIT:
+
+        _toFloatKernel = convertS32toFloat;
+        _fromFloatKernel = convertFloatToS32;
+#ifdef AUDIO_CONVERSION_X86
+        if (useSse2) {
+
+            _toFloatKernel = convertS32toFloatSse2;
+            _fromFloatKernel = convertFloatToS32Sse2;
+        }
+#endif
+        break;
+
+    case SampleSpec::PCM_24_BIT_PACKED_FORMAT:
+
+        _toFloatKernel = convertS24PackedToFloat;
+        _fromFloatKernel = convertFloatToS24Packed;
+        break;
+
+    case SampleSpec::PCM_FLOAT_FORMAT:
+
+        _toFloatKernel = copyToFloat;
+        _fromFloatKernel = copyFromFloat;
+        break;
+
+    default:
+
+        ALOGE("%s: format %d not supported", __FUNCTION__, format);
+        return INVALID_OPERATION;
+    }
     return NO_ERROR;
 }
 
@@ -78,8 +415,10 @@ status_t Resampler::configure(const SampleSpec &ssSrc, const SampleSpec &ssDst)
     ALOGD("%s: DST rate=%d format=%d channels=%d", __FUNCTION__, ssDst.getSampleRate(),
           ssDst.getFormat(), ssDst.getChannelCount());
 
-    if (ssSrc.getSampleRate() == _ssSrc.getSampleRate() &&
-        ssDst.getSampleRate() == _ssDst.getSampleRate() && _context) {
+    _floatInput = false;
+    _floatOutput = false;
+
+    if (ssSrc == _ssSrc && ssDst == _ssDst && _engineReady) {
 
         return NO_ERROR;
     }
@@ -90,12 +429,28 @@ status_t Resampler::configure(const SampleSpec &ssSrc, const SampleSpec &ssDst)
         return status;
     }
 
-    if (_context) {
-        iaresamplib_reset(_context);
-        iaresamplib_delete(&_context);
-        _context = NULL;
+    deleteEngine();
+    _engineReady = false;
+
+    status = selectFloatKernels(ssSrc.getFormat());
+    if (status != NO_ERROR) {
+
+        return status;
     }
 
+    status = createEngine(ssSrc, ssDst);
+    if (status != NO_ERROR) {
+
+        return status;
+    }
+    _engineReady = true;
+
+    _convertSamplesFct = static_cast<SampleConverter>(&Resampler::resampleFrames);
+    return NO_ERROR;
+}
+
+status_t Resampler::createEngine(const SampleSpec &ssSrc, const SampleSpec &ssDst)
+{
     if (!iaresamplib_supported_conversion(ssSrc.getSampleRate(), ssDst.getSampleRate())) {
 
         ALOGE("%s: SRC lib doesn't support this conversion", __FUNCTION__);
@@ -108,52 +463,88 @@ status_t Resampler::configure(const SampleSpec &ssSrc, const SampleSpec &ssDst)
         ALOGE("cannot create resampler handle for lacking of memory.\n");
         return BAD_VALUE;
     }
-
-    _convertSamplesFct = static_cast<SampleConverter>(&Resampler::resampleFrames);
     return NO_ERROR;
 }
 
-void Resampler::convertShort2Float(int16_t *inp, float *out, size_t sz) const
+void Resampler::deleteEngine()
 {
-    size_t i;
-    for (i = 0; i < sz; i++) {
-        *out++ = (float) *inp++;
+    if (_context) {
+        iaresamplib_reset(_context);
+        iaresamplib_delete(&_context);
+        _context = NULL;
     }
 }
 
-void Resampler::convertFloat2Short(float *inp, int16_t *out, size_t sz) const
+void Resampler::reset()
 {
-    size_t i;
-    for (i = 0; i < sz; i++) {
-        if (*inp > SHRT_MAX) {
-            *inp = SHRT_MAX;
-        } else if (*inp < SHRT_MIN) {
-            *inp = SHRT_MIN;
-        }
-        *out++ = (short) *inp++;
+    if (_engineReady) {
+
+        resetEngine();
     }
 }
 
+void Resampler::resetEngine()
+{
+    iaresamplib_reset(_context);
+}
+
+void Resampler::processFloat(float *src, uint32_t inFrames, float *dst, uint32_t *outFrames)
+{
+    unsigned int outNbFrames;
+    iaresamplib_process_float(_context, src, inFrames, dst, &outNbFrames);
+    *outFrames = outNbFrames;
+}
+
+void Resampler::setFloatInterface(bool floatInput, bool floatOutput)
+{
+    _floatInput = floatInput;
+    _floatOutput = floatOutput;
+}
+
+status_t Resampler::reserve(size_t maxInFrames)
+{
+    // Intermediate buffers are only needed for the samples not exchanged in float
+    if (_floatInput && _floatOutput) {
+
+        return NO_ERROR;
+    }
+    return allocateBuffer(max(maxInFrames, convertSrcToDstInFrames(maxInFrames)));
+}
+
 status_t Resampler::resampleFrames(const void *src,
                                     void *dst,
                                     const uint32_t inFrames,
                                     uint32_t *outFrames)
 {
     size_t outFrameCount = convertSrcToDstInFrames(inFrames);
+    size_t channelCount = _ssSrc.getChannelCount();
 
-    while (outFrameCount > _maxFrameCnt) {
+    // Intermediate buffers are only needed for the samples not exchanged in float
+    if (!_floatInput || !_floatOutput) {
 
-        status_t ret = allocateBuffer();
+        status_t ret = allocateBuffer(max(outFrameCount, static_cast<size_t>(inFrames)));
         if (ret != NO_ERROR) {
 
             ALOGE("%s: could not allocate memory for resampling operation", __FUNCTION__);
             return ret;
         }
     }
-    unsigned int outNbFrames;
-    convertShort2Float((short *)src, _floatInp, inFrames * _ssSrc.getChannelCount());
-    iaresamplib_process_float(_context, _floatInp, inFrames, _floatOut, &outNbFrames);
-    convertFloat2Short(_floatOut, (short *)dst, outNbFrames * _ssSrc.getChannelCount());
+
+    float *floatInp = const_cast<float *>(static_cast<const float *>(src));
+    if (!_floatInput) {
+
+        _toFloatKernel(src, _floatInp, inFrames * channelCount);
+        floatInp = _floatInp;
+    }
+    float *floatOut = _floatOutput ? static_cast<float *>(dst) : _floatOut;
+
+    uint32_t outNbFrames;
+    processFloat(floatInp, inFrames, floatOut, &outNbFrames);
+
+    if (!_floatOutput) {
+
+        _fromFloatKernel(floatOut, dst, outNbFrames * channelCount);
+    }
 
     *outFrames = outNbFrames;
 
@@ -51,6 +51,8 @@ public:
      * Configures the resampler.
      * It configures the resampler that may be used to convert samples from the source
      * to destination sample rate.
+     * Samples are exchanged in the format of the sample specifications until
+     * setFloatInterface is called.
      *
      * @param[in] ssSrc source sample specifications.
      * @param[in] ssDst destination sample specification.
@@ -59,23 +61,115 @@ public:
      */
     virtual android::status_t configure(const SampleSpec &ssSrc, const SampleSpec &ssDst);
 
+    /**
+     * Exchanges float samples instead of the sample specifications format.
+     * Float samples keep the scale of the sample specifications format, so that resamplers
+     * chained in float do not convert the samples in between.
+     * Caller is in charge of providing the float destination buffer.
+     *
+     * @param[in] floatInput source buffer holds float samples.
+     * @param[in] floatOutput destination buffer receives float samples.
+     */
+    void setFloatInterface(bool floatInput, bool floatOutput);
+
+    /**
+     * Allocates the intermediate float buffers for a maximum number of input frames per call.
+     * Must be called after setFloatInterface, as samples exchanged in float need no buffer.
+     *
+     * @param[in] maxInFrames maximum number of frames in the source sample specification.
+     *
+     * @return status OK if the buffers are allocated, error code otherwise.
+     */
+    virtual android::status_t reserve(size_t maxInFrames);
+
+    /**
+     * Clears the state of the resampling engine, see resetEngine.
+     */
+    virtual void reset();
+
+protected:
+    /**
+     * Creates the resampling engine for the source and destination sample rates.
+     * Default engine is the resampling library.
+     *
+     * @param[in] ssSrc source sample specifications.
+     * @param[in] ssDst destination sample specification.
+     *
+     * @return status OK, error code if the conversion is not supported.
+     */
+    virtual android::status_t createEngine(const SampleSpec &ssSrc, const SampleSpec &ssDst);
+
+    /**
+     * Deletes the resampling engine, if any.
+     */
+    virtual void deleteEngine();
+
+    /**
+     * Clears the state of the resampling engine, keeping its buffers.
+     */
+    virtual void resetEngine();
+
+    /**
+     * Resamples interleaved float samples with the engine.
+     *
+     * @param[in] src the float source buffer.
+     * @param[in] inFrames number of input frames.
+     * @param[out] dst the float destination buffer.
+     * @param[out] outFrames output frames processed.
+     */
+    virtual void processFloat(float *src, uint32_t inFrames, float *dst, uint32_t *outFrames);
+
 private:
     // forbid copy
     Resampler(const Resampler &);
     Resampler &operator =(const Resampler &);
 
+    /**
+     * Kernel converting samples to float.
+     *
+     * @param[in] src the source buffer.
+     * @param[out] dst the float destination buffer.
+     * @param[in] samples number of samples to convert.
+     */
+    typedef void (*ToFloatKernel)(const void *src, float *dst, size_t samples);
 
-    android::status_t allocateBuffer();
+    /**
+     * Kernel converting float samples back, clipped to the range of the format.
+     *
+     * @param[in] src the float source buffer, left untouched.
+     * @param[out] dst the destination buffer.
+     * @param[in] samples number of samples to convert.
+     */
+    typedef void (*FromFloatKernel)(const float *src, void *dst, size_t samples);
 
-    void convertShort2Float(int16_t *inp, float *out, size_t sz) const;
+    /**
+     * Ensures the intermediate float buffers hold enough frames.
+     *
+     * @param[in] frames number of frames to hold, at the source or destination rate.
+     *
+     * @return error code.
+     */
+    android::status_t allocateBuffer(size_t frames);
 
-    void convertFloat2Short(float *inp, int16_t *out, size_t sz) const;
+    /**
+     * Selects the kernels converting the samples from and to float according to the format.
+     *
+     * @param[in] format format of the samples.
+     *
+     * @return OK if the format is supported, error code otherwise.
+     */
+    android::status_t selectFloatKernels(audio_format_t format);
 
     static const int BUF_SIZE = (1 << 13);
-    size_t  _maxFrameCnt;  /* max frame count the buffer can store */
+    size_t _bufferSamples; /**< Max sample count the float buffers can store. */
     void *_context;      /* handle used to do resample */
     float *_floatInp;     /* here sample size is 4 bytes */
     float *_floatOut;     /* here sample size is 4 bytes */
+    bool _engineReady; /**< Engine created for the current sample specifications. */
+    ToFloatKernel _toFloatKernel; /**< Kernel converting the source samples to float. */
+    FromFloatKernel _fromFloatKernel; /**< Kernel converting float to destination samples. */
+    bool _floatInput; /**< Source samples are already float. */
+    bool _floatOutput; /**< Destination samples are kept float. */
 };
 
 }; // namespace android
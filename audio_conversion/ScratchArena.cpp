@@ -0,0 +1,67 @@
+/*
+ **
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+#define LOG_TAG "ScratchArena"
+
+#include "ScratchArena.h"
+#include "AllocationGuard.h"
+#include <cutils/log.h>
+
+using namespace android;
+
+namespace android_audio_legacy{
+
+const size_t ScratchArena::ALIGNMENT = 16;
+
+ScratchArena::ScratchArena() :
+    _arena(NULL),
+    _bufferSize(0)
+{
+    _buffer[0] = _buffer[1] = NULL;
+}
+
+ScratchArena::~ScratchArena()
+{
+    delete []_arena;
+}
+
+status_t ScratchArena::allocate(size_t bytes)
+{
+    if (bytes <= _bufferSize) {
+
+        return NO_ERROR;
+    }
+
+    AllocationGuard::checkAllocation(__FUNCTION__);
+
+    // Second buffer starts on the same alignment as the first one.
+    bytes = (bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    delete []_arena;
+    _buffer[0] = _buffer[1] = NULL;
+    _bufferSize = 0;
+    _arena = new char[2 * bytes];
+    if (!_arena) {
+
+        LOGE("%s: cannot allocate scratch buffers", __FUNCTION__);
+        return NO_MEMORY;
+    }
+    _buffer[0] = _arena;
+    _buffer[1] = _arena + bytes;
+    _bufferSize = bytes;
+    return NO_ERROR;
+}
+
+}; // namespace android
@@ -0,0 +1,1566 @@
+/*
+ **
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+/**
+ * Host benchmark of the audio conversion library.
+ *
+ * Drives AudioConversion configure, convert and getConvertedBuffer over a matrix of rates,
+ * formats, channels count and channels policies, and reports for each case the time per
+ * frame, the CPU time per minute of call, the heap allocations per call and, where the perf
+ * counters are available, the cache misses per call. Results are written as JSON, one case per
+ * line.
+ *
+ * Conversions are reserved for the frames of a call, so that steady state calls must not
+ * allocate: with a debug build of the library, any allocation within convert is counted as a
+ * failure.
+ *
+ * The streams of a VoIP call are also converted within the same period, either one after the
+ * other or through AudioConversionBatch, with and without workers. Batches are reported
+ * separately and are not compared with the baseline.
+ *
+ * Given a baseline (a previous result file), the benchmark fails if any case got slower than
+ * the tolerance or allocates more than in the baseline, so that it may gate the changes of
+ * the conversion performances. Time per frame is the best of several series of calls, still,
+ * the comparison is only meaningful on an idle host with a fixed CPU frequency.
+ *
+ * Rate pairs that the resampling library does not support are also converted by the polyphase
+ * resampler at each quality level, and through the 48 kHz pivot rate as the resampler did before
+ * the polyphase resampler, for comparison. They are reported separately as well.
+ *
+ * Remap only conversions are also run with the generic remap kernel the remapper had before its
+ * kernels were specialized on the channels count, for comparison with the specialized kernels.
+ * Both kernels must give the same frames, the benchmark fails otherwise.
+ *
+ * Each case reports the plan of its conversion chain and its delay. With -c, the cost model of
+ * the planner is calibrated on the host before the cases are run.
+ *
+ * usage: audio_conversion_bench [-o output.json] [-b baseline.json] [-t tolerance_percent]
+ *                               [-n iterations] [-r repetitions] [-f name_filter] [-q] [-c]
+ */
+
+#define LOG_TAG "AudioConversionBench"
+
+#include "AllocationGuard.h"
+#include "AudioConversion.h"
+#include "AudioConversionBatch.h"
+#include <SampleSpec.h>
+#include <media/AudioBufferProvider.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace android;
+using namespace android_audio_legacy;
+
+#if __cplusplus >= 201103L
+#define BENCH_THROW_BAD_ALLOC
+#else
+#define BENCH_THROW_BAD_ALLOC throw(std::bad_alloc)
+#endif
+
+/**
+ * Heap accounting, only enabled while measuring.
+ * Every replaceable allocation and deallocation function is replaced, so that all the
+ * allocations of the process are counted and every deallocation matches its allocation.
+ */
+static bool allocCounting = false;
+static uint64_t allocCalls = 0;
+static uint64_t allocBytes = 0;
+
+/** Allocations within a convert call after a reservation, only detected by debug builds. */
+static uint64_t forbiddenAllocCalls = 0;
+
+/**
+ * Allocates and accounts a block of the heap.
+ * Neither this function nor countedFree is inlined, so that the compiler never sees malloc and
+ * free across the new and delete operators and does not report them as mismatched.
+ *
+ * @return block, NULL if the heap is exhausted.
+ */
+static __attribute__((noinline)) void *countedAlloc(size_t size)
+{
+    if (allocCounting) {
+
+        allocCalls++;
+        allocBytes += size;
+    }
+    if (AllocationGuard::isAllocationForbidden()) {
+
+        forbiddenAllocCalls++;
+    }
+    return malloc(size != 0 ? size : 1);
+}
+
+/**
+ * Releases a block allocated by countedAlloc.
+ */
+static __attribute__((noinline)) void countedFree(void *ptr)
+{
+    free(ptr);
+}
+
+void *operator new(size_t size) BENCH_THROW_BAD_ALLOC
+{
+    void *ptr = countedAlloc(size);
+    if (ptr == NULL) {
+
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void *operator new[](size_t size) BENCH_THROW_BAD_ALLOC
+{
+    void *ptr = countedAlloc(size);
+    if (ptr == NULL) {
+
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void *operator new(size_t size, const std::nothrow_t &) throw()
+{
+    return countedAlloc(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) throw()
+{
+    return countedAlloc(size);
+}
+
+void operator delete(void *ptr) throw()
+{
+    countedFree(ptr);
+}
+
+void operator delete[](void *ptr) throw()
+{
+    countedFree(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) throw()
+{
+    countedFree(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) throw()
+{
+    countedFree(ptr);
+}
+
+#if defined(__cpp_sized_deallocation)
+void operator delete(void *ptr, size_t) throw()
+{
+    countedFree(ptr);
+}
+
+void operator delete[](void *ptr, size_t) throw()
+{
+    countedFree(ptr);
+}
+#endif
+
+namespace {
+
+static const uint32_t defaultIterations = 200;
+static const uint32_t defaultRepetitions = 5;
+static const uint32_t warmUpCalls = 10;
+static const double defaultTolerancePercent = 10.0;
+
+/** Audio is processed by periods of 10 ms. */
+static const uint32_t periodsPerSecond = 100;
+
+/**
+ * Cache misses counter of the calling thread, user space only.
+ */
+class CacheMissCounter {
+
+public:
+    CacheMissCounter() : _fd(-1)
+    {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        _fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+    ~CacheMissCounter()
+    {
+        if (_fd >= 0) {
+
+            close(_fd);
+        }
+    }
+
+    bool isAvailable() const { return _fd >= 0; }
+
+    void start()
+    {
+        if (_fd >= 0) {
+
+            ioctl(_fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(_fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    uint64_t stop()
+    {
+        uint64_t count = 0;
+        if (_fd >= 0) {
+
+            ioctl(_fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(_fd, &count, sizeof(count)) != sizeof(count)) {
+
+                count = 0;
+            }
+        }
+        return count;
+    }
+
+private:
+    CacheMissCounter(const CacheMissCounter &);
+    CacheMissCounter &operator = (const CacheMissCounter &);
+
+    long _fd;
+};
+
+/**
+ * Provides the same preallocated source buffer on each request, so that the provider does
+ * not add any allocation nor copy to the measurements.
+ */
+class BenchBufferProvider : public AudioBufferProvider {
+
+public:
+    BenchBufferProvider(const SampleSpec &ss, size_t frames)
+        : _frames(frames), _buffer(ss.convertFramesToBytes(frames))
+    {
+        uint32_t channels = ss.getChannelCount();
+        for (size_t frame = 0; frame < frames; frame++) {
+
+            double value = 0.5 * sin(frame * 0.0314);
+            for (uint32_t channel = 0; channel < channels; channel++) {
+
+                writeSample(ss.getFormat(), frame * channels + channel, value);
+            }
+        }
+    }
+
+    void writeSample(audio_format_t format, size_t sample, double value)
+    {
+        int32_t value24 = static_cast<int32_t>(value * 8388607);
+
+        switch (static_cast<uint32_t>(format)) {
+
+        case AUDIO_FORMAT_PCM_16_BIT:
+            reinterpret_cast<int16_t *>(&_buffer[0])[sample] = static_cast<int16_t>(value * 32767);
+            break;
+        case AUDIO_FORMAT_PCM_8_24_BIT:
+            reinterpret_cast<uint32_t *>(&_buffer[0])[sample] =
+                    static_cast<uint32_t>(value24) & 0xffffff;
+            break;
+        case AUDIO_FORMAT_PCM_32_BIT:
+            reinterpret_cast<int32_t *>(&_buffer[0])[sample] =
+                    static_cast<int32_t>(value * 2147483647.0);
+            break;
+        case SampleSpec::PCM_FLOAT_FORMAT:
+            reinterpret_cast<float *>(&_buffer[0])[sample] = static_cast<float>(value);
+            break;
+        case SampleSpec::PCM_24_BIT_PACKED_FORMAT:
+            _buffer[3 * sample] = static_cast<uint8_t>(value24);
+            _buffer[3 * sample + 1] = static_cast<uint8_t>(value24 >> 8);
+            _buffer[3 * sample + 2] = static_cast<uint8_t>(value24 >> 16);
+            break;
+        }
+    }
+
+    virtual status_t getNextBuffer(Buffer *buffer, int64_t /*pts*/)
+    {
+        if (buffer->frameCount > _frames) {
+
+            buffer->frameCount = _frames;
+        }
+        buffer->raw = &_buffer[0];
+        return NO_ERROR;
+    }
+
+    virtual void releaseBuffer(Buffer *buffer)
+    {
+        buffer->raw = NULL;
+        buffer->frameCount = 0;
+    }
+
+    const void *data() const { return &_buffer[0]; }
+
+private:
+    size_t _frames;
+    std::vector<uint8_t> _buffer;
+};
+
+/**
+ * Measurements of one API on one case.
+ */
+struct Measure {
+
+    Measure() : valid(false), nsPerFrame(0), allocsPerCall(0), allocBytesPerCall(0),
+                cacheMissesPerCall(-1) {}
+
+    bool valid;
+    double nsPerFrame; /**< Best time per frame over the repetitions. */
+    double allocsPerCall;
+    double allocBytesPerCall;
+    double cacheMissesPerCall; /**< Negative if the counter is not available. */
+};
+
+struct BenchCase {
+
+    std::string name;
+    SampleSpec ssSrc;
+    SampleSpec ssDst;
+};
+
+struct BenchResult {
+
+    BenchResult() : configureStatus(NO_ERROR), configureNs(0), configureCachedNs(0),
+                    delayFrames(0) {}
+
+    status_t configureStatus;
+    double configureNs; /**< Configure of a new conversion. */
+    double configureCachedNs; /**< Configure of the same pair again. */
+    AudioConversion::Plan plan; /**< Steps chosen by the planner. */
+    size_t delayFrames; /**< Group delay of the conversion, in destination frames. */
+    Measure convert;
+    Measure getConvertedBuffer;
+};
+
+struct BenchOptions {
+
+    BenchOptions() : iterations(defaultIterations), repetitions(defaultRepetitions),
+                     tolerancePercent(defaultTolerancePercent), quick(false), calibrate(false) {}
+
+    uint32_t iterations;
+    uint32_t repetitions;
+    double tolerancePercent;
+    bool quick;
+    bool calibrate; /**< Calibrates the cost model of the planner before the cases. */
+    std::string output;
+    std::string baseline;
+    std::string filter;
+};
+
+double nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+const char *formatName(audio_format_t format)
+{
+    switch (static_cast<uint32_t>(format)) {
+
+    case AUDIO_FORMAT_PCM_16_BIT:
+        return "s16";
+    case AUDIO_FORMAT_PCM_8_24_BIT:
+        return "s8_24";
+    case AUDIO_FORMAT_PCM_32_BIT:
+        return "s32";
+    case SampleSpec::PCM_FLOAT_FORMAT:
+        return "float";
+    case SampleSpec::PCM_24_BIT_PACKED_FORMAT:
+        return "s24_3";
+    default:
+        return "unknown";
+    }
+}
+
+const char *policyName(SampleSpec::ChannelsPolicy policy)
+{
+    switch (policy) {
+
+    case SampleSpec::Copy:
+        return "c";
+    case SampleSpec::Average:
+        return "a";
+    default:
+        return "i";
+    }
+}
+
+/**
+ * Names the steps of a plan, in order, eg "resample+fused".
+ */
+std::string planName(const AudioConversion::Plan &plan)
+{
+    static const uint32_t remapStep = 1 << ChannelCountSampleSpecItem;
+    static const uint32_t reformatStep = 1 << FormatSampleSpecItem;
+    static const uint32_t resampleStep = 1 << RateSampleSpecItem;
+    std::string name;
+
+    for (size_t i = 0; i < plan.stepCount; i++) {
+
+        if (i != 0) {
+
+            name += "+";
+        }
+        if (plan.steps[i] == (remapStep | reformatStep)) {
+
+            name += "fused";
+        } else if (plan.steps[i] == remapStep) {
+
+            name += "remap";
+        } else if (plan.steps[i] == reformatStep) {
+
+            name += "reformat";
+        } else if (plan.steps[i] == resampleStep) {
+
+            name += "resample";
+        } else {
+
+            name += "unknown";
+        }
+    }
+    return name;
+}
+
+std::string sampleSpecName(const SampleSpec &ss)
+{
+    char name[64];
+    std::string policies;
+    for (uint32_t channel = 0; channel < ss.getChannelCount(); channel++) {
+
+        policies += policyName(ss.getChannelsPolicy(channel));
+    }
+    snprintf(name, sizeof(name), "%s_%uch_%s_%u", formatName(ss.getFormat()),
+             ss.getChannelCount(), policies.c_str(), ss.getSampleRate());
+    return name;
+}
+
+void addCase(std::vector<BenchCase> &cases, const BenchOptions &options,
+             const SampleSpec &ssSrc, const SampleSpec &ssDst)
+{
+    if (ssSrc.isCompatible(ssDst)) {
+
+        return;
+    }
+    BenchCase benchCase;
+    benchCase.name = sampleSpecName(ssSrc) + "-" + sampleSpecName(ssDst);
+    if (!options.filter.empty() && benchCase.name.find(options.filter) == std::string::npos) {
+
+        return;
+    }
+    benchCase.ssSrc = ssSrc;
+    benchCase.ssDst = ssDst;
+    cases.push_back(benchCase);
+}
+
+void buildCases(std::vector<BenchCase> &cases, const BenchOptions &options)
+{
+    static const uint32_t rates[] = { 8000, 16000, 44100, 48000, 96000 };
+    static const uint32_t quickRates[] = { 16000, 44100, 48000 };
+    static const audio_format_t formats[] = { AUDIO_FORMAT_PCM_16_BIT, AUDIO_FORMAT_PCM_8_24_BIT };
+    const uint32_t *rateSet = options.quick ? quickRates : rates;
+    size_t nbRates = options.quick ? sizeof(quickRates) / sizeof(quickRates[0]) :
+                                     sizeof(rates) / sizeof(rates[0]);
+
+    // Rates, formats and channels matrix, default channels policies
+    for (size_t srcRate = 0; srcRate < nbRates; srcRate++) {
+
+        for (size_t dstRate = 0; dstRate < nbRates; dstRate++) {
+
+            for (size_t srcFormat = 0; srcFormat < 2; srcFormat++) {
+
+                for (size_t dstFormat = 0; dstFormat < 2; dstFormat++) {
+
+                    for (uint32_t srcChannels = 1; srcChannels <= 2; srcChannels++) {
+
+                        for (uint32_t dstChannels = 1; dstChannels <= 2; dstChannels++) {
+
+                            addCase(cases, options,
+                                    SampleSpec(srcChannels, formats[srcFormat], rateSet[srcRate]),
+                                    SampleSpec(dstChannels, formats[dstFormat], rateSet[dstRate]));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Multichannel layouts, mixed with a matrix
+    static const uint32_t multichannel[][2] = { { 6, 2 }, { 8, 2 }, { 2, 8 }, { 6, 1 }, { 1, 6 } };
+    for (size_t format = 0; format < 2; format++) {
+
+        for (size_t layout = 0; layout < sizeof(multichannel) / sizeof(multichannel[0]); layout++) {
+
+            addCase(cases, options, SampleSpec(multichannel[layout][0], formats[format], 48000),
+                    SampleSpec(multichannel[layout][1], formats[format], 48000));
+            addCase(cases, options, SampleSpec(multichannel[layout][0], formats[format], 44100),
+                    SampleSpec(multichannel[layout][1], formats[format], 48000));
+        }
+    }
+
+    // Channels policies on stereo, at iso rate
+    static const SampleSpec::ChannelsPolicy policies[][2] = {
+
+        { SampleSpec::Copy, SampleSpec::Copy },
+        { SampleSpec::Copy, SampleSpec::Ignore },
+        { SampleSpec::Ignore, SampleSpec::Copy },
+        { SampleSpec::Average, SampleSpec::Average }
+    };
+    static const size_t nbPolicies = sizeof(policies) / sizeof(policies[0]);
+    for (size_t format = 0; format < 2; format++) {
+
+        for (size_t srcPolicy = 0; srcPolicy < nbPolicies; srcPolicy++) {
+
+            SampleSpec ssSrc(2, formats[format], 48000, policies[srcPolicy]);
+            addCase(cases, options, ssSrc, SampleSpec(1, formats[format], 48000));
+
+            for (size_t dstPolicy = 0; dstPolicy < nbPolicies; dstPolicy++) {
+
+                addCase(cases, options, ssSrc,
+                        SampleSpec(2, formats[format], 48000, policies[dstPolicy]));
+            }
+        }
+    }
+
+    // High resolution formats: every reformat pair, then with a resampler or a mix
+    static const audio_format_t allFormats[] = {
+
+        AUDIO_FORMAT_PCM_16_BIT, AUDIO_FORMAT_PCM_8_24_BIT, AUDIO_FORMAT_PCM_32_BIT,
+        SampleSpec::PCM_FLOAT_FORMAT, SampleSpec::PCM_24_BIT_PACKED_FORMAT
+    };
+    static const size_t nbFormats = sizeof(allFormats) / sizeof(allFormats[0]);
+    for (size_t srcFormat = 0; srcFormat < nbFormats; srcFormat++) {
+
+        for (size_t dstFormat = 0; dstFormat < nbFormats; dstFormat++) {
+
+            if (srcFormat == dstFormat || (srcFormat < 2 && dstFormat < 2)) {
+
+                // Iso format or already in the matrix
+                continue;
+            }
+            addCase(cases, options, SampleSpec(2, allFormats[srcFormat], 48000),
+                    SampleSpec(2, allFormats[dstFormat], 48000));
+        }
+    }
+    for (size_t format = 2; format < nbFormats; format++) {
+
+        addCase(cases, options, SampleSpec(2, allFormats[format], 44100),
+                SampleSpec(2, allFormats[format], 48000));
+        addCase(cases, options, SampleSpec(2, allFormats[format], 96000),
+                SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, 48000));
+        addCase(cases, options, SampleSpec(6, allFormats[format], 48000),
+                SampleSpec(2, allFormats[format], 48000));
+        addCase(cases, options, SampleSpec(2, allFormats[format], 48000),
+                SampleSpec(1, allFormats[format], 48000));
+    }
+}
+
+/**
+ * Measures one API: calls it warmUpCalls times, then repetitions series of iterations calls.
+ * Time per frame is the best of the series, allocations and cache misses are averaged on all
+ * the measured calls.
+ */
+template<typename Call>
+Measure measure(Call &call, uint32_t framesPerCall, const BenchOptions &options,
+                CacheMissCounter &counter)
+{
+    uint32_t iterations = options.iterations;
+    uint32_t repetitions = options.repetitions;
+    Measure result;
+    for (uint32_t i = 0; i < warmUpCalls; i++) {
+
+        if (call() != NO_ERROR) {
+
+            return result;
+        }
+    }
+
+    double bestNs = 0;
+    uint64_t cacheMisses = 0;
+    allocCalls = 0;
+    allocBytes = 0;
+    for (uint32_t repetition = 0; repetition < repetitions; repetition++) {
+
+        counter.start();
+        allocCounting = true;
+        double start = nowNs();
+        for (uint32_t i = 0; i < iterations; i++) {
+
+            call();
+        }
+        double elapsed = nowNs() - start;
+        allocCounting = false;
+        cacheMisses += counter.stop();
+
+        if (repetition == 0 || elapsed < bestNs) {
+
+            bestNs = elapsed;
+        }
+    }
+
+    double calls = static_cast<double>(repetitions) * iterations;
+    result.valid = true;
+    result.nsPerFrame = bestNs / (static_cast<double>(iterations) * framesPerCall);
+    result.allocsPerCall = allocCalls / calls;
+    result.allocBytesPerCall = allocBytes / calls;
+    result.cacheMissesPerCall = counter.isAvailable() ? cacheMisses / calls : -1;
+    return result;
+}
+
+struct ConvertCall {
+
+    AudioConversion *conversion;
+    const void *src;
+    uint32_t frames;
+
+    status_t operator()()
+    {
+        void *dst = NULL;
+        uint32_t outFrames;
+        return conversion->convert(src, &dst, frames, &outFrames);
+    }
+};
+
+struct GetConvertedBufferCall {
+
+    AudioConversion *conversion;
+    void *dst;
+    uint32_t frames;
+    AudioBufferProvider *provider;
+
+    status_t operator()()
+    {
+        return conversion->getConvertedBuffer(dst, frames, provider);
+    }
+};
+
+BenchResult runCase(const BenchCase &benchCase, const BenchOptions &options,
+                    CacheMissCounter &counter)
+{
+    BenchResult result;
+    uint32_t srcFrames = benchCase.ssSrc.getSampleRate() / periodsPerSecond;
+    uint32_t dstFrames = benchCase.ssDst.getSampleRate() / periodsPerSecond;
+
+    // A period of destination frames never needs more than a few periods of source frames
+    size_t providerFrames = 4 * (srcFrames > dstFrames ? srcFrames : dstFrames) *
+            (benchCase.ssSrc.getSampleRate() / benchCase.ssDst.getSampleRate() + 1);
+    BenchBufferProvider provider(benchCase.ssSrc, providerFrames);
+    std::vector<uint8_t> dst(benchCase.ssDst.convertFramesToBytes(dstFrames));
+
+    // Configure cost, on a new conversion then on the same pair again
+    AudioConversion conversion;
+    double start = nowNs();
+    result.configureStatus = conversion.configure(benchCase.ssSrc, benchCase.ssDst);
+    result.configureNs = nowNs() - start;
+    if (result.configureStatus != NO_ERROR) {
+
+        return result;
+    }
+    result.plan = conversion.getPlan();
+    result.delayFrames = conversion.getDelayFrames();
+    start = nowNs();
+    conversion.configure(benchCase.ssSrc, benchCase.ssDst);
+    result.configureCachedNs = nowNs() - start;
+
+    // Largest call is either convert or the source frames getConvertedBuffer requests
+    uint32_t requestedFrames = (static_cast<uint64_t>(dstFrames) *
+                                benchCase.ssSrc.getSampleRate() +
+                                benchCase.ssDst.getSampleRate() - 1) /
+            benchCase.ssDst.getSampleRate();
+    conversion.reserve(srcFrames > requestedFrames ? srcFrames : requestedFrames);
+
+    ConvertCall convertCall = { &conversion, provider.data(), srcFrames };
+    result.convert = measure(convertCall, srcFrames, options, counter);
+
+    GetConvertedBufferCall getCall = { &conversion, &dst[0], dstFrames, &provider };
+    result.getConvertedBuffer = measure(getCall, dstFrames, options, counter);
+
+    return result;
+}
+
+/**
+ * Converts the streams of a batch one after the other, each with its own conversion.
+ */
+struct StreamsCall {
+
+    AudioConversionBatch::Job *jobs;
+    size_t count;
+
+    status_t operator()()
+    {
+        for (size_t i = 0; i < count; i++) {
+
+            void *dst = jobs[i].dst;
+            status_t status = jobs[i].conversion->convert(jobs[i].src, &dst, jobs[i].inFrames,
+                                                          &jobs[i].outFrames);
+            if (status != NO_ERROR) {
+
+                return status;
+            }
+        }
+        return NO_ERROR;
+    }
+};
+
+struct BatchCall {
+
+    AudioConversionBatch *batch;
+    AudioConversionBatch::Job *jobs;
+    size_t count;
+
+    status_t operator()()
+    {
+        return batch->run(jobs, count);
+    }
+};
+
+/**
+ * Streams of a VoIP call on a 48 kHz device: media and downlink playback, uplink capture and
+ * echo reference.
+ */
+struct BatchStream {
+
+    uint32_t srcRate;
+    uint32_t srcChannels;
+    uint32_t dstRate;
+    uint32_t dstChannels;
+};
+
+static const BatchStream voipStreams[] = {
+
+    { 44100, 2, 48000, 2 },
+    { 16000, 1, 48000, 2 },
+    { 48000, 2, 16000, 1 },
+    { 48000, 2, 16000, 1 }
+};
+
+static const size_t voipStreamCount = sizeof(voipStreams) / sizeof(voipStreams[0]);
+
+/**
+ * Modes of the batch measurements: streams one after the other, batch on the calling
+ * thread, batch spread over workers whatever its size.
+ */
+enum BatchMode {
+
+    StreamsBatchMode,
+    SequentialBatchMode,
+    WorkersBatchMode,
+    NbBatchModes
+};
+
+static const char *const batchModeNames[NbBatchModes] = {
+
+    "streams", "batch", "batch_workers"
+};
+
+static const uint32_t batchWorkers = 2;
+
+/**
+ * Measures the VoIP batch in each mode, on a period of each stream.
+ *
+ * @param[out] measures measurements per mode.
+ *
+ * @return total source frames of the batch, 0 on error.
+ */
+uint32_t runVoipBatch(Measure measures[NbBatchModes], const BenchOptions &options,
+                      CacheMissCounter &counter)
+{
+    // Streams keep a state, each mode runs its own conversions
+    AudioConversion conversions[NbBatchModes][voipStreamCount];
+    AudioConversionBatch::Job jobs[NbBatchModes][voipStreamCount];
+    std::vector<std::vector<uint8_t> > buffers;
+    uint32_t totalFrames = 0;
+
+    // Jobs point within the buffers, which must never move
+    buffers.reserve(voipStreamCount * (1 + NbBatchModes));
+
+    for (size_t stream = 0; stream < voipStreamCount; stream++) {
+
+        const BatchStream &batchStream = voipStreams[stream];
+        SampleSpec ssSrc(batchStream.srcChannels, AUDIO_FORMAT_PCM_16_BIT, batchStream.srcRate);
+        SampleSpec ssDst(batchStream.dstChannels, AUDIO_FORMAT_PCM_16_BIT, batchStream.dstRate);
+        uint32_t frames = batchStream.srcRate / periodsPerSecond;
+        totalFrames += frames;
+
+        buffers.push_back(std::vector<uint8_t>(ssSrc.convertFramesToBytes(frames)));
+        for (size_t i = 0; i < buffers.back().size(); i++) {
+
+            buffers.back()[i] = rand();
+        }
+        const void *src = &buffers.back()[0];
+        for (int mode = 0; mode < NbBatchModes; mode++) {
+
+            if (conversions[mode][stream].configure(ssSrc, ssDst) != NO_ERROR) {
+
+                return 0;
+            }
+            uint32_t dstFrames = (static_cast<uint64_t>(frames) * batchStream.dstRate +
+                                  batchStream.srcRate - 1) / batchStream.srcRate + 1;
+            buffers.push_back(std::vector<uint8_t>(ssDst.convertFramesToBytes(dstFrames)));
+            AudioConversionBatch::Job job = {
+                &conversions[mode][stream], src, &buffers.back()[0], frames, 0, NO_ERROR
+            };
+            jobs[mode][stream] = job;
+        }
+    }
+
+    AudioConversionBatch sequentialBatch;
+    AudioConversionBatch workersBatch(batchWorkers, 0);
+    for (size_t stream = 0; stream < voipStreamCount; stream++) {
+
+        conversions[StreamsBatchMode][stream].reserve(jobs[StreamsBatchMode][stream].inFrames);
+    }
+    sequentialBatch.reserve(jobs[SequentialBatchMode], voipStreamCount);
+    workersBatch.reserve(jobs[WorkersBatchMode], voipStreamCount);
+
+    StreamsCall streamsCall = { jobs[StreamsBatchMode], voipStreamCount };
+    measures[StreamsBatchMode] = measure(streamsCall, totalFrames, options, counter);
+    BatchCall sequentialCall = { &sequentialBatch, jobs[SequentialBatchMode], voipStreamCount };
+    measures[SequentialBatchMode] = measure(sequentialCall, totalFrames, options, counter);
+    BatchCall workersCall = { &workersBatch, jobs[WorkersBatchMode], voipStreamCount };
+    measures[WorkersBatchMode] = measure(workersCall, totalFrames, options, counter);
+
+    return totalFrames;
+}
+
+/**
+ * Rate pairs that the resampling library does not support, as they are either converted by the
+ * polyphase resampler or by the pivot chain.
+ */
+static const uint32_t unsupportedRatePairs[][2] = {
+
+    { 44100, 16000 },
+    { 22050, 16000 },
+    { 11025, 8000 },
+    { 16000, 44100 },
+    { 44100, 32000 }
+};
+
+static const size_t unsupportedRatePairCount =
+        sizeof(unsupportedRatePairs) / sizeof(unsupportedRatePairs[0]);
+
+/**
+ * Modes of the resampling measurements: through the pivot rate with two conversions, or in
+ * a single pass at each quality level of the polyphase resampler.
+ */
+enum ResamplingMode {
+
+    PivotResamplingMode,
+    LowResamplingMode,
+    MediumResamplingMode,
+    HighResamplingMode,
+    NbResamplingModes
+};
+
+static const char *const resamplingModeNames[NbResamplingModes] = {
+
+    "pivot", "polyphase_low", "polyphase_medium", "polyphase_high"
+};
+
+static const AudioConversion::ResamplingQuality resamplingModeQualities[NbResamplingModes] = {
+
+    AudioConversion::MediumResamplingQuality,
+    AudioConversion::LowResamplingQuality,
+    AudioConversion::MediumResamplingQuality,
+    AudioConversion::HighResamplingQuality
+};
+
+static const uint32_t pivotRate = 48000;
+
+/**
+ * Converts through the pivot rate, the output of the first conversion being the input of the
+ * second one, as the pivot chain of the resampler.
+ */
+struct PivotCall {
+
+    AudioConversion *toPivot;
+    AudioConversion *fromPivot;
+    const void *src;
+    uint32_t frames;
+
+    status_t operator()()
+    {
+        void *pivot = NULL;
+        uint32_t pivotFrames;
+        status_t status = toPivot->convert(src, &pivot, frames, &pivotFrames);
+        if (status != NO_ERROR) {
+
+            return status;
+        }
+        void *dst = NULL;
+        uint32_t outFrames;
+        return fromPivot->convert(pivot, &dst, pivotFrames, &outFrames);
+    }
+};
+
+std::string resamplingName(const uint32_t ratePair[2])
+{
+    char name[64];
+    snprintf(name, sizeof(name), "resampling_%u_%u", ratePair[0], ratePair[1]);
+    return name;
+}
+
+/**
+ * Measures the convert calls of a rate pair in each resampling mode, on stereo 16 bits frames.
+ *
+ * @param[out] measures measurements per mode, only valid if the mode could be configured.
+ */
+void runResampling(const uint32_t ratePair[2], Measure measures[NbResamplingModes],
+                   const BenchOptions &options, CacheMissCounter &counter)
+{
+    SampleSpec ssSrc(2, AUDIO_FORMAT_PCM_16_BIT, ratePair[0]);
+    SampleSpec ssPivot(2, AUDIO_FORMAT_PCM_16_BIT, pivotRate);
+    SampleSpec ssDst(2, AUDIO_FORMAT_PCM_16_BIT, ratePair[1]);
+    uint32_t frames = ratePair[0] / periodsPerSecond;
+    std::vector<uint8_t> src(ssSrc.convertFramesToBytes(frames));
+    for (size_t i = 0; i < src.size(); i++) {
+
+        src[i] = rand();
+    }
+
+    AudioConversion toPivot;
+    AudioConversion fromPivot;
+    if (toPivot.configure(ssSrc, ssPivot) == NO_ERROR &&
+        fromPivot.configure(ssPivot, ssDst) == NO_ERROR) {
+
+        toPivot.reserve(frames);
+        fromPivot.reserve((static_cast<uint64_t>(frames) * pivotRate + ratePair[0] - 1) /
+                          ratePair[0] + 1);
+        PivotCall pivotCall = { &toPivot, &fromPivot, &src[0], frames };
+        measures[PivotResamplingMode] = measure(pivotCall, frames, options, counter);
+    }
+
+    for (int mode = LowResamplingMode; mode < NbResamplingModes; mode++) {
+
+        AudioConversion conversion;
+        conversion.setResamplingQuality(resamplingModeQualities[mode]);
+        if (conversion.configure(ssSrc, ssDst) != NO_ERROR) {
+
+            continue;
+        }
+        conversion.reserve(frames);
+        ConvertCall convertCall = { &conversion, &src[0], frames };
+        measures[mode] = measure(convertCall, frames, options, counter);
+    }
+}
+
+/**
+ * Remap operation of one destination channel, as compiled in the remap table of the remapper.
+ */
+struct GenericRemapEntry {
+
+    uint32_t srcA;
+    uint32_t srcB;
+    uint32_t mask;
+};
+
+static const uint32_t maxRemapChannels = 2;
+
+/**
+ * Channels count pairs the remapper has specialized kernels for, with the remap table their
+ * channels policies compile into.
+ */
+struct RemapCase {
+
+    const char *name;
+    uint32_t srcChannels;
+    uint32_t dstChannels;
+    SampleSpec::ChannelsPolicy dstPolicies[maxRemapChannels];
+    GenericRemapEntry table[maxRemapChannels];
+};
+
+static const RemapCase remapCases[] = {
+
+    { "mono_to_stereo", 1, 2, { SampleSpec::Copy, SampleSpec::Copy },
+      { { 0, 0, ~0u }, { 0, 0, ~0u } } },
+    { "stereo_to_mono", 2, 1, { SampleSpec::Copy, SampleSpec::Copy },
+      { { 0, 1, ~0u }, { 0, 0, 0 } } },
+    { "stereo_to_average", 2, 2, { SampleSpec::Average, SampleSpec::Average },
+      { { 0, 1, ~0u }, { 0, 1, ~0u } } }
+};
+
+static const size_t remapCaseCount = sizeof(remapCases) / sizeof(remapCases[0]);
+
+static const audio_format_t remapFormats[] = {
+
+    AUDIO_FORMAT_PCM_16_BIT, AUDIO_FORMAT_PCM_8_24_BIT
+};
+
+static const size_t remapFormatCount = sizeof(remapFormats) / sizeof(remapFormats[0]);
+
+/**
+ * Modes of the remapping measurements: the generic kernel the remapper had before its kernels
+ * were specialized on the channels count, or the specialized kernel selected on configure.
+ */
+enum RemappingMode {
+
+    GenericRemappingMode,
+    SpecializedRemappingMode,
+    NbRemappingModes
+};
+
+static const char *const remappingModeNames[NbRemappingModes] = {
+
+    "generic", "specialized"
+};
+
+template<typename type>
+inline type averageGenericSamples(type a, type b)
+{
+    return (a >> 1) + (b >> 1) + (a & b & 1);
+}
+
+/**
+ * Generic remap kernel, as the remapper had before its kernels were specialized: the channels
+ * count are read on each call and the remap table on each sample.
+ */
+template<typename type>
+__attribute__((noinline)) void remapGeneric(const RemapCase &remapCase, const type *src,
+                                            type *dst, uint32_t frames)
+{
+    uint32_t srcChannels = remapCase.srcChannels;
+    uint32_t dstChannels = remapCase.dstChannels;
+
+    for (uint32_t frame = 0; frame < frames; frame++) {
+
+        const type *srcFrame = &src[srcChannels * frame];
+        type *dstFrame = &dst[dstChannels * frame];
+        type remappedFrame[maxRemapChannels];
+
+        for (uint32_t channel = 0; channel < dstChannels; channel++) {
+
+            const GenericRemapEntry &entry = remapCase.table[channel];
+            remappedFrame[channel] = averageGenericSamples<type>(srcFrame[entry.srcA],
+                                                                 srcFrame[entry.srcB]) &
+                    entry.mask;
+        }
+        for (uint32_t channel = 0; channel < dstChannels; channel++) {
+
+            dstFrame[channel] = remappedFrame[channel];
+        }
+    }
+}
+
+template<typename type>
+struct GenericRemapCall {
+
+    const RemapCase *remapCase;
+    const void *src;
+    void *dst;
+    uint32_t frames;
+
+    status_t operator()()
+    {
+        remapGeneric<type>(*remapCase, static_cast<const type *>(src), static_cast<type *>(dst),
+                           frames);
+        return NO_ERROR;
+    }
+};
+
+std::string remappingName(const RemapCase &remapCase, audio_format_t format)
+{
+    return std::string("remapping_") + formatName(format) + "_" + remapCase.name;
+}
+
+/**
+ * Measures the remapping of a case with the generic kernel and through a conversion, that
+ * runs the specialized kernel, on the same source frames.
+ *
+ * @param[out] measures measurements per mode, only valid if the mode could be run.
+ *
+ * @return true if both modes give the same destination frames, false otherwise.
+ */
+bool runRemapping(const RemapCase &remapCase, audio_format_t format,
+                  Measure measures[NbRemappingModes], const BenchOptions &options,
+                  CacheMissCounter &counter)
+{
+    SampleSpec ssSrc(remapCase.srcChannels, format, pivotRate);
+    SampleSpec ssDst(remapCase.dstChannels, format, pivotRate, remapCase.dstPolicies);
+    uint32_t frames = pivotRate / periodsPerSecond;
+    std::vector<uint8_t> src(ssSrc.convertFramesToBytes(frames));
+    std::vector<uint8_t> genericDst(ssDst.convertFramesToBytes(frames));
+    std::vector<uint8_t> specializedDst(genericDst.size());
+    for (size_t i = 0; i < src.size(); i++) {
+
+        src[i] = rand();
+    }
+
+    if (format == AUDIO_FORMAT_PCM_16_BIT) {
+
+        GenericRemapCall<int16_t> genericCall = { &remapCase, &src[0], &genericDst[0], frames };
+        measures[GenericRemappingMode] = measure(genericCall, frames, options, counter);
+    } else {
+
+        GenericRemapCall<uint32_t> genericCall = { &remapCase, &src[0], &genericDst[0], frames };
+        measures[GenericRemappingMode] = measure(genericCall, frames, options, counter);
+    }
+
+    AudioConversion conversion;
+    if (conversion.configure(ssSrc, ssDst) != NO_ERROR) {
+
+        return false;
+    }
+    conversion.reserve(frames);
+    ConvertCall convertCall = { &conversion, &src[0], frames };
+    measures[SpecializedRemappingMode] = measure(convertCall, frames, options, counter);
+
+    void *dst = &specializedDst[0];
+    uint32_t outFrames;
+    return conversion.convert(&src[0], &dst, frames, &outFrames) == NO_ERROR &&
+            outFrames == frames && genericDst == specializedDst;
+}
+
+/**
+ * Writes the measurements of one API.
+ * CPU per call minute is the processing time of one minute of audio, in ms, given the rate of
+ * the frames counted by the API.
+ */
+void writeMeasure(FILE *out, const char *name, const Measure &measure, uint32_t rate)
+{
+    if (!measure.valid) {
+
+        fprintf(out, "\"%s\": null", name);
+        return;
+    }
+    fprintf(out, "\"%s\": {\"ns_per_frame\": %.4f, \"cpu_ms_per_call_minute\": %.3f, "
+            "\"allocs_per_call\": %.3f, \"alloc_bytes_per_call\": %.1f, "
+            "\"cache_misses_per_call\": ",
+            name, measure.nsPerFrame, measure.nsPerFrame * rate * 60 / 1e6,
+            measure.allocsPerCall, measure.allocBytesPerCall);
+    if (measure.cacheMissesPerCall < 0) {
+
+        fprintf(out, "null}");
+    } else {
+
+        fprintf(out, "%.1f}", measure.cacheMissesPerCall);
+    }
+}
+
+void writeSampleSpec(FILE *out, const char *name, const SampleSpec &ss)
+{
+    std::string policies;
+    for (uint32_t channel = 0; channel < ss.getChannelCount(); channel++) {
+
+        policies += policyName(ss.getChannelsPolicy(channel));
+    }
+    fprintf(out, "\"%s\": {\"rate\": %u, \"format\": \"%s\", \"channels\": %u, "
+            "\"policies\": \"%s\"}",
+            name, ss.getSampleRate(), formatName(ss.getFormat()), ss.getChannelCount(),
+            policies.c_str());
+}
+
+/**
+ * Writes a case on a single line, so that a baseline file is parsed line by line.
+ */
+void writeCase(FILE *out, const BenchCase &benchCase, const BenchResult &result, bool last)
+{
+    fprintf(out, "    {\"name\": \"%s\", ", benchCase.name.c_str());
+    writeSampleSpec(out, "src", benchCase.ssSrc);
+    fprintf(out, ", ");
+    writeSampleSpec(out, "dst", benchCase.ssDst);
+    fprintf(out, ", \"configure_status\": %d", result.configureStatus);
+    if (result.configureStatus == NO_ERROR) {
+
+        fprintf(out, ", \"plan\": \"%s\", \"plan_cost_ns_per_s\": %.0f",
+                planName(result.plan).c_str(), result.plan.cost);
+        fprintf(out, ", \"delay_frames\": %u", static_cast<unsigned>(result.delayFrames));
+        fprintf(out, ", \"configure_ns\": %.0f, \"configure_cached_ns\": %.0f, ",
+                result.configureNs, result.configureCachedNs);
+        writeMeasure(out, "convert", result.convert, benchCase.ssSrc.getSampleRate());
+        fprintf(out, ", ");
+        writeMeasure(out, "get_converted_buffer", result.getConvertedBuffer,
+                     benchCase.ssDst.getSampleRate());
+    }
+    fprintf(out, "}%s\n", last ? "" : ",");
+}
+
+/**
+ * Writes a batch on a single line, its CPU per call minute accounts for the frames of all
+ * its streams.
+ */
+void writeBatch(FILE *out, const char *name, const Measure measures[NbBatchModes],
+                uint32_t framesPerPeriod)
+{
+    fprintf(out, "    {\"name\": \"%s\", \"streams_count\": %u, \"frames_per_period\": %u",
+            name, static_cast<uint32_t>(voipStreamCount), framesPerPeriod);
+    for (int mode = 0; mode < NbBatchModes; mode++) {
+
+        fprintf(out, ", ");
+        writeMeasure(out, batchModeNames[mode], measures[mode],
+                     framesPerPeriod * periodsPerSecond);
+    }
+    fprintf(out, "}\n");
+}
+
+/**
+ * Writes the resampling modes of a rate pair on a single line, CPU per call minute accounts for
+ * the source frames.
+ */
+void writeResampling(FILE *out, const char *name, const uint32_t ratePair[2],
+                     const Measure measures[NbResamplingModes], bool last)
+{
+    fprintf(out, "    {\"name\": \"%s\", \"src_rate\": %u, \"dst_rate\": %u",
+            name, ratePair[0], ratePair[1]);
+    for (int mode = 0; mode < NbResamplingModes; mode++) {
+
+        fprintf(out, ", ");
+        writeMeasure(out, resamplingModeNames[mode], measures[mode], ratePair[0]);
+    }
+    fprintf(out, "}%s\n", last ? "" : ",");
+}
+
+/**
+ * Writes the remapping modes of a case on a single line, with the check of their outputs.
+ */
+void writeRemapping(FILE *out, const char *name, uint32_t rate,
+                    const Measure measures[NbRemappingModes], bool bitExact, bool last)
+{
+    fprintf(out, "    {\"name\": \"%s\", \"bit_exact\": %s", name, bitExact ? "true" : "false");
+    for (int mode = 0; mode < NbRemappingModes; mode++) {
+
+        fprintf(out, ", ");
+        writeMeasure(out, remappingModeNames[mode], measures[mode], rate);
+    }
+    fprintf(out, "}%s\n", last ? "" : ",");
+}
+
+/**
+ * Baseline values of a case, read back from a previous result file.
+ */
+struct BaselineCase {
+
+    std::string name;
+    double values[4]; /**< ns per frame and allocs per call, of convert then getConvertedBuffer */
+    bool valid[4];
+};
+
+static const char *const baselineKeys[] = {
+
+    "\"convert\": {\"ns_per_frame\": ",
+    "\"get_converted_buffer\": {\"ns_per_frame\": "
+};
+
+bool parseBaselineLine(const char *line, BaselineCase &baselineCase)
+{
+    static const char nameKey[] = "{\"name\": \"";
+    static const char allocsKey[] = "\"allocs_per_call\": ";
+
+    const char *name = strstr(line, nameKey);
+    if (name == NULL) {
+
+        return false;
+    }
+    name += sizeof(nameKey) - 1;
+    const char *nameEnd = strchr(name, '"');
+    if (nameEnd == NULL) {
+
+        return false;
+    }
+    baselineCase.name.assign(name, nameEnd - name);
+
+    for (size_t api = 0; api < 2; api++) {
+
+        baselineCase.valid[2 * api] = baselineCase.valid[2 * api + 1] = false;
+        const char *measure = strstr(line, baselineKeys[api]);
+        if (measure == NULL) {
+
+            continue;
+        }
+        measure += strlen(baselineKeys[api]);
+        baselineCase.valid[2 * api] = sscanf(measure, "%lf", &baselineCase.values[2 * api]) == 1;
+        const char *allocs = strstr(measure, allocsKey);
+        if (allocs != NULL) {
+
+            baselineCase.valid[2 * api + 1] =
+                    sscanf(allocs + sizeof(allocsKey) - 1, "%lf",
+                           &baselineCase.values[2 * api + 1]) == 1;
+        }
+    }
+    return true;
+}
+
+bool loadBaseline(const std::string &path, std::vector<BaselineCase> &baseline)
+{
+    FILE *in = fopen(path.c_str(), "r");
+    if (in == NULL) {
+
+        fprintf(stderr, "cannot open baseline %s\n", path.c_str());
+        return false;
+    }
+    char line[2048];
+    while (fgets(line, sizeof(line), in) != NULL) {
+
+        BaselineCase baselineCase;
+        if (parseBaselineLine(line, baselineCase)) {
+
+            baseline.push_back(baselineCase);
+        }
+    }
+    fclose(in);
+    return true;
+}
+
+/**
+ * Compares a result with the baseline.
+ *
+ * @return number of regressions found.
+ */
+uint32_t checkRegression(const BenchCase &benchCase, const BenchResult &result,
+                         const std::vector<BaselineCase> &baseline, double tolerancePercent)
+{
+    static const char *const apiNames[] = { "convert", "getConvertedBuffer" };
+    const Measure *measures[] = { &result.convert, &result.getConvertedBuffer };
+    uint32_t regressions = 0;
+
+    for (size_t i = 0; i < baseline.size(); i++) {
+
+        if (baseline[i].name != benchCase.name) {
+
+            continue;
+        }
+        for (size_t api = 0; api < 2; api++) {
+
+            const Measure &measure = *measures[api];
+            if (!measure.valid || !baseline[i].valid[2 * api]) {
+
+                continue;
+            }
+            double reference = baseline[i].values[2 * api];
+            if (measure.nsPerFrame > reference * (1 + tolerancePercent / 100)) {
+
+                fprintf(stderr, "REGRESSION %s %s: %.4f ns/frame, baseline %.4f\n",
+                        benchCase.name.c_str(), apiNames[api], measure.nsPerFrame, reference);
+                regressions++;
+            }
+            if (baseline[i].valid[2 * api + 1] &&
+                measure.allocsPerCall > baseline[i].values[2 * api + 1]) {
+
+                fprintf(stderr, "REGRESSION %s %s: %.3f allocs/call, baseline %.3f\n",
+                        benchCase.name.c_str(), apiNames[api], measure.allocsPerCall,
+                        baseline[i].values[2 * api + 1]);
+                regressions++;
+            }
+        }
+        break;
+    }
+    return regressions;
+}
+
+void usage(const char *program)
+{
+    fprintf(stderr, "usage: %s [-o output.json] [-b baseline.json] [-t tolerance_percent]\n"
+            "       [-n iterations] [-r repetitions] [-f name_filter] [-q] [-c]\n", program);
+}
+
+bool parseOptions(int argc, char **argv, BenchOptions &options)
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "o:b:t:n:r:f:qch")) != -1) {
+
+        switch (opt) {
+
+        case 'o':
+            options.output = optarg;
+            break;
+        case 'b':
+            options.baseline = optarg;
+            break;
+        case 't':
+            options.tolerancePercent = atof(optarg);
+            break;
+        case 'n':
+            options.iterations = strtoul(optarg, NULL, 0);
+            break;
+        case 'r':
+            options.repetitions = strtoul(optarg, NULL, 0);
+            break;
+        case 'f':
+            options.filter = optarg;
+            break;
+        case 'q':
+            options.quick = true;
+            break;
+        case 'c':
+            options.calibrate = true;
+            break;
+        default:
+            return false;
+        }
+    }
+    return options.iterations != 0 && options.repetitions != 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options)) {
+
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::vector<BaselineCase> baseline;
+    if (!options.baseline.empty() && !loadBaseline(options.baseline, baseline)) {
+
+        return 2;
+    }
+
+    FILE *out = stdout;
+    if (!options.output.empty()) {
+
+        out = fopen(options.output.c_str(), "w");
+        if (out == NULL) {
+
+            fprintf(stderr, "cannot open %s\n", options.output.c_str());
+            return 2;
+        }
+    }
+
+    if (options.calibrate) {
+
+        AudioConversion::calibrate();
+    }
+
+    std::vector<BenchCase> cases;
+    buildCases(cases, options);
+    CacheMissCounter counter;
+    uint32_t regressions = 0;
+    uint32_t failures = 0;
+
+    fprintf(out, "{\n  \"benchmark\": \"audio_conversion\",\n  \"iterations\": %u,\n"
+            "  \"repetitions\": %u,\n  \"cache_misses_available\": %s,\n  \"cases\": [\n",
+            options.iterations, options.repetitions, counter.isAvailable() ? "true" : "false");
+
+    for (size_t i = 0; i < cases.size(); i++) {
+
+        BenchResult result = runCase(cases[i], options, counter);
+        writeCase(out, cases[i], result, i + 1 == cases.size());
+        fflush(out);
+
+        if (result.configureStatus != NO_ERROR) {
+
+            failures++;
+        }
+        regressions += checkRegression(cases[i], result, baseline, options.tolerancePercent);
+    }
+    fprintf(out, "  ],\n  \"batches\": [\n");
+
+    static const char voipBatchName[] = "voip_batch";
+    if (options.filter.empty() || std::string(voipBatchName).find(options.filter) !=
+        std::string::npos) {
+
+        Measure measures[NbBatchModes];
+        uint32_t framesPerPeriod = runVoipBatch(measures, options, counter);
+        if (framesPerPeriod == 0) {
+
+            failures++;
+        }
+        writeBatch(out, voipBatchName, measures, framesPerPeriod);
+    }
+    fprintf(out, "  ],\n  \"resamplers\": [\n");
+
+    std::vector<size_t> ratePairs;
+    for (size_t pair = 0; pair < unsupportedRatePairCount; pair++) {
+
+        if (options.filter.empty() || resamplingName(unsupportedRatePairs[pair]).find(
+                options.filter) != std::string::npos) {
+
+            ratePairs.push_back(pair);
+        }
+    }
+    for (size_t i = 0; i < ratePairs.size(); i++) {
+
+        const uint32_t *ratePair = unsupportedRatePairs[ratePairs[i]];
+        Measure measures[NbResamplingModes];
+        runResampling(ratePair, measures, options, counter);
+        writeResampling(out, resamplingName(ratePair).c_str(), ratePair, measures,
+                        i + 1 == ratePairs.size());
+        fflush(out);
+    }
+
+    fprintf(out, "  ],\n  \"remappers\": [\n");
+
+    uint32_t remapMismatches = 0;
+    std::vector<std::pair<size_t, size_t> > remappings;
+    for (size_t format = 0; format < remapFormatCount; format++) {
+
+        for (size_t remapCase = 0; remapCase < remapCaseCount; remapCase++) {
+
+            if (options.filter.empty() || remappingName(remapCases[remapCase],
+                                                        remapFormats[format]).find(
+                    options.filter) != std::string::npos) {
+
+                remappings.push_back(std::make_pair(format, remapCase));
+            }
+        }
+    }
+    for (size_t i = 0; i < remappings.size(); i++) {
+
+        const RemapCase &remapCase = remapCases[remappings[i].second];
+        audio_format_t format = remapFormats[remappings[i].first];
+        Measure measures[NbRemappingModes];
+        bool bitExact = runRemapping(remapCase, format, measures, options, counter);
+        if (!bitExact) {
+
+            remapMismatches++;
+        }
+        writeRemapping(out, remappingName(remapCase, format).c_str(), pivotRate, measures,
+                       bitExact, i + 1 == remappings.size());
+        fflush(out);
+    }
+
+    fprintf(out, "  ],\n  \"unsupported_cases\": %u,\n  \"regressions\": %u,\n"
+            "  \"remap_mismatches\": %u,\n  \"forbidden_allocations\": %llu\n}\n",
+            failures, regressions, remapMismatches,
+            static_cast<unsigned long long>(forbiddenAllocCalls));
+
+    if (out != stdout) {
+
+        fclose(out);
+    }
+    if (forbiddenAllocCalls != 0) {
+
+        fprintf(stderr, "%llu allocations within convert despite the reservation\n",
+                static_cast<unsigned long long>(forbiddenAllocCalls));
+        return 1;
+    }
+    if (remapMismatches != 0) {
+
+        fprintf(stderr, "%u remappings differ between the generic and specialized kernels\n",
+                remapMismatches);
+        return 1;
+    }
+    return regressions != 0 ? 1 : 0;
+}
@@ -0,0 +1,136 @@
+/*
+ **
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+/**
+ * Local stand-in for the iasrc resampler library, so that the benchmark runs on any host.
+ * It mimics the library constraints (conversions from or to 48 kHz only) so that the same
+ * conversion chains are built, but uses a linear interpolation: timings of the resampling
+ * step itself are not representative of the target library.
+ */
+
+#include <iasrc_resampler.h>
+#include <stdlib.h>
+
+namespace {
+
+enum {
+
+    MaxChannels = 8
+};
+
+struct StandInContext {
+
+    int channels;
+    int inRate;
+    int outRate;
+    double position; /**< Position of the next output frame, relative to the next input. */
+    float lastFrame[MaxChannels]; /**< Last input frame of the previous call. */
+};
+
+bool isRateSupported(int rate)
+{
+    static const int supportedRates[] = {
+
+        8000, 11025, 16000, 22050, 24000, 32000, 44100, 48000, 96000
+    };
+    for (size_t i = 0; i < sizeof(supportedRates) / sizeof(supportedRates[0]); i++) {
+
+        if (supportedRates[i] == rate) {
+
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+extern "C" {
+
+int iaresamplib_supported_conversion(int in_rate, int out_rate)
+{
+    return ((in_rate == 48000) || (out_rate == 48000)) &&
+            isRateSupported(in_rate) && isRateSupported(out_rate);
+}
+
+void iaresamplib_new(void **context, int channels, int in_rate, int out_rate)
+{
+    if (channels > MaxChannels) {
+
+        *context = NULL;
+        return;
+    }
+    StandInContext *ctx = static_cast<StandInContext *>(calloc(1, sizeof(StandInContext)));
+    if (ctx != NULL) {
+
+        ctx->channels = channels;
+        ctx->inRate = in_rate;
+        ctx->outRate = out_rate;
+    }
+    *context = ctx;
+}
+
+void iaresamplib_reset(void *context)
+{
+    StandInContext *ctx = static_cast<StandInContext *>(context);
+    ctx->position = 0;
+    for (int channel = 0; channel < MaxChannels; channel++) {
+
+        ctx->lastFrame[channel] = 0;
+    }
+}
+
+void iaresamplib_delete(void **context)
+{
+    free(*context);
+    *context = NULL;
+}
+
+void iaresamplib_process_float(void *context, float *in, int in_frames, float *out,
+                               unsigned int *out_frames)
+{
+    StandInContext *ctx = static_cast<StandInContext *>(context);
+    double step = static_cast<double>(ctx->inRate) / ctx->outRate;
+    double position = ctx->position;
+    unsigned int frames = 0;
+
+    while (position < in_frames) {
+
+        int index = static_cast<int>(position);
+        float fraction = static_cast<float>(position - index);
+        for (int channel = 0; channel < ctx->channels; channel++) {
+
+            float previous = index == 0 ? ctx->lastFrame[channel] :
+                    in[(index - 1) * ctx->channels + channel];
+            float next = in[index * ctx->channels + channel];
+            out[frames * ctx->channels + channel] = previous + (next - previous) * fraction;
+        }
+        frames++;
+        position += step;
+    }
+    ctx->position = position - in_frames;
+    if (in_frames > 0) {
+
+        for (int channel = 0; channel < ctx->channels; channel++) {
+
+            ctx->lastFrame[channel] = in[(in_frames - 1) * ctx->channels + channel];
+        }
+    }
+    *out_frames = frames;
+}
+
+} // extern "C"
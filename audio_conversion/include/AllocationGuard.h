@@ -0,0 +1,67 @@
+/*
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+#pragma once
+#pragma once
+
+namespace android_audio_legacy {
+
+/**
+ * Debug check of the allocation free contract of the conversion.
+ * While a thread is within a forbidden scope, the conversion library asserts on any allocation
+ * of its own buffers. Heap hooks of the process (e.g. an operator new of a test) may query the
+ * scope to trip on any other allocation.
+ * Checks are only built in debug builds (DEBUG defined), scopes do nothing otherwise.
+ */
+class AllocationGuard {
+
+public:
+    /**
+     * Forbids the allocations of the calling thread until destruction. Scopes may be nested.
+     */
+    class ForbiddenScope {
+
+    public:
+        /**
+         * @param[in] forbid false to make the scope neutral.
+         */
+        ForbiddenScope(bool forbid = true);
+        ~ForbiddenScope();
+
+    private:
+        ForbiddenScope(const ForbiddenScope &);
+        ForbiddenScope &operator = (const ForbiddenScope &);
+
+        bool _forbid;
+    };
+
+    /**
+     * Checks if the calling thread is within a forbidden scope.
+     *
+     * @return true if allocations are forbidden, always false in release builds.
+     */
+    static bool isAllocationForbidden();
+
+    /**
+     * Asserts the calling thread is allowed to allocate.
+     * To be called by the conversion library before any allocation that may happen on the
+     * audio thread.
+     *
+     * @param[in] context name of the caller, logged if the check fails.
+     */
+    static void checkAllocation(const char *context);
+};
+
+}; // namespace android
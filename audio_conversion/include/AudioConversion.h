@@ -16,6 +16,8 @@
  */
 #pragma once
 
+#include "AudioRingBuffer.h"
+#include "ScratchArena.h"
 #include <SampleSpec.h>
 #include <media/AudioBufferProvider.h>
 #include <list>
@@ -23,13 +25,39 @@
 namespace android_audio_legacy {
 
 class AudioConverter;
+class AudioConversionBatch;
 
 class AudioConversion {
 
+    typedef std::list<AudioConverter*> AudioConverterList;
     typedef std::list<AudioConverter*>::iterator AudioConverterListIterator;
     typedef std::list<AudioConverter*>::const_iterator AudioConverterListConstIterator;
 
 public:
+    /**
+     * Conversion steps chosen by configure, for debugging purposes.
+     * Each step is a converter, given by the mask of the sample spec items it converts: the
+     * fused converter converts both the channels and the format.
+     */
+    struct Plan {
+
+        Plan() : stepCount(0), cost(0) {}
+
+        uint32_t steps[NbSampleSpecItems]; /**< Sample spec items mask of each step, in order. */
+        size_t stepCount; /**< Number of steps, 0 if no conversion is performed. */
+        float cost; /**< Estimated CPU time to convert one second of audio, in nanoseconds. */
+    };
+
+    /**
+     * Quality / cost levels of the resampling of the rate pairs that the resampling library
+     * does not support, ie of the polyphase resampler.
+     */
+    enum ResamplingQuality {
+
+        LowResamplingQuality = 0,
+        MediumResamplingQuality,
+        HighResamplingQuality
+    };
 
     AudioConversion();
     virtual ~AudioConversion();
@@ -37,14 +65,16 @@ public:
     /**
      * Configures the conversion chain.
      * It configures the conversion chain that may be used to convert samples from the source
-     * to destination sample specification. This configuration tries to order the list of converters
-     * so that it minimizes the number of samples on which the resampling is done.
-     * To optimize the convertion and make the processing as light as possible, the
-     * order of converter is important.
-     * This function will call the recursive function configureAndAddConverter starting
-     * from the remapper operation (ie the converter working on the number of channels),
-     * then the reformatter operation (ie converter changing the format of the samples),
-     * and finally the resampler (ie converter changing the sample rate).
+     * to destination sample specification. To make the processing as light as possible, the
+     * order of the converters is important: every order of the remapper (ie the converter
+     * working on the number of channels), the reformatter (ie converter changing the format of
+     * the samples) and the resampler (ie converter changing the sample rate) is weighed with
+     * the streaming cost model, and the cheapest one that the converters support is chosen.
+     * Frequent combinations of remap and reformat may be handled by a single pass fused
+     * converter, weighed as a step of the chain as well.
+     * Configured chains are kept in a small cache, so that switching back to a previously used
+     * pair of sample specifications reuses its converters without any allocation. Their filter
+     * histories are cleared, so that the reused chain starts from silence as a new one.
      *
      * @param[in] ssSrc source sample specifications.
      * @param[in] ssDst destination sample specifications.
@@ -53,12 +83,49 @@ public:
      */
     android::status_t configure(const SampleSpec &ssSrc, const SampleSpec &ssDst);
 
+    /**
+     * Reserves the buffers of the conversion for a maximum number of frames per call.
+     * Scratch buffers of the conversion are allocated at once within a single arena, along with
+     * the internal buffers of the converters. The reservation is kept and applied again by each
+     * configure, so that once made, convert and getConvertedBuffer never allocate as long as the
+     * calls stay within the reservation. A longer call reserves again for its frames first.
+     * Debug builds assert on any allocation of the conversion within convert once a reservation
+     * is made.
+     *
+     * @param[in] maxFrames maximum number of frames in the source sample specification given to
+     *                      convert, or requested from the provider by getConvertedBuffer.
+     *
+     * @return status OK, error code otherwise.
+     */
+    android::status_t reserve(size_t maxFrames);
+
+    /**
+     * Enables or disables the dithering of the conversions reducing the bit depth to 16 bits.
+     * When enabled, such conversions requantize the samples with a high-pass TPDF dither instead
+     * of rounding them, at the cost of a slightly higher noise floor. Voice streams, that are
+     * processed afterwards by speech codecs, may disable it.
+     * Dithering is enabled by default, the setting is applied on next configure.
+     *
+     * @param[in] enable true to dither the requantizations to 16 bits, false to round them.
+     */
+    void setDithering(bool enable) { _dithering = enable; }
+
+    /**
+     * Selects the quality level of the resampling of the rate pairs that the resampling library
+     * does not support, which are converted in a single pass by a polyphase filter: a higher
+     * level has more taps per phase and a sharper rolloff, at a higher CPU cost.
+     * Medium by default, the setting is applied on next configure.
+     *
+     * @param[in] quality quality level of the polyphase filter.
+     */
+    void setResamplingQuality(ResamplingQuality quality) { _resamplingQuality = quality; }
+
     /**
      * Converts audio samples.
      * It converts audio samples using the conversion chains that must be configured before.
      * Destination buffer may be given or not to minimize the number of copy. If not given,
-     * allocation is done by the resampler. In this case, the ouput buffer will contain valid data
-     * until next convert call or configure.
+     * output is done within a scratch buffer of the conversion. In this case, the ouput buffer will
+     * contain valid data until next convert call or configure.
      *
      * @param[in] src buffer of samples to conversion.
      * @param[out] dst destination sample buffer. If the value pointer by dst
@@ -93,12 +160,101 @@ public:
                                          const uint32_t outFrames,
                                          android::AudioBufferProvider *bufferProvider);
 
+    /**
+     * Number of configure calls that reused a cached conversion chain.
+     *
+     * @return chain cache hits since construction.
+     */
+    uint32_t getChainCacheHits() const { return _chainCacheHits; }
+
+    /**
+     * Number of configure calls that had to configure a new conversion chain.
+     *
+     * @return chain cache misses since construction.
+     */
+    uint32_t getChainCacheMisses() const { return _chainCacheMisses; }
+
+    /**
+     * Gets the plan of the conversion chain in use.
+     *
+     * @return plan chosen by the last configure, without any step if no conversion is performed.
+     */
+    Plan getPlan() const;
+
+    /**
+     * Gets the delay added by the conversion, ie the group delay of the filters of the
+     * conversion chain, pivot resampler included, plus the converted frames kept in the
+     * conversion for the next getConvertedBuffer call.
+     * Streams add it to the delay of the hardware buffer for their latency and the timestamps
+     * of the echo reference.
+     *
+     * @return delay in frames in the destination sample specification.
+     */
+    size_t getDelayFrames() const;
+
+    /**
+     * Measures the cost model of the converters on the running platform, so that the plans
+     * of the next configure calls follow the actual costs of the platform.
+     * Cost model is process wide: calibrate must be called at startup, before any stream is
+     * configured.
+     */
+    static void calibrate();
+
 private:
+    /**
+     * Converters configured for a pair of source and destination sample specifications.
+     * Each chain owns its converters, so that their configuration and context survive a
+     * configure call for another pair.
+     */
+    struct ConversionChain {
+
+        ConversionChain();
+        ~ConversionChain();
+
+        SampleSpec _ssSrc; /**< Source sample specifications the chain is configured for. */
+        SampleSpec _ssDst; /**< Destination sample specifications the chain is configured for. */
+        bool _configured; /**< Chain successfully configured for _ssSrc to _ssDst. */
+        bool _dithering; /**< Chain configured with the dithering setting. */
+        ResamplingQuality _resamplingQuality; /**< Chain configured with the quality level. */
+
+        /**
+         * List of audio converter enabled
+         */
+        AudioConverterList _audioConvList;
+
+        /**
+         * List of Audio Converter objects available.
+         * Each converter works on a dedicated sample spec item.
+         */
+        AudioConverter *_audioConverter[NbSampleSpecItems];
+
+        /**
+         * Converter working on several sample spec items in a single pass.
+         * Used as a step of the chain when the plan merges the remap and the reformat.
+         */
+        AudioConverter *_fusedConverter;
+
+        /**
+         * Converter requantizing the samples to 16 bits with a dither.
+         * Used instead of the reformatter when the dithering is enabled and the format
+         * conversion reduces the bit depth.
+         */
+        AudioConverter *_ditherer;
+
+        Plan _plan; /**< Steps of the chain, valid once configured. */
+
+    private:
+        ConversionChain(const ConversionChain &);
+        ConversionChain &operator = (const ConversionChain &);
+    };
+
+    typedef std::list<ConversionChain *>::iterator ConversionChainListIterator;
+
     AudioConversion(const AudioConversion &);
     AudioConversion &operator = (const AudioConversion &);
 
     /**
-     * This function pushes the converter to the list
+     * This function pushes the converter of a step to the list
      * and alters the source sample spec according to the sample spec reached
      * after this convertion.
      *
@@ -108,75 +264,131 @@ private:
      *              -b is the number of bytes used in the audio format.
      *              -c is the rate,
      *
-     * Let s' take the assumption that our converter (SampleSpecItem input parameter) is a
-     * resampler ie works on sample spec item b
+     * Let s' take the assumption that our converter is a reformatter ie works on sample
+     * spec item b.
      * After the converter, temporary destination sample spec will be: { a, b', c }
      *
      * Update the source Sample Spec to this temporary sample spec for the
      * next convertion that might have to be added.
      * ssSrc = temp dest = { a, b', c }
      *
-     * @param[in] sampleSpecItem sample spec item on which the converter is working
+     * @param[in] step mask of the sample spec items the converter is working on.
      * @param[in:out] ssSrc source sample specifications.
      * @param[in] ssDst destination sample specifications.
      *
      * @return status OK, error code otherwise.
      */
-    android::status_t doConfigureAndAddConverter(SampleSpecItem sampleSpecItem,
+    android::status_t doConfigureAndAddConverter(uint32_t step,
                                                  SampleSpec *ssSrc,
                                                  const SampleSpec *ssDst);
 
     /**
-     * Recursive function to add converters to the chain of convertion required.
+     * Gets the sample specifications reached after a step.
      *
-     * When a converter is added, the source sample specification is modified to represents the
-     * audio data sample specification AFTER applying this converter.
-     * This sample spec will be used as the source for next convertion.
-     * In order to minimize power consumption, resampling operation should be applied on the minimum
-     * frame size. So, down-remapping or down-formatting will be done in prior of resampling.
+     * @param[in] step mask of the sample spec items the step is working on.
+     * @param[in] ssSrc source sample specifications of the step.
+     * @param[in] ssDst destination sample specifications of the conversion.
      *
-     * Let's take an example:
-     * ssSrc = { a, b, c } and ssDst = { a', b', c' } where:
-     *              -a / a' are the channel numbers,
-     *              -b / b' are the number of bytes used in the audio format.
-     *              -c / c' are the rates,
-     * and with (a' > a) and (b' < b)
-     * As all sample spec items are different, we need to use 3 converter to reach the destination
-     * audio data sample specifications.
-     *
-     * First take into account a (number of channels):
-     *      As a' is higher than a, first performs the remapping:
-     *      ssSrc = { a, b, c } dst = { a', b', c' }
-     *      The temporary output becomes the new source for next converter
-     *      ssSrc = temporary Output = { a', b, c }
-     *
-     * Then, take into account b (format size).
-     *      As b' is lower than b, do not perform the reformating now...
-     *
-     * Finally, take into account the sample rate:
-     *      as they are different, use a resampler:
-     *      ssSrc = { a', b, c } dst = { a', b', c' }
-     *      The temporary output becomes the new source for next converter
-     *      ssSrc = temporary Output = { a', b, c' }
-     *
-     * No more converter: exit from last recursive call
-     * Taking into account b again...(format size)
-     *      as b' < b, use a reformatter
-     *      ssSrc = { a', b, c' } dst = { a', b', c' }
-     *      The temporary output becomes the new source for next converter
-     *      ssSrc = temporary Output = { a', b', c' }
-     *
-     * Exit from recursive call
-     *
-     * @param[in] sampleSpecItem sample spec item on which the converter is working
-     * @param[in:out] ssSrc source sample specifications.
+     * @return source sample specifications with the items of the step taken from ssDst.
+     */
+    static SampleSpec getStepDstSampleSpec(uint32_t step,
+                                           const SampleSpec &ssSrc,
+                                           const SampleSpec &ssDst);
+
+    /**
+     * Gets the estimated cost of a step, according to the converter that would perform it.
+     *
+     * @param[in] step mask of the sample spec items the step is working on.
+     * @param[in] ssSrc source sample specifications of the step.
+     * @param[in] ssDst destination sample specifications of the step.
+     *
+     * @return CPU time to convert one second of audio in nanoseconds, negative if no converter
+     *         is meant to perform the step.
+     */
+    float getStepCost(uint32_t step, const SampleSpec &ssSrc, const SampleSpec &ssDst) const;
+
+    /**
+     * Lists the plans able to convert the source to the destination sample specifications.
+     * Each candidate order of the steps is weighed with the cost model; the steps working on
+     * items already equal are dropped, so that different orders may lead to the same plan,
+     * listed once.
+     *
+     * @param[in] ssSrc source sample specifications.
      * @param[in] ssDst destination sample specifications.
+     * @param[out] plans plans, cheapest first, at least NB_CANDIDATE_PLANS entries.
+     *
+     * @return number of plans.
+     */
+    size_t listPlans(const SampleSpec &ssSrc, const SampleSpec &ssDst, Plan *plans) const;
+
+    /**
+     * Configures the converters of a plan and adds them to the active chain.
+     *
+     * @param[in] plan steps of the chain.
+     * @param[in] ssSrc source sample specifications.
+     * @param[in] ssDst destination sample specifications.
+     *
+     * @return status OK, error code otherwise.
+     */
+    android::status_t configurePlan(const Plan &plan,
+                                    const SampleSpec &ssSrc,
+                                    const SampleSpec &ssDst);
+
+    /**
+     * Keeps converted frames not requested yet within the converted buffer.
+     * Converted buffer is grown if the frames do not fit.
+     *
+     * @param[in] src remaining converted frames.
+     * @param[in] frames number of remaining frames.
+     *
+     * @return status OK, error code otherwise.
+     */
+    android::status_t pushRemainingFrames(const void *src, size_t frames);
+
+    /**
+     * Converts audio samples through the active chain, using external scratch buffers.
+     * Chain must not be empty.
+     *
+     * @param[in] src buffer of samples to convert.
+     * @param[in:out] dst destination sample buffer, see convert.
+     * @param[in] inFrames number of frames in the source sample specification to convert.
+     * @param[out] outFrames number of frames in the destination sample specification converted.
+     * @param[in] scratch scratch buffers, large enough for inFrames (see getScratchBufferSize).
+     *
+     * @return status OK, error code otherwise.
+     */
+    android::status_t convertChain(const void *src,
+                                   void **dst,
+                                   const uint32_t inFrames,
+                                   uint32_t *outFrames,
+                                   const ScratchArena &scratch);
+
+    /**
+     * Gets the size of the scratch buffers needed to convert a number of frames, ie the size
+     * of the largest output of the chain.
+     *
+     * @param[in] inFrames number of frames in the source sample specification to convert.
+     *
+     * @return size of each scratch buffer in bytes.
+     */
+    size_t getScratchBufferSize(uint32_t inFrames) const;
+
+    /**
+     * Ensures the scratch buffers may hold the output of any converter of the chain.
+     *
+     * @param[in] inFrames number of frames in the source sample specification to convert.
+     *
+     * @return status OK, error code otherwise.
+     */
+    android::status_t allocateScratchBuffers(uint32_t inFrames);
+
+    /**
+     * Applies the reservation to the active chain: scratch buffers and internal buffers of the
+     * converters.
      *
      * @return status OK, error code otherwise.
      */
-    android::status_t configureAndAddConverter(SampleSpecItem sampleSpecItem,
-                                               SampleSpec *ssSrc,
-                                               const SampleSpec *ssDst);
+    android::status_t reserveChainBuffers();
 
     /**
      * Reset the list of active converter.
@@ -185,15 +397,37 @@ private:
     void emptyConversionChain();
 
     /**
-     * List of audio converter enabled
+     * Checks if the active conversion chain has any converter.
+     *
+     * @return true if no conversion is performed, false otherwise.
      */
-    std::list<AudioConverter *> _activeAudioConvList;
+    bool isConversionChainEmpty() const;
 
     /**
-     * List of Audio Converter objects available.
-     * Each converter works on a dedicated sample spec item.
+     * Gets the chain matching a pair of sample specifications from the cache.
+     * On a miss, a new chain is created, or the least recently used one is recycled once
+     * the cache is full; the returned chain is then left unconfigured.
+     * Chains are also matched on the dithering setting and the resampling quality.
+     *
+     * @param[in] ssSrc source sample specifications.
+     * @param[in] ssDst destination sample specifications.
+     *
+     * @return chain, most recently used entry of the cache.
      */
-    AudioConverter *_audioConverter[NbSampleSpecItems];
+    ConversionChain *getCachedChain(const SampleSpec &ssSrc, const SampleSpec &ssDst);
+
+    /**
+     * Cache of conversion chains, most recently used first.
+     */
+    std::list<ConversionChain *> _chainCache;
+
+    /**
+     * Chain in use, NULL if no conversion is performed.
+     */
+    ConversionChain *_activeChain;
+
+    uint32_t _chainCacheHits; /**< Configure calls served by the chain cache. */
+    uint32_t _chainCacheMisses; /**< Configure calls that configured a chain. */
 
     /**
      * Source audio data sample specifications
@@ -205,11 +439,24 @@ private:
      */
     SampleSpec _ssDst;
 
-    // Conversion is done into ConvOutBuffer
-    size_t _convOutBufferIndex; /**< Current position into the Converted buffer. */
-    size_t _convOutFrames; /**< Number of converted Frames. */
-    size_t _convOutBufferSizeInFrames; /**< Converted buffer size in Frames. */
-    int16_t *_convOutBuffer; /**< Converted buffer. */
+    /**
+     * Frames converted beyond the frames requested by getConvertedBuffer, output first on
+     * next call.
+     */
+    AudioRingBuffer _convOutBuffer;
+
+    /**
+     * Intermediate buffers of the chain.
+     * Converters working in place write within the buffer holding their source, others write
+     * within the other scratch buffer.
+     */
+    ScratchArena _scratch;
+
+    size_t _reservedFrames; /**< Frames per call reserved, 0 if no reservation is made. */
+
+    bool _dithering; /**< Dithering of the requantizations to 16 bits enabled. */
+
+    ResamplingQuality _resamplingQuality; /**< Quality level of the polyphase resampling. */
 
     /**
      * Buffer is acquired from the provider into ConvInBuffer.
@@ -219,6 +466,23 @@ private:
     static const uint32_t MAX_RATE; /**< Max rate supported by resampler converter. */
 
     static const uint32_t MIN_RATE; /**< Min rate supported by resampler converter. */
+
+    static const size_t MAX_CACHED_CHAINS; /**< Max number of chains kept configured. */
+
+    /**
+     * Candidate orders of the steps, each terminated by a null step if shorter than
+     * NbSampleSpecItems.
+     */
+    static const uint32_t CANDIDATE_PLANS[][NbSampleSpecItems];
+
+    static const size_t NB_CANDIDATE_PLANS; /**< Number of candidate orders. */
+
+    static const uint32_t FUSED_STEP; /**< Step of the fused converter. */
+
+    /**
+     * Batches convert through the chains of the conversions with their own scratch buffers.
+     */
+    friend class AudioConversionBatch;
 };
 
 }; // namespace android
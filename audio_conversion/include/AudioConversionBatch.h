@@ -0,0 +1,159 @@
+/*
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+#pragma once
+#pragma once
+
+#include "ScratchArena.h"
+#include <utils/Errors.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+namespace android_audio_legacy {
+
+class AudioConversion;
+
+/**
+ * Runs the conversions of several streams back to back.
+ * Meant for callers handling several streams within the same period (e.g. the playback,
+ * capture and echo reference streams of a VoIP call): jobs are converted one after the
+ * other through the same scratch buffers, still hot in cache, instead of the scratch buffers
+ * of each conversion.
+ * Jobs may optionally be spread over a small pool of worker threads when the total work of
+ * a batch is large enough to pay for the wake up of the workers. Workers inherit the
+ * scheduling policy of the thread constructing the batch.
+ * Not thread safe: reserve and run must be serialized by the caller.
+ */
+class AudioConversionBatch {
+
+public:
+    /**
+     * Conversion of a buffer of a stream.
+     */
+    struct Job {
+
+        AudioConversion *conversion; /**< Configured conversion of the stream. */
+        const void *src; /**< Source samples. */
+        void *dst; /**< Destination buffer, large enough for the converted frames. */
+        uint32_t inFrames; /**< Frames to convert, in the source sample specification. */
+        uint32_t outFrames; /**< Converted frames, set by run. */
+        android::status_t status; /**< Status of the conversion, set by run. */
+    };
+
+    /**
+     * @param[in] workers number of worker threads, 0 to run every job on the calling thread.
+     * @param[in] parallelSamples total number of source samples of a batch from which its jobs
+     *                            are spread over the workers.
+     */
+    AudioConversionBatch(uint32_t workers = 0,
+                         size_t parallelSamples = DEFAULT_PARALLEL_SAMPLES);
+    ~AudioConversionBatch();
+
+    /**
+     * Reserves the buffers for a set of jobs, so that running them never allocates.
+     * Each conversion is reserved for the frames of its job (see AudioConversion::reserve),
+     * scratch buffers of the calling thread and of the workers for the largest job. A batch
+     * with a longer job reserves again for its jobs first.
+     * Debug builds assert on any allocation of the conversions within run once a reservation
+     * is made.
+     *
+     * @param[in] jobs jobs of the largest batch to run.
+     * @param[in] count number of jobs.
+     *
+     * @return status OK, error code otherwise.
+     */
+    android::status_t reserve(const Job *jobs, size_t count);
+
+    /**
+     * Converts the jobs of a batch.
+     * A conversion must appear in a single job of the batch. All jobs are run, even if one
+     * of them fails.
+     *
+     * @param[in:out] jobs jobs to run, outFrames and status are set on return.
+     * @param[in] count number of jobs.
+     *
+     * @return OK if all jobs succeeded, status of the first failing job otherwise.
+     */
+    android::status_t run(Job *jobs, size_t count);
+
+    /**
+     * Number of source samples from which a batch is spread over the workers by default.
+     */
+    static const size_t DEFAULT_PARALLEL_SAMPLES;
+
+private:
+    /**
+     * Worker thread of the pool, with its own scratch buffers.
+     */
+    struct Worker {
+
+        AudioConversionBatch *_batch;
+        pthread_t _thread;
+        ScratchArena _scratch;
+    };
+
+    // forbid copy
+    AudioConversionBatch(const AudioConversionBatch &);
+    AudioConversionBatch &operator =(const AudioConversionBatch &);
+
+    /**
+     * Checks the jobs of a batch.
+     *
+     * @return OK if the jobs may be run, BAD_VALUE otherwise.
+     */
+    static android::status_t checkJobs(const Job *jobs, size_t count);
+
+    /**
+     * Runs a job through its conversion.
+     *
+     * @param[in:out] job job to run.
+     * @param[in:out] scratch scratch buffers of the thread running the job.
+     */
+    static void runJob(Job *job, ScratchArena *scratch);
+
+    /**
+     * Runs the jobs of the batch in progress until none is left to pick.
+     *
+     * @param[in:out] scratch scratch buffers of the thread running the jobs.
+     */
+    void runPendingJobs(ScratchArena *scratch);
+
+    /**
+     * Worker loop, waits for batches until the pool is stopped.
+     */
+    void workerLoop(Worker *worker);
+
+    static void *workerThread(void *context);
+
+    ScratchArena _scratch; /**< Scratch buffers of the calling thread. */
+
+    Worker *_workers; /**< Worker pool, NULL if jobs are run on the calling thread only. */
+    uint32_t _workerCount; /**< Number of started workers. */
+    size_t _parallelSamples; /**< Samples of a batch from which workers are used. */
+    bool _reserved; /**< Reservation made, run must not allocate. */
+
+    pthread_mutex_t _lock; /**< Protects the batch in progress and the state of the pool. */
+    pthread_cond_t _startCond; /**< Signaled when a batch starts or the pool stops. */
+    pthread_cond_t _doneCond; /**< Signaled when the last job of a batch is done. */
+    Job *_jobs; /**< Batch in progress, NULL if none. */
+    size_t _jobCount; /**< Number of jobs of the batch in progress. */
+    size_t _nextJob; /**< Next job to pick. */
+    size_t _pendingJobs; /**< Jobs of the batch not done yet. */
+    uint32_t _generation; /**< Incremented on each batch given to the workers. */
+    bool _stopping; /**< Workers must exit. */
+};
+
+}; // namespace android
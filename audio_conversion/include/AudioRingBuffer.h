@@ -0,0 +1,132 @@
+/*
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+#pragma once
+
+#include <utils/Errors.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+namespace android_audio_legacy {
+
+/**
+ * Circular FIFO of audio frames.
+ * Capacity is a power of two so that positions wrap with a mask, and frames are never moved:
+ * readers and writers work on contiguous views of the FIFO, at most two views cover the whole
+ * readable or writable area.
+ * Not thread safe: producer and consumer must be serialized by the caller.
+ */
+class AudioRingBuffer {
+
+public:
+    AudioRingBuffer();
+    ~AudioRingBuffer();
+
+    /**
+     * Allocates the FIFO, emptying it.
+     * Memory is only reallocated if the capacity or the frame size changes.
+     *
+     * @param[in] frames minimum capacity in frames, rounded up to a power of two.
+     * @param[in] frameSize size of a frame in bytes.
+     *
+     * @return OK if allocation succeeded, NO_MEMORY otherwise.
+     */
+    android::status_t allocate(size_t frames, size_t frameSize);
+
+    /**
+     * Empties the FIFO.
+     */
+    void reset();
+
+    /**
+     * @return number of frames available for reading.
+     */
+    size_t getAvailableFrames() const { return _writeIndex - _readIndex; }
+
+    /**
+     * @return number of frames that may be written.
+     */
+    size_t getFreeFrames() const { return _capacity - getAvailableFrames(); }
+
+    /**
+     * @return capacity of the FIFO in frames.
+     */
+    size_t getCapacity() const { return _capacity; }
+
+    /**
+     * Gets the contiguous readable frames from the read position.
+     *
+     * @param[out] view first readable frame.
+     *
+     * @return number of contiguous readable frames.
+     */
+    size_t getReadView(const void **view) const;
+
+    /**
+     * Releases frames read through the read view.
+     *
+     * @param[in] frames number of frames consumed, must not exceed the available frames.
+     */
+    void consume(size_t frames);
+
+    /**
+     * Gets the contiguous writable frames from the write position.
+     *
+     * @param[out] view first writable frame.
+     *
+     * @return number of contiguous writable frames.
+     */
+    size_t getWriteView(void **view) const;
+
+    /**
+     * Commits frames written through the write view.
+     *
+     * @param[in] frames number of frames produced, must not exceed the free frames.
+     */
+    void produce(size_t frames);
+
+    /**
+     * Copies frames out of the FIFO.
+     *
+     * @param[out] dst destination buffer.
+     * @param[in] frames maximum number of frames to read.
+     *
+     * @return number of frames read.
+     */
+    size_t read(void *dst, size_t frames);
+
+    /**
+     * Copies frames into the FIFO.
+     *
+     * @param[in] src source buffer.
+     * @param[in] frames maximum number of frames to write.
+     *
+     * @return number of frames written.
+     */
+    size_t write(const void *src, size_t frames);
+
+private:
+    // forbid copy
+    AudioRingBuffer(const AudioRingBuffer &);
+    AudioRingBuffer &operator =(const AudioRingBuffer &);
+
+    char *_buffer; /**< Frames storage. */
+    size_t _capacity; /**< Capacity in frames, power of two. */
+    size_t _frameSize; /**< Size of a frame in bytes. */
+    size_t _readIndex; /**< Read position, unwrapped. */
+    size_t _writeIndex; /**< Write position, unwrapped. */
+};
+
+}; // namespace android
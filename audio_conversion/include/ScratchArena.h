@@ -0,0 +1,71 @@
+/*
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+#pragma once
+#pragma once
+
+#include <utils/Errors.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+namespace android_audio_legacy {
+
+/**
+ * Pair of scratch buffers carved from a single allocation.
+ * Conversion chains ping-pong between the two buffers, so that whatever the length of the
+ * chain, only two buffers are used. Both buffers start on the same alignment.
+ * Content is not kept when the arena grows.
+ */
+class ScratchArena {
+
+public:
+    ScratchArena();
+    ~ScratchArena();
+
+    /**
+     * Ensures each buffer of the arena holds a number of bytes.
+     * Memory is only reallocated if the arena grows.
+     *
+     * @param[in] bytes minimum size of each buffer in bytes.
+     *
+     * @return OK if allocation succeeded, NO_MEMORY otherwise.
+     */
+    android::status_t allocate(size_t bytes);
+
+    /**
+     * @param[in] index index of the buffer, 0 or 1.
+     *
+     * @return scratch buffer, NULL if the arena is not allocated.
+     */
+    char *getBuffer(int index) const { return _buffer[index]; }
+
+    /**
+     * @return size of each buffer in bytes.
+     */
+    size_t getBufferSize() const { return _bufferSize; }
+
+private:
+    // forbid copy
+    ScratchArena(const ScratchArena &);
+    ScratchArena &operator =(const ScratchArena &);
+
+    char *_arena; /**< Single allocation holding the buffers. */
+    char *_buffer[2]; /**< Buffers within the arena. */
+    size_t _bufferSize; /**< Size of each buffer in bytes. */
+
+    static const size_t ALIGNMENT; /**< Alignment of the buffers in bytes. */
+};
+
+}; // namespace android
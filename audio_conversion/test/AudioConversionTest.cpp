@@ -0,0 +1,543 @@
+/*
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+/**
+ * Host tests of the frames accounting of the audio conversion: the ring buffer keeping the
+ * converted frames, getConvertedBuffer driven by random request and provider sizes, and the
+ * calls longer than the reservation of the buffers.
+ * Resampling goes through the stand-in of the resampler library of the benchmark.
+ */
+
+#include "AudioConversion.h"
+#include "AudioConversionBatch.h"
+#include "AudioRingBuffer.h"
+#include <SampleSpec.h>
+#include <media/AudioBufferProvider.h>
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+using namespace android;
+using namespace android_audio_legacy;
+using std::vector;
+
+namespace
+{
+
+/**
+ * Random generator with a fixed seed, so that any failure is reproduced.
+ */
+class Random
+{
+public:
+    explicit Random(uint32_t seed) : _state(seed) {}
+
+    uint32_t next()
+    {
+        _state ^= _state << 13;
+        _state ^= _state >> 17;
+        _state ^= _state << 5;
+        return _state;
+    }
+
+    /**
+     * @return value within [min, max].
+     */
+    uint32_t next(uint32_t min, uint32_t max) { return min + next() % (max - min + 1); }
+
+private:
+    uint32_t _state;
+};
+
+/**
+ * Provider of a fixed stream of 16 bits frames, that gives at most a random number of frames
+ * per buffer, as the tracks of the mixer may do.
+ */
+class StreamProvider : public AudioBufferProvider
+{
+public:
+    StreamProvider(const SampleSpec &ss, const vector<int16_t> &samples,
+                   uint32_t maxBufferFrames, uint32_t seed) :
+        _ss(ss),
+        _samples(samples),
+        _maxBufferFrames(maxBufferFrames),
+        _random(seed),
+        _providedFrames(0)
+    {
+    }
+
+    virtual status_t getNextBuffer(Buffer *buffer, int64_t /*pts*/)
+    {
+        size_t frames = _samples.size() / _ss.getChannelCount() - _providedFrames;
+        size_t maxFrames = _random.next(1, _maxBufferFrames);
+        if (buffer->frameCount > maxFrames) {
+
+            buffer->frameCount = maxFrames;
+        }
+        if (buffer->frameCount > frames) {
+
+            buffer->frameCount = frames;
+        }
+        if (buffer->frameCount == 0) {
+
+            buffer->raw = NULL;
+            return NOT_ENOUGH_DATA;
+        }
+        buffer->i16 = const_cast<int16_t *>(&_samples[_providedFrames * _ss.getChannelCount()]);
+        _providedFrames += buffer->frameCount;
+        return NO_ERROR;
+    }
+
+    virtual void releaseBuffer(Buffer *buffer)
+    {
+        buffer->raw = NULL;
+        buffer->frameCount = 0;
+    }
+
+    size_t getProvidedFrames() const { return _providedFrames; }
+
+private:
+    SampleSpec _ss;
+    const vector<int16_t> &_samples;
+    uint32_t _maxBufferFrames;
+    Random _random;
+    size_t _providedFrames;
+};
+
+/**
+ * Conversion case: rates and channels of the 16 bits source and destination streams, and the
+ * tolerance of the resampling.
+ * Only the resampling library (its stand-in here) interpolates on a position accumulated in
+ * floating point over the calls: its samples may differ by one LSB once the calls are split
+ * differently, and its number of frames by one from the exact duration.
+ */
+struct ConversionCase {
+
+    uint32_t srcRate;
+    uint32_t srcChannels;
+    uint32_t dstRate;
+    uint32_t dstChannels;
+    uint32_t tolerance;
+};
+
+const ConversionCase conversionCases[] = {
+
+    { 16000, 1, 48000, 1, 0 },      // Integer ratio, upsampling
+    { 48000, 2, 16000, 2, 0 },      // Integer ratio, decimation
+    { 44100, 2, 48000, 2, 1 },      // Resampling library
+    { 48000, 1, 44100, 2, 1 },      // Resampling library and remap
+    { 44100, 2, 16000, 2, 0 },      // Polyphase, 441 / 160
+    { 11025, 1, 8000, 1, 0 },       // Polyphase, 441 / 320
+    { 8000, 2, 44100, 1, 0 },       // Polyphase, 160 / 882, and remap
+    { 22050, 1, 16000, 2, 0 }       // Polyphase, 441 / 320, and remap
+};
+
+const size_t nbConversionCases = sizeof(conversionCases) / sizeof(conversionCases[0]);
+
+/**
+ * Sizes of the getConvertedBuffer calls and of the buffers of the provider.
+ */
+struct CallPattern {
+
+    const char *name;
+    uint32_t minRequestFrames;
+    uint32_t maxRequestFrames;
+    uint32_t maxBufferFrames;
+};
+
+const CallPattern callPatterns[] = {
+
+    { "short", 1, 17, 13 },
+    { "long", 480, 4099, 8191 },
+    { "mixed", 1, 2049, 997 }
+};
+
+const size_t nbCallPatterns = sizeof(callPatterns) / sizeof(callPatterns[0]);
+
+/** Length of the source stream of each case. */
+const size_t streamSeconds = 2;
+
+/**
+ * Converts the source stream in a single convert call.
+ *
+ * @param[in] ssSrc source sample specifications.
+ * @param[in] ssDst destination sample specifications.
+ * @param[in] samples source samples.
+ * @param[in] frames number of source frames to convert.
+ * @param[out] converted converted samples.
+ */
+void convertAtOnce(const SampleSpec &ssSrc, const SampleSpec &ssDst,
+                   const vector<int16_t> &samples, size_t frames, vector<int16_t> &converted)
+{
+    AudioConversion conversion;
+    ASSERT_EQ(NO_ERROR, conversion.configure(ssSrc, ssDst));
+    void *dst = NULL;
+    uint32_t outFrames = 0;
+    ASSERT_EQ(NO_ERROR, conversion.convert(&samples[0], &dst, frames, &outFrames));
+    const int16_t *dstSamples = static_cast<const int16_t *>(dst);
+    converted.assign(dstSamples, dstSamples + outFrames * ssDst.getChannelCount());
+}
+
+/**
+ * Number of destination frames a resampler may output for the source frames, ie the number
+ * of frames at the destination rate within the duration of the source frames, rounded down or
+ * up, within the tolerance of the case.
+ */
+void getExpectedFrames(size_t srcFrames, const ConversionCase &conversionCase,
+                       size_t *minFrames, size_t *maxFrames)
+{
+    uint64_t scaled = static_cast<uint64_t>(srcFrames) * conversionCase.dstRate;
+    *minFrames = scaled / conversionCase.srcRate;
+    *maxFrames = (scaled + conversionCase.srcRate - 1) / conversionCase.srcRate;
+    *minFrames = *minFrames > conversionCase.tolerance ? *minFrames - conversionCase.tolerance : 0;
+    *maxFrames += conversionCase.tolerance;
+}
+
+}
+
+TEST(AudioRingBuffer, keepsFramesInOrder)
+{
+    static const size_t frameSize = 6;
+    AudioRingBuffer ring;
+    ASSERT_EQ(NO_ERROR, ring.allocate(100, frameSize));
+    ASSERT_EQ(128u, ring.getCapacity());
+    EXPECT_EQ(0u, ring.getAvailableFrames());
+    EXPECT_EQ(128u, ring.getFreeFrames());
+
+    Random random(0x1234567);
+    uint32_t written = 0;
+    uint32_t read = 0;
+    vector<uint8_t> chunk(ring.getCapacity() * 2 * frameSize);
+
+    // Random chunks, larger than the capacity as well, wrap the positions many times
+    for (uint32_t i = 0; i < 20000; i++) {
+
+        uint32_t frames = random.next(0, ring.getCapacity() + 16);
+        for (uint32_t frame = 0; frame < frames; frame++) {
+
+            uint32_t value = written + frame;
+            memcpy(&chunk[frame * frameSize], &value, sizeof(value));
+            memset(&chunk[frame * frameSize + sizeof(value)], value & 0xFF,
+                   frameSize - sizeof(value));
+        }
+        size_t free = ring.getFreeFrames();
+        size_t framesWritten = ring.write(&chunk[0], frames);
+        ASSERT_EQ(frames < free ? frames : free, framesWritten);
+        written += framesWritten;
+        ASSERT_EQ(written - read, ring.getAvailableFrames());
+
+        frames = random.next(0, ring.getCapacity() + 16);
+        size_t available = ring.getAvailableFrames();
+        size_t framesRead = ring.read(&chunk[0], frames);
+        ASSERT_EQ(frames < available ? frames : available, framesRead);
+        for (size_t frame = 0; frame < framesRead; frame++) {
+
+            uint32_t value;
+            memcpy(&value, &chunk[frame * frameSize], sizeof(value));
+            ASSERT_EQ(read + frame, value);
+            ASSERT_EQ(value & 0xFF, chunk[frame * frameSize + frameSize - 1]);
+        }
+        read += framesRead;
+        ASSERT_EQ(written - read, ring.getAvailableFrames());
+        ASSERT_EQ(ring.getCapacity() - (written - read), ring.getFreeFrames());
+    }
+}
+
+TEST(AudioRingBuffer, viewsCoverTheFrames)
+{
+    AudioRingBuffer ring;
+    ASSERT_EQ(NO_ERROR, ring.allocate(16, sizeof(uint32_t)));
+
+    // Moves the positions next to the end of the storage
+    uint32_t values[16];
+    for (uint32_t i = 0; i < 16; i++) {
+
+        values[i] = i;
+    }
+    ASSERT_EQ(11u, ring.write(values, 11));
+    ASSERT_EQ(11u, ring.read(values, 11));
+    ASSERT_EQ(16u, ring.write(values, 16));
+
+    // Full ring is read in two views: until the end of the storage, then from its beginning
+    const void *view;
+    ASSERT_EQ(5u, ring.getReadView(&view));
+    EXPECT_EQ(0u, static_cast<const uint32_t *>(view)[0]);
+    ring.consume(5);
+    ASSERT_EQ(11u, ring.getReadView(&view));
+    EXPECT_EQ(5u, static_cast<const uint32_t *>(view)[0]);
+    ring.consume(11);
+    EXPECT_EQ(0u, ring.getAvailableFrames());
+
+    void *writeView;
+    ASSERT_EQ(5u, ring.getWriteView(&writeView));
+    ring.produce(3);
+    ASSERT_EQ(2u, ring.getWriteView(&writeView));
+    ring.produce(2);
+    ASSERT_EQ(11u, ring.getWriteView(&writeView));
+    ring.reset();
+    EXPECT_EQ(0u, ring.getAvailableFrames());
+    EXPECT_EQ(16u, ring.getFreeFrames());
+}
+
+TEST(AudioConversion, getConvertedBufferNeitherLosesNorDuplicatesFrames)
+{
+    for (size_t i = 0; i < nbConversionCases; i++) {
+
+        const ConversionCase &conversionCase = conversionCases[i];
+        SampleSpec ssSrc(conversionCase.srcChannels, AUDIO_FORMAT_PCM_16_BIT,
+                         conversionCase.srcRate);
+        SampleSpec ssDst(conversionCase.dstChannels, AUDIO_FORMAT_PCM_16_BIT,
+                         conversionCase.dstRate);
+        size_t srcFrames = streamSeconds * conversionCase.srcRate;
+
+        // Half scale noise, so that no filter clips
+        Random signal(0xACE1 + i);
+        vector<int16_t> samples(srcFrames * conversionCase.srcChannels);
+        for (size_t sample = 0; sample < samples.size(); sample++) {
+
+            samples[sample] = static_cast<int16_t>(signal.next()) / 2;
+        }
+
+        for (size_t pattern = 0; pattern < nbCallPatterns; pattern++) {
+
+            const CallPattern &callPattern = callPatterns[pattern];
+            SCOPED_TRACE(testing::Message() << conversionCase.srcRate << " Hz "
+                         << conversionCase.srcChannels << " ch to " << conversionCase.dstRate
+                         << " Hz " << conversionCase.dstChannels << " ch, "
+                         << callPattern.name << " calls");
+
+            AudioConversion conversion;
+            ASSERT_EQ(NO_ERROR, conversion.configure(ssSrc, ssDst));
+            StreamProvider provider(ssSrc, samples, callPattern.maxBufferFrames, 0x5EED + i);
+            Random requests(0xBEEF + pattern);
+
+            // Converts until the stream may not provide the frames of a request any more
+            vector<int16_t> output;
+            vector<int16_t> request(callPattern.maxRequestFrames * conversionCase.dstChannels);
+            size_t minLeftFrames = static_cast<size_t>(callPattern.maxRequestFrames + 2) *
+                    conversionCase.srcRate / conversionCase.dstRate + 2;
+            while (srcFrames - provider.getProvidedFrames() > minLeftFrames) {
+
+                uint32_t frames = requests.next(callPattern.minRequestFrames,
+                                                callPattern.maxRequestFrames);
+                ASSERT_EQ(NO_ERROR, conversion.getConvertedBuffer(&request[0], frames,
+                                                                  &provider));
+                output.insert(output.end(), request.begin(),
+                              request.begin() + frames * conversionCase.dstChannels);
+
+                // Frames kept for the next call never exceed the output of one source frame
+                size_t keptMin;
+                size_t keptMax;
+                getExpectedFrames(provider.getProvidedFrames(), conversionCase, &keptMin,
+                                  &keptMax);
+                size_t outputFrames = output.size() / conversionCase.dstChannels;
+                ASSERT_LE(outputFrames, keptMax);
+                ASSERT_LE(keptMin, outputFrames + (conversionCase.dstRate +
+                                                   conversionCase.srcRate - 1) /
+                          conversionCase.srcRate);
+            }
+
+            // Frames provided are converted at once into the reference: output is its
+            // beginning, without any gap or repetition
+            size_t providedFrames = provider.getProvidedFrames();
+            vector<int16_t> reference;
+            convertAtOnce(ssSrc, ssDst, samples, providedFrames, reference);
+            size_t minFrames;
+            size_t maxFrames;
+            getExpectedFrames(providedFrames, conversionCase, &minFrames, &maxFrames);
+            size_t referenceFrames = reference.size() / conversionCase.dstChannels;
+            ASSERT_LE(minFrames, referenceFrames);
+            ASSERT_GE(maxFrames, referenceFrames);
+            ASSERT_LE(output.size(), reference.size());
+
+            for (size_t sample = 0; sample < output.size(); sample++) {
+
+                ASSERT_NEAR(reference[sample], output[sample],
+                            static_cast<int>(conversionCase.tolerance))
+                    << "frame " << sample / conversionCase.dstChannels;
+            }
+        }
+    }
+}
+
+TEST(AudioConversion, convertOutputsTheFramesOfTheRatio)
+{
+    for (size_t i = 0; i < nbConversionCases; i++) {
+
+        const ConversionCase &conversionCase = conversionCases[i];
+        SampleSpec ssSrc(conversionCase.srcChannels, AUDIO_FORMAT_PCM_16_BIT,
+                         conversionCase.srcRate);
+        SampleSpec ssDst(conversionCase.dstChannels, AUDIO_FORMAT_PCM_16_BIT,
+                         conversionCase.dstRate);
+        SCOPED_TRACE(testing::Message() << conversionCase.srcRate << " Hz to "
+                     << conversionCase.dstRate << " Hz");
+
+        AudioConversion conversion;
+        ASSERT_EQ(NO_ERROR, conversion.configure(ssSrc, ssDst));
+        vector<int16_t> samples(4096 * conversionCase.srcChannels, 0);
+        Random random(0xF00D + i);
+        size_t srcFrames = 0;
+        size_t dstFrames = 0;
+
+        // Whatever the split of the calls, the total stays the source duration at the
+        // destination rate, rounded either way
+        for (uint32_t call = 0; call < 2000; call++) {
+
+            uint32_t frames = (call & 1) ? random.next(1, 7) : random.next(1, 4096);
+            void *dst = NULL;
+            uint32_t outFrames = 0;
+            ASSERT_EQ(NO_ERROR, conversion.convert(&samples[0], &dst, frames, &outFrames));
+            srcFrames += frames;
+            dstFrames += outFrames;
+
+            size_t minFrames;
+            size_t maxFrames;
+            getExpectedFrames(srcFrames, conversionCase, &minFrames, &maxFrames);
+            ASSERT_LE(minFrames, dstFrames) << "after " << srcFrames << " frames";
+            ASSERT_GE(maxFrames, dstFrames) << "after " << srcFrames << " frames";
+        }
+    }
+}
+
+TEST(AudioConversion, callsBeyondTheReservationReserveAgain)
+{
+    static const uint32_t reservedFrames = 256;
+    static const uint32_t frameCounts[] = { 100, 4096, 7, 1000, 4096 };
+    static const size_t nbFrameCounts = sizeof(frameCounts) / sizeof(frameCounts[0]);
+
+    for (size_t i = 0; i < nbConversionCases; i++) {
+
+        const ConversionCase &conversionCase = conversionCases[i];
+        SampleSpec ssSrc(conversionCase.srcChannels, AUDIO_FORMAT_PCM_16_BIT,
+                         conversionCase.srcRate);
+        SampleSpec ssDst(conversionCase.dstChannels, AUDIO_FORMAT_PCM_16_BIT,
+                         conversionCase.dstRate);
+        SCOPED_TRACE(testing::Message() << conversionCase.srcRate << " Hz to "
+                     << conversionCase.dstRate << " Hz");
+
+        Random signal(0xD1CE + i);
+        vector<int16_t> samples(4096 * conversionCase.srcChannels);
+        for (size_t sample = 0; sample < samples.size(); sample++) {
+
+            samples[sample] = static_cast<int16_t>(signal.next()) / 2;
+        }
+
+        // Debug builds would abort on an allocation within the longer calls
+        AudioConversion reserved;
+        AudioConversion unreserved;
+        ASSERT_EQ(NO_ERROR, reserved.configure(ssSrc, ssDst));
+        ASSERT_EQ(NO_ERROR, reserved.reserve(reservedFrames));
+        ASSERT_EQ(NO_ERROR, unreserved.configure(ssSrc, ssDst));
+        for (size_t call = 0; call < nbFrameCounts; call++) {
+
+            void *reservedDst = NULL;
+            void *unreservedDst = NULL;
+            uint32_t reservedOutFrames = 0;
+            uint32_t unreservedOutFrames = 0;
+            ASSERT_EQ(NO_ERROR, reserved.convert(&samples[0], &reservedDst, frameCounts[call],
+                                                 &reservedOutFrames));
+            ASSERT_EQ(NO_ERROR, unreserved.convert(&samples[0], &unreservedDst,
+                                                   frameCounts[call], &unreservedOutFrames));
+            ASSERT_EQ(unreservedOutFrames, reservedOutFrames) << "call " << call;
+            EXPECT_EQ(0, memcmp(unreservedDst, reservedDst,
+                                ssDst.convertFramesToBytes(reservedOutFrames)))
+                << "call " << call;
+        }
+
+        // Same for a batch reserved for shorter jobs
+        AudioConversion batched;
+        ASSERT_EQ(NO_ERROR, batched.configure(ssSrc, ssDst));
+        vector<int16_t> converted((4096 * conversionCase.dstRate / conversionCase.srcRate + 1) *
+                                  conversionCase.dstChannels);
+        AudioConversionBatch batch;
+        AudioConversionBatch::Job job = { &batched, &samples[0], &converted[0], reservedFrames };
+        ASSERT_EQ(NO_ERROR, batch.reserve(&job, 1));
+        job.inFrames = 4096;
+        EXPECT_EQ(NO_ERROR, batch.run(&job, 1));
+        EXPECT_EQ(NO_ERROR, job.status);
+        EXPECT_NE(0u, job.outFrames);
+    }
+}
+
+TEST(AudioConversion, cachedChainRestartsFromSilence)
+{
+    static const audio_format_t srcFormats[] = {
+
+        AUDIO_FORMAT_PCM_16_BIT,
+        AUDIO_FORMAT_PCM_8_24_BIT       // Dithered to 16 bits
+    };
+    static const uint32_t frames = 1024;
+
+    for (size_t format = 0; format < sizeof(srcFormats) / sizeof(srcFormats[0]); format++) {
+
+        for (size_t i = 0; i < nbConversionCases; i++) {
+
+            const ConversionCase &conversionCase = conversionCases[i];
+            SampleSpec ssSrc(conversionCase.srcChannels, srcFormats[format],
+                             conversionCase.srcRate);
+            SampleSpec ssDst(conversionCase.dstChannels, AUDIO_FORMAT_PCM_16_BIT,
+                             conversionCase.dstRate);
+            SampleSpec ssOther(conversionCase.dstChannels, AUDIO_FORMAT_PCM_16_BIT,
+                               conversionCase.dstRate == 48000 ? 16000 : 48000);
+            SCOPED_TRACE(testing::Message() << "format " << srcFormats[format] << ", "
+                         << conversionCase.srcRate << " Hz to " << conversionCase.dstRate
+                         << " Hz");
+
+            // Noise first, then the signal the reused chain must convert as a new one
+            Random signal(0xCAFE + i);
+            vector<int32_t> noise(frames * conversionCase.srcChannels);
+            vector<int32_t> samples(frames * conversionCase.srcChannels);
+            for (size_t sample = 0; sample < samples.size(); sample++) {
+
+                noise[sample] = static_cast<int32_t>(signal.next()) >> 10;
+                samples[sample] = static_cast<int32_t>(signal.next()) >> 10;
+            }
+            if (srcFormats[format] == AUDIO_FORMAT_PCM_16_BIT) {
+
+                // 16 bits samples are packed at the beginning of the vectors
+                for (size_t sample = 0; sample < samples.size(); sample++) {
+
+                    reinterpret_cast<int16_t *>(&noise[0])[sample] = noise[sample] >> 8;
+                    reinterpret_cast<int16_t *>(&samples[0])[sample] = samples[sample] >> 8;
+                }
+            }
+
+            AudioConversion reused;
+            void *dst = NULL;
+            uint32_t outFrames = 0;
+            ASSERT_EQ(NO_ERROR, reused.configure(ssSrc, ssDst));
+            ASSERT_EQ(NO_ERROR, reused.convert(&noise[0], &dst, frames, &outFrames));
+            ASSERT_EQ(NO_ERROR, reused.configure(ssSrc, ssOther));
+            uint32_t cacheHits = reused.getChainCacheHits();
+            ASSERT_EQ(NO_ERROR, reused.configure(ssSrc, ssDst));
+            EXPECT_EQ(cacheHits + 1, reused.getChainCacheHits());
+            void *reusedDst = NULL;
+            uint32_t reusedOutFrames = 0;
+            ASSERT_EQ(NO_ERROR, reused.convert(&samples[0], &reusedDst, frames,
+                                               &reusedOutFrames));
+
+            AudioConversion fresh;
+            void *freshDst = NULL;
+            uint32_t freshOutFrames = 0;
+            ASSERT_EQ(NO_ERROR, fresh.configure(ssSrc, ssDst));
+            ASSERT_EQ(NO_ERROR, fresh.convert(&samples[0], &freshDst, frames, &freshOutFrames));
+
+            ASSERT_EQ(freshOutFrames, reusedOutFrames);
+            EXPECT_EQ(0, memcmp(freshDst, reusedDst, ssDst.convertFramesToBytes(freshOutFrames)));
+        }
+    }
+}
@@ -0,0 +1,202 @@
+/*
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+/**
+ * Host tests of the channels policies of the remapper, up to stereo: the float and packed
+ * 24 bits formats, mixed with a matrix, must give the channels of the S16 remap kernels.
+ */
+
+#include "AudioConversion.h"
+#include <SampleSpec.h>
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace android;
+using namespace android_audio_legacy;
+using std::vector;
+
+namespace
+{
+
+const uint32_t rate = 48000;
+
+const uint32_t frames = 1024;
+
+/** Every pair of channels policies of a stereo stream. */
+const SampleSpec::ChannelsPolicy stereoPolicies[][2] = {
+
+    { SampleSpec::Copy, SampleSpec::Copy },
+    { SampleSpec::Copy, SampleSpec::Average },
+    { SampleSpec::Copy, SampleSpec::Ignore },
+    { SampleSpec::Average, SampleSpec::Copy },
+    { SampleSpec::Average, SampleSpec::Average },
+    { SampleSpec::Average, SampleSpec::Ignore },
+    { SampleSpec::Ignore, SampleSpec::Copy },
+    { SampleSpec::Ignore, SampleSpec::Average },
+    { SampleSpec::Ignore, SampleSpec::Ignore }
+};
+
+const size_t nbStereoPolicies = sizeof(stereoPolicies) / sizeof(stereoPolicies[0]);
+
+/**
+ * Random generator with a fixed seed, so that any failure is reproduced.
+ */
+class Random
+{
+public:
+    explicit Random(uint32_t seed) : _state(seed) {}
+
+    uint32_t next()
+    {
+        _state ^= _state << 13;
+        _state ^= _state >> 17;
+        _state ^= _state << 5;
+        return _state;
+    }
+
+private:
+    uint32_t _state;
+};
+
+/**
+ * Lists the channels of the remapper up to stereo: mono, and stereo with each pair of
+ * channels policies.
+ *
+ * @param[in] format format of the samples.
+ * @param[out] sampleSpecs sample specifications.
+ */
+void listSampleSpecs(audio_format_t format, vector<SampleSpec> &sampleSpecs)
+{
+    sampleSpecs.clear();
+    sampleSpecs.push_back(SampleSpec(1, format, rate));
+    for (size_t policies = 0; policies < nbStereoPolicies; policies++) {
+
+        sampleSpecs.push_back(SampleSpec(2, format, rate, stereoPolicies[policies]));
+    }
+}
+
+/**
+ * Converts the channels of frames.
+ *
+ * @return true if the conversion is supported, false otherwise.
+ */
+bool remap(const SampleSpec &ssSrc, const SampleSpec &ssDst, const vector<uint8_t> &src,
+           vector<uint8_t> &dst)
+{
+    AudioConversion conversion;
+    if (conversion.configure(ssSrc, ssDst) != NO_ERROR) {
+
+        return false;
+    }
+    dst.resize(ssDst.convertFramesToBytes(frames));
+    void *dstBuffer = &dst[0];
+    uint32_t outFrames = 0;
+    return conversion.convert(&src[0], &dstBuffer, frames, &outFrames) == NO_ERROR &&
+            outFrames == frames;
+}
+
+/**
+ * Converts S16 samples in the samples of a format, in S16 units.
+ */
+void toFormat(const int16_t *samples, size_t count, audio_format_t format,
+              vector<uint8_t> &converted)
+{
+    converted.resize(count * SampleSpec::getBytesPerSample(format));
+    for (size_t i = 0; i < count; i++) {
+
+        if (format == static_cast<audio_format_t>(SampleSpec::PCM_FLOAT_FORMAT)) {
+
+            reinterpret_cast<float *>(&converted[0])[i] = samples[i] / 32768.0f;
+        } else {
+
+            uint32_t sample = static_cast<uint32_t>(samples[i]) << 8;
+            converted[3 * i] = sample;
+            converted[3 * i + 1] = sample >> 8;
+            converted[3 * i + 2] = sample >> 16;
+        }
+    }
+}
+
+/**
+ * Reads a sample of a format, in S16 units.
+ */
+double readSample(const vector<uint8_t> &samples, size_t index, audio_format_t format)
+{
+    if (format == static_cast<audio_format_t>(SampleSpec::PCM_FLOAT_FORMAT)) {
+
+        return reinterpret_cast<const float *>(&samples[0])[index] * 32768.0;
+    }
+    uint32_t sample = (static_cast<uint32_t>(samples[3 * index]) << 8) |
+            (static_cast<uint32_t>(samples[3 * index + 1]) << 16) |
+            (static_cast<uint32_t>(samples[3 * index + 2]) << 24);
+    return (static_cast<int32_t>(sample) >> 8) / 256.0;
+}
+
+}
+
+TEST(AudioRemapper, mixedFormatsFollowTheChannelsPoliciesOfTheRemapKernels)
+{
+    static const audio_format_t mixedFormats[] = {
+
+        static_cast<audio_format_t>(SampleSpec::PCM_FLOAT_FORMAT),
+        static_cast<audio_format_t>(SampleSpec::PCM_24_BIT_PACKED_FORMAT)
+    };
+    vector<SampleSpec> s16SampleSpecs;
+    listSampleSpecs(AUDIO_FORMAT_PCM_16_BIT, s16SampleSpecs);
+
+    Random random(0x2545F491);
+    vector<int16_t> samples(frames * 2);
+    for (size_t i = 0; i < samples.size(); i++) {
+
+        samples[i] = random.next();
+    }
+
+    for (size_t format = 0; format < sizeof(mixedFormats) / sizeof(mixedFormats[0]); format++) {
+
+        vector<SampleSpec> sampleSpecs;
+        listSampleSpecs(mixedFormats[format], sampleSpecs);
+
+        for (size_t src = 0; src < sampleSpecs.size(); src++) {
+
+            const SampleSpec &ssSrc = sampleSpecs[src];
+            vector<uint8_t> s16Src(reinterpret_cast<const uint8_t *>(&samples[0]),
+                                   reinterpret_cast<const uint8_t *>(&samples[0]) +
+                                   s16SampleSpecs[src].convertFramesToBytes(frames));
+            vector<uint8_t> mixedSrc;
+            toFormat(&samples[0], frames * ssSrc.getChannelCount(), mixedFormats[format],
+                     mixedSrc);
+
+            for (size_t dst = 0; dst < sampleSpecs.size(); dst++) {
+
+                SCOPED_TRACE(testing::Message() << "format " << mixedFormats[format]
+                             << ", from " << src << " to " << dst);
+                const SampleSpec &ssDst = sampleSpecs[dst];
+                vector<uint8_t> expected;
+                vector<uint8_t> mixed;
+                ASSERT_TRUE(remap(s16SampleSpecs[src], s16SampleSpecs[dst], s16Src, expected));
+                ASSERT_TRUE(remap(ssSrc, ssDst, mixedSrc, mixed));
+
+                // Remap kernels floor the averages, mixes round them
+                const int16_t *expectedSamples = reinterpret_cast<const int16_t *>(&expected[0]);
+                for (size_t i = 0; i < frames * ssDst.getChannelCount(); i++) {
+
+                    ASSERT_NEAR(expectedSamples[i], readSample(mixed, i, mixedFormats[format]),
+                                0.5) << "sample " << i;
+                }
+            }
+        }
+    }
+}
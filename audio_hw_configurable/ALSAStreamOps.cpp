@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <dlfcn.h>
+#include <algorithm>
 #include <limits>
 #include <fstream>
 
@@ -81,6 +82,8 @@ ALSAStreamOps::ALSAStreamOps(AudioHardwareALSA *parent, const char* pcLockTag) :
     mCurrentDevices(0),
     mNewDevices(0),
     mLatencyUs(0),
+    mConversionLatencyUs(0),
+    mSilenceDeadline(0),
     mPowerLock(false),
     mPowerLockTag(pcLockTag),
     mAudioConversion(new AudioConversion)
@@ -119,7 +122,10 @@ status_t ALSAStreamOps::set(int      *format,
             // as far as the channel count is supported
             mSampleSpec.setChannelMask(*channels);
 
-            if (popcount(*channels) > 2) {
+            // Output streams wider than stereo are mixed by the remapper from their channel
+            // mask, input masks do not give speaker positions to mix from
+            uint32_t maxChannels = isOut() ? SampleSpec::MAX_CHANNELS : 2;
+            if (static_cast<uint32_t>(popcount(*channels)) > maxChannels) {
 
                 ALOGD("%s: channels=(0x%x, %d) not supported", __FUNCTION__, *channels, popcount(*channels));
                 bad_channels = true;
@@ -170,9 +176,9 @@ status_t ALSAStreamOps::set(int      *format,
         if (*format != 0) {
 
             ALOGD("%s(requested format: %d))", __FUNCTION__, *format);
-            // Always accept the rate provided by the client
-            // as far as this rate is supported
-            if (*format != AUDIO_FORMAT_PCM_16_BIT && *format != AUDIO_FORMAT_PCM_8_24_BIT) {
+            // Always accept the format provided by the client
+            // as far as the conversion library supports it
+            if (SampleSpec::getBytesPerSample(*format) == 0) {
 
                 ALOGD("%s: format=(0x%x) not supported", __FUNCTION__, *format);
                 bad_format = true;
@@ -244,16 +250,24 @@ size_t ALSAStreamOps::getBufferSize(uint32_t flags) const
 
 uint32_t ALSAStreamOps::latency() const
 {
-    return AudioUtils::convertUsecToMsec(mLatencyUs);
+    return AudioUtils::convertUsecToMsec(mLatencyUs + mConversionLatencyUs);
+}
+
+uint32_t ALSAStreamOps::getConversionDelayUsL() const
+{
+    // Conversion delay is counted in frames of the destination of the conversion
+    const SampleSpec &ssDst = isOut() ? mHwSampleSpec : mSampleSpec;
+    return ssDst.convertFramesToUsec(getConversionDelayFramesL());
+}
+
+size_t ALSAStreamOps::getConversionDelayFramesL() const
+{
+    return mAudioConversion->getDelayFrames();
 }
 
 void ALSAStreamOps::updateLatency(uint32_t uiFlags)
 {
-    pcm_config pcmConf = mParent->getDefaultPcmConfig(isOut(), uiFlags);
-    uint64_t latency = (uint64_t)AudioUtils::USEC_TO_SEC * pcmConf.period_count *
-                                            pcmConf.period_size  / pcmConf.rate;
-    LOG_ALWAYS_FATAL_IF(latency > numeric_limits<uint32_t>::max());
-    mLatencyUs = latency;
+    mLatencyUs = AudioUtils::getPcmLatencyUs(mParent->getDefaultPcmConfig(isOut(), uiFlags));
 }
 
 status_t ALSAStreamOps::setStandby(bool isSet)
@@ -278,6 +292,36 @@ bool ALSAStreamOps::isRouteAvailableL() const
     return mCurrentRoute != NULL;
 }
 
+void ALSAStreamOps::waitSilence(size_t frames)
+{
+    nsecs_t duration = us2ns(mSampleSpec.convertFramesToUsec(frames));
+
+    android::Mutex::Autolock lock(mSilenceLock);
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+
+    if (mSilenceDeadline == 0 ||
+            now - mSilenceDeadline > std::max(duration, ms2ns(MAX_SILENCE_LAG_MS))) {
+
+        mSilenceDeadline = now;
+    }
+    mSilenceDeadline += duration;
+
+    // Deadline is reset if the clock is stopped while waiting
+    nsecs_t deadline = mSilenceDeadline;
+    while (mSilenceDeadline == deadline && now < deadline) {
+
+        mSilenceCondition.waitRelative(mSilenceLock, deadline - now);
+        now = systemTime(SYSTEM_TIME_MONOTONIC);
+    }
+}
+
+void ALSAStreamOps::stopSilenceClock()
+{
+    android::Mutex::Autolock lock(mSilenceLock);
+    mSilenceDeadline = 0;
+    mSilenceCondition.broadcast();
+}
+
 status_t ALSAStreamOps::attachRoute()
 {
     AutoW lock(_streamLock);
@@ -299,6 +343,20 @@ status_t ALSAStreamOps::attachRouteL()
     ssSrc = isOut() ? mSampleSpec : mHwSampleSpec;
     ssDst = isOut() ? mHwSampleSpec : mSampleSpec;
 
+    mAudioConversion->setDithering(isDitheringAllowed());
+
+    int32_t quality = TProperty<int32_t>(
+        AudioHardwareALSA::CONVERSION_RESAMPLING_QUALITY_PROP_NAME,
+        AudioConversion::MediumResamplingQuality);
+    if (quality < AudioConversion::LowResamplingQuality ||
+        quality > AudioConversion::HighResamplingQuality) {
+
+        ALOGW("%s: invalid resampling quality %d, using medium", __FUNCTION__, quality);
+        quality = AudioConversion::MediumResamplingQuality;
+    }
+    mAudioConversion->setResamplingQuality(
+        static_cast<AudioConversion::ResamplingQuality>(quality));
+
     status_t err = configureAudioConversion(ssSrc, ssDst);
     if (err != NO_ERROR) {
 
@@ -306,10 +364,28 @@ status_t ALSAStreamOps::attachRouteL()
         return err;
     }
 
+    // Reserve the conversion for a transfer as long as the hardware buffer, so that the audio
+    // thread never allocates after a route change
+    if (mHandle != NULL) {
+
+        size_t hwBufferFrames = pcm_get_buffer_size(mHandle);
+        err = mAudioConversion->reserve(
+                    AudioUtils::convertSrcToDstInFrames(hwBufferFrames, mHwSampleSpec, ssSrc));
+        if (err != NO_ERROR) {
+
+            ALOGE("%s: could not reserve audio conversion buffers (err=%d)", __FUNCTION__, err);
+            return err;
+        }
+    }
+    // Freshly configured conversion keeps no frame, its delay is the one of its filters
+    mConversionLatencyUs = getConversionDelayUsL();
+
     // Open successful - Update current route
     mCurrentRoute = mNewRoute;
     mCurrentDevices = mNewDevices;
 
+    stopSilenceClock();
+
     return NO_ERROR;
 }
 
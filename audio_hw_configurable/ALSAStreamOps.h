@@ -20,6 +20,9 @@
 #include <media/AudioBufferProvider.h>
 #include <SampleSpec.h>
 #include <utils/String8.h>
+#include <utils/Condition.h>
+#include <utils/Mutex.h>
+#include <utils/Timers.h>
 #include "Utils.h"
 
 /**
@@ -169,6 +172,14 @@ public:
      */
     virtual uint32_t    getApplicabilityMask() const = 0;
 
+    /**
+     * Checks if the audio conversion of the stream may dither the samples it requantizes to
+     * 16 bits. Called with the stream lock held, when a route is attached.
+     *
+     * @return true if dithering is allowed, false if samples must be rounded.
+     */
+    virtual bool        isDitheringAllowed() const { return true; }
+
     /**
      * Get audio dump object before conversion for debug purposes
      *
@@ -212,6 +223,38 @@ protected:
     uint32_t            latency() const;
     void                updateLatency(uint32_t uiFlags = 0);
 
+    /**
+     * Gets the delay added by the audio conversion, ie the group delay of its filters plus
+     * the converted frames it keeps for the next transfer.
+     * Must be called with stream lock held.
+     *
+     * @return delay in microseconds.
+     */
+    uint32_t getConversionDelayUsL() const;
+
+    /**
+     * Gets the delay added by the audio conversion in frames, see getConversionDelayUsL.
+     * Must be called with stream lock held.
+     *
+     * @return delay in frames in the sample specification of the destination of the
+     *         conversion, ie hardware for output streams, stream for input streams.
+     */
+    size_t getConversionDelayFramesL() const;
+
+    /**
+     * Waits for the duration of silent frames on the virtual clock of the stream.
+     * No hardware drives the timeline while the stream has no route, so silent transfers are
+     * paced by an absolute deadline on the monotonic clock, advanced by each transfer: the
+     * timeline does not drift whatever the scheduling latency of the calls: late transfers
+     * return at once to catch up. The clock restarts if the stream comes back later than
+     * MAX_SILENCE_LAG_MS or than the transfer, e.g. after a standby.
+     * Attaching a route stops the clock and wakes the waiter immediately, so it must be called
+     * without the stream lock held, except on hardware errors.
+     *
+     * @param[in] frames number of silent frames, in the stream sample specification.
+     */
+    void waitSilence(size_t frames);
+
     /**
      * Checks if a stream is fully routed or not.
      * Note that a stream is considered as routed when
@@ -317,6 +360,23 @@ private:
 
     uint32_t                mLatencyUs;
 
+    /**
+     * Group delay of the audio conversion of the current route, part of the latency.
+     */
+    uint32_t                mConversionLatencyUs;
+
+    /**
+     * Stops the virtual clock of the silence and wakes up its waiter, the hardware drives the
+     * timeline again.
+     */
+    void stopSilenceClock();
+
+    android::Mutex          mSilenceLock; /**< Protects the virtual clock of the silence. */
+    android::Condition      mSilenceCondition; /**< Signaled when the clock is stopped. */
+    nsecs_t                 mSilenceDeadline; /**< End of the silence on the clock, 0 if stopped. */
+
+    static const uint32_t MAX_SILENCE_LAG_MS = 100; /**< Lag caught up by the silence clock. */
+
     bool                    mPowerLock;
     const char*             mPowerLockTag;
 
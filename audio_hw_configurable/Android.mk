@@ -41,7 +41,8 @@ audio_hw_configurable_src_files :=  \
     AudioHardwareALSA.cpp \
     AudioHardwareInterface.cpp \
     AudioStreamInALSA.cpp \
-    AudioStreamOutALSA.cpp
+    AudioStreamOutALSA.cpp \
+    AudioStreamOutAsyncWriter.cpp
 
 audio_hw_configurable_src_files +=  \
     audio_route_manager/AudioCompressedStreamRoute.cpp \
@@ -259,6 +260,28 @@ $(call make_audio_hw_configurable_test_lib,host)
 LOCAL_MODULE := libaudio_hw_configurable_static_host
 include $(BUILD_HOST_STATIC_LIBRARY)
 
+# Host unit test of the stream routes and of the output stream in mmap mode, linked with
+# stand-ins of tinyalsa and of the wake locks instead of the audio devices
+include $(CLEAR_VARS)
+LOCAL_MODULE := audio_hw_configurable_test_host
+LOCAL_SRC_FILES := \
+    test/AudioStreamRouteTest.cpp \
+    test/PowerStandIn.cpp \
+    test/TinyAlsaStandIn.cpp
+LOCAL_C_INCLUDES := $(audio_hw_configurable_includes_dir_host)
+LOCAL_CFLAGS := $(audio_hw_configurable_cflags)
+LOCAL_STATIC_LIBRARIES := \
+    libaudio_hw_configurable_static_host \
+    $(audio_hw_configurable_static_lib_host) \
+    libcutils \
+    libutils \
+    liblog
+LOCAL_IMPORT_C_INCLUDE_DIRS_FROM_STATIC_LIBRARIES := \
+    $(audio_hw_configurable_include_dirs_from_static_libraries_host)
+LOCAL_LDLIBS := -lrt -lpthread
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_HOST_NATIVE_TEST)
+
 endif #ifeq ($(audiocomms_test_host),true)
 
 # Build for target test
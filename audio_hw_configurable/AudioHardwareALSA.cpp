@@ -71,6 +71,12 @@ const uint32_t AudioHardwareALSA::DEFAULT_SAMPLE_RATE = 48000;
 const uint32_t AudioHardwareALSA::DEFAULT_CHANNEL_COUNT = 2;
 const uint32_t AudioHardwareALSA::DEFAULT_FORMAT = AUDIO_FORMAT_PCM_16_BIT;
 
+const char* const AudioHardwareALSA::CONVERSION_CALIBRATION_PROP_NAME =
+    "audio.conversion.calibrate";
+
+const char* const AudioHardwareALSA::CONVERSION_RESAMPLING_QUALITY_PROP_NAME =
+    "audio.conversion.resampling_quality";
+
 AudioHardwareInterface *AudioHardwareALSA::create() {
 
     ALOGD("Using Audio HAL Configurable");
@@ -81,6 +87,12 @@ AudioHardwareInterface *AudioHardwareALSA::create() {
 AudioHardwareALSA::AudioHardwareALSA() :
     mRouteMgr(new CAudioRouteManager(this))
 {
+    // Conversion chains are planned with the costs measured on the platform, before any stream
+    if (TProperty<bool>(CONVERSION_CALIBRATION_PROP_NAME, false)) {
+
+        AudioConversion::calibrate();
+    }
+
     // Start the route manager service
     if (mRouteMgr->start() != NO_ERROR) {
 
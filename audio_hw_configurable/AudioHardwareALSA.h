@@ -214,6 +214,17 @@ private:
     static const char* const AUDIENCE_IS_PRESENT_PROP_NAME;
     static const bool AUDIENCE_IS_PRESENT_DEFAULT_VALUE;
 
+    /**
+     * Property requesting the calibration of the audio conversion cost model at startup.
+     */
+    static const char* const CONVERSION_CALIBRATION_PROP_NAME;
+
+    /**
+     * Property giving the quality level of the audio conversion for the rate pairs the
+     * resampling library does not support: 0 for low, 1 for medium (default), 2 for high.
+     */
+    static const char* const CONVERSION_RESAMPLING_QUALITY_PROP_NAME;
+
 private:
     CAudioRouteManager* mRouteMgr;
 };
@@ -83,8 +83,8 @@ size_t AudioStreamInALSA::generateSilence(void *buffer, size_t bytes)
     memset(buffer, 0, bytes);
     // No HW will drive the timeline:
     //       we are here because of hardware error or missing route availability.
-    // Also, keep time sync by sleeping the equivalent amount of time.
-    usleep(mSampleSpec.convertFramesToUsec(mSampleSpec.convertBytesToFrames(bytes)));
+    // Also, keep time sync by waiting the equivalent amount of time.
+    waitSilence(mSampleSpec.convertBytesToFrames(bytes));
     return bytes;
 }
 
@@ -163,7 +163,7 @@ ssize_t AudioStreamInALSA::readFrames(void *buffer, size_t frames)
     //
     // No conversion required, read HW frames directly
     //
-    if (mSampleSpec == mHwSampleSpec) {
+    if (mSampleSpec.isCompatible(mHwSampleSpec)) {
 
         return readHwFrames(buffer, frames);
     }
@@ -303,16 +303,23 @@ ssize_t AudioStreamInALSA::read(void *buffer, ssize_t bytes)
 {
     setStandby(false);
 
-    AutoR lock(_streamLock);
+    {
+        AutoR lock(_streamLock);
 
-    // Check if the audio route is available for this stream
-    if (!isRouteAvailableL()) {
+        // Check if the audio route is available for this stream
+        if (isRouteAvailableL()) {
 
-        ALOGW("%s(buffer=%p, bytes=%ld) No route available. Generating silence.",
-              __FUNCTION__, buffer, static_cast<long int>(bytes));
-        return generateSilence(buffer, bytes);
+            return readL(buffer, bytes);
+        }
     }
+    // Silence is generated without the stream lock, so that attaching a route interrupts it
+    ALOGW("%s(buffer=%p, bytes=%ld) No route available. Generating silence.",
+          __FUNCTION__, buffer, static_cast<long int>(bytes));
+    return generateSilence(buffer, bytes);
+}
 
+ssize_t AudioStreamInALSA::readL(void *buffer, ssize_t bytes)
+{
     LOG_ALWAYS_FATAL_IF(mHandle == NULL);
 
     ssize_t received_frames = -1;
@@ -453,6 +460,19 @@ status_t AudioStreamInALSA::detachRouteL()
     return base::detachRouteL();
 }
 
+//
+// Called from Route Manager Context -> WLocked
+//
+bool AudioStreamInALSA::isDitheringAllowed() const
+{
+    static const uint32_t voiceSourcesMask = (1 << AUDIO_SOURCE_VOICE_UPLINK) |
+                                             (1 << AUDIO_SOURCE_VOICE_DOWNLINK) |
+                                             (1 << AUDIO_SOURCE_VOICE_CALL) |
+                                             (1 << AUDIO_SOURCE_VOICE_COMMUNICATION);
+
+    return (_inputSourceMask & voiceSourcesMask) == 0;
+}
+
 size_t AudioStreamInALSA::bufferSize() const
 {
     AutoR lock(_streamLock);
@@ -694,6 +714,7 @@ void AudioStreamInALSA::getCaptureDelay(struct echo_reference_buffer* buffer)
     struct timespec tstamp;
     long buf_delay;
     long kernel_delay;
+    long conversion_delay;
     long delay_ns;
 
     if (pcm_get_htimestamp(mHandle, &kernel_frames, &tstamp) < 0) {
@@ -712,14 +733,18 @@ void AudioStreamInALSA::getCaptureDelay(struct echo_reference_buffer* buffer)
     // add delay introduced by kernel
     kernel_delay = mHwSampleSpec.convertFramesToUsec(kernel_frames);
 
-    delay_ns = kernel_delay + buf_delay;
+    // add delay introduced by the filters of the conversion and the converted frames it keeps
+    conversion_delay = getConversionDelayUsL();
+
+    // delays are computed in microseconds
+    delay_ns = (kernel_delay + buf_delay + conversion_delay) * 1000;
 
     buffer->time_stamp = tstamp;
     buffer->delay_ns   = delay_ns;
     ALOGV("get_capture_delay time_stamp = [%ld].[%ld], delay_ns: [%d],"
-          " kernel_delay:[%ld], buf_delay:[%ld], kernel_frames:[%d], ",
+          " kernel_delay:[%ld], buf_delay:[%ld], conversion_delay:[%ld], kernel_frames:[%d], ",
           buffer->time_stamp.tv_sec , buffer->time_stamp.tv_nsec, buffer->delay_ns,
-          kernel_delay, buf_delay, kernel_frames);
+          kernel_delay, buf_delay, conversion_delay, kernel_frames);
 }
 
 int32_t AudioStreamInALSA::updateEchoReference(ssize_t frames,
@@ -137,6 +137,14 @@ public:
         return _inputSourceMask;
     }
 
+    /**
+     * Dithering is not allowed for the voice sources, as their samples are processed
+     * afterwards by the speech codecs and the echo canceller.
+     *
+     * @return true if dithering is allowed, false otherwise.
+     */
+    virtual bool        isDitheringAllowed() const;
+
 private:
     class AudioEffectHandle
     {
@@ -249,6 +257,12 @@ private:
     void                resetFramesLost();
     size_t              generateSilence(void* buffer, size_t bytes);
 
+    /**
+     * Reads from the current route, see read.
+     * Must be called with stream lock held, and a route available.
+     */
+    ssize_t             readL(void *buffer, ssize_t bytes);
+
     ssize_t             readHwFrames(void* buffer, size_t frames);
 
     ssize_t             readFrames(void* buffer, size_t frames);
@@ -30,6 +30,7 @@
 #include "AudioStreamOutALSA.h"
 #include "AudioStreamRoute.h"
 #include <AudioCommsAssert.hpp>
+#include "Property.h"
 
 #define base ALSAStreamOps
 
@@ -37,23 +38,46 @@ namespace android_audio_legacy
 {
 
 const uint32_t AudioStreamOutALSA::MAX_AGAIN_RETRY = 2;
-const uint32_t AudioStreamOutALSA::WAIT_TIME_MS = 20;
+const uint32_t AudioStreamOutALSA::MMAP_WAIT_PERIODS = 2;
 const uint32_t AudioStreamOutALSA::WAIT_BEFORE_RETRY_US = 10000; //10ms
 /**
  * Is aligned on one period time
  */
 const uint32_t AudioStreamOutALSA::USEC_PER_MSEC = 1000;
 
+const char* const AudioStreamOutALSA::ASYNC_WRITE_PROP_NAME = "audio.out.async_write";
+
 AudioStreamOutALSA::AudioStreamOutALSA(AudioHardwareALSA *parent, audio_output_flags_t flags) :
     base(parent, "AudioOutLock"),
-    mFrameCount(0),
+    mIsMmap(false),
+    mMmapStarted(false),
+    mMmapStartThreshold(0),
+    mMmapQueuedFrames(0),
+    mMmapWaitTimeMs(0),
+    mAsyncWriter(NULL),
+    mAsyncStarted(false),
+    mAsyncLatencyMs(0),
+    mRouteFramesWritten(0),
+    mHwFramesWritten(0),
+    mStandbyFrames(0),
     _flags(flags),
     mEchoReference(NULL)
 {
+    if (TProperty<bool>(ASYNC_WRITE_PROP_NAME, false)) {
+
+        mAsyncWriter = new AudioStreamOutAsyncWriter();
+        if (!mAsyncWriter->isRunning()) {
+
+            ALOGE("%s: asynchronous mode not available", __FUNCTION__);
+            delete mAsyncWriter;
+            mAsyncWriter = NULL;
+        }
+    }
 }
 
 AudioStreamOutALSA::~AudioStreamOutALSA()
 {
+    delete mAsyncWriter;
 }
 
 uint32_t AudioStreamOutALSA::channels() const
@@ -70,8 +94,8 @@ size_t AudioStreamOutALSA::generateSilence(size_t bytes)
 {
     // No HW will drive the timeline:
     //       we are here because of hardware error or missing route availability.
-    // Also, keep time sync by sleeping the equivalent amount of time.
-    usleep(mSampleSpec.convertFramesToUsec(mSampleSpec.convertBytesToFrames(bytes)));
+    // Also, keep time sync by waiting the equivalent amount of time.
+    waitSilence(mSampleSpec.convertBytesToFrames(bytes));
     return bytes;
 }
 
@@ -79,16 +103,30 @@ ssize_t AudioStreamOutALSA::write(const void *buffer, size_t bytes)
 {
     setStandby(false);
 
-    AutoR lock(_streamLock);
+    if (mAsyncWriter != NULL) {
+
+        // Blocks without the stream lock, so that a route change preempts the write
+        mAsyncWriter->waitForRoom(
+                    mSampleSpec.convertFramesToUsec(mSampleSpec.convertBytesToFrames(bytes)));
+    }
 
-    // Check if the audio route is available for this stream
-    if (!isRouteAvailableL()) {
+    {
+        AutoR lock(_streamLock);
 
-        ALOGW("%s(buffer=%p, bytes=%d) No route available. Generating silence.",
-            __FUNCTION__, buffer, bytes);
-        return generateSilence(bytes);
+        // Check if the audio route is available for this stream
+        if (isRouteAvailableL()) {
+
+            return writeL(buffer, bytes);
+        }
     }
+    // Silence is generated without the stream lock, so that attaching a route interrupts it
+    ALOGW("%s(buffer=%p, bytes=%d) No route available. Generating silence.",
+        __FUNCTION__, buffer, bytes);
+    return generateSilence(bytes);
+}
 
+ssize_t AudioStreamOutALSA::writeL(const void *buffer, size_t bytes)
+{
     AUDIOCOMMS_ASSERT(mHandle != NULL, "unexpected NULL handle on audio device");
 
     ssize_t srcFrames = mSampleSpec.convertBytesToFrames(bytes);
@@ -109,15 +147,33 @@ ssize_t AudioStreamOutALSA::write(const void *buffer, size_t bytes)
 
     pushEchoReference(buffer, srcFrames);
 
-    status = applyAudioConversion(buffer, (void**)&dstBuf, srcFrames, &dstFrames);
+    ssize_t ret;
+    if (mIsMmap && mSampleSpec.getSampleRate() == mHwSampleSpec.getSampleRate()) {
 
-    if (status != NO_ERROR) {
+        // Conversion keeps the frames count, it outputs straight into the DMA ring buffer
+        ret = writeMmapFrames(buffer, srcFrames, true);
+    } else {
 
-        return status;
-    }
-    ALOGV("%s: srcFrames=%lu, bytes=%d dstFrames=%d", __FUNCTION__, srcFrames, bytes, dstFrames);
+        status = applyAudioConversion(buffer, (void**)&dstBuf, srcFrames, &dstFrames);
 
-    ssize_t ret = writeFrames(dstBuf, dstFrames);
+        if (status != NO_ERROR) {
+
+            return status;
+        }
+        ALOGV("%s: srcFrames=%lu, bytes=%d dstFrames=%d", __FUNCTION__, srcFrames, bytes,
+              dstFrames);
+
+        if (mIsMmap) {
+
+            ret = writeMmapFrames(dstBuf, dstFrames, false);
+        } else if (mAsyncStarted) {
+
+            ret = writeAsyncFramesL(dstBuf, dstFrames);
+        } else {
+
+            ret = writeFrames(dstBuf, dstFrames);
+        }
+    }
 
     if (ret < 0) {
 
@@ -132,12 +188,19 @@ ssize_t AudioStreamOutALSA::write(const void *buffer, size_t bytes)
 
         return ret;
     }
+    if (!mAsyncStarted) {
+
+        // Writer thread counts the frames it writes in asynchronous mode
+        android::Mutex::Autolock positionLock(mPositionLock);
+        mHwFramesWritten += ret;
+    }
     ALOGV("%s: returns %u", __FUNCTION__, mSampleSpec.convertFramesToBytes(
               CAudioUtils::convertSrcToDstInFrames(ret, mHwSampleSpec, mSampleSpec)));
 
-    // Dump audio output after eventual conversions
+    // Dump audio output after eventual conversions, done by chunks when converted within the
+    // DMA ring buffer
     // FOR DEBUG PURPOSE ONLY
-    if (getDumpObjectAfterConv() != NULL) {
+    if (getDumpObjectAfterConv() != NULL && dstBuf != NULL) {
       getDumpObjectAfterConv()->dumpAudioSamples((const void*)dstBuf,
                                                  mHwSampleSpec.convertFramesToBytes(dstFrames),
                                                  isOut(),
@@ -186,6 +249,146 @@ ssize_t AudioStreamOutALSA::writeFrames(void* buffer, ssize_t frames)
     return frames;
 }
 
+ssize_t AudioStreamOutALSA::writeAsyncFramesL(const void *buffer, ssize_t frames)
+{
+    size_t pushedFrames = mAsyncWriter->push(buffer, frames);
+    if (pushedFrames < static_cast<size_t>(frames)) {
+
+        ALOGW("%s: writer late, %d frames dropped", __FUNCTION__, frames - pushedFrames);
+    }
+    return frames;
+}
+
+uint64_t AudioStreamOutALSA::getHwFramesWrittenL() const
+{
+    return mHwFramesWritten + (mAsyncStarted ? mAsyncWriter->getFramesWritten() : 0);
+}
+
+ssize_t AudioStreamOutALSA::writeMmapFrames(const void *buffer, ssize_t frames, bool bConvert)
+{
+    const char *srcBytes = static_cast<const char *>(buffer);
+    const SampleSpec &srcSampleSpec = bConvert ? mSampleSpec : mHwSampleSpec;
+    ssize_t framesWritten = 0;
+    uint32_t retryCount = 0;
+    uint32_t timeoutCount = 0;
+
+    while (framesWritten < frames) {
+
+        void *dmaAreas;
+        unsigned int offset;
+        unsigned int dmaFrames = frames - framesWritten;
+
+        int ret = pcm_mmap_begin(mHandle, &dmaAreas, &offset, &dmaFrames);
+        if (ret == 0 && dmaFrames == 0) {
+
+            // Ring buffer is full, the DMA must run to free some room
+            if (!mMmapStarted) {
+
+                ret = pcm_start(mHandle);
+                mMmapStarted = (ret == 0);
+            } else {
+
+                ret = pcm_wait(mHandle, mMmapWaitTimeMs);
+                if (ret == 0) {
+
+                    // DMA may be late on a full ring buffer, room is checked again
+                    ALOGW("%s: no room in the ring buffer after %d ms", __FUNCTION__,
+                          mMmapWaitTimeMs);
+                    if (++timeoutCount >= MAX_READ_WRITE_RETRIES) {
+
+                        ALOGE("%s: DMA stalled, %d frames not written", __FUNCTION__,
+                              frames - framesWritten);
+                        return -ETIMEDOUT;
+                    }
+                }
+            }
+            if (ret >= 0) {
+
+                continue;
+            }
+        }
+        if (ret < 0) {
+
+            ALOGE("%s: mmap error: %d %s", __FUNCTION__, ret, pcm_get_error(mHandle));
+            if (ret != -EPIPE) {
+
+                return ret;
+            }
+            // Underrun, the ring buffer is dropped
+            LOG_ALWAYS_FATAL_IF(++retryCount >= MAX_READ_WRITE_RETRIES,
+                                "Hardware not responding, restarting media server");
+            recoverMmapL();
+            continue;
+        }
+
+        char *dmaBuffer = static_cast<char *>(dmaAreas) + pcm_frames_to_bytes(mHandle, offset);
+        if (bConvert) {
+
+            void *dstBuf = dmaBuffer;
+            uint32_t dstFrames = 0;
+            status_t status = applyAudioConversion(srcBytes, &dstBuf, dmaFrames, &dstFrames);
+            if (status != NO_ERROR) {
+
+                return status;
+            }
+            LOG_ALWAYS_FATAL_IF(dstFrames != dmaFrames);
+
+            // FOR DEBUG PURPOSE ONLY
+            if (getDumpObjectAfterConv() != NULL) {
+
+                getDumpObjectAfterConv()->dumpAudioSamples(dmaBuffer,
+                                                           pcm_frames_to_bytes(mHandle, dmaFrames),
+                                                           isOut(),
+                                                           mHwSampleSpec.getSampleRate(),
+                                                           mHwSampleSpec.getChannelCount(),
+                                                           "after_conversion");
+            }
+        } else {
+
+            memcpy(dmaBuffer, srcBytes, pcm_frames_to_bytes(mHandle, dmaFrames));
+        }
+
+        ret = pcm_mmap_commit(mHandle, offset, dmaFrames);
+        if (ret < 0) {
+
+            ALOGE("%s: mmap commit error: %d %s", __FUNCTION__, ret, pcm_get_error(mHandle));
+            if (ret != -EPIPE) {
+
+                return ret;
+            }
+            LOG_ALWAYS_FATAL_IF(++retryCount >= MAX_READ_WRITE_RETRIES,
+                                "Hardware not responding, restarting media server");
+            recoverMmapL();
+            continue;
+        }
+        srcBytes += srcSampleSpec.convertFramesToBytes(dmaFrames);
+        framesWritten += dmaFrames;
+        timeoutCount = 0;
+
+        if (!mMmapStarted) {
+
+            mMmapQueuedFrames += dmaFrames;
+            if (mMmapQueuedFrames >= mMmapStartThreshold) {
+
+                mMmapStarted = (pcm_start(mHandle) == 0);
+            }
+        }
+    }
+    return framesWritten;
+}
+
+void AudioStreamOutALSA::recoverMmapL()
+{
+    // Stop is required to prepare a device that is still running
+    pcm_stop(mHandle);
+    if (pcm_prepare(mHandle) != 0) {
+
+        ALOGE("%s: prepare error %s", __FUNCTION__, pcm_get_error(mHandle));
+    }
+    mMmapStarted = false;
+    mMmapQueuedFrames = 0;
+}
+
 status_t AudioStreamOutALSA::dump(int , const Vector<String16>& )
 {
     return NO_ERROR;
@@ -211,6 +414,21 @@ status_t AudioStreamOutALSA::attachRouteL()
     AUDIOCOMMS_ASSERT(getCurrentRouteL() != NULL, "NULL route pointer");
     AUDIOCOMMS_ASSERT(mHandle != NULL, "NULL audio device handle");
 
+    // Device has just been prepared by the route
+    mIsMmap = getCurrentRouteL()->isMmap(isOut());
+    mMmapStarted = false;
+    mMmapQueuedFrames = 0;
+    if (mIsMmap) {
+
+        const pcm_config &config = getCurrentRouteL()->getPcmConfig(isOut());
+        mMmapStartThreshold = config.start_threshold != 0 ?
+                    config.start_threshold : config.period_size;
+        mMmapWaitTimeMs = AudioUtils::convertUsecToMsec(
+                    mHwSampleSpec.convertFramesToUsec(MMAP_WAIT_PERIODS * config.period_size));
+        ALOGD("%s: mmap mode, DMA started after %d frames, waits up to %d ms", __FUNCTION__,
+              mMmapStartThreshold, mMmapWaitTimeMs);
+    }
+
     uint32_t uiSilenceMs = getCurrentRouteL()->getOutputSilencePrologMs();
     if (uiSilenceMs) {
 
@@ -222,12 +440,30 @@ status_t AudioStreamOutALSA::attachRouteL()
         uint32_t uiMsCount;
         for (uiMsCount = 0; uiMsCount < uiSilenceMs; uiMsCount++) {
 
-            pcm_write(mHandle,
-                          (const char*)pSilenceBuffer,
-                          uiBufferSize);
+            if (mIsMmap) {
+
+                writeMmapFrames(pSilenceBuffer, mHwSampleSpec.convertBytesToFrames(uiBufferSize),
+                                false);
+            } else {
+
+                pcm_write(mHandle,
+                              (const char*)pSilenceBuffer,
+                              uiBufferSize);
+            }
         }
     }
 
+    // Writer thread drains to the device from now on, as long as the stream writes in it
+    if (mAsyncWriter != NULL && !mIsMmap) {
+
+        size_t ringFrames = pcm_get_buffer_size(mHandle);
+        mAsyncStarted = mAsyncWriter->start(mHandle, mHwSampleSpec.getFrameSize(),
+                                            mHwSampleSpec.getSampleRate(),
+                                            ringFrames) == NO_ERROR;
+        mAsyncLatencyMs = mAsyncStarted ? AudioUtils::convertUsecToMsec(
+                    mHwSampleSpec.convertFramesToUsec(ringFrames)) : 0;
+    }
+
     return NO_ERROR;
 }
 
@@ -239,14 +475,20 @@ status_t AudioStreamOutALSA::close()
 
 status_t AudioStreamOutALSA::standby()
 {
-    mFrameCount = 0;
+    {
+        AutoW lock(_streamLock);
+        struct timespec timestamp;
+
+        // Render position restarts from the frames presented so far
+        getPresentedFramesL(&mStandbyFrames, &timestamp);
+    }
 
     return setStandby(true);
 }
 
 uint32_t AudioStreamOutALSA::latency() const
 {
-    return base::latency();
+    return base::latency() + mAsyncLatencyMs;
 }
 
 size_t AudioStreamOutALSA::bufferSize() const
@@ -258,25 +500,86 @@ size_t AudioStreamOutALSA::bufferSize() const
 // the output has exited standby
 status_t AudioStreamOutALSA::getRenderPosition(uint32_t *dspFrames)
 {
-    *dspFrames = mFrameCount;
+    AutoR lock(_streamLock);
+    uint64_t frames;
+    struct timespec timestamp;
+
+    // Without hardware timestamp, written frames are reported as rendered
+    getPresentedFramesL(&frames, &timestamp);
+    *dspFrames = static_cast<uint32_t>(frames > mStandbyFrames ? frames - mStandbyFrames : 0);
     return NO_ERROR;
 }
 
-// flush the data down the flow. It is similar to drop.
-status_t AudioStreamOutALSA::flush()
+status_t AudioStreamOutALSA::getPresentationPosition(uint64_t *frames, struct timespec *timestamp)
 {
     AutoR lock(_streamLock);
 
-    // Check if there is an available audio route to flush
-    if (!isRouteAvailableL()) {
+    return getPresentedFramesL(frames, timestamp);
+}
+
+status_t AudioStreamOutALSA::getPresentedFramesL(uint64_t *frames, struct timespec *timestamp)
+{
+    status_t status = INVALID_OPERATION;
+    size_t hwPendingFrames = 0;
+
+    if (isRouteAvailableL() && mHandle != NULL) {
+
+        size_t hwAvailableFrames;
+        if (pcm_get_htimestamp(mHandle, &hwAvailableFrames, timestamp) == 0) {
 
-        ALOGW("%s: No route available. There is no pcm to flush.", __FUNCTION__);
-        return NO_ERROR;
+            // Frames in the hardware buffer, and the ones held back by the conversion filters
+            hwPendingFrames = pcm_get_buffer_size(mHandle) - hwAvailableFrames +
+                    getConversionDelayFramesL();
+            status = NO_ERROR;
+        }
     }
 
-    LOG_ALWAYS_FATAL_IF(mHandle == NULL);
+    android::Mutex::Autolock positionLock(mPositionLock);
+    // Silence written when the route is attached is not counted, clip to the written frames
+    uint64_t hwFramesWritten = getHwFramesWrittenL();
+    uint64_t hwFrames = hwFramesWritten > hwPendingFrames ?
+                hwFramesWritten - hwPendingFrames : 0;
+    *frames = mRouteFramesWritten + (hwFrames != 0 ? convertHwToStreamFramesL(hwFrames) : 0);
+    return status;
+}
+
+uint64_t AudioStreamOutALSA::convertHwToStreamFramesL(uint64_t hwFrames) const
+{
+    return hwFrames * mSampleSpec.getSampleRate() / mHwSampleSpec.getSampleRate();
+}
+
+// flush the data down the flow. It is similar to drop.
+status_t AudioStreamOutALSA::flush()
+{
+    {
+        AutoR lock(_streamLock);
+
+        // Check if there is an available audio route to flush
+        if (!isRouteAvailableL()) {
+
+            ALOGW("%s: No route available. There is no pcm to flush.", __FUNCTION__);
+            return NO_ERROR;
+        }
 
-    status_t status = pcm_stop(mHandle);
+        LOG_ALWAYS_FATAL_IF(mHandle == NULL);
+
+        if (!mAsyncStarted) {
+
+            status_t status = pcm_stop(mHandle);
+            ALOGD("pcm stop status %d", status);
+
+            if (mIsMmap) {
+
+                // Device opened in mmap mode is started by the stream, it must be prepared again
+                recoverMmapL();
+            }
+            return status;
+        }
+    }
+    // Writer thread stops the device between two writes, and drops the frames pending within.
+    // The stream lock is not held meanwhile, so that a route change is not delayed by the
+    // write in progress: if the route stops the writer first, there is nothing left to flush.
+    status_t status = mAsyncWriter->flush();
     ALOGD("pcm stop status %d", status);
     return status;
 }
@@ -351,12 +654,20 @@ int AudioStreamOutALSA::getPlaybackDelay(ssize_t frames, struct echo_reference_b
         return status;
     }
     kernel_frames = pcm_get_buffer_size(mHandle) - kernel_frames;
+    if (mAsyncStarted) {
+
+        // Frames pending within the writer thread are played after the ones of the device
+        kernel_frames += mAsyncWriter->getPendingFrames();
+    }
 
-    /* adjust render time stamp with delay added by current driver buffer.
+    /* adjust render time stamp with delay added by current driver buffer and by the
+     * filters of the conversion.
      * Add the duration of current frame as we want the render time of the last
      * sample being written.
      */
-    buffer->delay_ns = mSampleSpec.convertFramesToUsec(kernel_frames + frames);
+    buffer->delay_ns = (mHwSampleSpec.convertFramesToUsec(kernel_frames) +
+                        getConversionDelayUsL() +
+                        mSampleSpec.convertFramesToUsec(frames)) * 1000;
 
     ALOGV("%s: kernel_frames=%d buffer->time_stamp.tv_sec=%lu,"
           "buffer->time_stamp.tv_nsec =%lu buffer->delay_ns=%d",
@@ -385,6 +696,24 @@ status_t AudioStreamOutALSA::detachRouteL()
 {
     removeEchoReferenceL(mEchoReference);
 
+    if (mAsyncStarted) {
+
+        // Writer thread leaves the device once its write is over, before the route closes it
+        mAsyncWriter->stop();
+    }
+    {
+        // Frames of the route are counted as presented, even if dropped from the buffer
+        android::Mutex::Autolock positionLock(mPositionLock);
+        uint64_t hwFramesWritten = getHwFramesWrittenL();
+        if (hwFramesWritten != 0) {
+
+            mRouteFramesWritten += convertHwToStreamFramesL(hwFramesWritten);
+            mHwFramesWritten = 0;
+        }
+    }
+    mAsyncStarted = false;
+    mAsyncLatencyMs = 0;
+
     return base::detachRouteL();
 }
 
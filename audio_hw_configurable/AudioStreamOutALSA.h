@@ -19,6 +19,9 @@
 
 #include "AudioHardwareALSA.h"
 #include "ALSAStreamOps.h"
+#include "AudioStreamOutAsyncWriter.h"
+#include <utils/Mutex.h>
+#include <time.h>
 
 struct echo_reference_itfe;
 
@@ -73,6 +76,20 @@ public:
     // the output has exited standby
     virtual status_t    getRenderPosition(uint32_t* dspFrames);
 
+    /**
+     * Get the number of frames presented to the DAC since the stream was opened.
+     * Frames are counted in the stream sample specification, written frames still in the
+     * hardware buffer or delayed by the audio conversion are not presented yet. The count
+     * goes on across route changes and standby.
+     *
+     * @param[out] frames number of frames presented.
+     * @param[out] timestamp CLOCK_MONOTONIC time at which the count was valid, given by the
+     *                       audio device.
+     *
+     * @return OK if the count is valid, INVALID_OPERATION if no audio device is running.
+     */
+    status_t            getPresentationPosition(uint64_t *frames, struct timespec *timestamp);
+
     virtual bool        isOut() const { return true; }
 
     status_t            open(int mode);
@@ -128,15 +145,132 @@ public:
      */
     virtual uint32_t    getApplicabilityMask() const { return getFlags(); }
 
+protected:
+    /**
+     * Writes frames within the DMA ring buffer of a device opened in mmap mode.
+     * Frames are either copied, or converted by the audio conversion straight into the ring
+     * buffer, which requires a conversion that keeps the number of frames. The DMA is started
+     * once the start threshold of the route is reached, or once the ring buffer is full.
+     * On a full ring buffer, waits for the DMA as long as it keeps running. The ring buffer is
+     * dropped on underrun only.
+     * Must be called with stream lock held.
+     *
+     * @param[in] buffer frames to write.
+     * @param[in] frames number of frames to write, in the stream sample specification if
+     *                   converted, in the hardware sample specification otherwise.
+     * @param[in] bConvert true to convert the frames within the ring buffer, false to copy them.
+     *
+     * @return number of frames written, negative error code otherwise.
+     */
+    ssize_t             writeMmapFrames(const void *buffer, ssize_t frames, bool bConvert);
+
+    /**
+     * Prepares the device opened in mmap mode again after an error, the frames within the
+     * ring buffer are dropped.
+     * Must be called with stream lock held.
+     */
+    void                recoverMmapL();
+
 private:
     AudioStreamOutALSA(const AudioStreamOutALSA&);
     AudioStreamOutALSA& operator = (const AudioStreamOutALSA&);
 
     size_t              generateSilence(size_t bytes);
 
+    /**
+     * Writes to the current route, see write.
+     * Must be called with stream lock held, and a route available.
+     */
+    ssize_t             writeL(const void *buffer, size_t bytes);
+
     ssize_t             writeFrames(void* buffer, ssize_t frames);
 
-    uint32_t            mFrameCount;
+    /**
+     * Pushes converted frames to the writer thread in asynchronous mode.
+     * Frames that do not fit within the ring buffer of the writer are dropped, as the writer is
+     * late because of a stalled device.
+     * Must be called with stream lock held.
+     *
+     * @param[in] buffer frames in the hardware sample specification.
+     * @param[in] frames number of frames to push.
+     *
+     * @return number of frames consumed.
+     */
+    ssize_t             writeAsyncFramesL(const void *buffer, ssize_t frames);
+
+    /**
+     * Gets the frames written on the current route, by the stream or by the writer thread in
+     * asynchronous mode.
+     * Must be called with stream lock and position lock held.
+     *
+     * @return frames in the hardware sample specification.
+     */
+    uint64_t            getHwFramesWrittenL() const;
+
+    bool                mIsMmap; /**< Device of the current route is opened in mmap mode. */
+    bool                mMmapStarted; /**< DMA started since the device was prepared. */
+    uint32_t            mMmapStartThreshold; /**< Frames to queue before starting the DMA. */
+    uint32_t            mMmapQueuedFrames; /**< Frames queued before starting the DMA. */
+    uint32_t            mMmapWaitTimeMs; /**< Timeout of a wait for room in the ring buffer. */
+
+    /**
+     * Writer thread of the asynchronous mode, NULL if the stream writes synchronously.
+     */
+    AudioStreamOutAsyncWriter *mAsyncWriter;
+    bool                mAsyncStarted; /**< Writer thread drains to the current route. */
+    uint32_t            mAsyncLatencyMs; /**< Latency added by the ring buffer of the writer. */
+
+    /**
+     * Property enabling the asynchronous mode of the output streams.
+     */
+    static const char* const ASYNC_WRITE_PROP_NAME;
+
+    /**
+     * Get the number of frames presented since the stream was opened.
+     * If the audio device does not give the frames still in its buffer, all the written frames
+     * are considered as presented.
+     * Must be called with stream lock held.
+     *
+     * @param[out] frames number of frames presented, in the stream sample specification.
+     * @param[out] timestamp time at which the count was valid.
+     *
+     * @return OK if the frames still in the hardware buffer are known, error code otherwise.
+     */
+    status_t            getPresentedFramesL(uint64_t *frames, struct timespec *timestamp);
+
+    /**
+     * Converts a number of frames in the hardware sample specification into frames in the
+     * stream sample specification, without the size limit of the sample specification helpers
+     * as the frames counts of the stream grow as long as it is opened.
+     * Must be called with stream lock held.
+     *
+     * @param[in] hwFrames frames in the hardware sample specification.
+     *
+     * @return frames in the stream sample specification.
+     */
+    uint64_t            convertHwToStreamFramesL(uint64_t hwFrames) const;
+
+    /**
+     * Protects the frames counts, updated by the write context while the position may be
+     * queried from any context.
+     */
+    android::Mutex      mPositionLock;
+
+    /**
+     * Frames written on the previous routes, in the stream sample specification.
+     */
+    uint64_t            mRouteFramesWritten;
+
+    /**
+     * Frames written on the current route, in the hardware sample specification.
+     */
+    uint64_t            mHwFramesWritten;
+
+    /**
+     * Frames presented when the stream entered standby for the last time, origin of the
+     * render position.
+     */
+    uint64_t            mStandbyFrames;
 
     uint32_t            _flags;
 
@@ -147,7 +281,10 @@ private:
     struct echo_reference_itfe* mEchoReference;
 
     static const uint32_t MAX_AGAIN_RETRY;
-    static const uint32_t WAIT_TIME_MS;
+    /**
+     * Periods the DMA consumes before a wait for room in the ring buffer times out.
+     */
+    static const uint32_t MMAP_WAIT_PERIODS;
     static const uint32_t WAIT_BEFORE_RETRY_US;
     static const uint32_t USEC_PER_MSEC;
 };
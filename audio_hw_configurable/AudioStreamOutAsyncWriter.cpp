@@ -0,0 +1,318 @@
+/*
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#define LOG_TAG "AudioStreamOutAsyncWriter"
+
+#include "AudioStreamOutAsyncWriter.h"
+#include <cutils/atomic.h>
+#include <utils/Log.h>
+#include <utils/Timers.h>
+#include <tinyalsa/asoundlib.h>
+#include <algorithm>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace android;
+
+namespace android_audio_legacy
+{
+
+const int AudioStreamOutAsyncWriter::WRITER_PRIORITY = 2;
+// Writes of a few ms keep the ring buffer draining regularly
+const uint32_t AudioStreamOutAsyncWriter::MAX_WRITE_FRAMES = 1024;
+const uint32_t AudioStreamOutAsyncWriter::WAIT_BEFORE_RETRY_US = 10000;
+const uint32_t AudioStreamOutAsyncWriter::WAIT_FOR_ROOM_TIMEOUT_MS = 500;
+
+AudioStreamOutAsyncWriter::AudioStreamOutAsyncWriter() :
+    _threadStarted(false),
+    _handle(NULL),
+    _request(ENoRequest),
+    _requestStatus(NO_ERROR),
+    _exiting(false),
+    _ringBuffer(NULL),
+    _ringFrames(0),
+    _allocatedBytes(0),
+    _frameSize(0),
+    _sampleRate(0),
+    _writeIndex(0),
+    _readIndex(0),
+    _framesWritten(0)
+{
+    if (pthread_create(&_thread, NULL, writerThread, this) != 0) {
+
+        ALOGE("%s: could not start the writer thread", __FUNCTION__);
+        return;
+    }
+    _threadStarted = true;
+}
+
+AudioStreamOutAsyncWriter::~AudioStreamOutAsyncWriter()
+{
+    stop();
+
+    if (_threadStarted) {
+
+        {
+            Mutex::Autolock lock(_lock);
+            _exiting = true;
+        }
+        _wakeSemaphore.sync();
+        pthread_join(_thread, NULL);
+    }
+    free(_ringBuffer);
+}
+
+status_t AudioStreamOutAsyncWriter::start(pcm *handle, size_t frameSize, uint32_t sampleRate,
+                                          size_t ringFrames)
+{
+    Mutex::Autolock lock(_lock);
+
+    if (ringFrames * frameSize > _allocatedBytes) {
+
+        char *ringBuffer = static_cast<char *>(realloc(_ringBuffer, ringFrames * frameSize));
+        if (ringBuffer == NULL) {
+
+            ALOGE("%s: could not allocate %d frames", __FUNCTION__, ringFrames);
+            return NO_MEMORY;
+        }
+        _ringBuffer = ringBuffer;
+        _allocatedBytes = ringFrames * frameSize;
+    }
+    _frameSize = frameSize;
+    _sampleRate = sampleRate;
+    _ringFrames = ringFrames;
+    _writeIndex = 0;
+    _readIndex = 0;
+    _framesWritten = 0;
+    _handle = handle;
+
+    return NO_ERROR;
+}
+
+void AudioStreamOutAsyncWriter::stop()
+{
+    request(EStopRequest);
+}
+
+status_t AudioStreamOutAsyncWriter::flush()
+{
+    return request(EFlushRequest);
+}
+
+status_t AudioStreamOutAsyncWriter::request(Request request)
+{
+    Mutex::Autolock lock(_lock);
+
+    while (_request != ENoRequest) {
+
+        _requestCond.wait(_lock);
+    }
+    if (_handle == NULL) {
+
+        return NO_ERROR;
+    }
+    _request = request;
+    _wakeSemaphore.sync();
+    while (_request != ERequestServed) {
+
+        _requestCond.wait(_lock);
+    }
+    status_t status = _requestStatus;
+
+    // Next request may be posted
+    _request = ENoRequest;
+    _requestCond.broadcast();
+    return status;
+}
+
+void AudioStreamOutAsyncWriter::serveRequestL()
+{
+    // Pending frames are dropped, the ones pushed from now on are kept if the writer goes on
+    android_atomic_release_store(android_atomic_acquire_load(&_writeIndex), &_readIndex);
+
+    if (_request == EFlushRequest) {
+
+        // Frames queued within the device are dropped as well
+        _requestStatus = pcm_stop(_handle);
+    } else {
+
+        _handle = NULL;
+        _requestStatus = NO_ERROR;
+    }
+    _request = ERequestServed;
+    _requestCond.broadcast();
+    _roomCond.broadcast();
+}
+
+void AudioStreamOutAsyncWriter::waitForRoom(uint32_t durationUs)
+{
+    // Room is mostly there, the indexes tell it without the lock. If the writer is restarted
+    // meanwhile, the room is checked again under the lock.
+    if (hasRoom(durationUs)) {
+
+        return;
+    }
+    Mutex::Autolock lock(_lock);
+
+    nsecs_t timeout = ms2ns(WAIT_FOR_ROOM_TIMEOUT_MS);
+    while (_handle != NULL) {
+
+        if (hasRoom(durationUs)) {
+
+            return;
+        }
+        if (_roomCond.waitRelative(_lock, timeout) != NO_ERROR) {
+
+            ALOGW("%s: audio device stalled, frames will be dropped", __FUNCTION__);
+            return;
+        }
+    }
+}
+
+size_t AudioStreamOutAsyncWriter::push(const void *buffer, size_t frames)
+{
+    if (_ringFrames == 0) {
+
+        return 0;
+    }
+    uint32_t writeIndex = android_atomic_acquire_load(&_writeIndex);
+    uint32_t readIndex = android_atomic_acquire_load(&_readIndex);
+    size_t room = _ringFrames - getDistance(writeIndex, readIndex);
+    frames = std::min(frames, room);
+
+    // Copies in up to two parts, the ring buffer may wrap
+    const char *src = static_cast<const char *>(buffer);
+    size_t offset = getOffset(writeIndex);
+    size_t firstFrames = std::min(frames, _ringFrames - offset);
+    memcpy(_ringBuffer + offset * _frameSize, src, firstFrames * _frameSize);
+    memcpy(_ringBuffer, src + firstFrames * _frameSize, (frames - firstFrames) * _frameSize);
+
+    android_atomic_release_store(advanceIndex(writeIndex, frames), &_writeIndex);
+
+    // Posting wakes up the writer if it sleeps, a post while it writes costs a spurious loop.
+    // Unlike a condition, the post is not lost if the writer is about to sleep.
+    _wakeSemaphore.sync();
+    return frames;
+}
+
+size_t AudioStreamOutAsyncWriter::getPendingFrames() const
+{
+    Mutex::Autolock lock(_lock);
+    return _handle != NULL ? getPendingFramesL() : 0;
+}
+
+uint64_t AudioStreamOutAsyncWriter::getFramesWritten() const
+{
+    Mutex::Autolock lock(_lock);
+    return _framesWritten;
+}
+
+uint32_t AudioStreamOutAsyncWriter::getPendingFramesL() const
+{
+    return getDistance(android_atomic_acquire_load(&_writeIndex),
+                       android_atomic_acquire_load(&_readIndex));
+}
+
+bool AudioStreamOutAsyncWriter::hasRoom(uint32_t durationUs) const
+{
+    // Ring buffer capacity limits the frames waited for, pushes are partial otherwise
+    size_t frames = std::min(static_cast<size_t>(static_cast<uint64_t>(durationUs) *
+                                                 _sampleRate / 1000000),
+                             _ringFrames);
+    return _ringFrames - getPendingFramesL() >= frames;
+}
+
+uint32_t AudioStreamOutAsyncWriter::getDistance(uint32_t writeIndex, uint32_t readIndex) const
+{
+    return writeIndex >= readIndex ? writeIndex - readIndex :
+                                     writeIndex + 2 * _ringFrames - readIndex;
+}
+
+uint32_t AudioStreamOutAsyncWriter::advanceIndex(uint32_t index, size_t frames) const
+{
+    index += frames;
+    return index >= 2 * _ringFrames ? index - 2 * _ringFrames : index;
+}
+
+size_t AudioStreamOutAsyncWriter::getOffset(uint32_t index) const
+{
+    return index >= _ringFrames ? index - _ringFrames : index;
+}
+
+void *AudioStreamOutAsyncWriter::writerThread(void *context)
+{
+    struct sched_param param;
+    param.sched_priority = WRITER_PRIORITY;
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+
+        ALOGW("%s: SCHED_FIFO not allowed, writer runs with the default policy", __FUNCTION__);
+    }
+    static_cast<AudioStreamOutAsyncWriter *>(context)->drain();
+    return NULL;
+}
+
+void AudioStreamOutAsyncWriter::drain()
+{
+    Mutex::Autolock lock(_lock);
+
+    while (!_exiting) {
+
+        if (_request == EStopRequest || _request == EFlushRequest) {
+
+            serveRequestL();
+            continue;
+        }
+        uint32_t pendingFrames = getPendingFramesL();
+        if (_handle == NULL || pendingFrames == 0) {
+
+            _lock.unlock();
+            _wakeSemaphore.wait();
+            _lock.lock();
+            continue;
+        }
+        pcm *handle = _handle;
+        uint32_t readIndex = android_atomic_acquire_load(&_readIndex);
+        size_t offset = getOffset(readIndex);
+        size_t frames = std::min(std::min(static_cast<size_t>(pendingFrames),
+                                          _ringFrames - offset),
+                                 static_cast<size_t>(MAX_WRITE_FRAMES));
+        const char *frameBuffer = _ringBuffer + offset * _frameSize;
+
+        // Device may block up to a period, the lock is released so that the stream may query
+        // the writer and post a request meanwhile. A stopped device is started again.
+        _lock.unlock();
+        int ret = pcm_write(handle, frameBuffer, frames * _frameSize);
+        _lock.lock();
+
+        android_atomic_release_store(advanceIndex(readIndex, frames), &_readIndex);
+        if (ret == 0) {
+
+            _framesWritten += frames;
+        } else {
+
+            // Frames are dropped, the stream keeps on pushing at its own pace
+            ALOGE("%s: write error: %d %s", __FUNCTION__, ret, pcm_get_error(handle));
+            _lock.unlock();
+            usleep(WAIT_BEFORE_RETRY_US);
+            _lock.lock();
+        }
+        _roomCond.broadcast();
+    }
+}
+
+}       // namespace android
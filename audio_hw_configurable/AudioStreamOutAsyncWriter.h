@@ -0,0 +1,242 @@
+/*
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+#pragma once
+
+#include "SyncSemaphore.h"
+#include <utils/Condition.h>
+#include <utils/Errors.h>
+#include <utils/Mutex.h>
+#include <pthread.h>
+#include <stdint.h>
+
+struct pcm;
+
+namespace android_audio_legacy
+{
+
+/**
+ * Writer thread of an output stream in asynchronous mode.
+ * The stream pushes the converted frames within a single producer single consumer ring buffer,
+ * without blocking on the audio device. The writer thread, running in SCHED_FIFO if allowed,
+ * drains the ring buffer to the audio device. Indexes of the ring buffer are shared with
+ * atomic loads and stores. The writer thread sleeps on a semaphore the stream posts on push, so
+ * that the stream never takes the lock of the writer to push frames or to check the room.
+ * Indexes run modulo twice the capacity, so that a full ring buffer is told from an empty one
+ * whatever its capacity: the capacity is the one of the hardware buffer, seldom a power of 2.
+ * While draining, the audio device is only called by the writer thread: stop and flush are
+ * requests the writer thread serves between two writes, the caller waits for their
+ * acknowledgement, ie for the time of a write at most.
+ */
+class AudioStreamOutAsyncWriter
+{
+public:
+    AudioStreamOutAsyncWriter();
+    ~AudioStreamOutAsyncWriter();
+
+    /**
+     * Checks if the writer thread is running, ie if the asynchronous mode can be used.
+     *
+     * @return true if running, false otherwise.
+     */
+    bool isRunning() const { return _threadStarted; }
+
+    /**
+     * Starts draining the ring buffer to an audio device. The ring buffer is allocated if it
+     * is smaller than requested, and emptied.
+     * Must be called with the writer stopped, and with stream lock held for writing, or for
+     * reading by the stream context.
+     *
+     * @param[in] handle audio device, opened and prepared.
+     * @param[in] frameSize size of a frame of the device in bytes.
+     * @param[in] sampleRate sample rate of the device.
+     * @param[in] ringFrames capacity of the ring buffer in frames.
+     *
+     * @return OK if started, NO_MEMORY if the ring buffer could not be allocated.
+     */
+    android::status_t start(pcm *handle, size_t frameSize, uint32_t sampleRate,
+                            size_t ringFrames);
+
+    /**
+     * Stops draining the ring buffer, the frames pending within are dropped.
+     * The writer thread serves the request once its current write is over. On return, it does
+     * not use the audio device any more.
+     * Must be called with stream lock held for writing, or for reading by the stream context.
+     */
+    void stop();
+
+    /**
+     * Drops the frames pending within the ring buffer and within the audio device.
+     * The writer thread serves the request once its current write is over: it stops the device,
+     * which its next write starts again. Does nothing if the writer is stopped.
+     * May be called without the stream lock held.
+     *
+     * @return status of the stop of the device.
+     */
+    android::status_t flush();
+
+    /**
+     * Waits until the ring buffer has room for a duration of frames, or until the writer is
+     * stopped. The lock of the writer is only taken if the room is short.
+     * Must be called without the stream lock held, so that a route change can stop the writer
+     * meanwhile.
+     *
+     * @param[in] durationUs duration of the frames to push, in microseconds.
+     */
+    void waitForRoom(uint32_t durationUs);
+
+    /**
+     * Pushes frames within the ring buffer, and wakes up the writer thread. Never blocks, and
+     * never takes the lock of the writer.
+     * Must be called with stream lock held.
+     *
+     * @param[in] buffer frames in the sample specification of the device.
+     * @param[in] frames number of frames to push.
+     *
+     * @return number of frames pushed, less than requested if the ring buffer is full.
+     */
+    size_t push(const void *buffer, size_t frames);
+
+    /**
+     * Gets the number of frames pushed and not yet written to the audio device.
+     *
+     * @return pending frames.
+     */
+    size_t getPendingFrames() const;
+
+    /**
+     * Gets the number of frames written to the audio device since the writer was started.
+     *
+     * @return written frames.
+     */
+    uint64_t getFramesWritten() const;
+
+private:
+    AudioStreamOutAsyncWriter(const AudioStreamOutAsyncWriter &);
+    AudioStreamOutAsyncWriter &operator=(const AudioStreamOutAsyncWriter &);
+
+    /** Requests served by the writer thread. */
+    enum Request {
+
+        ENoRequest,
+        EStopRequest,
+        EFlushRequest,
+        ERequestServed
+    };
+
+    /**
+     * Posts a request to the writer thread, and waits until it is served.
+     * Requests are served one after the other.
+     *
+     * @param[in] request stop or flush request.
+     *
+     * @return status of the request, OK if the writer is stopped.
+     */
+    android::status_t request(Request request);
+
+    /**
+     * Serves the pending request, from the writer thread.
+     */
+    void serveRequestL();
+
+    /**
+     * Entry point of the writer thread.
+     *
+     * @param[in] context writer instance.
+     */
+    static void *writerThread(void *context);
+
+    /**
+     * Loop of the writer thread, drains the ring buffer until the writer is destroyed.
+     */
+    void drain();
+
+    /**
+     * Gets the frames pushed and not yet written, from the indexes of the ring buffer.
+     *
+     * @return pending frames.
+     */
+    uint32_t getPendingFramesL() const;
+
+    /**
+     * Checks if the ring buffer has room for a duration of frames, from the indexes of the ring
+     * buffer.
+     *
+     * @param[in] durationUs duration of the frames to push, in microseconds.
+     *
+     * @return true if the frames fit, false otherwise.
+     */
+    bool hasRoom(uint32_t durationUs) const;
+
+    /**
+     * Gets the frames between two indexes of the ring buffer.
+     *
+     * @param[in] writeIndex index of the frames pushed.
+     * @param[in] readIndex index of the frames written, not after writeIndex.
+     *
+     * @return frames from readIndex to writeIndex.
+     */
+    uint32_t getDistance(uint32_t writeIndex, uint32_t readIndex) const;
+
+    /**
+     * Moves an index of the ring buffer forward.
+     *
+     * @param[in] index index to move.
+     * @param[in] frames frames to move by, not more than the capacity.
+     *
+     * @return moved index, modulo twice the capacity.
+     */
+    uint32_t advanceIndex(uint32_t index, size_t frames) const;
+
+    /**
+     * Gets the frame of the ring buffer an index refers to.
+     *
+     * @param[in] index index of the ring buffer.
+     *
+     * @return offset in frames within the ring buffer.
+     */
+    size_t getOffset(uint32_t index) const;
+
+    pthread_t _thread; /**< Writer thread. */
+    bool _threadStarted; /**< Writer thread is running. */
+
+    mutable android::Mutex _lock; /**< Protects the state of the writer, not the frames. */
+    CSyncSemaphore _wakeSemaphore; /**< Posted when frames are pushed or the writer exits. */
+    android::Condition _roomCond; /**< Signaled when frames are written or the writer stops. */
+    android::Condition _requestCond; /**< Signaled when a request is served or released. */
+
+    pcm *_handle; /**< Audio device drained, NULL if stopped. */
+    Request _request; /**< Request posted to the writer thread. */
+    android::status_t _requestStatus; /**< Status of the request served. */
+    bool _exiting; /**< Writer thread must exit. */
+
+    char *_ringBuffer; /**< Frames of the ring buffer. */
+    size_t _ringFrames; /**< Capacity of the ring buffer in frames. */
+    size_t _allocatedBytes; /**< Bytes allocated for the ring buffer. */
+    size_t _frameSize; /**< Size of a frame in bytes. */
+    uint32_t _sampleRate; /**< Sample rate of the frames. */
+
+    volatile int32_t _writeIndex; /**< Index of the frames pushed, set by the stream only. */
+    volatile int32_t _readIndex; /**< Index of the frames written, set by the writer only. */
+
+    uint64_t _framesWritten; /**< Frames written to the audio device since start. */
+
+    static const int WRITER_PRIORITY; /**< SCHED_FIFO priority of the writer thread. */
+    static const uint32_t MAX_WRITE_FRAMES; /**< Frames written to the device at once. */
+    static const uint32_t WAIT_BEFORE_RETRY_US; /**< Wait after an error of the device. */
+    static const uint32_t WAIT_FOR_ROOM_TIMEOUT_MS; /**< Wait for a stalled device. */
+};
+
+};        // namespace android
@@ -31,6 +31,8 @@
 #ifdef ENABLE_AUDIO_DUMP
 #include "AudioDumpInterface.h"
 #include <utils/String8.h>
+#else
+#include "AudioStreamOutALSA.h"
 #endif
 
 namespace android_audio_legacy {
@@ -251,6 +253,18 @@ static int out_get_render_position(const struct audio_stream_out *stream,
     return out->legacy_out->getRenderPosition(dsp_frames);
 }
 
+#ifndef ENABLE_AUDIO_DUMP
+static int out_get_presentation_position(const struct audio_stream_out *stream,
+                                         uint64_t *frames, struct timespec *timestamp)
+{
+    const struct legacy_stream_out *out =
+        reinterpret_cast<const struct legacy_stream_out *>(stream);
+    // Legacy interface has no presentation position, output streams are all ALSA streams
+    return static_cast<AudioStreamOutALSA *>(out->legacy_out)->getPresentationPosition(frames,
+                                                                                       timestamp);
+}
+#endif
+
 static int out_get_next_write_timestamp(const struct audio_stream_out *stream,
                                         int64_t *timestamp)
 {
@@ -534,6 +548,9 @@ static int adev_open_output_stream(struct audio_hw_device *dev,
     out->stream.write = out_write;
     out->stream.get_render_position = out_get_render_position;
     out->stream.get_next_write_timestamp = out_get_next_write_timestamp;
+#ifndef ENABLE_AUDIO_DUMP
+    out->stream.get_presentation_position = out_get_presentation_position;
+#endif
     out->stream.flush = out_flush;
 
     *stream_out = &out->stream;
@@ -163,6 +163,9 @@ public:
     static const pcm_config& getRoutePcmConfig(int iRouteIndex, bool bIsOut) {
         return _astAudioRoutes[iRouteIndex].astPcmConfig[bIsOut];
     }
+    static bool isRouteMmapPlayback(int iRouteIndex) {
+        return _astAudioRoutes[iRouteIndex].bMmapPlayback;
+    }
     static uint32_t getSlaveRoutes(int iRouteIndex) {
 
         std::string srtSlaveRoutes(_astAudioRoutes[iRouteIndex].pcSlaveRoutes);
@@ -210,15 +213,10 @@ public:
     // Property name indicating time to write silence before first write
     static const char* CODEC_DELAY_PROP_NAME;
 
-    static const vector<SampleSpec::ChannelsPolicy> getChannelsPolicy(int iRouteIndex,
-                                                                      bool bIsOut) {
-
-        std::vector<SampleSpec::ChannelsPolicy> channelsPolicyVector(
-                    _astAudioRoutes[iRouteIndex].aChannelsPolicy[bIsOut],
-                    _astAudioRoutes[iRouteIndex].aChannelsPolicy[bIsOut] +
-                            getRoutePcmConfig(iRouteIndex, bIsOut).channels);
+    // Policy of each channel of the route, as many entries as channels of its pcm configuration
+    static const SampleSpec::ChannelsPolicy *getChannelsPolicy(int iRouteIndex, bool bIsOut) {
 
-        return channelsPolicyVector;
+        return _astAudioRoutes[iRouteIndex].aChannelsPolicy[bIsOut];
     }
 
     /**
@@ -229,21 +227,31 @@ public:
      *
      * @param[in] bIsOut direction of the stream requesting the configuration
      * @param[in] uiFlags only valid for output stream, depends on flag, might use different
-     *                    buffering model.
+     *                    buffering model: deep buffer first, then low latency (fast).
+     *                    Platforms without such a route fall back to the media playback one.
      *
      * @return reference of default pcm_config
      */
     static const pcm_config& getDefaultPcmConfig(bool bIsOut, uint32_t uiFlags)
     {
-        bool bIsDeepFlag = uiFlags & AUDIO_OUTPUT_FLAG_DEEP_BUFFER;
-        return bIsOut ?
-                    (bIsDeepFlag ?
-                         pcm_config_deep_media_playback : pcm_config_media_playback) :
-                    pcm_config_media_capture;
+        if (!bIsOut) {
+
+            return pcm_config_media_capture;
+        }
+        if ((uiFlags & AUDIO_OUTPUT_FLAG_DEEP_BUFFER) &&
+                pcm_config_deep_media_playback.period_size != 0) {
+
+            return pcm_config_deep_media_playback;
+        }
+        if ((uiFlags & AUDIO_OUTPUT_FLAG_FAST) && pcm_config_fast_media_playback.period_size != 0) {
+
+            return pcm_config_fast_media_playback;
+        }
+        return pcm_config_media_playback;
     }
 
 private:
-    static const uint32_t MAX_CHANNELS = 32;
+    static const uint32_t MAX_CHANNELS = SampleSpec::MAX_CHANNELS;
 
     struct s_route_t {
 
@@ -271,6 +279,8 @@ private:
         SampleSpec::ChannelsPolicy aChannelsPolicy[CUtils::ENbDirections][MAX_CHANNELS];
         /**< Literal coma list separated of slave routes */
         const char* pcSlaveRoutes;
+        /**< Playback device opened in mmap mode, streams write within the DMA ring buffer */
+        bool bMmapPlayback;
     };
 
     static const uint32_t _uiNbPorts;
@@ -290,5 +300,7 @@ private:
     static const pcm_config pcm_config_media_capture;
 
     static const pcm_config pcm_config_deep_media_playback;
+
+    static const pcm_config pcm_config_fast_media_playback;
 };
 };        // namespace android
@@ -47,6 +47,8 @@ namespace android_audio_legacy
 // first frame.
 const pcm_config CAudioPlatformHardware::pcm_config_deep_media_playback = pcm_config_not_applicable;
 
+const pcm_config CAudioPlatformHardware::pcm_config_fast_media_playback = pcm_config_not_applicable;
+
 const pcm_config CAudioPlatformHardware::pcm_config_media_playback = {
    channels          : 2,
    rate              : SAMPLE_RATE_48000,
@@ -129,7 +131,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             { SampleSpec::Copy, SampleSpec::Copy },
             { SampleSpec::Copy, SampleSpec::Copy }
         },
-        ""
+        "",
+        false
     },
 
     ////////////////////////////////////////////////////////////////////////
@@ -168,7 +171,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             channel_policy_not_applicable,
             channel_policy_not_applicable
         },
-        "Media"
+        "Media",
+        false
     }
 };
 
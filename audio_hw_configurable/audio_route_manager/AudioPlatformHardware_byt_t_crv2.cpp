@@ -21,6 +21,7 @@
 
 #define DEEP_PLAYBACK_PERIOD_TIME_MS    ((int)96)
 #define PLAYBACK_PERIOD_TIME_MS         ((int)24)
+#define FAST_PLAYBACK_PERIOD_TIME_MS    ((int)5)
 #define VOICE_PERIOD_TIME_MS            ((int)20)
 
 #define LONG_PERIOD_FACTOR              ((int)2)
@@ -35,12 +36,14 @@
 #define VOICE_8000_PERIOD_SIZE          ((int)VOICE_PERIOD_TIME_MS * SAMPLE_RATE_8000 / SEC_PER_MSEC)
 #define DEEP_PLAYBACK_48000_PERIOD_SIZE ((int)DEEP_PLAYBACK_PERIOD_TIME_MS * SAMPLE_RATE_48000 / SEC_PER_MSEC)
 #define PLAYBACK_48000_PERIOD_SIZE      ((int)PLAYBACK_PERIOD_TIME_MS * SAMPLE_RATE_48000 / SEC_PER_MSEC)
+#define FAST_PLAYBACK_48000_PERIOD_SIZE ((int)FAST_PLAYBACK_PERIOD_TIME_MS * SAMPLE_RATE_48000 / SEC_PER_MSEC)
 #define CAPTURE_48000_PERIOD_SIZE       ((int)VOICE_PERIOD_TIME_MS * SAMPLE_RATE_48000 / SEC_PER_MSEC)
 #define VOICE_48000_PERIOD_SIZE         ((int)VOICE_PERIOD_TIME_MS * SAMPLE_RATE_48000 / SEC_PER_MSEC)
 
 static const char* MEDIA_CARD_NAME = "baytrailaudio";
 #define DEEP_MEDIA_PLAYBACK_DEVICE_ID   ((int)0)
 #define MEDIA_PLAYBACK_DEVICE_ID        ((int)0)
+#define FAST_MEDIA_PLAYBACK_DEVICE_ID   ((int)0)
 #define MEDIA_CAPTURE_DEVICE_ID         ((int)0)
 
 static const char* VOICE_CARD_NAME = "baytrailaudio";
@@ -67,6 +70,18 @@ const pcm_config CAudioPlatformHardware::pcm_config_deep_media_playback = {
     avail_min         : DEEP_PLAYBACK_48000_PERIOD_SIZE,
 };
 
+const pcm_config CAudioPlatformHardware::pcm_config_fast_media_playback = {
+    channels          : 2,
+    rate              : SAMPLE_RATE_48000,
+    period_size       : FAST_PLAYBACK_48000_PERIOD_SIZE,
+    period_count      : NB_RING_BUFFER,
+    format            : PCM_FORMAT_S16_LE,
+    start_threshold   : FAST_PLAYBACK_48000_PERIOD_SIZE,
+    stop_threshold    : FAST_PLAYBACK_48000_PERIOD_SIZE * NB_RING_BUFFER,
+    silence_threshold : 0,
+    avail_min         : FAST_PLAYBACK_48000_PERIOD_SIZE,
+};
+
 const pcm_config CAudioPlatformHardware::pcm_config_media_playback = {
     channels          : 2,
     rate              : SAMPLE_RATE_48000,
@@ -136,6 +151,39 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
     // Streams routes
     //
     ////////////////////////////////////////////////////////////////////////
+    {
+        "FastMedia",
+        CAudioRoute::EStreamRoute,
+        "",
+        {
+            NOT_APPLICABLE,
+            DEVICE_OUT_MM_ALL
+        },
+        {
+            NOT_APPLICABLE,
+            AUDIO_OUTPUT_FLAG_FAST
+        },
+        {
+            NOT_APPLICABLE,
+            (1 << AudioSystem::MODE_NORMAL) | (1 << AudioSystem::MODE_RINGTONE) |
+            (1 << AudioSystem::MODE_IN_COMMUNICATION)
+        },
+        MEDIA_CARD_NAME,
+        {
+            NOT_APPLICABLE,
+            FAST_MEDIA_PLAYBACK_DEVICE_ID
+        },
+        {
+            pcm_config_not_applicable,
+            CAudioPlatformHardware::pcm_config_fast_media_playback
+        },
+        {
+            { SampleSpec::Copy, SampleSpec::Copy },
+            { SampleSpec::Copy, SampleSpec::Copy }
+        },
+        "",
+        true
+    },
     {
         "Media",
         CAudioRoute::EStreamRoute,
@@ -168,7 +216,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             { SampleSpec::Copy, SampleSpec::Copy },
             { SampleSpec::Copy, SampleSpec::Copy }
         },
-        ""
+        "",
+        false
     },
     {
         "DeepMedia",
@@ -200,7 +249,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             { SampleSpec::Copy, SampleSpec::Copy },
             { SampleSpec::Copy, SampleSpec::Copy }
         },
-        ""
+        "",
+        false
     },
     {
         "CompressedMedia",
@@ -231,7 +281,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             channel_policy_not_applicable,
             channel_policy_not_applicable
         },
-        ""
+        "",
+        false
     },
     {
         "BtComm",
@@ -263,7 +314,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             { SampleSpec::Copy, SampleSpec::Copy },
             { SampleSpec::Copy, SampleSpec::Copy }
         },
-        ""
+        "",
+        false
     },
     ////////////////////////////////////////////////////////////////////////
     //
@@ -301,7 +353,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             channel_policy_not_applicable,
             channel_policy_not_applicable
         },
-        "CompressedMedia,Media,DeepMedia"
+        "CompressedMedia,Media,DeepMedia,FastMedia",
+        false
     }
 };
 
@@ -406,6 +459,10 @@ CAudioRoute* CAudioPlatformHardware::createAudioRoute(uint32_t uiRouteIndex,
 
         return new CAudioStreamRoute(uiRouteIndex, pPlatformState);
 
+    } else if (strName == "FastMedia") {
+
+        return new CAudioStreamRoute(uiRouteIndex, pPlatformState);
+
     } else if (strName == "CompressedMedia") {
 
         return new CAudioCompressedStreamRoute(uiRouteIndex, pPlatformState);
@@ -23,6 +23,7 @@
 
 #define DEEP_PLAYBACK_PERIOD_TIME_MS    ((int)96)
 #define PLAYBACK_PERIOD_TIME_MS         ((int)24)
+#define FAST_PLAYBACK_PERIOD_TIME_MS    ((int)5)
 #define CAPTURE_PERIOD_TIME_MS          ((int)24)
 #define VOICE_PERIOD_TIME_MS            ((int)20)
 
@@ -37,12 +38,14 @@
 #define VOICE_48000_PERIOD_SIZE         ((int)VOICE_PERIOD_TIME_MS * SAMPLE_RATE_48000 / MSEC_PER_SEC)
 #define DEEP_PLAYBACK_48000_PERIOD_SIZE ((int)DEEP_PLAYBACK_PERIOD_TIME_MS * LONG_PERIOD_FACTOR * SAMPLE_RATE_48000 / MSEC_PER_SEC)
 #define PLAYBACK_48000_PERIOD_SIZE      ((int)PLAYBACK_PERIOD_TIME_MS * SAMPLE_RATE_48000 / MSEC_PER_SEC)
+#define FAST_PLAYBACK_48000_PERIOD_SIZE ((int)FAST_PLAYBACK_PERIOD_TIME_MS * SAMPLE_RATE_48000 / MSEC_PER_SEC)
 #define CAPTURE_48000_PERIOD_SIZE       ((int)CAPTURE_PERIOD_TIME_MS * SAMPLE_RATE_48000 / MSEC_PER_SEC)
 
 
 static const char* MEDIA_CARD_NAME = "cloverviewaudio";
 #define DEEP_MEDIA_PLAYBACK_DEVICE_ID   ((int)0)
 #define MEDIA_PLAYBACK_DEVICE_ID        ((int)0)
+#define FAST_MEDIA_PLAYBACK_DEVICE_ID   ((int)0)
 #define MEDIA_CAPTURE_DEVICE_ID         ((int)0)
 
 
@@ -77,6 +80,18 @@ const pcm_config CAudioPlatformHardware::pcm_config_deep_media_playback = {
    avail_min         : DEEP_PLAYBACK_48000_PERIOD_SIZE,
 };
 
+const pcm_config CAudioPlatformHardware::pcm_config_fast_media_playback = {
+    channels            : 2,
+    rate                : SAMPLE_RATE_48000,
+    period_size         : FAST_PLAYBACK_48000_PERIOD_SIZE,
+    period_count        : NB_RING_BUFFER,
+    format              : PCM_FORMAT_S16_LE,
+    start_threshold     : FAST_PLAYBACK_48000_PERIOD_SIZE,
+    stop_threshold      : FAST_PLAYBACK_48000_PERIOD_SIZE * NB_RING_BUFFER,
+    silence_threshold   : 0,
+    avail_min           : FAST_PLAYBACK_48000_PERIOD_SIZE,
+};
+
 const pcm_config CAudioPlatformHardware::pcm_config_media_playback = {
     channels            : 2,
     rate                : SAMPLE_RATE_48000,
@@ -154,6 +169,39 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
     //
     // MEDIA Route
     //
+    {
+        "FastMedia",
+        CAudioRoute::EStreamRoute,
+        "",
+        {
+            NOT_APPLICABLE,
+            DEVICE_OUT_MM_ALL
+        },
+        {
+            NOT_APPLICABLE,
+            AUDIO_OUTPUT_FLAG_FAST
+        },
+        {
+            NOT_APPLICABLE,
+            (1 << AudioSystem::MODE_NORMAL) | (1 << AudioSystem::MODE_RINGTONE) |
+                                                    (1 << AudioSystem::MODE_IN_COMMUNICATION),
+        },
+        MEDIA_CARD_NAME,
+        {
+            NOT_APPLICABLE,
+            FAST_MEDIA_PLAYBACK_DEVICE_ID
+        },
+        {
+            pcm_config_not_applicable,
+            CAudioPlatformHardware::pcm_config_fast_media_playback
+        },
+        {
+            channel_policy_not_applicable,
+            { SampleSpec::Copy, SampleSpec::Copy }
+        },
+        "",
+        true
+    },
     {
         "Media",
         CAudioRoute::EStreamRoute,
@@ -186,7 +234,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             { SampleSpec::Copy, SampleSpec::Copy },
             { SampleSpec::Copy, SampleSpec::Copy }
         },
-        ""
+        "",
+        false
     },
     //
     // Deep Media Route
@@ -221,7 +270,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             channel_policy_not_applicable,
             { SampleSpec::Copy, SampleSpec::Copy }
         },
-        ""
+        "",
+        false
     },
     //
     // Compressed Media Route
@@ -256,7 +306,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             channel_policy_not_applicable,
             { SampleSpec::Copy, SampleSpec::Copy }
         },
-        ""
+        "",
+        false
     },
     {
         "ModemMix",
@@ -290,7 +341,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             { SampleSpec::Copy, SampleSpec::Copy },
             { SampleSpec::Average, SampleSpec::Ignore }
         },
-        ""
+        "",
+        false
     },
     ////////////////////////////////////////////////////////////////////////
     //
@@ -331,7 +383,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             channel_policy_not_applicable,
             channel_policy_not_applicable
         },
-        "CompressedMedia,Media,DeepMedia"
+        "CompressedMedia,Media,DeepMedia,FastMedia",
+        false
     },
     {
         "HwCodecBt",
@@ -362,7 +415,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             channel_policy_not_applicable,
             channel_policy_not_applicable
         },
-        "HwCodecCSV,Media,DeepMedia,CompressedMedia"
+        "HwCodecCSV,Media,DeepMedia,FastMedia,CompressedMedia",
+        false
     },
     {
         "HwCodecCSV",
@@ -393,7 +447,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             channel_policy_not_applicable,
             channel_policy_not_applicable
         },
-        ""
+        "",
+        false
     },
     {
         "VirtualASP",
@@ -424,7 +479,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             channel_policy_not_applicable,
             channel_policy_not_applicable
         },
-        ""
+        "",
+        false
     }
 };
 
@@ -612,6 +668,10 @@ CAudioRoute* CAudioPlatformHardware::createAudioRoute(uint32_t uiRouteIndex, CAu
 
         return new CAudioStreamRouteMedia(uiRouteIndex, pPlatformState);
 
+    } else if (strName == "FastMedia") {
+
+        return new CAudioStreamRouteMedia(uiRouteIndex, pPlatformState);
+
     } else if (strName == "CompressedMedia") {
 
         return new CAudioCompressedStreamRoute(uiRouteIndex, pPlatformState);
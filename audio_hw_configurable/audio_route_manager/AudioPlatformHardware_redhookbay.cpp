@@ -27,6 +27,7 @@
 
 #define DEEP_PLAYBACK_PERIOD_TIME_MS    ((int)96)
 #define PLAYBACK_PERIOD_TIME_MS         ((int)24)
+#define FAST_PLAYBACK_PERIOD_TIME_MS    ((int)5)
 #define VOICE_PERIOD_TIME_MS            ((int)20)
 
 #define LONG_PERIOD_FACTOR              ((int)2)
@@ -41,12 +42,14 @@
 #define VOICE_8000_PERIOD_SIZE          ((int)VOICE_PERIOD_TIME_MS * SAMPLE_RATE_8000 / MSEC_PER_SEC)
 #define DEEP_PLAYBACK_48000_PERIOD_SIZE ((int)DEEP_PLAYBACK_PERIOD_TIME_MS * SAMPLE_RATE_48000 / MSEC_PER_SEC)
 #define PLAYBACK_48000_PERIOD_SIZE      ((int)PLAYBACK_PERIOD_TIME_MS * SAMPLE_RATE_48000 / MSEC_PER_SEC)
+#define FAST_PLAYBACK_48000_PERIOD_SIZE ((int)FAST_PLAYBACK_PERIOD_TIME_MS * SAMPLE_RATE_48000 / MSEC_PER_SEC)
 #define CAPTURE_48000_PERIOD_SIZE       ((int)VOICE_PERIOD_TIME_MS * SAMPLE_RATE_48000 / MSEC_PER_SEC)
 #define VOICE_48000_PERIOD_SIZE         ((int)VOICE_PERIOD_TIME_MS * SAMPLE_RATE_48000 / MSEC_PER_SEC)
 
 static const char* MEDIA_CARD_NAME = "cloverviewaudio";
 #define DEEP_MEDIA_PLAYBACK_DEVICE_ID   ((int)0)
 #define MEDIA_PLAYBACK_DEVICE_ID        ((int)0)
+#define FAST_MEDIA_PLAYBACK_DEVICE_ID   ((int)0)
 #define MEDIA_CAPTURE_DEVICE_ID         ((int)0)
 
 static const char* VOICE_MIXING_CARD_NAME = "cloverviewaudio";
@@ -80,6 +83,18 @@ const pcm_config CAudioPlatformHardware::pcm_config_deep_media_playback = {
    avail_min         : DEEP_PLAYBACK_48000_PERIOD_SIZE,
 };
 
+const pcm_config CAudioPlatformHardware::pcm_config_fast_media_playback = {
+   channels          : 2,
+   rate              : SAMPLE_RATE_48000,
+   period_size       : FAST_PLAYBACK_48000_PERIOD_SIZE,
+   period_count      : NB_RING_BUFFER,
+   format            : PCM_FORMAT_S16_LE,
+   start_threshold   : FAST_PLAYBACK_48000_PERIOD_SIZE,
+   stop_threshold    : FAST_PLAYBACK_48000_PERIOD_SIZE * NB_RING_BUFFER,
+   silence_threshold : 0,
+   avail_min         : FAST_PLAYBACK_48000_PERIOD_SIZE,
+};
+
 const pcm_config CAudioPlatformHardware::pcm_config_media_playback = {
    channels          : 2,
    rate              : SAMPLE_RATE_48000,
@@ -213,6 +228,38 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
     // Streams routes
     //
     ////////////////////////////////////////////////////////////////////////
+    {
+        "FastMedia",
+        CAudioRoute::EStreamRoute,
+        "",
+        {
+            NOT_APPLICABLE,
+            DEVICE_OUT_MM_ALL
+        },
+        {
+            NOT_APPLICABLE,
+            AUDIO_OUTPUT_FLAG_FAST
+        },
+        {
+            NOT_APPLICABLE,
+            (1 << AudioSystem::MODE_NORMAL)
+        },
+        MEDIA_CARD_NAME,
+        {
+            NOT_APPLICABLE,
+            FAST_MEDIA_PLAYBACK_DEVICE_ID
+        },
+        {
+            pcm_config_not_applicable,
+            CAudioPlatformHardware::pcm_config_fast_media_playback
+        },
+        {
+            { SampleSpec::Copy, SampleSpec::Copy },
+            { SampleSpec::Copy, SampleSpec::Copy }
+        },
+        "",
+        true
+    },
     {
         "Media",
         CAudioRoute::EStreamRoute,
@@ -243,7 +290,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             { SampleSpec::Copy, SampleSpec::Copy },
             { SampleSpec::Copy, SampleSpec::Copy }
         },
-        ""
+        "",
+        false
     },
     {
         "DeepMedia",
@@ -274,7 +322,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             { SampleSpec::Copy, SampleSpec::Copy },
             { SampleSpec::Copy, SampleSpec::Copy }
         },
-        ""
+        "",
+        false
     },
     {
         "CompressedMedia",
@@ -305,7 +354,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             channel_policy_not_applicable,
             channel_policy_not_applicable
         },
-        ""
+        "",
+        false
     },
     {
         "ModemMix",
@@ -339,7 +389,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             { SampleSpec::Copy, SampleSpec::Copy },
             { SampleSpec::Average, SampleSpec::Ignore }
         },
-        ""
+        "",
+        false
     },
     {
         "HwCodecComm",
@@ -370,7 +421,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             { SampleSpec::Copy, SampleSpec::Copy },
             { SampleSpec::Copy, SampleSpec::Copy }
         },
-        ""
+        "",
+        false
     },
     {
         "BtComm",
@@ -401,7 +453,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             { SampleSpec::Copy, SampleSpec::Copy },
             { SampleSpec::Copy, SampleSpec::Copy }
         },
-        ""
+        "",
+        false
     },
     ////////////////////////////////////////////////////////////////////////
     //
@@ -437,7 +490,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             channel_policy_not_applicable,
             channel_policy_not_applicable
         },
-        "CompressedMedia,Media,DeepMedia"
+        "CompressedMedia,Media,DeepMedia,FastMedia",
+        false
     },
     {
         "HwCodecCSV",
@@ -468,7 +522,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             channel_policy_not_applicable,
             channel_policy_not_applicable
         },
-        ""
+        "",
+        false
     },
     {
         "BtCSV",
@@ -499,7 +554,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             channel_policy_not_applicable,
             channel_policy_not_applicable
         },
-        ""
+        "",
+        false
     },
     {
         "HwCodecFm",
@@ -530,7 +586,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             channel_policy_not_applicable,
             channel_policy_not_applicable
         },
-        ""
+        "",
+        false
     },
     {
         "VirtualASP",
@@ -561,7 +618,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             channel_policy_not_applicable,
             channel_policy_not_applicable
         },
-        ""
+        "",
+        false
     }
 };
 
@@ -858,6 +916,10 @@ CAudioRoute* CAudioPlatformHardware::createAudioRoute(uint32_t uiRouteIndex, CAu
 
         return new CAudioStreamRouteMedia(uiRouteIndex, pPlatformState);
 
+    } else if (strName == "FastMedia") {
+
+        return new CAudioStreamRouteMedia(uiRouteIndex, pPlatformState);
+
     } else if (strName == "CompressedMedia") {
 
         return new CAudioCompressedStreamRoute(uiRouteIndex, pPlatformState);
@@ -30,6 +30,11 @@ using audio_comms::utilities::BitField;
  *  boundary. This is the best optimized size for a buffer in the LPE.
  */
 #define PLAYBACK_PERIOD_TIME_MS         ((int)24)
+/**
+ *  5 ms makes a PCM frames count of 240 which is aligned on a 16-frames
+ *  boundary. Small periods for low latency playback.
+ */
+#define FAST_PLAYBACK_PERIOD_TIME_MS    ((int)5)
 /**
  *  96 ms makes a PCM frames count of 4608 which is aligned on a 16-frames
  *  boundary. This is the best optimized size for a buffer in the LPE for DB.
@@ -60,6 +65,10 @@ using audio_comms::utilities::BitField;
  * Media playback period size of 1152 frames
  */
 #define PLAYBACK_48000_PERIOD_SIZE      ((int)PLAYBACK_PERIOD_TIME_MS * SAMPLE_RATE_48000 / SEC_PER_MSEC)
+/**
+ * Low latency media playback period size of 240 frames
+ */
+#define FAST_PLAYBACK_48000_PERIOD_SIZE ((int)FAST_PLAYBACK_PERIOD_TIME_MS * SAMPLE_RATE_48000 / SEC_PER_MSEC)
 /**
  * Media capture period size of 960 frames
  */
@@ -76,6 +85,7 @@ using audio_comms::utilities::BitField;
  * Audio card for Media streams
  */
 #define MEDIA_PLAYBACK_DEVICE_ID        (0)
+#define FAST_MEDIA_PLAYBACK_DEVICE_ID   (0)
 #define MEDIA_CAPTURE_DEVICE_ID         (0)
 #define DEEP_MEDIA_PLAYBACK_DEVICE_ID   (0)
 
@@ -103,6 +113,18 @@ const pcm_config CAudioPlatformHardware::pcm_config_deep_media_playback = {
    avail_min         : DEEP_PLAYBACK_48000_PERIOD_SIZE,
 };
 
+const pcm_config CAudioPlatformHardware::pcm_config_fast_media_playback = {
+    channels        : 2,
+    rate            : SAMPLE_RATE_48000,
+    period_size     : FAST_PLAYBACK_48000_PERIOD_SIZE,
+    period_count    : NB_RING_BUFFER,
+    format          : PCM_FORMAT_S16_LE,
+    start_threshold : FAST_PLAYBACK_48000_PERIOD_SIZE,
+    stop_threshold  : FAST_PLAYBACK_48000_PERIOD_SIZE * NB_RING_BUFFER,
+    silence_threshold : 0,
+    avail_min       : FAST_PLAYBACK_48000_PERIOD_SIZE,
+};
+
 const pcm_config CAudioPlatformHardware::pcm_config_media_playback = {
     channels        : 2,
     rate            : SAMPLE_RATE_48000,
@@ -177,6 +199,38 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
     //
     // Media Route
     //
+    {
+        "FastMedia",
+        CAudioRoute::EStreamRoute,
+        "",
+        {
+            NOT_APPLICABLE,
+            DEVICE_OUT_MM_ALL | DEVICE_OUT_BLUETOOTH_SCO_ALL
+        },
+        {
+            NOT_APPLICABLE,
+            AUDIO_OUTPUT_FLAG_FAST
+        },
+        {
+            NOT_APPLICABLE,
+            (1 << AudioSystem::MODE_NORMAL)
+        },
+        mediaCardName,
+        {
+            NOT_APPLICABLE,
+            FAST_MEDIA_PLAYBACK_DEVICE_ID
+        },
+        {
+            pcm_config_not_applicable,
+            CAudioPlatformHardware::pcm_config_fast_media_playback
+        },
+        {
+            channel_policy_not_applicable,
+            { SampleSpec::Copy, SampleSpec::Copy }
+        },
+        "",
+        true
+    },
     {
         "Media",
         CAudioRoute::EStreamRoute,
@@ -214,7 +268,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             { SampleSpec::Copy, SampleSpec::Ignore },
             { SampleSpec::Copy, SampleSpec::Copy }
         },
-        ""
+        "",
+        false
     },
     {
         "DeepMedia",
@@ -245,7 +300,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             channel_policy_not_applicable,
             { SampleSpec::Copy, SampleSpec::Copy }
         },
-        ""
+        "",
+        false
     },
     //
     // Voice Route
@@ -279,7 +335,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             { SampleSpec::Copy, SampleSpec::Ignore },
             { SampleSpec::Copy, SampleSpec::Copy }
         },
-        ""
+        "",
+        false
     },
     {
         "CompressedMedia",
@@ -310,7 +367,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             channel_policy_not_applicable,
             channel_policy_not_applicable
         },
-        ""
+        "",
+        false
     },
     ////////////////////////////////////////////////////////////////////////
     //
@@ -349,7 +407,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             channel_policy_not_applicable,
             channel_policy_not_applicable
         },
-        "ModemIA,Voice,Media,ContextAwareness,CompressedMedia,AlwaysListening,DeepMedia,FMIA"
+        "ModemIA,Voice,Media,ContextAwareness,CompressedMedia,AlwaysListening,DeepMedia,FastMedia,FMIA",
+        false
     },
     //
     // HWCODEC 1 route
@@ -383,7 +442,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             channel_policy_not_applicable,
             channel_policy_not_applicable
         },
-        "ModemIA,Voice,Media,CompressedMedia,AlwaysListening,DeepMedia,FMIA"
+        "ModemIA,Voice,Media,CompressedMedia,AlwaysListening,DeepMedia,FastMedia,FMIA",
+        false
     },
     //
     // ModemIA route
@@ -417,7 +477,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             channel_policy_not_applicable,
             channel_policy_not_applicable
         },
-        ""
+        "",
+        false
     },
     //
     // BT route
@@ -451,7 +512,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             channel_policy_not_applicable,
             channel_policy_not_applicable
         },
-        "ModemIA,Voice,Media,DeepMedia"
+        "ModemIA,Voice,Media,DeepMedia,FastMedia",
+        false
     },
     //
     // FM route
@@ -485,7 +547,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             channel_policy_not_applicable,
             channel_policy_not_applicable
         },
-        ""
+        "",
+        false
     },
     ////////////////////////////////////////////////////////////////////////
     //
@@ -524,7 +587,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             channel_policy_not_applicable,
             channel_policy_not_applicable
         },
-        ""
+        "",
+        false
     },
     // Always Listening
     //
@@ -557,7 +621,8 @@ const CAudioPlatformHardware::s_route_t CAudioPlatformHardware::_astAudioRoutes[
             channel_policy_not_applicable,
             channel_policy_not_applicable
         },
-        ""
+        "",
+        false
     },
 };
 
@@ -931,6 +996,10 @@ CAudioRoute* CAudioPlatformHardware::createAudioRoute(uint32_t uiRouteIndex, CAu
 
         return new CAudioLPECentricStreamRoute(uiRouteIndex, pPlatformState);
 
+    } else if (strName == "FastMedia") {
+
+        return new CAudioLPECentricStreamRoute(uiRouteIndex, pPlatformState);
+
     } else if (strName == "Voice") {
 
         return new CAudioVoiceLPECentricStreamRoute(uiRouteIndex, pPlatformState);
@@ -36,13 +36,15 @@ CAudioStreamRoute::CAudioStreamRoute(uint32_t uiRouteIndex,
                                      CAudioPlatformState *platformState) :
     CAudioRoute(uiRouteIndex, platformState),
     _pEffectSupported(0),
-    _pcCardName(CAudioPlatformHardware::getRouteCardName(uiRouteIndex))
+    _pcCardName(CAudioPlatformHardware::getRouteCardName(uiRouteIndex)),
+    _bMmapPlayback(CAudioPlatformHardware::isRouteMmapPlayback(uiRouteIndex))
 {
     for (int iDir = 0; iDir < CUtils::ENbDirections; iDir++) {
 
        _stStreams[iDir].pCurrent = NULL;
        _stStreams[iDir].pNew = NULL;
        _astPcmDevice[iDir] = NULL;
+       _bPowerLock[iDir] = false;
        _aiPcmDeviceId[iDir] = CAudioPlatformHardware::getRouteDeviceId(uiRouteIndex, iDir);
        _astPcmConfig[iDir] = CAudioPlatformHardware::getRoutePcmConfig(uiRouteIndex, iDir);
        _acPowerLockTag[iDir] = POWER_LOCK_TAG[iDir];
@@ -51,7 +53,9 @@ CAudioStreamRoute::CAudioStreamRoute(uint32_t uiRouteIndex,
                    AudioUtils::convertTinyToHalFormat(_astPcmConfig[iDir].format));
        _routeSampleSpec[iDir].setSampleRate(_astPcmConfig[iDir].rate);
        _routeSampleSpec[iDir].setChannelCount(_astPcmConfig[iDir].channels);
-       _routeSampleSpec[iDir].setChannelsPolicy(CAudioPlatformHardware::getChannelsPolicy(uiRouteIndex, iDir));
+       _routeSampleSpec[iDir].setChannelsPolicy(
+                   CAudioPlatformHardware::getChannelsPolicy(uiRouteIndex, iDir),
+                   _astPcmConfig[iDir].channels);
     }
 }
 
@@ -279,12 +283,18 @@ status_t CAudioStreamRoute::openPcmDevice(bool bIsOut)
                                 config.silence_threshold);
 
     //
-    // Opens the device in BLOCKING mode (default)
+    // Opens the device in BLOCKING mode (default), or in mmap mode if requested by the route
     // No need to check for NULL handle, tiny alsa
     // guarantee to return a pcm structure, even when failing to open
     // it will return a reference on a "bad pcm" structure
+    // Timestamps of the device are taken from CLOCK_MONOTONIC, as required by the presentation
+    // position, in both directions so that the echo reference compares the same clock
     //
-    uint32_t uiFlags= (bIsOut ? PCM_OUT : PCM_IN);
+    uint32_t uiFlags= (bIsOut ? PCM_OUT : PCM_IN) | PCM_MONOTONIC;
+    if (isMmap(bIsOut)) {
+
+        uiFlags |= PCM_MMAP;
+    }
     _astPcmDevice[bIsOut] = pcm_open(AudioUtils::getCardIndexByName(getCardName()),
                                      getPcmDeviceId(bIsOut), uiFlags, &config);
     if (_astPcmDevice[bIsOut] && !pcm_is_ready(_astPcmDevice[bIsOut])) {
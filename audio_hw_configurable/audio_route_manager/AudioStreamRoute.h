@@ -36,6 +36,19 @@ public:
 
     pcm* getPcmDevice(bool bIsOut) const;
 
+    /**
+     * Checks if the device of the route is opened in mmap mode for a direction.
+     * In mmap mode, the stream must write its frames within the DMA ring buffer with the
+     * pcm_mmap_begin / pcm_mmap_commit API instead of pcm_write.
+     *
+     * @param[in] bIsOut direction of the audio stream route.
+     *
+     * @return true if the device is opened in mmap mode, false otherwise.
+     */
+    bool isMmap(bool bIsOut) const { return bIsOut && _bMmapPlayback; }
+
+    const pcm_config& getPcmConfig(bool bIsOut) const;
+
     const SampleSpec getSampleSpec(bool bIsOut) const { return _routeSampleSpec[bIsOut]; }
 
     virtual RouteType getRouteType() const { return CAudioRoute::EStreamRoute; }
@@ -98,6 +111,23 @@ protected:
 
     std::list<const effect_uuid_t*> _pEffectSupported;
 
+    /**
+     * Opens and prepares the audio device of the route for a direction, with the pcm
+     * configuration of the route. Timestamps of the device are given by CLOCK_MONOTONIC.
+     *
+     * @param[in] bIsOut direction of the audio stream route.
+     *
+     * @return OK if the device is ready, error code otherwise.
+     */
+    android::status_t openPcmDevice(bool bIsOut);
+
+    /**
+     * Closes the audio device of the route for a direction.
+     *
+     * @param[in] bIsOut direction of the audio stream route.
+     */
+    void closePcmDevice(bool bIsOut);
+
 private:
     // Function to be used as the predicate in find_if call.
     struct hasEffect :
@@ -112,14 +142,8 @@ private:
 
     int getPcmDeviceId(bool bIsOut) const;
 
-    const pcm_config& getPcmConfig(bool bIsOut) const;
-
     const char* getCardName() const;
 
-    android::status_t openPcmDevice(bool bIsOut);
-
-    void closePcmDevice(bool bIsOut);
-
     android::status_t attachNewStream(bool bIsOut);
 
     void detachCurrentStream(bool bIsOut);
@@ -134,6 +158,8 @@ private:
 
     pcm* _astPcmDevice[CUtils::ENbDirections];
 
+    bool _bMmapPlayback;
+
     SampleSpec _routeSampleSpec[CUtils::ENbDirections];
 
     bool _bPowerLock[CUtils::ENbDirections];
@@ -0,0 +1,394 @@
+/*
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+/**
+ * Host tests of the stream routes of the platform the HAL is built for, and of the output
+ * stream writing within the DMA ring buffer of the routes opened in mmap mode.
+ * Audio devices are opened through a stand-in of tinyalsa (see TinyAlsaStandIn.h).
+ */
+
+// Stream declares the device masks the route manager defines as macros, it comes first
+#include "AudioStreamOutALSA.h"
+#include "AudioPlatformHardware.h"
+#include "AudioStreamRoute.h"
+#include "TinyAlsaStandIn.h"
+#include <AudioUtils.h>
+#include <gtest/gtest.h>
+#include <errno.h>
+#include <time.h>
+#include <vector>
+
+using namespace android;
+using namespace android_audio_legacy;
+using std::vector;
+
+namespace
+{
+
+/**
+ * Stream route opening its audio devices without any stream attached.
+ */
+class StreamRouteUnderTest : public CAudioStreamRoute
+{
+public:
+    explicit StreamRouteUnderTest(uint32_t uiRouteIndex) :
+        CAudioStreamRoute(uiRouteIndex, NULL)
+    {
+    }
+
+    status_t open(bool bIsOut) { return openPcmDevice(bIsOut); }
+
+    void close(bool bIsOut) { closePcmDevice(bIsOut); }
+};
+
+/**
+ * Output stream attached to a route without the route manager, writing frames of the hardware
+ * sample specification within the DMA ring buffer.
+ */
+class StreamOutUnderTest : public AudioStreamOutALSA
+{
+public:
+    StreamOutUnderTest() :
+        AudioStreamOutALSA(NULL, AUDIO_OUTPUT_FLAG_FAST)
+    {
+    }
+
+    status_t attach(CAudioStreamRoute *pRoute)
+    {
+        setNewRoute(pRoute);
+        return attachRoute();
+    }
+
+    ssize_t writeHwFrames(const void *buffer, ssize_t frames)
+    {
+        AutoW lock(_streamLock);
+        return writeMmapFrames(buffer, frames, false);
+    }
+};
+
+/**
+ * Output stream attached to the low latency route, opened in mmap mode.
+ * Frames are stereo, the samples of a frame hold its index so that the ring buffer is checked.
+ */
+class AudioStreamOutMmap : public testing::Test
+{
+protected:
+    AudioStreamOutMmap() :
+        _pRoute(NULL),
+        _pDevice(NULL)
+    {
+    }
+
+    virtual void SetUp();
+
+    virtual void TearDown();
+
+    /**
+     * Writes frames with their indexes, following the ones of the previous write.
+     *
+     * @return number of frames written, negative error code otherwise.
+     */
+    ssize_t write(uint32_t uiFrames);
+
+    /**
+     * Gets the index of the frame held at a position of the ring buffer.
+     */
+    int16_t getRingFrameIndex(uint32_t uiPosition) const;
+
+    StreamRouteUnderTest *_pRoute;
+    pcm *_pDevice;
+    StreamOutUnderTest _stream;
+    vector<int16_t> _frames;
+};
+
+/**
+ * Gets the index of a route within the route table of the platform.
+ *
+ * @param[in] name name of the route.
+ *
+ * @return index of the route, negative if the platform has no such route.
+ */
+int getRouteIndex(const char *name)
+{
+    for (uint32_t index = 0; index < CAudioPlatformHardware::getNbRoutes(); index++) {
+
+        if (CAudioPlatformHardware::getRouteName(index) == name) {
+
+            return index;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Gets the difference between two times.
+ *
+ * @return difference in nanoseconds.
+ */
+int64_t getDifferenceNs(const struct timespec &lhs, const struct timespec &rhs)
+{
+    return (static_cast<int64_t>(lhs.tv_sec) - rhs.tv_sec) * 1000000000LL +
+            (lhs.tv_nsec - rhs.tv_nsec);
+}
+
+void AudioStreamOutMmap::SetUp()
+{
+    int iRouteIndex = getRouteIndex("FastMedia");
+    if (iRouteIndex < 0) {
+
+        // Platforms without low latency route have no playback in mmap mode
+        return;
+    }
+    _pRoute = new StreamRouteUnderTest(iRouteIndex);
+    ASSERT_TRUE(_pRoute->isMmap(true));
+    ASSERT_EQ(NO_ERROR, _pRoute->open(true));
+    _pDevice = _pRoute->getPcmDevice(true);
+    ASSERT_TRUE(TinyAlsaStandIn::getOpenFlags(_pDevice) & PCM_MMAP);
+    ASSERT_EQ(2u, _pRoute->getSampleSpec(true).getChannelCount());
+    ASSERT_EQ(NO_ERROR, _stream.attach(_pRoute));
+}
+
+void AudioStreamOutMmap::TearDown()
+{
+    if (_pRoute == NULL) {
+
+        return;
+    }
+    _stream.detachRoute();
+    _pRoute->close(true);
+    delete _pRoute;
+}
+
+ssize_t AudioStreamOutMmap::write(uint32_t uiFrames)
+{
+    size_t firstFrame = _frames.size() / 2;
+    for (uint32_t uiFrame = 0; uiFrame < uiFrames; uiFrame++) {
+
+        int16_t index = firstFrame + uiFrame;
+        _frames.push_back(index);
+        _frames.push_back(~index);
+    }
+    return _stream.writeHwFrames(&_frames[2 * firstFrame], uiFrames);
+}
+
+int16_t AudioStreamOutMmap::getRingFrameIndex(uint32_t uiPosition) const
+{
+    const int16_t *pRing = static_cast<const int16_t *>(TinyAlsaStandIn::getMmapBuffer(_pDevice));
+    EXPECT_EQ(pRing[2 * uiPosition], ~pRing[2 * uiPosition + 1]) << uiPosition;
+    return pRing[2 * uiPosition];
+}
+
+}
+
+TEST(AudioStreamRoute, timestampsAreMonotonic)
+{
+    int iRouteIndex = getRouteIndex("Media");
+    ASSERT_GE(iRouteIndex, 0);
+
+    for (int iDir = 0; iDir < CUtils::ENbDirections; iDir++) {
+
+        bool bIsOut = iDir == CUtils::EOutput;
+        if (CAudioPlatformHardware::getRoutePcmConfig(iRouteIndex, bIsOut).channels == 0) {
+
+            continue;
+        }
+        StreamRouteUnderTest route(iRouteIndex);
+        ASSERT_EQ(NO_ERROR, route.open(bIsOut));
+        EXPECT_TRUE(TinyAlsaStandIn::getOpenFlags(route.getPcmDevice(bIsOut)) & PCM_MONOTONIC);
+
+        // Presentation position and echo reference use the timestamps of the device as is
+        unsigned int avail;
+        struct timespec tstamp;
+        struct timespec now;
+        ASSERT_EQ(0, pcm_get_htimestamp(route.getPcmDevice(bIsOut), &avail, &tstamp));
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        EXPECT_GE(getDifferenceNs(now, tstamp), 0);
+        EXPECT_LT(getDifferenceNs(now, tstamp), 1000000000LL);
+
+        route.close(bIsOut);
+    }
+}
+
+TEST(AudioPlatformHardware, fastStreamsUseTheLowLatencyConfig)
+{
+    const pcm_config &fastConfig =
+            CAudioPlatformHardware::getDefaultPcmConfig(true, AUDIO_OUTPUT_FLAG_FAST);
+    const pcm_config &mediaConfig = CAudioPlatformHardware::getDefaultPcmConfig(true, 0);
+    int iFastRouteIndex = getRouteIndex("FastMedia");
+
+    if (iFastRouteIndex < 0) {
+
+        // Platforms without low latency config fall back to the media playback one
+        EXPECT_EQ(&mediaConfig, &fastConfig);
+        return;
+    }
+    const pcm_config &routeConfig = CAudioPlatformHardware::getRoutePcmConfig(iFastRouteIndex,
+                                                                              true);
+    // Route table holds a copy of the config
+    EXPECT_EQ(routeConfig.period_size, fastConfig.period_size);
+    EXPECT_EQ(routeConfig.period_count, fastConfig.period_count);
+    EXPECT_TRUE(CAudioPlatformHardware::getRouteApplicableMask(iFastRouteIndex, true) &
+                AUDIO_OUTPUT_FLAG_FAST);
+
+    // 5 ms periods within a ring of 4 periods, the transfer starts on the first period
+    EXPECT_EQ(48000u, fastConfig.rate);
+    EXPECT_EQ(240u, fastConfig.period_size);
+    EXPECT_EQ(4u, fastConfig.period_count);
+    EXPECT_EQ(fastConfig.period_size, fastConfig.start_threshold);
+    EXPECT_EQ(20000u, AudioUtils::getPcmLatencyUs(fastConfig));
+    EXPECT_LT(AudioUtils::getPcmLatencyUs(fastConfig), AudioUtils::getPcmLatencyUs(mediaConfig));
+
+    // Deep buffer wins over low latency, if the platform has a deep buffer config
+    const pcm_config &deepConfig = CAudioPlatformHardware::getDefaultPcmConfig(
+        true, AUDIO_OUTPUT_FLAG_FAST | AUDIO_OUTPUT_FLAG_DEEP_BUFFER);
+    EXPECT_NE(&fastConfig, &deepConfig);
+    EXPECT_NE(0u, deepConfig.period_size);
+}
+
+TEST(AudioStreamRoute, reportedLatencyMatchesOpenedDevice)
+{
+    static const uint32_t auiFlags[] = { 0, AUDIO_OUTPUT_FLAG_FAST };
+    static const char *const apcRouteNames[] = { "Media", "FastMedia" };
+
+    for (size_t i = 0; i < sizeof(auiFlags) / sizeof(auiFlags[0]); i++) {
+
+        int iRouteIndex = getRouteIndex(apcRouteNames[i]);
+        if (iRouteIndex < 0) {
+
+            continue;
+        }
+        StreamRouteUnderTest route(iRouteIndex);
+        ASSERT_EQ(NO_ERROR, route.open(true));
+        const pcm *pDevice = route.getPcmDevice(true);
+        const pcm_config &openConfig = TinyAlsaStandIn::getOpenConfig(pDevice);
+        const pcm_config &defaultConfig =
+                CAudioPlatformHardware::getDefaultPcmConfig(true, auiFlags[i]);
+
+        // Device is opened with the periods the stream reports its latency and buffer size for
+        EXPECT_EQ(defaultConfig.period_size, openConfig.period_size) << apcRouteNames[i];
+        EXPECT_EQ(defaultConfig.period_count, openConfig.period_count) << apcRouteNames[i];
+        EXPECT_EQ(defaultConfig.rate, openConfig.rate) << apcRouteNames[i];
+        uint64_t bufferUs = 1000000ULL *
+                pcm_get_buffer_size(const_cast<pcm *>(pDevice)) / openConfig.rate;
+        EXPECT_EQ(bufferUs, AudioUtils::getPcmLatencyUs(defaultConfig)) << apcRouteNames[i];
+
+        route.close(true);
+    }
+}
+
+TEST_F(AudioStreamOutMmap, dmaStartsOnceTheStartThresholdIsQueued)
+{
+    if (_pDevice == NULL) {
+
+        return;
+    }
+    uint32_t uiStartThreshold = TinyAlsaStandIn::getOpenConfig(_pDevice).start_threshold;
+    ASSERT_NE(0u, uiStartThreshold);
+
+    EXPECT_EQ(uiStartThreshold - 1, write(uiStartThreshold - 1));
+    EXPECT_FALSE(TinyAlsaStandIn::isRunning(_pDevice));
+    EXPECT_EQ(uiStartThreshold - 1, TinyAlsaStandIn::getQueuedFrames(_pDevice));
+
+    EXPECT_EQ(1, write(1));
+    EXPECT_TRUE(TinyAlsaStandIn::isRunning(_pDevice));
+    EXPECT_EQ(1u, TinyAlsaStandIn::getStartCount(_pDevice));
+
+    // Running DMA is not started again
+    EXPECT_EQ(uiStartThreshold, write(uiStartThreshold));
+    EXPECT_EQ(1u, TinyAlsaStandIn::getStartCount(_pDevice));
+    EXPECT_EQ(2 * uiStartThreshold, TinyAlsaStandIn::getQueuedFrames(_pDevice));
+}
+
+TEST_F(AudioStreamOutMmap, partialWindowsWrapAroundTheRingBuffer)
+{
+    if (_pDevice == NULL) {
+
+        return;
+    }
+    uint32_t uiPeriodSize = TinyAlsaStandIn::getOpenConfig(_pDevice).period_size;
+    uint32_t uiRingFrames = pcm_get_buffer_size(_pDevice);
+    ASSERT_EQ(4 * uiPeriodSize, uiRingFrames);
+
+    // All periods but the last one are written, the DMA plays the first one
+    EXPECT_EQ(3 * uiPeriodSize, write(3 * uiPeriodSize));
+    TinyAlsaStandIn::playFrames(_pDevice, uiPeriodSize);
+
+    // Windows stop at the end of the ring buffer, then at the frames the DMA has not played yet,
+    // the last period is written once the stream waited for the DMA
+    EXPECT_EQ(5 * uiPeriodSize / 2, write(5 * uiPeriodSize / 2));
+    EXPECT_EQ(uiRingFrames, TinyAlsaStandIn::getQueuedFrames(_pDevice) + uiPeriodSize / 2);
+    for (uint32_t uiPosition = 0; uiPosition < uiRingFrames; uiPosition++) {
+
+        uint32_t uiIndex = uiPosition;
+        if (uiPosition < 3 * uiPeriodSize / 2) {
+
+            uiIndex += uiRingFrames;
+        }
+        ASSERT_EQ(static_cast<int16_t>(uiIndex), getRingFrameIndex(uiPosition)) << uiPosition;
+    }
+}
+
+TEST_F(AudioStreamOutMmap, waitsCoverTwoPeriodsAndKeepWaitingOnTimeout)
+{
+    if (_pDevice == NULL) {
+
+        return;
+    }
+    const pcm_config &config = TinyAlsaStandIn::getOpenConfig(_pDevice);
+    uint32_t uiRingFrames = pcm_get_buffer_size(_pDevice);
+    uint32_t uiPrepareCount = TinyAlsaStandIn::getPrepareCount(_pDevice);
+    EXPECT_EQ(uiRingFrames, write(uiRingFrames));
+
+    // DMA late on a full ring buffer keeps the queued frames
+    TinyAlsaStandIn::injectWaitTimeouts(_pDevice, 3);
+    EXPECT_EQ(config.period_size, write(config.period_size));
+    EXPECT_EQ(static_cast<int>((2 * config.period_size * 1000 + config.rate - 1) / config.rate),
+              TinyAlsaStandIn::getLastWaitTimeoutMs(_pDevice));
+    EXPECT_EQ(uiPrepareCount, TinyAlsaStandIn::getPrepareCount(_pDevice));
+    EXPECT_EQ(uiRingFrames, TinyAlsaStandIn::getQueuedFrames(_pDevice));
+
+    // Stalled DMA fails the write, the ring buffer is still kept
+    TinyAlsaStandIn::injectWaitTimeouts(_pDevice, 1000);
+    EXPECT_EQ(-ETIMEDOUT, write(config.period_size));
+    EXPECT_EQ(uiPrepareCount, TinyAlsaStandIn::getPrepareCount(_pDevice));
+    EXPECT_EQ(uiRingFrames, TinyAlsaStandIn::getQueuedFrames(_pDevice));
+    EXPECT_TRUE(TinyAlsaStandIn::isRunning(_pDevice));
+}
+
+TEST_F(AudioStreamOutMmap, underrunPreparesTheDeviceAgain)
+{
+    if (_pDevice == NULL) {
+
+        return;
+    }
+    uint32_t uiPeriodSize = TinyAlsaStandIn::getOpenConfig(_pDevice).period_size;
+    uint32_t uiRingFrames = pcm_get_buffer_size(_pDevice);
+    uint32_t uiPrepareCount = TinyAlsaStandIn::getPrepareCount(_pDevice);
+    EXPECT_EQ(uiRingFrames - uiPeriodSize, write(uiRingFrames - uiPeriodSize));
+
+    // Frames left once the ring buffer is full are written from the start of the ring buffer
+    TinyAlsaStandIn::injectWaitError(_pDevice, -EPIPE);
+    EXPECT_EQ(2 * uiPeriodSize, write(2 * uiPeriodSize));
+    EXPECT_EQ(uiPrepareCount + 1, TinyAlsaStandIn::getPrepareCount(_pDevice));
+    EXPECT_EQ(uiPeriodSize, TinyAlsaStandIn::getQueuedFrames(_pDevice));
+    EXPECT_TRUE(TinyAlsaStandIn::isRunning(_pDevice));
+    EXPECT_EQ(2u, TinyAlsaStandIn::getStartCount(_pDevice));
+    for (uint32_t uiPosition = 0; uiPosition < uiPeriodSize; uiPosition++) {
+
+        ASSERT_EQ(static_cast<int16_t>(uiRingFrames + uiPosition), getRingFrameIndex(uiPosition))
+                << uiPosition;
+    }
+}
@@ -0,0 +1,45 @@
+/*
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+/**
+ * Local stand-in for the wake locks of the power library, so that the stream routes are tested
+ * on any host. Locks are only counted.
+ */
+
+#include <hardware_legacy/power.h>
+
+namespace
+{
+
+int heldLocks = 0;
+
+}
+
+extern "C" {
+
+int acquire_wake_lock(int /*lock*/, const char * /*id*/)
+{
+    ++heldLocks;
+    return 0;
+}
+
+int release_wake_lock(const char * /*id*/)
+{
+    --heldLocks;
+    return 0;
+}
+
+}
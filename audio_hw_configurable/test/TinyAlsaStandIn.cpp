@@ -0,0 +1,279 @@
+/*
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+/**
+ * Local stand-in for tinyalsa, so that the stream routes are tested on any host.
+ * Devices accept any write and read silence, without blocking. Devices opened in mmap mode
+ * are played by the tests. See TinyAlsaStandIn.h.
+ */
+
+#include "TinyAlsaStandIn.h"
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+struct pcm {
+
+    unsigned int flags;
+    struct pcm_config config;
+    bool ready;
+    char *mmapBuffer; /**< Ring buffer of a device opened in mmap mode. */
+    unsigned int applPtr; /**< Frames written within the ring buffer since prepared. */
+    unsigned int hwPtr; /**< Frames played from the ring buffer since prepared. */
+    bool running;
+    unsigned int startCount;
+    unsigned int prepareCount;
+    int lastWaitTimeoutMs;
+    unsigned int waitTimeouts; /**< Next waits to time out. */
+    int waitError; /**< Error of the next wait, 0 if none. */
+};
+
+namespace
+{
+
+unsigned int getFrameSize(const struct pcm *handle)
+{
+    unsigned int sampleSize = handle->config.format == PCM_FORMAT_S16_LE ? 2 : 4;
+    return handle->config.channels * sampleSize;
+}
+
+unsigned int getQueuedFrames(const struct pcm *handle)
+{
+    return handle->applPtr - handle->hwPtr;
+}
+
+void playFrames(struct pcm *handle, unsigned int frames)
+{
+    unsigned int queuedFrames = getQueuedFrames(handle);
+    handle->hwPtr += frames < queuedFrames ? frames : queuedFrames;
+}
+
+}
+
+extern "C" {
+
+struct pcm *pcm_open(unsigned int /*card*/, unsigned int /*device*/, unsigned int flags,
+                     struct pcm_config *config)
+{
+    struct pcm *handle = new pcm;
+    memset(handle, 0, sizeof(*handle));
+    handle->flags = flags;
+    if (config != NULL) {
+
+        handle->config = *config;
+        handle->ready = config->channels != 0 && config->rate != 0 &&
+                config->period_size != 0 && config->period_count != 0;
+    }
+    if (handle->ready && (flags & PCM_MMAP)) {
+
+        unsigned int bytes = pcm_frames_to_bytes(handle, pcm_get_buffer_size(handle));
+        handle->mmapBuffer = new char[bytes];
+        memset(handle->mmapBuffer, 0, bytes);
+    }
+    handle->lastWaitTimeoutMs = -1;
+    return handle;
+}
+
+int pcm_close(struct pcm *pcm)
+{
+    delete[] pcm->mmapBuffer;
+    delete pcm;
+    return 0;
+}
+
+int pcm_is_ready(struct pcm *pcm)
+{
+    return pcm->ready;
+}
+
+int pcm_prepare(struct pcm *pcm)
+{
+    pcm->applPtr = 0;
+    pcm->hwPtr = 0;
+    pcm->running = false;
+    ++pcm->prepareCount;
+    return 0;
+}
+
+int pcm_start(struct pcm *pcm)
+{
+    pcm->running = true;
+    ++pcm->startCount;
+    return 0;
+}
+
+int pcm_stop(struct pcm *pcm)
+{
+    pcm->running = false;
+    return 0;
+}
+
+int pcm_wait(struct pcm *pcm, int timeout)
+{
+    pcm->lastWaitTimeoutMs = timeout;
+    if (pcm->waitError != 0) {
+
+        int error = pcm->waitError;
+        pcm->waitError = 0;
+        return error;
+    }
+    if (pcm->waitTimeouts != 0) {
+
+        --pcm->waitTimeouts;
+        return 0;
+    }
+    if (!pcm->running) {
+
+        // Nothing plays the ring buffer
+        return 0;
+    }
+    playFrames(pcm, pcm->config.period_size);
+    return 1;
+}
+
+const char *pcm_get_error(struct pcm * /*pcm*/)
+{
+    return "tinyalsa stand-in";
+}
+
+unsigned int pcm_get_buffer_size(struct pcm *pcm)
+{
+    return pcm->config.period_size * pcm->config.period_count;
+}
+
+unsigned int pcm_frames_to_bytes(struct pcm *pcm, unsigned int frames)
+{
+    return frames * getFrameSize(pcm);
+}
+
+unsigned int pcm_bytes_to_frames(struct pcm *pcm, unsigned int bytes)
+{
+    return bytes / getFrameSize(pcm);
+}
+
+int pcm_get_htimestamp(struct pcm *pcm, unsigned int *avail, struct timespec *tstamp)
+{
+    // Only devices opened in mmap mode hold frames within their ring buffer
+    *avail = pcm_get_buffer_size(pcm) - getQueuedFrames(pcm);
+    return clock_gettime((pcm->flags & PCM_MONOTONIC) ? CLOCK_MONOTONIC : CLOCK_REALTIME,
+                         tstamp);
+}
+
+int pcm_write(struct pcm * /*pcm*/, const void * /*data*/, unsigned int /*count*/)
+{
+    return 0;
+}
+
+int pcm_read(struct pcm * /*pcm*/, void *data, unsigned int count)
+{
+    memset(data, 0, count);
+    return 0;
+}
+
+int pcm_mmap_begin(struct pcm *pcm, void **areas, unsigned int *offset, unsigned int *frames)
+{
+    if (pcm->mmapBuffer == NULL) {
+
+        // No DMA ring buffer to map
+        return -1;
+    }
+    // Window stops at the end of the ring buffer, as the one of the kernel
+    unsigned int bufferFrames = pcm_get_buffer_size(pcm);
+    unsigned int availFrames = bufferFrames - getQueuedFrames(pcm);
+    *areas = pcm->mmapBuffer;
+    *offset = pcm->applPtr % bufferFrames;
+    if (*frames > availFrames) {
+
+        *frames = availFrames;
+    }
+    if (*frames > bufferFrames - *offset) {
+
+        *frames = bufferFrames - *offset;
+    }
+    return 0;
+}
+
+int pcm_mmap_commit(struct pcm *pcm, unsigned int offset, unsigned int frames)
+{
+    if (pcm->mmapBuffer == NULL || offset != pcm->applPtr % pcm_get_buffer_size(pcm)) {
+
+        return -EINVAL;
+    }
+    pcm->applPtr += frames;
+    return frames;
+}
+
+}
+
+namespace android_audio_legacy
+{
+
+unsigned int TinyAlsaStandIn::getOpenFlags(const pcm *handle)
+{
+    return handle->flags;
+}
+
+const pcm_config &TinyAlsaStandIn::getOpenConfig(const pcm *handle)
+{
+    return handle->config;
+}
+
+const void *TinyAlsaStandIn::getMmapBuffer(const pcm *handle)
+{
+    return handle->mmapBuffer;
+}
+
+unsigned int TinyAlsaStandIn::getQueuedFrames(const pcm *handle)
+{
+    return ::getQueuedFrames(handle);
+}
+
+void TinyAlsaStandIn::playFrames(pcm *handle, unsigned int frames)
+{
+    ::playFrames(handle, frames);
+}
+
+bool TinyAlsaStandIn::isRunning(const pcm *handle)
+{
+    return handle->running;
+}
+
+unsigned int TinyAlsaStandIn::getStartCount(const pcm *handle)
+{
+    return handle->startCount;
+}
+
+unsigned int TinyAlsaStandIn::getPrepareCount(const pcm *handle)
+{
+    return handle->prepareCount;
+}
+
+int TinyAlsaStandIn::getLastWaitTimeoutMs(const pcm *handle)
+{
+    return handle->lastWaitTimeoutMs;
+}
+
+void TinyAlsaStandIn::injectWaitTimeouts(pcm *handle, unsigned int count)
+{
+    handle->waitTimeouts = count;
+}
+
+void TinyAlsaStandIn::injectWaitError(pcm *handle, int error)
+{
+    handle->waitError = error;
+}
+
+}        // namespace android
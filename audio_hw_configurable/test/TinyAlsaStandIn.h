@@ -0,0 +1,131 @@
+/*
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+#pragma once
+
+#include <tinyalsa/asoundlib.h>
+
+namespace android_audio_legacy
+{
+
+/**
+ * Inspection of the audio devices opened through the tinyalsa stand-in of the host tests.
+ * The stand-in opens devices without any sound card: a device is ready as soon as its pcm
+ * configuration is valid, and its timestamps are taken from CLOCK_MONOTONIC if opened with
+ * PCM_MONOTONIC, from CLOCK_REALTIME otherwise, as the kernel does.
+ * Devices opened with PCM_MMAP map a ring buffer that only the tests drain: once started, each
+ * wait of the stream plays one period. Other devices keep an empty ring buffer.
+ */
+class TinyAlsaStandIn
+{
+public:
+    /**
+     * Gets the flags a device was opened with.
+     *
+     * @param[in] handle device opened by the stand-in.
+     *
+     * @return flags given to pcm_open.
+     */
+    static unsigned int getOpenFlags(const pcm *handle);
+
+    /**
+     * Gets the pcm configuration a device was opened with.
+     *
+     * @param[in] handle device opened by the stand-in.
+     *
+     * @return configuration given to pcm_open.
+     */
+    static const pcm_config &getOpenConfig(const pcm *handle);
+
+    /**
+     * Gets the ring buffer mapped by a device opened in mmap mode.
+     *
+     * @param[in] handle device opened by the stand-in.
+     *
+     * @return frames of the ring buffer, NULL if the device is not opened in mmap mode.
+     */
+    static const void *getMmapBuffer(const pcm *handle);
+
+    /**
+     * Gets the frames written within the ring buffer and not played yet.
+     *
+     * @param[in] handle device opened by the stand-in.
+     *
+     * @return number of frames.
+     */
+    static unsigned int getQueuedFrames(const pcm *handle);
+
+    /**
+     * Plays frames of the ring buffer, as the DMA would.
+     *
+     * @param[in] handle device opened by the stand-in.
+     * @param[in] frames number of frames to play, up to the queued ones.
+     */
+    static void playFrames(pcm *handle, unsigned int frames);
+
+    /**
+     * Tells if the DMA of a device runs, ie if it is started and not stopped since.
+     *
+     * @param[in] handle device opened by the stand-in.
+     *
+     * @return true if running, false otherwise.
+     */
+    static bool isRunning(const pcm *handle);
+
+    /**
+     * Gets the number of calls to pcm_start since the device was opened.
+     *
+     * @param[in] handle device opened by the stand-in.
+     *
+     * @return number of starts.
+     */
+    static unsigned int getStartCount(const pcm *handle);
+
+    /**
+     * Gets the number of calls to pcm_prepare since the device was opened.
+     *
+     * @param[in] handle device opened by the stand-in.
+     *
+     * @return number of prepares.
+     */
+    static unsigned int getPrepareCount(const pcm *handle);
+
+    /**
+     * Gets the timeout of the last call to pcm_wait.
+     *
+     * @param[in] handle device opened by the stand-in.
+     *
+     * @return timeout in milliseconds, negative if the device was never waited for.
+     */
+    static int getLastWaitTimeoutMs(const pcm *handle);
+
+    /**
+     * Makes the next calls to pcm_wait time out, without playing any frame.
+     *
+     * @param[in] handle device opened by the stand-in.
+     * @param[in] count number of waits to time out.
+     */
+    static void injectWaitTimeouts(pcm *handle, unsigned int count);
+
+    /**
+     * Makes the next call to pcm_wait fail, with -EPIPE for an underrun for instance.
+     *
+     * @param[in] handle device opened by the stand-in.
+     * @param[in] error negative error code to return.
+     */
+    static void injectWaitError(pcm *handle, int error);
+};
+
+};        // namespace android
@@ -29,6 +29,7 @@ LOCAL_PATH := $(call my-dir)
 
 sample_specifications_src_files :=  \
     AudioUtils.cpp \
+    FixedPointDivider.cpp \
     SampleSpec.cpp
 
 sample_specifications_common_includes_dir := \
@@ -113,6 +114,23 @@ LOCAL_MODULE := libsamplespec_static_host
 $(call make_sample_specifications_lib,host)
 include $(BUILD_HOST_STATIC_LIBRARY)
 
+# Fixed point divisions checked against the plain divisions, comparisons of sample specifications
+include $(CLEAR_VARS)
+LOCAL_MODULE := sample_specifications_test_host
+LOCAL_SRC_FILES := \
+    test/FixedPointDividerTest.cpp \
+    test/SampleSpecTest.cpp
+LOCAL_C_INCLUDES := \
+    $(sample_specifications_common_includes_dir) \
+    $(sample_specifications_includes_dir_host)
+LOCAL_CFLAGS := $(sample_specifications_cflags)
+LOCAL_STATIC_LIBRARIES := \
+    libsamplespec_static_host \
+    $(sample_specifications_static_lib_host) \
+    liblog
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_HOST_NATIVE_TEST)
+
 endif
 
 # Build for target (inconditionnal)
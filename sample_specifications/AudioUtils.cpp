@@ -59,8 +59,8 @@ size_t AudioUtils::convertSrcToDstInFrames(size_t frames,
 {
     LOG_ALWAYS_FATAL_IF(ssSrc.getSampleRate() == 0);
     AUDIOCOMMS_COMPILE_TIME_ASSERT(sizeof(uint64_t) >= (2 * sizeof(ssize_t)));
-    int64_t dstFrames = ((uint64_t)frames * ssDst.getSampleRate() + ssSrc.getSampleRate() - 1) /
-            ssSrc.getSampleRate();
+    int64_t dstFrames = ssSrc.divideByRate((uint64_t)frames * ssDst.getSampleRate() +
+                                           ssSrc.getSampleRate() - 1);
     LOG_ALWAYS_FATAL_IF(dstFrames > numeric_limits<ssize_t>::max());
     return dstFrames;
 }
@@ -95,11 +95,13 @@ pcm_format AudioUtils::convertHalToTinyFormat(audio_format_t format)
         convFormat = PCM_FORMAT_S16_LE;
         break;
     case AUDIO_FORMAT_PCM_8_24_BIT:
+    case AUDIO_FORMAT_PCM_32_BIT:
         convFormat = PCM_FORMAT_S32_LE;
         break;
     default:
-        ALOGE("%s: format not recognized", __FUNCTION__);
-        convFormat = PCM_FORMAT_S16_LE;
+        // Float and packed 24 bits samples have no tiny alsa counterpart
+        ALOGE("%s: format 0x%x not recognized", __FUNCTION__, format);
+        convFormat = PCM_FORMAT_MAX;
         break;
     }
     return convFormat;
@@ -144,6 +146,15 @@ uint32_t AudioUtils::convertUsecToMsec(uint32_t timeUsec)
     return ((static_cast<uint64_t>(timeUsec) + 999) / 1000);
 }
 
+uint32_t AudioUtils::getPcmLatencyUs(const pcm_config &config)
+{
+    LOG_ALWAYS_FATAL_IF(config.rate == 0);
+    uint64_t latencyUs = static_cast<uint64_t>(USEC_TO_SEC) * config.period_count *
+            config.period_size / config.rate;
+    LOG_ALWAYS_FATAL_IF(latencyUs > numeric_limits<uint32_t>::max());
+    return latencyUs;
+}
+
 bool AudioUtils::isAudioInputDevice(uint32_t devices)
 {
     return (popcount(devices) == 1) && ((devices & ~AudioSystem::DEVICE_IN_ALL) == 0);
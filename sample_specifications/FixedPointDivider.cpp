@@ -0,0 +1,46 @@
+/*
+ **
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+#define LOG_TAG "FixedPointDivider"
+
+#include "FixedPointDivider.h"
+#include <cutils/log.h>
+
+namespace android_audio_legacy {
+
+FixedPointDivider::FixedPointDivider(uint32_t divisor)
+{
+    setDivisor(divisor);
+}
+
+void FixedPointDivider::setDivisor(uint32_t divisor)
+{
+    LOG_ALWAYS_FATAL_IF(divisor == 0);
+
+    // Rounded up log2 of the divisor
+    uint32_t log2 = 0;
+    while ((static_cast<uint64_t>(1) << log2) < divisor) {
+
+        log2++;
+    }
+    _divisor = divisor;
+    _multiplier = ((static_cast<uint64_t>(1) << 32) *
+                   ((static_cast<uint64_t>(1) << log2) - divisor)) / divisor + 1;
+    _preShift = log2 > 0 ? 1 : 0;
+    _postShift = log2 > 0 ? log2 - 1 : 0;
+}
+
+}; // namespace android
@@ -30,6 +30,8 @@ namespace android_audio_legacy {
 #define SAMPLE_SPEC_ITEM_IS_VALID(sampleSpecItem) \
                 LOG_ALWAYS_FATAL_IF((sampleSpecItem) < 0 || (sampleSpecItem) >= NbSampleSpecItems)
 
+const audio_format_t SampleSpec::PCM_FLOAT_FORMAT;
+const audio_format_t SampleSpec::PCM_24_BIT_PACKED_FORMAT;
 
 SampleSpec::SampleSpec(uint32_t channel,
                        uint32_t format,
@@ -41,10 +43,10 @@ SampleSpec::SampleSpec(uint32_t channel,
 SampleSpec::SampleSpec(uint32_t channel,
                        uint32_t format,
                        uint32_t rate,
-                       const vector<ChannelsPolicy> &channelsPolicy)
+                       const ChannelsPolicy *channelsPolicy)
 {
     init(channel, format, rate);
-    setChannelsPolicy(channelsPolicy);
+    setChannelsPolicy(channelsPolicy, channel);
 }
 
 void SampleSpec::init(uint32_t channel,
@@ -52,11 +54,27 @@ void SampleSpec::init(uint32_t channel,
                       uint32_t rate)
 {
     _channelMask = 0;
+    _sampleSpec[FormatSampleSpecItem] = format;
+    _sampleSpec[RateSampleSpecItem] = rate;
+    // Last item set computes the factors of all of them
     setSampleSpecItem(ChannelCountSampleSpecItem, channel);
-    setSampleSpecItem(FormatSampleSpecItem, format);
-    setSampleSpecItem(RateSampleSpecItem, rate);
 }
 
+namespace {
+
+uint32_t greatestCommonDivisor(uint32_t a, uint32_t b)
+{
+    while (b != 0) {
+
+        uint32_t remainder = a % b;
+        a = b;
+        b = remainder;
+    }
+    return a;
+}
+
+} // namespace
+
 // Generic Accessor
 void SampleSpec::setSampleSpecItem(SampleSpecItem sampleSpecItem, uint32_t value)
 {
@@ -64,28 +82,78 @@ void SampleSpec::setSampleSpecItem(SampleSpecItem sampleSpecItem, uint32_t value
 
     if (sampleSpecItem == ChannelCountSampleSpecItem) {
 
-        LOG_ALWAYS_FATAL_IF(value >= MAX_CHANNELS);
+        LOG_ALWAYS_FATAL_IF(value > MAX_CHANNELS);
 
-        _channelsPolicy.clear();
         // Reset all the channels policy to copy by default
-        for (uint32_t i = 0; i < value; i++) {
-
-            _channelsPolicy.push_back(Copy);
-        }
+        _channelsPolicy = 0;
     }
     _sampleSpec[sampleSpecItem] = value;
+    updateFactors();
 }
 
-void SampleSpec::setChannelsPolicy(const vector<ChannelsPolicy> &channelsPolicy)
+void SampleSpec::updateFactors()
 {
-    LOG_ALWAYS_FATAL_IF(channelsPolicy.size() > _sampleSpec[ChannelCountSampleSpecItem]);
+    _frameSize = getBytesPerSample(_sampleSpec[FormatSampleSpecItem]) *
+            _sampleSpec[ChannelCountSampleSpecItem];
+    _maxFramesToBytes = _frameSize != 0 ? numeric_limits<size_t>::max() / _frameSize : 0;
+    _frameSizeDivider.setDivisor(_frameSize != 0 ? _frameSize : 1);
+
+    uint32_t rate = _sampleSpec[RateSampleSpecItem];
+    uint32_t gcd = greatestCommonDivisor(USEC_PER_SEC, rate);
+    _usecPerFramesNumerator = USEC_PER_SEC / gcd;
+    _usecPerFramesDivider.setDivisor(rate != 0 ? rate / gcd : 1);
+    _framesPerUsecNumerator = rate / gcd;
+    _framesPerUsecDivider.setDivisor(USEC_PER_SEC / gcd);
+    _rateDivider.setDivisor(rate != 0 ? rate : 1);
+
+    // Frames such that frames / rate > size_t max / USEC_PER_SEC, saturated
+    uint64_t maxSeconds = numeric_limits<size_t>::max() / USEC_PER_SEC;
+    _maxFramesToUsec = (rate == 0 || maxSeconds >= numeric_limits<uint64_t>::max() / rate) ?
+            numeric_limits<uint64_t>::max() : (maxSeconds + 1) * rate - 1;
+}
+
+void SampleSpec::setChannelsPolicy(const ChannelsPolicy *channelsPolicy, uint32_t count)
+{
+    LOG_ALWAYS_FATAL_IF(count > _sampleSpec[ChannelCountSampleSpecItem]);
+
+    uint64_t packedPolicy = 0;
+    for (uint32_t channel = 0; channel < count; channel++) {
+
+        LOG_ALWAYS_FATAL_IF(channelsPolicy[channel] >= NbChannelsPolicy);
+        packedPolicy |= static_cast<uint64_t>(channelsPolicy[channel]) <<
+                (channel * CHANNELS_POLICY_BITS);
+    }
+    _channelsPolicy = packedPolicy;
+}
+
+void SampleSpec::setChannelsPolicy(uint64_t channelsPolicy)
+{
+    uint32_t bits = _sampleSpec[ChannelCountSampleSpecItem] * CHANNELS_POLICY_BITS;
+    LOG_ALWAYS_FATAL_IF(bits < 64 && (channelsPolicy >> bits) != 0);
     _channelsPolicy = channelsPolicy;
 }
 
 SampleSpec::ChannelsPolicy SampleSpec::getChannelsPolicy(uint32_t channelIndex) const
 {
-    LOG_ALWAYS_FATAL_IF(channelIndex >= _channelsPolicy.size());
-    return _channelsPolicy[channelIndex];
+    LOG_ALWAYS_FATAL_IF(channelIndex >= _sampleSpec[ChannelCountSampleSpecItem]);
+    uint64_t policy = _channelsPolicy >> (channelIndex * CHANNELS_POLICY_BITS);
+    return static_cast<ChannelsPolicy>(policy & ((1 << CHANNELS_POLICY_BITS) - 1));
+}
+
+size_t SampleSpec::hash() const
+{
+    // Mixes each field into the state with the 64 bits finalizer of MurmurHash3
+    uint64_t state = _channelsPolicy ^ (static_cast<uint64_t>(_channelMask) << 32);
+    for (int i = 0; i < NbSampleSpecItems; i++) {
+
+        state ^= _sampleSpec[i] + 0x9e3779b97f4a7c15ULL + (state << 6) + (state >> 2);
+        state ^= state >> 33;
+        state *= 0xff51afd7ed558ccdULL;
+        state ^= state >> 33;
+        state *= 0xc4ceb9fe1a85ec53ULL;
+        state ^= state >> 33;
+    }
+    return static_cast<size_t>(state ^ (state >> 32));
 }
 
 uint32_t SampleSpec::getSampleSpecItem(SampleSpecItem sampleSpecItem) const
@@ -94,35 +162,67 @@ uint32_t SampleSpec::getSampleSpecItem(SampleSpecItem sampleSpecItem) const
     return _sampleSpec[sampleSpecItem];
 }
 
-size_t SampleSpec::getFrameSize() const
+size_t SampleSpec::getBytesPerSample(uint32_t format)
 {
-    return audio_bytes_per_sample(getFormat()) * getChannelCount();
+    switch (format) {
+
+    case AUDIO_FORMAT_PCM_16_BIT:
+        return sizeof(int16_t);
+    case PCM_24_BIT_PACKED_FORMAT:
+        return 3;
+    case AUDIO_FORMAT_PCM_8_24_BIT:
+    case AUDIO_FORMAT_PCM_32_BIT:
+        return sizeof(int32_t);
+    case PCM_FLOAT_FORMAT:
+        return sizeof(float);
+    default:
+        return 0;
+    }
 }
 
 size_t SampleSpec::convertBytesToFrames(size_t bytes) const
 {
-    LOG_ALWAYS_FATAL_IF(getFrameSize() == 0);
-    return bytes / getFrameSize();
+    LOG_ALWAYS_FATAL_IF(_frameSize == 0);
+    return divide(bytes, _frameSizeDivider);
 }
 
 size_t SampleSpec::convertFramesToBytes(size_t frames) const
 {
-    LOG_ALWAYS_FATAL_IF(getFrameSize() == 0);
-    LOG_ALWAYS_FATAL_IF(frames > numeric_limits<size_t>::max() / getFrameSize());
-    return frames * getFrameSize();
+    LOG_ALWAYS_FATAL_IF(_frameSize == 0);
+    LOG_ALWAYS_FATAL_IF(frames > _maxFramesToBytes);
+    return frames * _frameSize;
 }
 
 size_t SampleSpec::convertFramesToUsec(uint32_t frames) const
 {
     LOG_ALWAYS_FATAL_IF(getSampleRate() == 0);
-    LOG_ALWAYS_FATAL_IF((frames / getSampleRate()) >
-                        (numeric_limits<size_t>::max() / USEC_PER_SEC));
-    return (USEC_PER_SEC * static_cast<uint64_t>(frames)) / getSampleRate();
+    LOG_ALWAYS_FATAL_IF(frames > _maxFramesToUsec);
+    return divide(static_cast<uint64_t>(frames) * _usecPerFramesNumerator,
+                  _usecPerFramesDivider);
 }
 
 size_t SampleSpec::convertUsecToframes(uint32_t intervalUsec) const
 {
-    return static_cast<uint64_t>(intervalUsec) * getSampleRate() / USEC_PER_SEC;
+    return divide(static_cast<uint64_t>(intervalUsec) * _framesPerUsecNumerator,
+                  _framesPerUsecDivider);
+}
+
+uint64_t SampleSpec::divideByRate(uint64_t value) const
+{
+    LOG_ALWAYS_FATAL_IF(getSampleRate() == 0);
+    return divide(value, _rateDivider);
+}
+
+bool SampleSpec::isCompatible(const SampleSpec &right) const
+{
+    for (int i = 0; i < NbSampleSpecItems; i++) {
+
+        if (!isSampleSpecItemEqual(static_cast<SampleSpecItem>(i), *this, right)) {
+
+            return false;
+        }
+    }
+    return true;
 }
 
 bool SampleSpec::isSampleSpecItemEqual(SampleSpecItem sampleSpecItem,
@@ -135,7 +235,15 @@ bool SampleSpec::isSampleSpecItemEqual(SampleSpecItem sampleSpecItem,
     }
 
     return ((sampleSpecItem != ChannelCountSampleSpecItem) ||
-            ssSrc.getChannelsPolicy() == ssDst.getChannelsPolicy());
+            ((ssSrc.getChannelsPolicy() == ssDst.getChannelsPolicy()) &&
+             isChannelMaskCompatible(ssSrc, ssDst)));
+}
+
+bool SampleSpec::isChannelMaskCompatible(const SampleSpec &ssSrc, const SampleSpec &ssDst)
+{
+    return (ssSrc.getChannelCount() <= 2) ||
+            (ssSrc.getChannelMask() == 0) || (ssDst.getChannelMask() == 0) ||
+            (ssSrc.getChannelMask() == ssDst.getChannelMask());
 }
 
 }; // namespace android
@@ -87,9 +87,10 @@ public:
      *
      * @param[in] format in HAL domain.
      *
-     * @return format in HAL domain, note that AUDIO_FORMAT_PCM_8_24_BIT of AudioHAL is mapped on
-     *              PCM_FORMAT_S32_LE of Tiny alsa. It returns PCM_FORMAT_S16_LE format in case of
-     *              unrecognized tiny alsa format.
+     * @return format in Tiny alsa domain, note that AUDIO_FORMAT_PCM_8_24_BIT and
+     *              AUDIO_FORMAT_PCM_32_BIT of AudioHAL are mapped on PCM_FORMAT_S32_LE of
+     *              Tiny alsa.
+     *              It returns PCM_FORMAT_MAX in case of HAL format without Tiny alsa counterpart.
      */
     static pcm_format convertHalToTinyFormat(audio_format_t format);
 
@@ -116,6 +117,15 @@ public:
      */
     static uint32_t convertUsecToMsec(uint32_t timeUsec);
 
+    /**
+     * Gets the latency of an audio device, ie the duration of its whole ring buffer.
+     *
+     * @param[in] config pcm configuration of the device.
+     *
+     * @return latency in microseconds.
+     */
+    static uint32_t getPcmLatencyUs(const pcm_config &config);
+
     /**
      * Checks the device is an input device.
      * This function works with AudioSystem REV1.0 API.
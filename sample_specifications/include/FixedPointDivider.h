@@ -0,0 +1,66 @@
+/*
+ **
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+#pragma once
+
+#include <stdint.h>
+
+namespace android_audio_legacy {
+
+/**
+ * Division of unsigned 32 bits integers by a constant divisor.
+ * The divisor is turned once into a fixed point reciprocal, so that each division becomes a
+ * multiplication, an addition and shifts (see Granlund and Montgomery, "Division by invariant
+ * integers using multiplication", figure 4.1). Quotients are exact for any dividend.
+ */
+class FixedPointDivider {
+
+public:
+    /**
+     * @param[in] divisor divisor, must not be null.
+     */
+    explicit FixedPointDivider(uint32_t divisor = 1);
+
+    /**
+     * Changes the divisor.
+     *
+     * @param[in] divisor divisor, must not be null.
+     */
+    void setDivisor(uint32_t divisor);
+
+    uint32_t getDivisor() const { return _divisor; }
+
+    /**
+     * Divides by the divisor.
+     *
+     * @param[in] dividend value to divide.
+     *
+     * @return quotient, rounded down.
+     */
+    uint32_t divide(uint32_t dividend) const
+    {
+        uint32_t high = (static_cast<uint64_t>(dividend) * _multiplier) >> 32;
+        return (high + ((dividend - high) >> _preShift)) >> _postShift;
+    }
+
+private:
+    uint32_t _divisor;
+    uint32_t _multiplier; /**< Low 32 bits of the 33 bits reciprocal. */
+    uint8_t _preShift; /**< 1, or 0 if the divisor is 1. */
+    uint8_t _postShift; /**< Rounded up log2 of the divisor, minus the pre shift. */
+};
+
+}; // namespace android
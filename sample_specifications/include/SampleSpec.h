@@ -16,8 +16,9 @@
  */
 #pragma once
 
+#include "FixedPointDivider.h"
+#include <stdint.h>
 #include <string.h>
-#include <vector>
 
 #include <tinyalsa/asoundlib.h>
 #include <system/audio.h>
@@ -41,10 +42,14 @@ enum SampleSpecItem {
 class SampleSpec {
 
 public:
+    /**
+     * Checks upon strict equality, channel mask included, so that it may compare keys.
+     * See isCompatible to check if a conversion is required.
+     */
     bool operator==(const SampleSpec &right) const {
 
         return !memcmp(_sampleSpec, right._sampleSpec, sizeof(_sampleSpec)) &&
-                (_channelsPolicy == right._channelsPolicy);
+                (_channelsPolicy == right._channelsPolicy) && (_channelMask == right._channelMask);
     }
 
     bool operator!=(const SampleSpec &right) const {
@@ -73,14 +78,34 @@ public:
         NbChannelsPolicy
     };
 
+    static const uint32_t MAX_CHANNELS = 32; /**< supports until 32 channels. */
+
+    static const uint32_t CHANNELS_POLICY_BITS = 2; /**< Bits of a packed channel policy. */
+
+    /**
+     * PCM formats not defined by the platform audio_format_t yet.
+     * Values follow the PCM sub formats numbering of the later platform releases.
+     * As they are not part of the enumeration, switch on these formats as integers.
+     */
+    static const audio_format_t PCM_FLOAT_FORMAT =
+            static_cast<audio_format_t>(AUDIO_FORMAT_PCM | 0x5); /**< float in [-1.0, 1.0]. */
+    static const audio_format_t PCM_24_BIT_PACKED_FORMAT =
+            static_cast<audio_format_t>(AUDIO_FORMAT_PCM | 0x6); /**< 24 bits on 3 bytes. */
+
     SampleSpec(uint32_t channel = DEFAULT_CHANNELS,
                uint32_t format = DEFAULT_FORMAT,
                uint32_t rate = DEFAULT_RATE);
 
+    /**
+     * @param[in] channel number of channels.
+     * @param[in] format sample format.
+     * @param[in] rate sample rate.
+     * @param[in] channelsPolicy policy of each channel, channel number entries.
+     */
     SampleSpec(uint32_t channel,
                uint32_t format,
                uint32_t rate,
-               const std::vector<ChannelsPolicy> &channelsPolicy);
+               const ChannelsPolicy *channelsPolicy);
 
     // Specific Accessors
     void setChannelCount(uint32_t channelCount) {
@@ -101,16 +126,55 @@ public:
     void setChannelMask(uint32_t channelMask) { _channelMask = channelMask; }
     uint32_t getChannelMask() const { return _channelMask; }
 
-    void setChannelsPolicy(const std::vector<ChannelsPolicy> &channelsPolicy);
-    const std::vector<ChannelsPolicy>& getChannelsPolicy() const { return _channelsPolicy; }
+    /**
+     * Sets the policy of the channels.
+     *
+     * @param[in] channelsPolicy policy of each channel.
+     * @param[in] count number of policies given, at most the number of channels. Channels
+     *                  above are set to Copy.
+     */
+    void setChannelsPolicy(const ChannelsPolicy *channelsPolicy, uint32_t count);
+
+    /**
+     * Sets the policy of the channels from a packed field, see getChannelsPolicy.
+     *
+     * @param[in] channelsPolicy packed channels policy, no policy above the channel number.
+     */
+    void setChannelsPolicy(uint64_t channelsPolicy);
+
+    /**
+     * Gets the policy of all the channels, packed on CHANNELS_POLICY_BITS per channel, first
+     * channel in the lowest bits. Channels above the channel number are Copy.
+     *
+     * @return packed channels policy.
+     */
+    uint64_t getChannelsPolicy() const { return _channelsPolicy; }
+
     ChannelsPolicy getChannelsPolicy(uint32_t channelIndex) const;
 
+    /**
+     * Hashes the sample specifications, consistently with operator==.
+     *
+     * @return hash value.
+     */
+    size_t hash() const;
+
     // Generic Accessor
     void setSampleSpecItem(SampleSpecItem sampleSpecItem, uint32_t value);
 
     uint32_t getSampleSpecItem(SampleSpecItem sampleSpecItem) const;
 
-    size_t getFrameSize() const;
+    size_t getFrameSize() const { return _frameSize; }
+
+    /**
+     * Gets the size of a sample.
+     * Unlike audio_bytes_per_sample, it knows the formats the platform does not define yet.
+     *
+     * @param[in] format sample format.
+     *
+     * @return size of a sample in bytes, 0 if the format is not supported.
+     */
+    static size_t getBytesPerSample(uint32_t format);
 
     /**
      * Converts the bytes number to frames number.
@@ -155,15 +219,37 @@ public:
      */
     size_t convertUsecToframes(uint32_t intervalUsec) const;
 
+    /**
+     * Divides by the sample rate, without any division for quotients computed on 32 bits.
+     *
+     * @param[in] value value to divide.
+     *
+     * @return value divided by the sample rate, rounded down.
+     */
+    uint64_t divideByRate(uint64_t value) const;
+
     bool isMono() const { return _sampleSpec[ChannelCountSampleSpecItem] == 1; }
 
     bool isStereo() const { return _sampleSpec[ChannelCountSampleSpecItem] == 2; }
 
+    /**
+     * Checks if frames of the sample specifications may be given as is to the other, ie if no
+     * conversion is required between them: all items are equal, see isSampleSpecItemEqual.
+     * As a null channel mask is compatible with any mask, it is not transitive: unlike
+     * operator==, it must not compare keys.
+     *
+     * @param[in] right sample specifications to check against.
+     *
+     * @return true if no conversion is required, false otherwise.
+     */
+    bool isCompatible(const SampleSpec &right) const;
+
     /**
      * Checks upon equality of a sample spec item.
      *  For channels, it checks:
      *          -not only that channels count is equal
-     *          -but also the channels policy of source and destination is the same.
+     *          -but also the channels policy of source and destination is the same
+     *          -and that the channel masks are compatible, see isChannelMaskCompatible.
      * @param[in] sampleSpecItem item to checks.
      * @param[in] ssSrc source sample specifications.
      * @param[in] ssDst destination sample specifications.
@@ -175,6 +261,18 @@ public:
                                       const SampleSpec &ssDst);
 
 private:
+    /**
+     * Checks upon compatibility of the channel masks.
+     * Masks only tell the position of the channels above stereo, where they drive the remap
+     * matrix. A null mask, ie unknown layout, is compatible with any mask.
+     *
+     * @param[in] ssSrc source sample specifications.
+     * @param[in] ssDst destination sample specifications.
+     *
+     * @return true if masks are equal, or not relevant, false otherwise.
+     */
+    static bool isChannelMaskCompatible(const SampleSpec &ssSrc, const SampleSpec &ssDst);
+
     /**
      * Initialise the sample specifications.
      * Parts of the private constructor. It sets the basic fields, reset the channel mask to 0,
@@ -186,6 +284,29 @@ private:
      */
     void init(uint32_t channel, uint32_t format, uint32_t rate);
 
+    /**
+     * Computes again the factors cached for the conversions once a sample spec item changed.
+     * Conversions between frames, bytes and time are called several times per read or write,
+     * so that the frame size and the time ratios are reduced here into multiplications by
+     * fixed point reciprocals.
+     */
+    void updateFactors();
+
+    /**
+     * Divides a 64 bits value, using the reciprocal of the divisor if the value fits on
+     * 32 bits.
+     *
+     * @param[in] value value to divide.
+     * @param[in] divider divider holding the divisor.
+     *
+     * @return quotient, rounded down.
+     */
+    static uint64_t divide(uint64_t value, const FixedPointDivider &divider)
+    {
+        return (value >> 32) == 0 ? divider.divide(static_cast<uint32_t>(value)) :
+                value / divider.getDivisor();
+    }
+
     uint32_t _sampleSpec[NbSampleSpecItems]; /**< Array of sample spec items:
                                                         -channel number
                                                         -format
@@ -193,13 +314,32 @@ private:
 
     uint32_t _channelMask; /**< Bit field that defines the channels used. */
 
-    std::vector<ChannelsPolicy> _channelsPolicy; /**< channels policy array. */
+    uint64_t _channelsPolicy; /**< Packed channels policy, see getChannelsPolicy. */
+
+    size_t _frameSize; /**< Size of a frame in bytes, 0 if the format is not supported. */
+    size_t _maxFramesToBytes; /**< Frames above would overflow once converted in bytes. */
+    FixedPointDivider _frameSizeDivider; /**< Divides by the frame size. */
+
+    /**
+     * Frames to time ratio, ie microseconds per second over the rate, reduced by their GCD.
+     * Time is the frames multiplied by the numerator, divided by the denominator.
+     */
+    uint32_t _usecPerFramesNumerator;
+    FixedPointDivider _usecPerFramesDivider; /**< Divides by the denominator of the ratio. */
+
+    /**
+     * Time to frames ratio, ie the inverse of the frames to time ratio.
+     */
+    uint32_t _framesPerUsecNumerator;
+    FixedPointDivider _framesPerUsecDivider; /**< Divides by the denominator of the ratio. */
+
+    FixedPointDivider _rateDivider; /**< Divides by the rate. */
+    uint64_t _maxFramesToUsec; /**< Frames above would overflow once converted in time. */
 
     static const uint32_t USEC_PER_SEC = 1000000; /**<  to convert sec to-from microseconds. */
     static const uint32_t DEFAULT_CHANNELS = 2; /**< default channel used is stereo. */
     static const uint32_t DEFAULT_FORMAT = AUDIO_FORMAT_PCM_16_BIT; /**< default format is 16bits.*/
     static const uint32_t DEFAULT_RATE = 48000; /**< default rate is 48 kHz. */
-    static const uint32_t MAX_CHANNELS = 32; /**< supports until 32 channels. */
 };
 
 }; // namespace android
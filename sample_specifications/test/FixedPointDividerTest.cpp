@@ -0,0 +1,279 @@
+/*
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+/**
+ * Host tests of the fixed point divisions of the sample specifications.
+ * Every conversion is checked bit exact against the plain division it replaced, over the rates,
+ * channels count and formats the audio conversion supports.
+ */
+
+#include "AudioUtils.h"
+#include "FixedPointDivider.h"
+#include "SampleSpec.h"
+#include <gtest/gtest.h>
+#include <sys/types.h>
+#include <limits>
+#include <vector>
+
+using namespace android_audio_legacy;
+using std::numeric_limits;
+using std::vector;
+
+namespace
+{
+
+const uint32_t rates[] = {
+
+    8000, 11025, 12000, 16000, 22050, 24000, 32000, 44100, 48000, 64000, 88200, 96000, 176400,
+    192000
+};
+
+const size_t nbRates = sizeof(rates) / sizeof(rates[0]);
+
+const uint32_t formats[] = {
+
+    AUDIO_FORMAT_PCM_16_BIT, AUDIO_FORMAT_PCM_8_24_BIT, AUDIO_FORMAT_PCM_32_BIT,
+    SampleSpec::PCM_FLOAT_FORMAT, SampleSpec::PCM_24_BIT_PACKED_FORMAT
+};
+
+const size_t nbFormats = sizeof(formats) / sizeof(formats[0]);
+
+const uint32_t usecPerSec = 1000000;
+
+/** Every value up to this one is checked, larger values are sampled. */
+const uint32_t exhaustiveValues = 1 << 16;
+
+/** Number of random values checked beyond the exhaustive range. */
+const uint32_t randomValues = 4096;
+
+/**
+ * Random generator with a fixed seed, so that any failure is reproduced.
+ */
+class Random
+{
+public:
+    Random() : _state(0x2545F491) {}
+
+    uint32_t next()
+    {
+        _state ^= _state << 13;
+        _state ^= _state >> 17;
+        _state ^= _state << 5;
+        return _state;
+    }
+
+private:
+    uint32_t _state;
+};
+
+/**
+ * Lists the values to divide by a divisor: every small value, values around the multiples of
+ * the divisor close to the 32 bits limit, and random values.
+ *
+ * @param[in] divisor divisor the values are chosen for.
+ * @param[out] values values to divide.
+ */
+void listDividends(uint32_t divisor, vector<uint32_t> &values)
+{
+    values.clear();
+    for (uint32_t value = 0; value <= exhaustiveValues; value++) {
+
+        values.push_back(value);
+    }
+    uint32_t lastMultiple = numeric_limits<uint32_t>::max() / divisor;
+    for (uint32_t multiple = lastMultiple; multiple > 0 && multiple + 16 > lastMultiple;
+         multiple--) {
+
+        uint32_t product = multiple * divisor;
+        values.push_back(product - 1);
+        values.push_back(product);
+        if (multiple != lastMultiple || product != numeric_limits<uint32_t>::max()) {
+
+            values.push_back(product + 1);
+        }
+    }
+    values.push_back(numeric_limits<uint32_t>::max());
+
+    Random random;
+    for (uint32_t i = 0; i < randomValues; i++) {
+
+        values.push_back(random.next());
+    }
+}
+
+/**
+ * Lists the divisors of the conversions: frame sizes and rates of the table, and the
+ * denominators of the reduced ratios between frames and time.
+ *
+ * @param[out] divisors divisors, edge divisors included.
+ */
+void listDivisors(vector<uint32_t> &divisors)
+{
+    static const uint32_t edgeDivisors[] = {
+
+        1, 2, 3, 5, 7, 641, 0x7FFFFFFF, 0x80000000, 0x80000001, 0xFFFFFFFF
+    };
+    divisors.assign(edgeDivisors, edgeDivisors + sizeof(edgeDivisors) / sizeof(edgeDivisors[0]));
+
+    for (size_t format = 0; format < nbFormats; format++) {
+
+        for (uint32_t channels = 1; channels <= SampleSpec::MAX_CHANNELS; channels++) {
+
+            divisors.push_back(SampleSpec::getBytesPerSample(formats[format]) * channels);
+        }
+    }
+    for (size_t rate = 0; rate < nbRates; rate++) {
+
+        uint32_t gcd = usecPerSec;
+        uint32_t remainder = rates[rate];
+        while (remainder != 0) {
+
+            uint32_t next = gcd % remainder;
+            gcd = remainder;
+            remainder = next;
+        }
+        divisors.push_back(rates[rate]);
+        divisors.push_back(rates[rate] / gcd);
+        divisors.push_back(usecPerSec / gcd);
+    }
+}
+
+}
+
+TEST(FixedPointDivider, quotientsMatchDivision)
+{
+    vector<uint32_t> divisors;
+    vector<uint32_t> values;
+    listDivisors(divisors);
+
+    for (size_t i = 0; i < divisors.size(); i++) {
+
+        FixedPointDivider divider(divisors[i]);
+        ASSERT_EQ(divisors[i], divider.getDivisor());
+        listDividends(divisors[i], values);
+
+        for (size_t j = 0; j < values.size(); j++) {
+
+            ASSERT_EQ(values[j] / divisors[i], divider.divide(values[j]))
+                << values[j] << " / " << divisors[i];
+        }
+    }
+}
+
+TEST(FixedPointDivider, setDivisorReplacesReciprocal)
+{
+    FixedPointDivider divider;
+    EXPECT_EQ(1u, divider.getDivisor());
+    EXPECT_EQ(numeric_limits<uint32_t>::max(), divider.divide(numeric_limits<uint32_t>::max()));
+
+    divider.setDivisor(44100);
+    EXPECT_EQ(44100u, divider.getDivisor());
+    EXPECT_EQ(numeric_limits<uint32_t>::max() / 44100,
+              divider.divide(numeric_limits<uint32_t>::max()));
+
+    divider.setDivisor(6);
+    EXPECT_EQ(numeric_limits<uint32_t>::max() / 6,
+              divider.divide(numeric_limits<uint32_t>::max()));
+}
+
+TEST(SampleSpec, bytesAndFramesMatchDivision)
+{
+    vector<uint32_t> values;
+
+    for (size_t format = 0; format < nbFormats; format++) {
+
+        for (uint32_t channels = 1; channels <= SampleSpec::MAX_CHANNELS; channels++) {
+
+            SampleSpec ss(channels, formats[format], 48000);
+            size_t frameSize = SampleSpec::getBytesPerSample(formats[format]) * channels;
+            ASSERT_EQ(frameSize, ss.getFrameSize());
+            listDividends(frameSize, values);
+
+            for (size_t i = 0; i < values.size(); i++) {
+
+                ASSERT_EQ(values[i] / frameSize, ss.convertBytesToFrames(values[i]))
+                    << values[i] << " bytes, " << channels << " channels, format "
+                    << formats[format];
+                if (values[i] <= numeric_limits<size_t>::max() / frameSize) {
+
+                    ASSERT_EQ(values[i] * frameSize, ss.convertFramesToBytes(values[i]));
+                }
+            }
+            // Above 32 bits, the plain division is taken
+            if (sizeof(size_t) > sizeof(uint32_t)) {
+
+                size_t bytes = static_cast<size_t>(numeric_limits<uint32_t>::max()) * 3 + 1;
+                EXPECT_EQ(bytes / frameSize, ss.convertBytesToFrames(bytes));
+            }
+        }
+    }
+}
+
+TEST(SampleSpec, timeAndFramesMatchDivision)
+{
+    vector<uint32_t> values;
+
+    for (size_t rate = 0; rate < nbRates; rate++) {
+
+        for (uint32_t channels = 1; channels <= SampleSpec::MAX_CHANNELS; channels *= 2) {
+
+            SampleSpec ss(channels, AUDIO_FORMAT_PCM_16_BIT, rates[rate]);
+            listDividends(rates[rate], values);
+
+            for (size_t i = 0; i < values.size(); i++) {
+
+                uint64_t frames = values[i];
+                if (frames / rates[rate] <= numeric_limits<size_t>::max() / usecPerSec) {
+
+                    ASSERT_EQ((usecPerSec * frames) / rates[rate],
+                              ss.convertFramesToUsec(values[i]))
+                        << values[i] << " frames at " << rates[rate];
+                }
+                ASSERT_EQ(static_cast<uint64_t>(values[i]) * rates[rate] / usecPerSec,
+                          ss.convertUsecToframes(values[i]))
+                    << values[i] << " us at " << rates[rate];
+            }
+        }
+    }
+}
+
+TEST(AudioUtils, srcToDstFramesMatchDivision)
+{
+    vector<uint32_t> values;
+
+    for (size_t src = 0; src < nbRates; src++) {
+
+        SampleSpec ssSrc(2, AUDIO_FORMAT_PCM_16_BIT, rates[src]);
+        listDividends(rates[src], values);
+
+        for (size_t dst = 0; dst < nbRates; dst++) {
+
+            SampleSpec ssDst(1, AUDIO_FORMAT_PCM_16_BIT, rates[dst]);
+
+            for (size_t i = 0; i < values.size(); i++) {
+
+                uint64_t expected = (static_cast<uint64_t>(values[i]) * rates[dst] +
+                                     rates[src] - 1) / rates[src];
+                if (expected > static_cast<uint64_t>(numeric_limits<ssize_t>::max())) {
+
+                    continue;
+                }
+                ASSERT_EQ(expected, AudioUtils::convertSrcToDstInFrames(values[i], ssSrc, ssDst))
+                    << values[i] << " frames from " << rates[src] << " to " << rates[dst];
+            }
+        }
+    }
+}
@@ -0,0 +1,150 @@
+/*
+ ** Copyright 2013 Intel Corporation
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **      http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+/**
+ * Host tests of the comparisons of the sample specifications: operator== is a strict
+ * equivalence that may compare keys, isCompatible tells if a conversion is required.
+ */
+
+#include "SampleSpec.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace android_audio_legacy;
+using std::vector;
+
+namespace
+{
+
+/** Layouts of 4 channels, the null mask being the unknown layout. */
+const uint32_t quadMasks[] = {
+
+    0,
+    AUDIO_CHANNEL_OUT_QUAD,
+    AUDIO_CHANNEL_OUT_STEREO | AUDIO_CHANNEL_OUT_FRONT_CENTER | AUDIO_CHANNEL_OUT_LOW_FREQUENCY
+};
+
+const size_t nbQuadMasks = sizeof(quadMasks) / sizeof(quadMasks[0]);
+
+SampleSpec makeSampleSpec(uint32_t channels, uint32_t channelMask)
+{
+    SampleSpec ss(channels, AUDIO_FORMAT_PCM_16_BIT, 48000);
+    ss.setChannelMask(channelMask);
+    return ss;
+}
+
+/**
+ * Lists sample specifications that only differ by their channels: masks of 4 channels, masks
+ * up to stereo and channels policies.
+ *
+ * @param[out] sampleSpecs sample specifications, each one listed twice.
+ */
+void listSampleSpecs(vector<SampleSpec> &sampleSpecs)
+{
+    static const SampleSpec::ChannelsPolicy ignoreRight[] = {
+
+        SampleSpec::Copy, SampleSpec::Ignore
+    };
+    sampleSpecs.clear();
+    for (int copy = 0; copy < 2; copy++) {
+
+        for (size_t mask = 0; mask < nbQuadMasks; mask++) {
+
+            sampleSpecs.push_back(makeSampleSpec(4, quadMasks[mask]));
+        }
+        sampleSpecs.push_back(makeSampleSpec(2, 0));
+        sampleSpecs.push_back(makeSampleSpec(2, AUDIO_CHANNEL_OUT_STEREO));
+        sampleSpecs.push_back(SampleSpec(2, AUDIO_FORMAT_PCM_16_BIT, 48000, ignoreRight));
+    }
+}
+
+}
+
+TEST(SampleSpec, equalityIsStrictOnChannelMask)
+{
+    SampleSpec unknownLayout = makeSampleSpec(4, 0);
+    SampleSpec quad = makeSampleSpec(4, quadMasks[1]);
+    SampleSpec otherQuad = makeSampleSpec(4, quadMasks[2]);
+
+    EXPECT_FALSE(unknownLayout == quad);
+    EXPECT_TRUE(unknownLayout != quad);
+    EXPECT_FALSE(quad == otherQuad);
+    EXPECT_TRUE(quad == makeSampleSpec(4, quadMasks[1]));
+
+    // Up to stereo, masks do not drive any conversion but are still part of the equality
+    EXPECT_FALSE(makeSampleSpec(2, 0) == makeSampleSpec(2, AUDIO_CHANNEL_OUT_STEREO));
+}
+
+TEST(SampleSpec, unknownLayoutIsCompatibleWithAnyLayout)
+{
+    SampleSpec unknownLayout = makeSampleSpec(4, 0);
+    SampleSpec quad = makeSampleSpec(4, quadMasks[1]);
+    SampleSpec otherQuad = makeSampleSpec(4, quadMasks[2]);
+
+    EXPECT_TRUE(unknownLayout.isCompatible(quad));
+    EXPECT_TRUE(quad.isCompatible(unknownLayout));
+    EXPECT_TRUE(unknownLayout.isCompatible(otherQuad));
+    EXPECT_FALSE(quad.isCompatible(otherQuad));
+    EXPECT_TRUE(makeSampleSpec(2, 0).isCompatible(makeSampleSpec(2, AUDIO_CHANNEL_OUT_STEREO)));
+
+    // Other items and channels policies must still be equal
+    EXPECT_FALSE(unknownLayout.isCompatible(makeSampleSpec(2, 0)));
+    SampleSpec otherRate = quad;
+    otherRate.setSampleRate(44100);
+    EXPECT_FALSE(quad.isCompatible(otherRate));
+    static const SampleSpec::ChannelsPolicy averageFirst[] = {
+
+        SampleSpec::Average, SampleSpec::Copy, SampleSpec::Copy, SampleSpec::Copy
+    };
+    SampleSpec otherPolicy = quad;
+    otherPolicy.setChannelsPolicy(averageFirst, 4);
+    EXPECT_FALSE(quad.isCompatible(otherPolicy));
+}
+
+TEST(SampleSpec, equalityIsAnEquivalence)
+{
+    vector<SampleSpec> sampleSpecs;
+    listSampleSpecs(sampleSpecs);
+
+    for (size_t a = 0; a < sampleSpecs.size(); a++) {
+
+        const SampleSpec &ssA = sampleSpecs[a];
+        EXPECT_TRUE(ssA == ssA) << a;
+        EXPECT_TRUE(ssA.isCompatible(ssA)) << a;
+
+        for (size_t b = 0; b < sampleSpecs.size(); b++) {
+
+            const SampleSpec &ssB = sampleSpecs[b];
+            EXPECT_EQ(ssA == ssB, ssB == ssA) << a << ", " << b;
+            EXPECT_EQ(ssA == ssB, !(ssA != ssB)) << a << ", " << b;
+            EXPECT_EQ(ssA.isCompatible(ssB), ssB.isCompatible(ssA)) << a << ", " << b;
+            if (ssA == ssB) {
+
+                EXPECT_EQ(ssA.hash(), ssB.hash()) << a << ", " << b;
+                EXPECT_TRUE(ssA.isCompatible(ssB)) << a << ", " << b;
+            }
+
+            for (size_t c = 0; c < sampleSpecs.size(); c++) {
+
+                const SampleSpec &ssC = sampleSpecs[c];
+                if (ssA == ssB && ssB == ssC) {
+
+                    EXPECT_TRUE(ssA == ssC) << a << ", " << b << ", " << c;
+                }
+            }
+        }
+    }
+}